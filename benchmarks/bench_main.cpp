@@ -0,0 +1,524 @@
+// Google Benchmark suite for the simulator's hot paths.
+//
+//   ./StatArbBench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// Synthetic data follows scripts/generate_sample_data.py: weekday dates from
+// 2020-01-01, pairs A<i>/B<i> where A is a geometric random walk from 100 and
+// B = coef * A + AR(1) noise, plus one independent walk C1.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetPair.h"
+#include "Backtester.h"
+#include "BasketScanner.h"
+#include "CostModel.h"
+#include "LiveTrader.h"
+#include "MarketData.h"
+#include "PairScanner.h"
+#include "SpscQueue.h"
+#include "Timestamps.h"
+#include "Utilities.h"
+
+namespace {
+
+std::vector<double> randomWalk(std::mt19937& rng, size_t n, double drift = 0.0001,
+                               double volatility = 0.01) {
+    std::normal_distribution<double> step(drift, volatility);
+    std::vector<double> path(n);
+    double price = 100.0;
+    for (size_t i = 0; i < n; ++i) {
+        price *= 1.0 + step(rng);
+        path[i] = price;
+    }
+    return path;
+}
+
+std::vector<double> cointegratedWith(std::mt19937& rng, const std::vector<double>& base,
+                                     double coef, double noiseVol = 0.005,
+                                     double persistence = 0.9) {
+    std::normal_distribution<double> noise(0.0, noiseVol);
+    std::vector<double> series(base.size());
+    double error = 0.0;
+    double minValue = 0.0;
+    for (size_t i = 0; i < base.size(); ++i) {
+        if (i > 0) error = persistence * error + noise(rng);
+        series[i] = coef * base[i] + error;
+        minValue = std::min(minValue, series[i]);
+    }
+    if (minValue <= 0) {
+        for (double& v : series) v = v - minValue + 1.0;
+    }
+    return series;
+}
+
+// Weekday dates from 2020-01-01 (a Wednesday), formatted YYYY-MM-DD
+std::vector<std::string> tradingDates(size_t n) {
+    static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    std::vector<std::string> dates;
+    dates.reserve(n);
+    int year = 2020, month = 0, day = 1, weekday = 2;
+    // Room for three full-range ints, so the format can never truncate
+    char buffer[3 * 11 + 3];
+    while (dates.size() < n) {
+        if (weekday < 5) {
+            std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month + 1, day);
+            dates.emplace_back(buffer);
+        }
+        weekday = (weekday + 1) % 7;
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        int monthLength = daysInMonth[month] + ((month == 1 && leap) ? 1 : 0);
+        if (++day > monthLength) {
+            day = 1;
+            if (++month == 12) {
+                month = 0;
+                ++year;
+            }
+        }
+    }
+    return dates;
+}
+
+// Write a sample-data CSV with numPairs pairs plus C1, leaving each cell empty
+// with probability missingPerMille / 1000; returns its path
+std::string writeSampleCSV(size_t numDays, size_t numPairs, size_t missingPerMille = 0) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("statarb_bench_" + std::to_string(numDays) + "_" +
+                         std::to_string(numPairs) +
+                         (missingPerMille ? "_gaps" + std::to_string(missingPerMille) : "") +
+                         ".csv")).string();
+    if (std::filesystem::exists(path)) {
+        return path;
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coefs(0.5, 1.5);
+    std::vector<std::vector<double>> columns;
+    std::ofstream file(path);
+    file << "Date";
+    for (size_t p = 0; p < numPairs; ++p) {
+        file << ",A" << (p + 1) << ",B" << (p + 1);
+        columns.push_back(randomWalk(rng, numDays));
+        columns.push_back(cointegratedWith(rng, columns.back(), coefs(rng)));
+    }
+    file << ",C1\n";
+    columns.push_back(randomWalk(rng, numDays, 0.0003, 0.015));
+
+    auto dates = tradingDates(numDays);
+    std::uniform_int_distribution<size_t> cell(0, 999);
+    for (size_t t = 0; t < numDays; ++t) {
+        file << dates[t];
+        for (const auto& column : columns) {
+            file << ',';
+            if (cell(rng) >= missingPerMille) {
+                file << column[t];
+            }
+        }
+        file << '\n';
+    }
+    return path;
+}
+
+std::shared_ptr<MarketData> loadSample(size_t numDays, size_t numPairs, size_t missingPerMille = 0) {
+    auto data = std::make_shared<MarketData>();
+    data->loadFromCSV(writeSampleCSV(numDays, numPairs, missingPerMille), 1);
+    return data;
+}
+
+std::vector<double> spreadSeries(size_t n) {
+    std::mt19937 rng(7);
+    auto base = randomWalk(rng, n);
+    auto other = cointegratedWith(rng, base, 0.8);
+    for (size_t i = 0; i < n; ++i) other[i] -= 0.8 * base[i];
+    return other;
+}
+
+// ---- Utilities -------------------------------------------------------------
+
+void BM_RollingMean(benchmark::State& state) {
+    auto data = spreadSeries(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Utilities::rollingMean(data, state.range(1)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RollingMean)->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {20, 252}});
+
+void BM_RollingStdDev(benchmark::State& state) {
+    auto data = spreadSeries(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Utilities::rollingStdDev(data, state.range(1)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RollingStdDev)->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {20, 252}});
+
+void BM_RollingZScore(benchmark::State& state) {
+    auto data = spreadSeries(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Utilities::rollingZScore(data, state.range(1)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RollingZScore)->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {20, 252}});
+
+void BM_LinearRegression(benchmark::State& state) {
+    std::mt19937 rng(3);
+    auto x = randomWalk(rng, state.range(0));
+    auto y = cointegratedWith(rng, x, 1.2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Utilities::linearRegression(x, y));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LinearRegression)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+void BM_AdfTest(benchmark::State& state) {
+    auto data = spreadSeries(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Utilities::adfTest(data, static_cast<int>(state.range(1))));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AdfTest)->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {0, 1, 4}});
+
+void BM_AdfTestBatch(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const size_t lanes = Utilities::kAdfBatchLanes;
+    auto data = spreadSeries(n);
+    std::vector<double> interleaved(n * lanes);
+    for (size_t t = 0; t < n; ++t) {
+        for (size_t l = 0; l < lanes; ++l) interleaved[t * lanes + l] = data[t] * (1.0 + 0.1 * l);
+    }
+    Utilities::AdfResult results[Utilities::kAdfBatchLanes];
+    for (auto _ : state) {
+        Utilities::adfTestBatch(interleaved.data(), n, lanes, results, 1);
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * n * lanes);
+}
+BENCHMARK(BM_AdfTestBatch)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+// ---- MarketData ------------------------------------------------------------
+
+void BM_LoadFromCSV(benchmark::State& state) {
+    std::string path = writeSampleCSV(state.range(0), state.range(1));
+    for (auto _ : state) {
+        MarketData data;
+        benchmark::DoNotOptimize(data.loadFromCSV(path, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * (2 * state.range(1) + 1));
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+}
+BENCHMARK(BM_LoadFromCSV)->ArgsProduct({{2520, 25200}, {5, 50}})->Unit(benchmark::kMillisecond);
+
+// Daily bars to weekly (range(2) = 7) or two-day bars in one pass over the store
+void BM_Resample(benchmark::State& state) {
+    auto data = loadSample(state.range(0), state.range(1));
+    const int64_t interval = state.range(2) * Timestamps::kNanosPerDay;
+    for (auto _ : state) {
+        MarketData coarse = data->resample(interval);
+        benchmark::DoNotOptimize(coarse.getPrices(0).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * (2 * state.range(1) + 1));
+}
+BENCHMARK(BM_Resample)->ArgsProduct({{2520, 25200}, {5, 50}, {2, 7}})->Unit(benchmark::kMillisecond);
+
+// ---- AssetPair -------------------------------------------------------------
+
+void BM_GenerateSignals(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 1);
+    AssetPair pair("A1", "B1", *data->getPriceSeries("A1"), *data->getPriceSeries("B1"));
+    pair.testCointegration();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pair.generateSignals(1.5, 0.0, state.range(1)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GenerateSignals)->ArgsProduct({{2520, 25200, 252000}, {20, 252}});
+
+void BM_ComputeSignalsInPlace(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 1);
+    AssetPair pair("A1", "B1", *data->getPriceSeries("A1"), *data->getPriceSeries("B1"));
+    pair.testCointegration();
+    std::vector<AssetPair::Signal> signals(state.range(0));
+    for (auto _ : state) {
+        pair.computeSignals(1.5, 0.0, state.range(1), signals.data());
+        benchmark::DoNotOptimize(signals.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComputeSignalsInPlace)->ArgsProduct({{2520, 25200, 252000}, {20, 252}});
+
+// Threshold state machine alone, as evaluated per grid point by the sweep
+void BM_SignalsFromZScores(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 1);
+    AssetPair pair("A1", "B1", *data->getPriceSeries("A1"), *data->getPriceSeries("B1"));
+    pair.testCointegration();
+    std::vector<double> zScores(state.range(0));
+    pair.computeSignals(0.0, 0.0, 20, nullptr, zScores.data());
+    std::vector<AssetPair::Signal> signals(state.range(0));
+    for (auto _ : state) {
+        AssetPair::signalsFromZScores(zScores.data(), zScores.size(), 1.5, 0.0, signals.data());
+        benchmark::DoNotOptimize(signals.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SignalsFromZScores)->Arg(25200)->Arg(252000);
+
+// ---- Screening and backtesting ---------------------------------------------
+
+// Third argument: correlation prefilter top-K (0 = every pair)
+void BM_PairScan(benchmark::State& state) {
+    auto data = loadSample(state.range(0), state.range(1));
+    PairScanner::Options options;
+    options.numThreads = 1;
+    options.topK = state.range(2);
+    PairScanner scanner(data, options);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner.scan());
+    }
+    state.SetItemsProcessed(state.iterations() * scanner.getPairsTested());
+}
+BENCHMARK(BM_PairScan)->ArgsProduct({{2520}, {5, 25, 50}, {0, 5}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Second argument: prescreen prefix bars (0 = single full-length ADF)
+void BM_PairScanStaged(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 50);
+    PairScanner::Options options;
+    options.numThreads = 1;
+    options.prescreenBars = state.range(1);
+    PairScanner scanner(data, options);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner.scan());
+    }
+    state.counters["pruned"] = static_cast<double>(scanner.getPairsPruned());
+    state.SetItemsProcessed(state.iterations() * scanner.getPairsTested());
+}
+BENCHMARK(BM_PairScanStaged)->ArgsProduct({{25200}, {0, 2520}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Second argument: missing cells per mille, third: fill policy (0 = Drop, 1 = ForwardFill).
+// With gaps every pair leaves the cached-sum and batched-ADF path for its aligned bars.
+void BM_PairScanGaps(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 25, state.range(1));
+    data->setFillPolicy(state.range(2) ? MarketData::FillPolicy::ForwardFill : MarketData::FillPolicy::Drop);
+    PairScanner::Options options;
+    options.numThreads = 1;
+    PairScanner scanner(data, options);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner.scan());
+    }
+    state.SetItemsProcessed(state.iterations() * scanner.getPairsTested());
+}
+BENCHMARK(BM_PairScanGaps)->ArgsProduct({{2520}, {0, 1, 20}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Bitmap alignment plus gather of one pair's legs onto their dense bars
+void BM_AlignPrices(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 5, state.range(1));
+    data->setFillPolicy(state.range(2) ? MarketData::FillPolicy::ForwardFill : MarketData::FillPolicy::Drop);
+    std::vector<Validity::Range> ranges;
+    std::vector<double> alignedA, alignedB;
+    for (auto _ : state) {
+        data->alignPrices(0, 1, ranges, alignedA, alignedB);
+        benchmark::DoNotOptimize(alignedA.data());
+        benchmark::DoNotOptimize(alignedB.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AlignPrices)->ArgsProduct({{25200}, {1, 20}, {0, 1}});
+
+void BM_ReturnCorrelations(benchmark::State& state) {
+    auto data = loadSample(state.range(0), state.range(1));
+    std::vector<MarketData::SymbolId> ids(data->getNumSymbols());
+    std::iota(ids.begin(), ids.end(), 0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PairScanner::returnCorrelations(*data, ids, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size() * ids.size() * state.range(0));
+}
+BENCHMARK(BM_ReturnCorrelations)->ArgsProduct({{2520}, {25, 250}})->Unit(benchmark::kMillisecond);
+
+// Second argument: legs per basket
+void BM_BasketScan(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 25);
+    BasketScanner::Options options;
+    options.numThreads = 1;
+    options.numLegs = state.range(1);
+    BasketScanner scanner(data, options);
+    auto baskets = BasketScanner::correlatedBaskets(*data, options.numLegs, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scanner.scan(baskets));
+    }
+    state.SetItemsProcessed(state.iterations() * baskets.size());
+}
+BENCHMARK(BM_BasketScan)->ArgsProduct({{2520}, {3, 6}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Formation-window re-screen on every fold of train=504,test=63. Second
+// argument: 0 recomputes each window, 1 slides SlidingCointegration.
+void BM_WalkForwardScreen(benchmark::State& state) {
+    const size_t numDays = state.range(0);
+    auto data = loadSample(numDays, 1);
+    PriceView a = data->getPrices(0);
+    PriceView b = data->getPrices(1);
+    std::vector<double> spread(504);
+    size_t folds = 0;
+    for (auto _ : state) {
+        Utilities::SlidingCointegration sliding(a, b, AssetPair::kAdfLags);
+        for (size_t begin = 0; begin + 504 <= numDays; begin += 63, ++folds) {
+            if (state.range(1)) {
+                sliding.setWindow(begin, begin + 504);
+                benchmark::DoNotOptimize(sliding.adfTest(sliding.beta()));
+            } else {
+                PriceView wa = a.subview(begin, 504);
+                PriceView wb = b.subview(begin, 504);
+                double beta = Utilities::regressionFromSums(Utilities::regressionSums(wb, wa)).beta;
+                for (size_t t = 0; t < 504; ++t) {
+                    spread[t] = wa[t] - beta * wb[t];
+                }
+                benchmark::DoNotOptimize(Utilities::adfTest(spread, AssetPair::kAdfLags));
+            }
+        }
+    }
+    state.SetItemsProcessed(folds);
+}
+BENCHMARK(BM_WalkForwardScreen)->ArgsProduct({{2520, 25200}, {0, 1}});
+
+// Second argument: 0 float64, 1 float32, 2 int32 cent ticks
+void BM_CrossProductTile(benchmark::State& state) {
+    auto data = loadSample(state.range(0), 16);
+    // Cent ticks: the long synthetic walks outgrow int32 at 1e-4
+    data->setPriceStorage(static_cast<MarketData::PriceStorage>(state.range(1)), 0.01);
+    std::vector<MarketData::SymbolId> ids(data->getNumSymbols());
+    std::iota(ids.begin(), ids.end(), 0);
+    std::vector<double> out(ids.size() * ids.size());
+    for (auto _ : state) {
+        PairScanner::crossProductTile(*data, ids.data(), ids.size(), ids.data(), ids.size(), 512,
+                                      out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size() * ids.size() * state.range(0));
+}
+BENCHMARK(BM_CrossProductTile)->ArgsProduct({{2520, 25200}, {0, 1, 2}})->Unit(benchmark::kMillisecond);
+
+void BM_RunBacktest(benchmark::State& state) {
+    const size_t numPairs = state.range(1);
+    auto data = loadSample(state.range(0), numPairs);
+    Backtester backtester(data);
+    backtester.setVerbose(false);
+    for (size_t p = 0; p < numPairs; ++p) {
+        auto a = static_cast<MarketData::SymbolId>(2 * p);
+        backtester.addPair(PairCandidate{a, a + 1, 1.0, 0.0, 0.0});
+    }
+    for (auto _ : state) {
+        backtester.runBacktest(1000000.0, 1.5, 0.0, 20, true);
+        benchmark::DoNotOptimize(backtester.getPortfolioValues().data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * numPairs);
+}
+BENCHMARK(BM_RunBacktest)->ArgsProduct({{2520, 25200}, {5, 50}})->Unit(benchmark::kMillisecond);
+
+// Re-pricing an existing run's fills, to compare against BM_RunBacktest
+void BM_EvaluateCosts(benchmark::State& state) {
+    const size_t numPairs = state.range(1);
+    auto data = loadSample(state.range(0), numPairs);
+    Backtester backtester(data);
+    backtester.setVerbose(false);
+    for (size_t p = 0; p < numPairs; ++p) {
+        auto a = static_cast<MarketData::SymbolId>(2 * p);
+        backtester.addPair(PairCandidate{a, a + 1, 1.0, 0.0, 0.0});
+    }
+    backtester.runBacktest(1000000.0, 1.5, 0.0, 20, true);
+    CostModel costs;
+    costs.commissionPerShare = 0.005;
+    costs.halfSpreadBps = 1.0;
+    costs.impactBps = 10.0;
+    costs.averageVolume = 1e6;
+    for (auto _ : state) {
+        auto run = backtester.evaluateCosts(costs);
+        benchmark::DoNotOptimize(run.portfolioValues.data());
+    }
+    state.counters["trades"] = static_cast<double>(backtester.getTradeHistory().size());
+}
+BENCHMARK(BM_EvaluateCosts)->ArgsProduct({{2520, 25200}, {5, 50}})->Unit(benchmark::kMillisecond);
+
+// One live bar: the price copy, every pair's online state machine and the
+// paper book's fills; compare per pair-bar against BM_RunBacktest
+void BM_LiveBar(benchmark::State& state) {
+    const size_t numPairs = state.range(0);
+    const size_t numDays = 2520;
+    auto data = loadSample(numDays, numPairs);
+    std::vector<std::string> symbols;
+    for (MarketData::SymbolId id = 0; id < data->getNumSymbols(); ++id) {
+        symbols.push_back(data->getSymbol(id));
+    }
+    std::vector<double> bars(numDays * symbols.size());
+    for (size_t day = 0; day < numDays; ++day) {
+        for (size_t id = 0; id < symbols.size(); ++id) {
+            bars[day * symbols.size() + id] = data->getPrice(static_cast<MarketData::SymbolId>(id), day);
+        }
+    }
+    
+    Backtester backtester(symbols);
+    backtester.setVerbose(false);
+    for (size_t p = 0; p < numPairs; ++p) {
+        backtester.addPair(symbols[2 * p], symbols[2 * p + 1], 1.0);
+    }
+    backtester.startLive(1000000.0, 1.5, 0.0, 20, true);
+    size_t day = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(backtester.onLiveBar(bars.data() + day * symbols.size()));
+        if (++day == numDays) {
+            state.PauseTiming();
+            backtester.startLive(1000000.0, 1.5, 0.0, 20, true);
+            day = 0;
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numPairs);
+}
+BENCHMARK(BM_LiveBar)->Arg(5)->Arg(50);
+
+// Feed-to-strategy handoff: one producer and one consumer thread moving
+// FeedMessages through a queue of the given capacity
+void BM_SpscQueue(benchmark::State& state) {
+    constexpr size_t kMessages = 1 << 20;
+    SpscQueue<FeedMessage> queue(state.range(0));
+    for (auto _ : state) {
+        std::thread producer([&] {
+            FeedMessage message;
+            for (size_t i = 0; i < kMessages; ++i) {
+                message.slot = static_cast<uint32_t>(i);
+                while (!queue.tryPush(message)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        FeedMessage message;
+        uint64_t checksum = 0;
+        for (size_t received = 0; received < kMessages; ) {
+            if (queue.tryPop(message)) {
+                checksum += message.slot;
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.SetItemsProcessed(state.iterations() * kMessages);
+}
+BENCHMARK(BM_SpscQueue)->Arg(64)->Arg(1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -1,26 +1,53 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <optional>
+#include "SeriesView.h"
+#include "StrategyPolicies.h"
 #include "Utilities.h"
 
 class AssetPair {
 public:
-    // Constructor with asset symbols and price data
+    // Position signal per bar: 1 long spread, -1 short spread, 0 flat
+    using Signal = int8_t;
+    
+    // Outcome of an Engle-Granger style screen (regression of A on B, ADF on the spread)
+    struct CointegrationResult {
+        double beta = 0.0;
+        double adfStatistic = 0.0;
+        double pValue = 1.0;
+        bool isCointegrated = false;
+    };
+    
+    // Lagged differences in the ADF regression used by every screen
+    static constexpr int kAdfLags = 1;
+    
+    // Constructor with asset symbols and price data. The pair keeps views into
+    // the caller's price storage (normally the MarketData column store), which
+    // must outlive the pair.
     AssetPair(const std::string& symbolA, const std::string& symbolB,
-              const std::vector<double>& pricesA, const std::vector<double>& pricesB);
+              PriceView pricesA, PriceView pricesB);
+    
+    // Streaming-only pair with a known hedge ratio and no price history
+    AssetPair(const std::string& symbolA, const std::string& symbolB, double beta);
     
     // Get asset symbols
     const std::string& getSymbolA() const { return symbolA_; }
     const std::string& getSymbolB() const { return symbolB_; }
     
     // Get price data
-    const std::vector<double>& getPricesA() const { return pricesA_; }
-    const std::vector<double>& getPricesB() const { return pricesB_; }
+    PriceView getPricesA() const { return pricesA_; }
+    PriceView getPricesB() const { return pricesB_; }
     
-    // Get the spreads between the assets (price_A - beta * price_B)
-    const std::vector<double>& getSpreads() const { return spreads_; }
+    // Hedge ratio in force on a bar (the rolling estimate if one is set)
+    double getHedgeRatio(size_t i) const { return betas_.empty() ? beta_ : betas_[i]; }
+    
+    // Spread on one bar (price_A - beta * price_B). The signal path derives
+    // spreads from prices on the fly, so the full series is only built on request.
+    double getSpread(size_t i) const { return pricesA_[i] - getHedgeRatio(i) * pricesB_[i]; }
+    std::vector<double> getSpreads() const;
     
     // Get the z-scores of the spread
     std::vector<double> getZScores(size_t window) const;
@@ -28,24 +55,103 @@ public:
     // Test for cointegration
     bool testCointegration(double significanceLevel = 0.05);
     
+    // Test for cointegration using precomputed regression sums of A on B
+    // (e.g. from MarketData::getRegressionSums), skipping the regression pass
+    bool testCointegration(const Utilities::RegressionSums& sums, double significanceLevel = 0.05);
+    
+    // Run the cointegration screen on raw price views without building a pair.
+    // spreadBuffer is caller-owned scratch so repeated calls do not reallocate.
+    static CointegrationResult evaluateCointegration(PriceView pricesA, PriceView pricesB,
+                                                     std::vector<double>& spreadBuffer,
+                                                     double significanceLevel = 0.05);
+    
+    // ADF stage only: build the spread A - beta * B into spreadBuffer and test it
+    static CointegrationResult evaluateSpread(PriceView pricesA, PriceView pricesB, double beta,
+                                              std::vector<double>& spreadBuffer,
+                                              double significanceLevel = 0.05);
+    
+    // Time-varying hedge ratio: rolling OLS of A on B over the trailing `window`
+    // bars (expanding until the window fills), updated in O(1) per bar. One pass
+    // produces the beta series and the spread series that z-scores and signals
+    // use. window == 0 restores the static full-sample beta.
+    void estimateRollingHedgeRatio(size_t window);
+    
+    // Per-bar hedge ratios from estimateRollingHedgeRatio (empty when static)
+    const std::vector<double>& getHedgeRatios() const { return betas_; }
+    
+    // Adopt a hedge ratio estimated elsewhere (e.g. by PairScanner)
+    void setCointegrationBeta(double beta, bool isCointegrated = true);
+    
     // Get the cointegration coefficient (beta)
     double getCointegrationBeta() const { return beta_; }
+    bool isCointegrated() const { return isCointegrated_; }
     
     // Calculate signals based on z-score thresholds
     // Returns: 1 for long spread, -1 for short spread, 0 for no position
     std::vector<int> generateSignals(double entryThreshold = 1.5, 
                                     double exitThreshold = 0.0,
                                     size_t lookbackWindow = 20) const;
+    
+    // Fused spread -> rolling z-score -> signal pass over the price views. Writes
+    // getPricesA().size() entries into each non-null output and allocates nothing.
+    void computeSignals(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                        Signal* signals, double* zScores = nullptr) const;
+    
+    // Threshold state machine on a precomputed z-score series, so several
+    // threshold settings can share one z-score computation
+    static std::vector<int> signalsFromZScores(const std::vector<double>& zScores,
+                                               double entryThreshold,
+                                               double exitThreshold);
+    static void signalsFromZScores(const double* zScores, size_t count,
+                                   double entryThreshold, double exitThreshold,
+                                   Signal* signals);
+    
+    // One step of the threshold state machine: returns this bar's signal and
+    // updates currentPosition. NaN z-scores give no signal and keep the position.
+    static int stepSignal(int& currentPosition, double zScore,
+                          double entryThreshold, double exitThreshold) {
+        return StrategyPolicies::ZScoreBands{entryThreshold, exitThreshold}.step(currentPosition, zScore);
+    }
+    
+    // Online mode: feed bars one at a time. Each onBar() updates the spread, the
+    // rolling moments (ring buffer of lookbackWindow spreads) and the position
+    // state machine in O(1) and returns the current signal. Replaying a history
+    // reproduces generateSignals() exactly whenever lookbackWindow is shorter
+    // than the history (the batch path shrinks oversized windows, this one cannot).
+    // hedgeWindow > 0 re-estimates beta on every bar exactly as
+    // estimateRollingHedgeRatio does.
+    void startStreaming(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                        size_t hedgeWindow = 0);
+    int onBar(double priceA, double priceB);
+    double getCurrentZScore() const { return stream_.zScore; }
+    int getCurrentSignal() const { return stream_.signal; }
+    size_t getBarsSeen() const { return stream_.bars; }
 
 private:
     std::string symbolA_;
     std::string symbolB_;
-    std::vector<double> pricesA_;
-    std::vector<double> pricesB_;
-    std::vector<double> spreads_;
+    PriceView pricesA_;
+    PriceView pricesB_;
+    std::vector<double> betas_;   // rolling hedge ratios, empty for a static beta
     double beta_ = 1.0;  // Default to 1.0 (simple difference)
     bool isCointegrated_ = false;
     
-    // Calculate the spread based on cointegration beta
-    void calculateSpreads();
+    struct StreamingState {
+        Utilities::RollingWindow window;
+        double entryThreshold = 1.5;
+        double exitThreshold = 0.0;
+        double zScore = 0.0;
+        double beta = 1.0;
+        Utilities::RollingRegression hedge;
+        std::vector<double> hedgeA;    // ring buffers of the hedge window
+        std::vector<double> hedgeB;
+        size_t hedgeHead = 0;
+        int position = 0;
+        int signal = 0;
+        size_t bars = 0;
+    };
+    StreamingState stream_;
+    
+    // Lookback actually used by the batch path (oversized windows shrink)
+    size_t effectiveWindow(size_t window) const;
 }; 
\ No newline at end of file
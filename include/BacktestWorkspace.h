@@ -0,0 +1,111 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "AssetPair.h"
+#include "MarketData.h"
+
+// One open pair position. Symbols are interned ids into the MarketData the
+// backtest runs on, so opening a position copies no strings.
+struct BacktestPosition {
+    MarketData::SymbolId symbolA = 0;
+    MarketData::SymbolId symbolB = 0;
+    size_t pairIndex = 0;
+    double quantityA = 0.0;
+    double quantityB = 0.0;
+    double entryPriceA = 0.0;
+    double entryPriceB = 0.0;
+    int entryDay = -1;
+    int direction = 0;  // 1 for long spread, -1 for short spread
+};
+
+// Share of the capital base committed to each new position
+constexpr double kPositionFraction = 0.1;
+
+// Leg quantities for `notional` split evenly across A and B
+inline void sizePosition(BacktestPosition& position, int signal, double notional,
+                         double priceA, double priceB) {
+    if (signal > 0) {
+        // Long spread: buy A, sell B
+        position.quantityA = notional / (2 * priceA);
+        position.quantityB = -notional / (2 * priceB);
+    } else {
+        // Short spread: sell A, buy B
+        position.quantityA = -notional / (2 * priceA);
+        position.quantityB = notional / (2 * priceB);
+    }
+}
+
+// One closed round trip. Fixed layout with no owning members, so the trade
+// log is one flat array that can be copied, merged and exported column-wise.
+struct BacktestTrade {
+    size_t pairIndex = 0;
+    int direction = 0;       // 1 long spread, -1 short spread
+    int entryDay = 0;
+    int exitDay = 0;
+    double quantityA = 0.0;
+    double quantityB = 0.0;
+    double entryPriceA = 0.0;
+    double entryPriceB = 0.0;
+    double exitPriceA = 0.0;
+    double exitPriceB = 0.0;
+    double pnl = 0.0;
+    
+    int holdingDays() const { return exitDay - entryDay; }
+};
+
+inline bool operator==(const BacktestTrade& x, const BacktestTrade& y) {
+    return x.pairIndex == y.pairIndex && x.direction == y.direction &&
+           x.entryDay == y.entryDay && x.exitDay == y.exitDay &&
+           x.quantityA == y.quantityA && x.quantityB == y.quantityB &&
+           x.entryPriceA == y.entryPriceA && x.entryPriceB == y.entryPriceB &&
+           x.exitPriceA == y.exitPriceA && x.exitPriceB == y.exitPriceB && x.pnl == y.pnl;
+}
+
+// Close `position` at the given prices
+inline BacktestTrade closeTrade(const BacktestPosition& position, int exitDay,
+                                double exitPriceA, double exitPriceB) {
+    BacktestTrade trade;
+    trade.pairIndex = position.pairIndex;
+    trade.direction = position.direction;
+    trade.entryDay = position.entryDay;
+    trade.exitDay = exitDay;
+    trade.quantityA = position.quantityA;
+    trade.quantityB = position.quantityB;
+    trade.entryPriceA = position.entryPriceA;
+    trade.entryPriceB = position.entryPriceB;
+    trade.exitPriceA = exitPriceA;
+    trade.exitPriceB = exitPriceB;
+    trade.pnl = (position.quantityA * exitPriceA - position.quantityA * position.entryPriceA)
+              + (position.quantityB * exitPriceB - position.quantityB * position.entryPriceB);
+    return trade;
+}
+
+// Run-scoped buffers of a Backtester. reset() rewinds sizes but keeps
+// capacity, so back-to-back runs reuse the storage grown by earlier runs and
+// only the first run of a given shape touches the allocator.
+struct BacktestWorkspace {
+    std::vector<BacktestPosition> positions;     // live book, unordered
+    std::vector<int> pairPositionSlot;           // per pair: index into positions or -1
+    std::vector<int> currentPosition;            // per pair signal in force
+    std::vector<AssetPair::Signal> signals;      // pair-major signal matrix
+    std::vector<double> portfolioValues;
+    std::vector<BacktestTrade> tradeHistory;     // in exit order
+    
+    // Parallel modes: per-pair book (direction 0 = flat) and per-chunk partials
+    std::vector<BacktestPosition> pairBook;
+    std::vector<double> chunkCash;
+    std::vector<double> chunkValues;
+    std::vector<std::vector<BacktestTrade>> chunkTrades;
+    
+    // Prepare for a run; the signal matrix is left alone since it may be the run's input.
+    // numDays is 0 when the daily values are not kept.
+    void reset(size_t numPairs, size_t numDays, double initialCapital) {
+        positions.clear();
+        positions.reserve(numPairs);
+        pairPositionSlot.assign(numPairs, -1);
+        currentPosition.assign(numPairs, 0);
+        portfolioValues.assign(numDays, initialCapital);
+        tradeHistory.clear();
+    }
+};
@@ -1,77 +1,340 @@
 #pragma once
 
+#include <limits>
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include "MarketData.h"
 #include "AssetPair.h"
+#include "BacktestWorkspace.h"
+#include "CostModel.h"
+#include "PerformanceMetrics.h"
+#include "PairScanner.h"
+
+class MarketDataStream;
+class ThreadPool;
 
 class Backtester {
 public:
-    struct Position {
-        std::string symbolA;
-        std::string symbolB;
-        double quantityA = 0.0;
-        double quantityB = 0.0;
-        double entryPriceA = 0.0;
-        double entryPriceB = 0.0;
-        int entryDay = -1;
-        int direction = 0;  // 1 for long spread, -1 for short spread
+    using Position = BacktestPosition;
+    using Trade = BacktestTrade;
+    
+    using PerformanceMetrics = ::PerformanceMetrics;
+    
+    // How positions are sized and whether pairs run concurrently. Every new
+    // position is 10% of a capital base:
+    //  Serial         pairs handled in order each day, each sized off the
+    //                 running book (single-threaded)
+    //  SharedCapital  sized off the start-of-day equity; pairs run in parallel
+    //                 between day barriers
+    //  FixedNotional  sized off the initial capital; each pair's whole path
+    //                 runs independently and the P&L streams are merged after
+    // Parallel modes reduce over fixed pair chunks in pair order, so results
+    // are bit-identical for any thread count.
+    enum class ExecutionMode { Serial, SharedCapital, FixedNotional };
+    
+    // Stop a run as soon as it is clearly not worth finishing. maxDrawdown is
+    // checked on every bar; the other tests at checkpoints every
+    // checkpointBars bars after the first valued bar. A stopped run reports
+    // metrics over the bars up to the stop. FixedNotional runs every pair's
+    // whole path first and applies the criteria to the merged equity, dropping
+    // trades that exit after the stop, so it prunes results but saves no work.
+    struct KillCriteria {
+        double maxDrawdown = 0.0;          // stop once the drawdown exceeds this (0 = off)
+        size_t checkpointBars = 0;         // 0 = no checkpoint tests
+        double minSharpe = -std::numeric_limits<double>::infinity();  // running Sharpe at a checkpoint
+        int minTradesPerCheckpoint = 0;    // closed trades needed by checkpoint k: k * this
+        
+        bool isSet() const {
+            return maxDrawdown > 0.0 ||
+                   (checkpointBars > 0 && (minTradesPerCheckpoint > 0 || minSharpe > -std::numeric_limits<double>::infinity()));
+        }
+        
+        // Parse "drawdown=0.2,checkpoint=252,sharpe=0.5,trades=2"; keys not named keep their value
+        static bool parse(const std::string& spec, KillCriteria& criteria);
     };
     
-    struct PerformanceMetrics {
-        double totalReturn = 0.0;
-        double annualizedReturn = 0.0;
-        double sharpeRatio = 0.0;
-        double maxDrawdown = 0.0;
-        int winCount = 0;
-        int lossCount = 0;
-        double avgHoldingPeriod = 0.0;
-        double avgWin = 0.0;
-        double avgLoss = 0.0;
+    // A run re-priced under a CostModel. Entry costs are charged on the entry
+    // bar and exit costs on the exit bar, positions still open included.
+    struct CostedRun {
+        std::vector<double> portfolioValues;   // net of costs charged so far
+        std::vector<Trade> trades;             // P&L net of both legs' entry and exit costs
+        std::vector<double> tradeCosts;        // per trade, in trade order
+        double totalCost = 0.0;
+        PerformanceMetrics metrics;
     };
     
     // Constructor with market data
     explicit Backtester(std::shared_ptr<MarketData> marketData);
     
-    // Add a pair to backtest
+    // Streaming backtester: runBacktest() reads the stream chunk by chunk and
+    // keeps O(pairs x window) state instead of the full history.
+    // Pairs need a known hedge ratio, since there is no history to screen.
+    explicit Backtester(std::shared_ptr<MarketDataStream> stream);
+    
+    // Live/paper-trading backtester over the given symbols (SymbolIds in this
+    // order): bars are pushed one at a time with onLiveBar() instead of read
+    // from a source. Pairs need a known hedge ratio, as on a stream.
+    explicit Backtester(std::vector<std::string> symbols);
+    ~Backtester();
+    
+    // Add a pair to backtest if it passes the cointegration screen. In-memory
+    // pairs trade on MarketData::getFilledPrices, so a missing price carries
+    // the leg's last one. Bars before a leg's first price stay NaN and the
+    // z-score window never recovers from them: slice such data to start
+    // where both legs have prices.
     void addPair(const std::string& symbolA, const std::string& symbolB);
     
-    // Run the backtest with specified parameters
+    // Add a pair already accepted by PairScanner (no re-test)
+    void addPair(const PairCandidate& candidate);
+    
+    // Add a pair with a hedge ratio screened elsewhere (no re-test)
+    void addPair(const std::string& symbolA, const std::string& symbolB, double beta);
+    
+    // Number of pairs selected for trading
+    size_t getNumPairs() const { return pairs_.size(); }
+    
+    // Run the backtest with specified parameters. On a stream the signals,
+    // rolling hedge ratios and position book advance bar by bar as each chunk
+    // is read (Serial mode only); results match the in-memory run on the same
+    // pairs whenever lookbackWindow is shorter than the history.
     void runBacktest(double initialCapital = 1000000.0,
                     double entryThreshold = 1.5,
                     double exitThreshold = 0.0,
                     size_t lookbackWindow = 20,
                     bool delayedExecution = true);
     
-    // Get daily portfolio values
-    const std::vector<double>& getPortfolioValues() const { return portfolioValues_; }
+    // Start a live run. Each onLiveBar() then does what a streaming run does
+    // on one bar (Serial mode), so replaying a history bar by bar gives that
+    // run's metrics. No daily values or trade log are kept; after this call
+    // onLiveBar() does not allocate.
+    void startLive(double initialCapital = 1000000.0,
+                   double entryThreshold = 1.5,
+                   double exitThreshold = 0.0,
+                   size_t lookbackWindow = 20,
+                   bool delayedExecution = true);
+    
+    // One bar of prices indexed by SymbolId; a NaN price keeps the symbol's
+    // previous one. Returns every pair's latest signal, in addPair order.
+    const AssetPair::Signal* onLiveBar(const double* prices);
+    
+    // End a live run: fill the last bar's pending signals on that bar and compute the metrics
+    void finishLive();
+    
+    // Bars pushed so far in the live run
+    size_t getLiveBars() const { return liveBars_; }
+    
+    // Latest live price of a symbol, after the NaN carry
+    double getLivePrice(MarketData::SymbolId id) const {
+        return livePrices_[((liveBars_ + 1) & 1) * liveSymbols_.size() + id];
+    }
+    
+    // Cash plus open positions at the latest bar's prices
+    double getEquity() const { return cash_ + positionsValue_; }
+    
+    // Signal in force for a pair (its open position's direction, 0 when flat)
+    int getCurrentPosition(size_t pairIndex) const { return workspace_.currentPosition[pairIndex]; }
+    
+    // Run the backtest on signals already generated for each pair (in addPair order)
+    void runBacktestWithSignals(const std::vector<std::vector<int>>& signals,
+                                double initialCapital = 1000000.0,
+                                size_t lookbackWindow = 20,
+                                bool delayedExecution = true);
+    
+    // Same on a caller-owned pair-major signal matrix: signals[p * stride + day]
+    void runBacktestWithSignals(const AssetPair::Signal* signals, size_t stride,
+                                double initialCapital = 1000000.0,
+                                size_t lookbackWindow = 20,
+                                bool delayedExecution = true);
+    
+    // Access the selected pairs
+    const AssetPair& getPair(size_t index) const { return *pairs_[index]; }
+    const std::pair<MarketData::SymbolId, MarketData::SymbolId>& getPairSymbols(size_t index) const {
+        return pairSymbols_[index];
+    }
+    
+    // Rolling hedge-ratio window applied to every pair (0 = static beta)
+    void setHedgeRatioWindow(size_t window);
+    
+    // numThreads == 0 uses all cores; 1 runs the parallel modes inline
+    void setExecutionMode(ExecutionMode mode, size_t numThreads = 0);
+    ExecutionMode getExecutionMode() const { return executionMode_; }
+    
+    // Costs charged on every later run's fills (default: free). Position sizes
+    // come from the gross book, so the result equals evaluateCosts() on the
+    // free run; in FixedNotional mode that is also what charging costs in
+    // cash during the run would give.
+    void setCostModel(const CostModel& costs) { costModel_ = costs; }
+    const CostModel& getCostModel() const { return costModel_; }
+    
+    // Re-price the last run's fills under `costs` in one pass over the trade
+    // log, without re-simulating; always starts from the gross fills. Empty
+    // when the run kept no portfolio values (see setRecordValues).
+    CostedRun evaluateCosts(const CostModel& costs) const;
+    
+    // Print metrics to stdout after each run (default on)
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+    
+    // Keep the daily portfolio values (default on). Metrics are accumulated
+    // online either way; without the values getPortfolioValues() is empty and
+    // exportResults() and cost models have nothing to work on.
+    void setRecordValues(bool record) { recordValues_ = record; }
     
-    // Get trade history
-    const std::vector<std::pair<int, double>>& getTradeHistory() const { return tradeHistory_; }
+    // Annualization of the run metrics. Defaults to the market data's periods
+    // per year (see MarketData::getPeriodsPerYear), or 252 on a stream.
+    void setPeriodsPerYear(double periodsPerYear) { periodsPerYear_ = periodsPerYear; }
+    double getPeriodsPerYear() const { return periodsPerYear_; }
+    
+    // Kill criteria checked during every later run (default: none)
+    void setKillCriteria(const KillCriteria& criteria) { killCriteria_ = criteria; }
+    
+    // Whether the last run was stopped by the kill criteria, and after how many bars
+    bool wasPruned() const { return pruned_; }
+    size_t getBarsRun() const { return runDays_; }
+    
+    // Metrics accumulated so far in the current run, or over the last run
+    const MetricsAccumulator& getRunMetrics() const { return runMetrics_; }
+    
+    // Get daily portfolio values, net of the cost model
+    const std::vector<double>& getPortfolioValues() const {
+        return costed_ ? costed_->portfolioValues : workspace_.portfolioValues;
+    }
+    
+    // Positions still open at the end of the run
+    const std::vector<Position>& getOpenPositions() const { return workspace_.positions; }
+    
+    // Closed trades in exit order, P&L net of the cost model
+    const std::vector<Trade>& getTradeHistory() const {
+        return costed_ ? costed_->trades : workspace_.tradeHistory;
+    }
+    
+    // Costs charged on the last run (0 without a cost model)
+    double getTotalCosts() const { return costed_ ? costed_->totalCost : 0.0; }
     
     // Get performance metrics
     PerformanceMetrics getPerformanceMetrics() const { return metrics_; }
     
-    // Export results to CSV
+    // Export the daily portfolio values. Files ending in .sacol are written as
+    // a binary columnar table (see Utilities::writeColumnar), anything else as CSV.
     bool exportResults(const std::string& filename) const;
+    
+    // Export the trade log, one row per round trip; same format choice
+    bool exportTrades(const std::string& filename) const;
+    
+    // Metrics of a per-bar value series and its closed trades, as a run
+    // computes them; lets merged shard output be scored the same way
+    static PerformanceMetrics computeMetrics(const std::vector<double>& portfolioValues,
+                                             const std::vector<Trade>& trades,
+                                             double initialCapital,
+                                             double periodsPerYear = Timestamps::kTradingDaysPerYear);
+    // Holding periods are printed in days for daily bars, else in bars of barInterval
+    static void printMetrics(const PerformanceMetrics& metrics,
+                             int64_t barInterval = Timestamps::kNanosPerDay);
+    
+    // Write a daily value series in the exportResults format
+    static bool writePortfolioValues(const std::string& filename, const std::vector<double>& values);
 
 private:
     std::shared_ptr<MarketData> marketData_;
+    std::shared_ptr<MarketDataStream> stream_;   // set for streaming runs, marketData_ is then null
+    bool live_ = false;                          // live runs have neither data source
+    std::vector<std::string> liveSymbols_;
+    std::unordered_map<std::string, MarketData::SymbolId> liveSymbolIds_;
+    std::vector<double> livePrices_;             // latest two bars, bar d in row d & 1
+    size_t liveBars_ = 0;
+    size_t liveLookback_ = 0;
+    bool liveDelayed_ = true;
     std::vector<std::unique_ptr<AssetPair>> pairs_;
-    std::vector<Position> positions_;
-    std::vector<double> portfolioValues_;
-    std::vector<std::pair<int, double>> tradeHistory_; // (day, pnl)
+    std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> pairSymbols_;
+    BacktestWorkspace workspace_;            // run-scoped buffers, reused across runs
+    double positionsValue_ = 0.0;            // live positions valued at markDay_
+    int markDay_ = 0;
     double cash_ = 0.0;
     double initialCapital_ = 0.0;
+    double periodsPerYear_ = Timestamps::kTradingDaysPerYear;
+    int64_t barInterval_ = Timestamps::kNanosPerDay;
     PerformanceMetrics metrics_;
+    MetricsAccumulator runMetrics_;          // fed each valued day and closed trade
+    int pendingDay_ = -1;                    // last valued day, not yet accumulated
+    double pendingValue_ = 0.0;
+    size_t accumulatedDays_ = 0;
+    size_t runDays_ = 0;
+    bool recordValues_ = true;
+    KillCriteria killCriteria_;
+    bool pruned_ = false;
+    int firstValuedDay_ = -1;
+    CostModel costModel_;
+    std::optional<CostedRun> costed_;        // last run net of costModel_, empty when free
+    bool verbose_ = true;
+    size_t hedgeRatioWindow_ = 0;
+    ExecutionMode executionMode_ = ExecutionMode::Serial;
+    std::unique_ptr<ThreadPool> pool_;       // null runs everything on the caller
+    
+    // Leg prices of a pair on `day`: its price views, the resident chunk when
+    // streaming, or the latest two bars when live
+    double priceA(size_t pairIndex, int day) const;
+    double priceB(size_t pairIndex, int day) const;
+    
+    // Clear run state for a run over numDays bars
+    void resetRun(double initialCapital, size_t numDays);
+    
+    // Portfolio value of `day`, whose value may be revised until a later day
+    // is valued; days are valued in order and skipped days hold the initial capital
+    void recordValue(int day, double value);
+    
+    // Accumulate every day before `day` that is still pending or was skipped
+    void accumulateValuesBefore(size_t day);
+    
+    // Apply the kill criteria once `day` is final; a stop ends the run after it
+    void checkKillCriteria(int day);
+    
+    // Serial mode, one signal bar: move every pair to its signal at executionDay's
+    // prices and record that day's portfolio value. signals[p * stride] is pair
+    // p's signal (null = all flat).
+    void executeSignals(const AssetPair::Signal* signals, size_t stride, int executionDay);
+    
+    // Chunked run over stream_
+    void runStreaming(double entryThreshold, double exitThreshold,
+                      size_t lookbackWindow, bool delayedExecution);
+    
+    // Bar loops, instantiated per execution-delay policy (see StrategyPolicies.h)
+    // so the fill-day rule is resolved at compile time
+    template <typename Execution>
+    void simulate(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow);
+    template <typename Execution>
+    void runSerial(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow);
+    template <typename Execution>
+    void streamBars(size_t lookbackWindow);
+    
+    // One bar of an online run (stream or live): fill the pending signals as
+    // Execution dictates and step every pair's state machine on the bar
+    template <typename Execution>
+    void stepOnline(size_t day, size_t lookbackWindow);
+    
+    // Symbol lookup in whichever source the backtester runs on
+    std::optional<MarketData::SymbolId> findSymbol(const std::string& symbol) const;
+    const std::string& symbolName(MarketData::SymbolId id) const;
+    
+    // Advance the live book's mark-to-market value to `day` using per-position deltas
+    void markPositionsTo(int day);
+    
+    // Open/close the position of one pair at the given day's prices
+    void openPosition(size_t pairIndex, int signal, int day);
+    void closePosition(size_t pairIndex, int day);
+    
+    // Parallel execution modes over the same pair-major signal matrix
+    template <typename Execution>
+    void runSharedCapital(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow);
+    template <typename Execution>
+    void runFixedNotional(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow);
     
-    // Calculate portfolio value on a specific day
-    double calculatePortfolioValue(int day);
+    // Fold chunk trades into the history
+    void recordTrades(const std::vector<BacktestTrade>& trades);
     
-    // Execute a buy/sell order
-    void executeOrder(int day, const std::string& symbol, double quantity, double price);
+    // Rebuild the live book from the per-pair book after a parallel run
+    void collectOpenPositions();
     
     // Calculate performance metrics
     void calculateMetrics();
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Johansen.h"
+#include "MarketData.h"
+
+// A basket that passed the Johansen trace test
+struct BasketCandidate {
+    std::vector<MarketData::SymbolId> symbols;
+    std::vector<double> weights;     // first leg normalised to 1
+    double traceStatistic = 0.0;     // H0: no cointegration
+    double criticalValue = 0.0;
+    int rank = 0;
+};
+
+// Screens candidate baskets for cointegration with the Johansen estimator.
+// Candidates are processed batchSize at a time per thread-pool task; a worker
+// gathers each basket's legs into one reused bar-major price buffer and runs
+// the estimator in a reused fixed-capacity workspace, so the per-candidate
+// matrix work stays in cache and nothing is allocated per candidate beyond
+// the accepted results.
+class BasketScanner {
+public:
+    struct Options {
+        size_t numThreads = 0;           // 0 = hardware concurrency
+        size_t numLegs = 3;              // legs per generated basket (2..Johansen::kMaxLegs)
+        int lags = 1;                    // lagged differences in the VECM
+        double significanceLevel = 0.05;
+        size_t batchSize = 16;           // baskets per task
+    };
+
+    BasketScanner(std::shared_ptr<const MarketData> marketData, Options options);
+    explicit BasketScanner(std::shared_ptr<const MarketData> marketData);
+
+    // Screen one basket per symbol: the symbol and its numLegs - 1 most
+    // return-correlated partners (see correlatedBaskets)
+    std::vector<BasketCandidate> scan();
+
+    // Screen the given leg sets; results keep the input order
+    std::vector<BasketCandidate> scan(const std::vector<std::vector<MarketData::SymbolId>>& baskets);
+
+    // Number of baskets evaluated by the last scan
+    size_t getBasketsTested() const { return basketsTested_; }
+
+    // Each symbol with its numLegs - 1 highest return correlations, legs sorted
+    // by id and duplicate baskets removed
+    static std::vector<std::vector<MarketData::SymbolId>> correlatedBaskets(const MarketData& marketData,
+                                                                            size_t numLegs,
+                                                                            size_t numThreads = 0);
+
+private:
+    std::shared_ptr<const MarketData> marketData_;
+    Options options_;
+    size_t basketsTested_ = 0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "MarketData.h"
+
+// Execution costs charged per fill. A fill of q shares at price p costs
+//   |q| * commissionPerShare
+//   + |q| * p * (feeBps + halfSpreadBps + impactBps * |q| / volume) / 1e4
+// where volume is the symbol's average bar volume; the impact (participation)
+// term is dropped when no volume is known. Costs are evaluated after the
+// simulation over its recorded fills (see Backtester::evaluateCosts), so a
+// run can be re-priced under any number of cost scenarios without re-running.
+struct CostModel {
+    double commissionPerShare = 0.0;
+    double feeBps = 0.0;                 // exchange and clearing fees on traded notional
+    double halfSpreadBps = 0.0;          // paid crossing to the far side of the quote
+    double impactBps = 0.0;              // per unit of participation in bar volume
+    double averageVolume = 0.0;          // shares per bar for every symbol (0 = unknown)
+    std::vector<double> symbolVolumes;   // per SymbolId, overrides averageVolume when > 0
+
+    bool isFree() const {
+        return commissionPerShare == 0.0 && feeBps == 0.0 && halfSpreadBps == 0.0 && impactBps == 0.0;
+    }
+
+    double volumeOf(MarketData::SymbolId symbol) const {
+        return symbol < symbolVolumes.size() && symbolVolumes[symbol] > 0.0 ? symbolVolumes[symbol]
+                                                                             : averageVolume;
+    }
+
+    double fillCost(double quantity, double price, double volume) const {
+        const double shares = std::abs(quantity);
+        const double participation = volume > 0.0 ? shares / volume : 0.0;
+        return shares * (commissionPerShare +
+                         price * (feeBps + halfSpreadBps + impactBps * participation) * 1e-4);
+    }
+
+    // Every rate multiplied by `factor`, for sensitivity runs
+    CostModel scaled(double factor) const;
+
+    // Parse "commission=0.005,fee=0.5,spread=1,impact=10,adv=1e6"; keys not
+    // named keep their value
+    static bool parse(const std::string& spec, CostModel& model);
+};
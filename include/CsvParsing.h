@@ -0,0 +1,93 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include "Timestamps.h"
+
+// Row and cell scanning over an in-memory (normally memory-mapped) CSV buffer,
+// shared by the whole-file loader and the chunked stream reader
+namespace CsvParsing {
+
+inline const char* findNewline(const char* p, const char* end) {
+    // memchr is vectorised in every mainstream libc
+    const void* hit = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+// Line end excluding a trailing carriage return
+inline const char* trimLineEnd(const char* begin, const char* end) {
+    return (end > begin && end[-1] == '\r') ? end - 1 : end;
+}
+
+inline const char* findComma(const char* p, const char* end) {
+    const void* hit = std::memchr(p, ',', static_cast<size_t>(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+inline double parsePrice(const char* begin, const char* end) {
+    // Same leniency as std::stod: leading blanks/'+', trailing junk ignored
+    while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+    if (begin < end && *begin == '+') ++begin;
+
+    double value;
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return value;
+}
+
+// Non-empty lines in [p, end)
+inline size_t countRows(const char* p, const char* end) {
+    size_t rows = 0;
+    while (p < end) {
+        const char* eol = findNewline(p, end);
+        if (trimLineEnd(p, eol) > p) {
+            ++rows;
+        }
+        p = eol + 1;
+    }
+    return rows;
+}
+
+// Split the header line [begin, end) into column names
+inline std::vector<std::string> splitHeader(const char* begin, const char* end) {
+    std::vector<std::string> headers;
+    const char* last = trimLineEnd(begin, end);
+    for (const char* p = begin; p < last; ) {
+        const char* comma = findComma(p, last);
+        headers.emplace_back(p, comma);
+        p = comma + 1;
+    }
+    return headers;
+}
+
+// Parse one data row [p, last): the timestamp, then one price per symbol
+// written to out[id * stride]. Missing trailing cells are left untouched.
+// False if the timestamp cell does not parse (see Timestamps::parse).
+inline bool parseRow(const char* p, const char* last, size_t numSymbols,
+                     int64_t& timestamp, double* out, size_t stride) {
+    const char* comma = findComma(p, last);
+    if (!Timestamps::parse(p, comma, timestamp)) {
+        return false;
+    }
+    const char* cell = comma + 1;
+    for (size_t id = 0; id < numSymbols && cell <= last; ++id) {
+        const char* cellEnd = findComma(cell, last);
+        out[id * stride] = parsePrice(cell, cellEnd);
+        cell = cellEnd + 1;
+    }
+    return true;
+}
+
+// First cell of a row, for error messages
+inline std::string firstCell(const char* p, const char* last) {
+    return std::string(p, findComma(p, last));
+}
+
+} // namespace CsvParsing
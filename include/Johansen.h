@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Johansen-style multivariate cointegration estimator for small baskets.
+// Fits the VECM
+//   dy_t = c + Pi * y_{t-1} + sum_{i=1..p} G_i * dy_{t-i} + e_t
+// by accumulating the moment matrix of [dy_t, y_{t-1}, dy_{t-1..t-p}, 1] in
+// one pass over the bars, partialling out the lags and constant from the
+// moments, and solving S10 S00^-1 S01 v = lambda S11 v. The eigenvector of the
+// largest eigenvalue is the cointegrating weight vector; the trace statistics
+// give the cointegration rank. The linear algebra runs on Eigen when built
+// with USE_EIGEN and on a built-in Cholesky / Jacobi kernel otherwise; both
+// work in fixed-capacity storage, so estimation allocates nothing.
+namespace Johansen {
+
+// Legs per basket; price rows are laid out with this stride
+constexpr size_t kMaxLegs = 8;
+// Lagged differences supported in the VECM
+constexpr int kMaxLags = 2;
+// Regressors in the moment matrix at full capacity
+constexpr size_t kMaxTerms = kMaxLegs * (2 + kMaxLags) + 1;
+
+struct Result {
+    size_t numLegs = 0;
+    std::array<double, kMaxLegs> eigenvalues{};       // descending
+    std::array<double, kMaxLegs> traceStatistics{};   // H0: rank <= r, for r = 0..numLegs-1
+    std::array<double, kMaxLegs> criticalValues{};    // trace critical values at the test level
+    std::array<double, kMaxLegs> weights{};           // first cointegrating vector, weights[0] == 1
+    int rank = 0;
+    bool isCointegrated = false;
+    bool valid = false;                               // false when the moments were singular
+};
+
+// Caller-owned scratch so repeated estimates reuse the same memory
+struct Workspace {
+    std::array<double, kMaxTerms * kMaxTerms> moments;
+    std::array<double, kMaxTerms * kMaxTerms> scratch;
+    std::array<double, kMaxTerms * 2 * kMaxLegs> projection;
+};
+
+// Estimate on `length` bars of numLegs prices stored bar-major:
+// rows[t * kMaxLegs + leg]. numLegs <= kMaxLegs, lags <= kMaxLags.
+Result estimate(const double* rows, size_t length, size_t numLegs, int lags,
+                double significanceLevel, Workspace& workspace);
+
+// Trace test critical value for numFree = numLegs - r stochastic trends
+// (constant in the VECM; 90%, 95% and 99% levels, nearest one is used)
+double traceCriticalValue(size_t numFree, double significanceLevel);
+
+} // namespace Johansen
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Histogram of nanosecond latencies in fixed log-linear buckets: exact below
+// 16 ns, then 8 buckets per power of two, so any percentile is reported
+// within 12.5%. record() is O(1) and never allocates, so it can sit on a hot
+// path; histograms of the same quantity from several threads merge.
+class LatencyHistogram {
+public:
+    // Negative latencies (clock skew across threads) count as 0
+    void record(int64_t nanos) {
+        if (nanos < 0) {
+            nanos = 0;
+        }
+        ++counts_[bucketOf(static_cast<uint64_t>(nanos))];
+        ++count_;
+        total_ += static_cast<double>(nanos);
+        if (nanos > max_) {
+            max_ = nanos;
+        }
+        if (count_ == 1 || nanos < min_) {
+            min_ = nanos;
+        }
+    }
+
+    void merge(const LatencyHistogram& other);
+    void clear() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return count_; }
+    int64_t min() const { return min_; }
+    int64_t max() const { return max_; }
+    double mean() const { return count_ ? total_ / static_cast<double>(count_) : 0.0; }
+
+    // Upper edge of the bucket holding the q-quantile (0 <= q <= 1), capped at max()
+    int64_t percentile(double q) const;
+
+    // "name: N samples, mean, p50 / p90 / p99 / p99.9 / max" in microseconds
+    void print(std::ostream& out, const std::string& name) const;
+
+private:
+    static constexpr unsigned kSubBits = 3;                      // 8 buckets per power of two
+    static constexpr uint64_t kLinear = uint64_t(2) << kSubBits;  // exact below this
+    static constexpr size_t kBuckets = kLinear + (63 - kSubBits - 1) * (size_t(1) << kSubBits);
+
+    static size_t bucketOf(uint64_t nanos);
+    static int64_t upperEdge(size_t bucket);
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t count_ = 0;
+    double total_ = 0.0;
+    int64_t min_ = 0;
+    int64_t max_ = 0;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Backtester.h"
+#include "LatencyHistogram.h"
+#include "SpscQueue.h"
+
+// Live/paper trading. A feed-handler thread reads bars and hands them to the
+// strategy thread over a lock-free SPSC queue; the strategy thread steps a
+// live Backtester (the online AssetPair state machines and the paper position
+// book) and sends an order intent over a second SPSC queue whenever a pair's
+// target position changes. Once started, neither the feed nor the strategy
+// loop allocates.
+
+// Monotonic clock for latency stamps, in nanoseconds
+inline int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One bar handed from the feed to the strategy. The prices stay in the feed's
+// bar ring, so only the slot number crosses the queue.
+struct FeedMessage {
+    uint32_t slot = 0;
+    bool endOfFeed = false;    // no more bars follow
+    int64_t timestamp = 0;     // bar time, epoch nanoseconds
+    int64_t receivedAt = 0;    // steadyNanos() when the feed read the bar
+    int64_t pushedAt = 0;      // steadyNanos() when it entered the queue
+};
+
+// A change of one pair's target position, raised on the bar whose signal
+// changed. Quantities are the target legs sized like a backtest entry at
+// that bar's prices and equity (0 when going flat).
+struct OrderIntent {
+    size_t pairIndex = 0;
+    size_t bar = 0;            // live bar index
+    int64_t timestamp = 0;
+    int direction = 0;         // 1 long spread, -1 short spread, 0 flat
+    double quantityA = 0.0;
+    double quantityB = 0.0;
+    double priceA = 0.0;
+    double priceB = 0.0;
+    int64_t receivedAt = 0;    // feed stamp of the bar
+    int64_t signalledAt = 0;   // when the strategy produced the intent
+};
+
+// Feed handler reading bars in the simulator's CSV layout (a header row, then
+// one row per bar) from a file or "-" for stdin, so anything that writes
+// lines can feed it, e.g. a socket through `nc -l 9000 | StatArbSimulator -
+// --live ...`. Rows are read into a fixed line buffer and parsed straight
+// into a preallocated ring of bar rows. A full queue makes the feed wait
+// rather than drop bars.
+class CsvFeed {
+public:
+    // Queue of at least queueCapacity bars (rounded up to a power of two)
+    explicit CsvFeed(size_t queueCapacity = 1024);
+    ~CsvFeed();
+
+    CsvFeed(const CsvFeed&) = delete;
+    CsvFeed& operator=(const CsvFeed&) = delete;
+
+    // Open the input and read its header; sizes every buffer
+    bool open(const std::string& path);
+
+    const std::vector<std::string>& getSymbols() const { return symbols_; }
+
+    // Release one bar every paceNanos (0 = as fast as they are read), e.g.
+    // to replay a file at its bar rate
+    void setPace(int64_t paceNanos) { paceNanos_ = paceNanos; }
+
+    // Feed-thread loop: read and queue bars until the end of the input, then
+    // queue the end-of-feed message. Stops early on a malformed row.
+    void run();
+
+    SpscQueue<FeedMessage>& getQueue() { return queue_; }
+
+    // Prices of a queued bar, indexed by SymbolId (NaN where the row has no price)
+    const double* getBar(uint32_t slot) const { return bars_.data() + static_cast<size_t>(slot) * symbols_.size(); }
+
+    size_t getBarsRead() const { return barsRead_; }
+    // Bars that found the queue full
+    size_t getStalls() const { return stalls_; }
+    bool failed() const { return failed_; }
+
+private:
+    SpscQueue<FeedMessage> queue_;
+    std::FILE* file_ = nullptr;
+    bool ownsFile_ = false;
+    std::vector<std::string> symbols_;
+    std::vector<char> line_;
+    // The queue's capacity plus two rows: one the strategy is reading and
+    // one being parsed, so no queued bar is ever overwritten
+    std::vector<double> bars_;
+    size_t numSlots_ = 0;
+    int64_t paceNanos_ = 0;
+    size_t barsRead_ = 0;
+    size_t stalls_ = 0;
+    bool failed_ = false;
+
+    void push(const FeedMessage& message);
+};
+
+class LiveTrader {
+public:
+    struct Options {
+        double initialCapital = 1000000.0;
+        double entryThreshold = 1.5;
+        double exitThreshold = 0.0;
+        size_t lookbackWindow = 20;
+        size_t hedgeWindow = 0;
+        bool delayedExecution = true;
+        size_t orderQueueCapacity = 1024;
+    };
+
+    LiveTrader(const std::vector<std::string>& symbols, const Options& options);
+
+    // Add a pair with a known hedge ratio; false if a symbol is not in the feed
+    bool addPair(const std::string& symbolA, const std::string& symbolB, double beta);
+    size_t getNumPairs() const { return backtester_.getNumPairs(); }
+
+    // The paper book: kill criteria, periods per year and verbosity are set
+    // here, positions and metrics read back
+    Backtester& getBacktester() { return backtester_; }
+    const Backtester& getBacktester() const { return backtester_; }
+
+    // Whole session: the feed thread runs `feed`, an order thread passes each
+    // intent to onIntent, and the strategy runs on the calling thread until
+    // the end of the feed. The metrics are computed at the end.
+    void run(CsvFeed& feed, const std::function<void(const OrderIntent&)>& onIntent);
+
+    // The steps of run(), for callers that manage the threads themselves
+    void start();
+    // Strategy loop: consume bars until the end-of-feed message, pushing
+    // intents to getOrders(); waits while the order queue is full
+    void processFeed(CsvFeed& feed);
+    void finish();
+
+    SpscQueue<OrderIntent>& getOrders() { return orders_; }
+
+    // Feed read to signals computed, per bar
+    const LatencyHistogram& getTickToSignal() const { return tickToSignal_; }
+    // Time bars spent in the feed queue
+    const LatencyHistogram& getQueueDelay() const { return queueDelay_; }
+    // Feed read to the order thread receiving the intent (run() only)
+    const LatencyHistogram& getTickToOrder() const { return tickToOrder_; }
+
+    size_t getIntents() const { return intents_; }
+    // Intents that found the order queue full
+    size_t getOrderStalls() const { return orderStalls_; }
+
+private:
+    Options options_;
+    Backtester backtester_;
+    SpscQueue<OrderIntent> orders_;
+    std::vector<int> targets_;     // per pair: direction of the last intent
+    std::atomic<bool> strategyDone_{false};
+    LatencyHistogram tickToSignal_;
+    LatencyHistogram queueDelay_;
+    LatencyHistogram tickToOrder_;
+    size_t intents_ = 0;
+    size_t orderStalls_ = 0;
+
+    // Raise an intent for every pair whose signal differs from its last target
+    void sendIntents(const AssetPair::Signal* signals, const FeedMessage& message);
+};
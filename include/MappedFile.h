@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, file mapping on Windows).
+// The mapping is released when the object is destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map the file; returns false if it cannot be opened or mapped.
+    // An empty file opens successfully with size() == 0.
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return isOpen_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Hint that [offset, offset + length) has been consumed so its pages can be
+    // dropped from memory; they are re-read from disk if touched again.
+    // No-op on Windows.
+    void discard(size_t offset, size_t length);
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool isOpen_ = false;
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#endif
+};
@@ -1,40 +1,260 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <memory>
 #include <optional>
+#include <type_traits>
+#include "AlignedAllocator.h"
+#include "MappedFile.h"
+#include "SeriesView.h"
+#include "Timestamps.h"
+#include "Utilities.h"
+#include "Validity.h"
 
 class MarketData {
 public:
+    // Dense integer handle for a symbol (index into the column store)
+    using SymbolId = uint32_t;
+
+    // Element type of the column store. Float32 and Ticks32 (int32 multiples
+    // of a tick size) halve memory and bandwidth for the screening kernels,
+    // which widen every element to double before accumulating.
+    enum class PriceStorage { Float64, Float32, Ticks32 };
+    
+    // Ticks32 encoding of a missing (NaN) price
+    static constexpr int32_t kMissingTick = std::numeric_limits<int32_t>::min();
+    
+    // How pairwise kernels treat bars where a leg has no price. Drop keeps
+    // only the bars both legs observed; ForwardFill starts at the first bar
+    // both observed and carries each leg's last price over its later gaps.
+    enum class FillPolicy { Drop, ForwardFill };
+
+    // Column-major price store: all symbols share one aligned buffer and each
+    // column is padded to a cache-line multiple, so the price of symbol `id` on
+    // day `d` lives at prices[id * stride + d].
+    // Per-symbol sufficient statistics over the observed bars, cached at load time
+    struct SeriesMoments {
+        double sum = 0.0;
+        double sumSq = 0.0;
+    };
+
     struct TimeSeriesData {
-        std::vector<std::string> dates;
-        std::unordered_map<std::string, std::vector<double>> prices;
+        std::vector<int64_t> timestamps;                         // epoch nanoseconds, one per bar
+        std::vector<std::string> symbols;                        // indexed by SymbolId
+        std::unordered_map<std::string, SymbolId> symbolIndex;
+        size_t stride = 0;
+        AlignedVector<double> prices;                            // empty when cache-backed or narrowed
+        AlignedVector<float> pricesF32;                          // PriceStorage::Float32
+        AlignedVector<int32_t> priceTicks;                       // PriceStorage::Ticks32
+        std::vector<SeriesMoments> moments;                     // indexed by SymbolId
+        // Validity bitmaps (see Validity.h), validityWords words per symbol
+        size_t validityWords = 0;
+        std::vector<Validity::Word> validity;
+        std::vector<size_t> validCounts;                         // observed bars per symbol
+        // Optional prefix sums (stride + 1 per column), see buildPrefixSums()
+        std::vector<double> prefixSum;
+        std::vector<double> prefixSumSq;
     };
 
     // Constructor with filepath
     explicit MarketData(const std::string& dataFilePath);
-    
+
     // Default constructor
     MarketData() = default;
+
+    // Load market data from CSV. The file is memory-mapped and parsed straight
+    // into the column store; large files are parsed in row chunks on
+    // numThreads workers (0 = hardware concurrency). The first column holds
+    // timestamps in a format Timestamps::parse accepts, one row per bar.
+    bool loadFromCSV(const std::string& filePath, size_t numThreads = 0);
+
+    // Binary columnar cache: header, symbol table, timestamps, cached moments,
+    // validity bitmaps, then 64-byte aligned float64 columns. Loading maps the
+    // file and parses nothing.
+    bool saveCache(const std::string& cachePath) const;
+    bool loadFromCache(const std::string& cachePath);
+    static std::string cachePathFor(const std::string& csvPath) { return csvPath + ".sacache"; }
+    
+    // True when the data came from a memory-mapped cache
+    bool isCacheBacked() const { return cacheMapping_ != nullptr; }
+    
+    // Narrow the loaded float64 store to float32 or to ticks of tickSize
+    // (prices are rounded to the nearest tick). The float64 columns are
+    // released and the cached moments are recomputed from the stored values.
+    // After narrowing, getPrices() decodes a symbol's column to double on its
+    // first call and keeps it, so only traded symbols pay for float64.
+    // Returns false if the store is already narrowed or a price does not fit
+    // in int32 ticks.
+    bool setPriceStorage(PriceStorage storage, double tickSize = 1e-4);
+    PriceStorage getPriceStorage() const { return storage_; }
+    double getTickSize() const { return tickSize_; }
+    
+    // Raw column in the active storage type; T must match getPriceStorage()
+    template <typename T>
+    const T* getColumn(SymbolId id) const {
+        if constexpr (std::is_same_v<T, float>) {
+            return data_.pricesF32.data() + id * data_.stride;
+        } else if constexpr (std::is_same_v<T, int32_t>) {
+            return data_.priceTicks.data() + id * data_.stride;
+        } else {
+            return priceBase_ + id * data_.stride;
+        }
+    }
     
-    // Load market data from CSV
-    bool loadFromCSV(const std::string& filePath);
+    // Stored element to price
+    double decode(double price) const { return price; }
+    double decode(float price) const { return price; }
+    double decode(int32_t ticks) const {
+        return ticks == kMissingTick ? std::numeric_limits<double>::quiet_NaN() : ticks * tickSize_;
+    }
     
-    // Get price series for a specific asset
-    std::optional<std::vector<double>> getPriceSeries(const std::string& symbol) const;
+    // Call fn(T()) for the active storage type T, so a kernel written as a
+    // generic lambda is instantiated once per element type
+    template <typename Fn>
+    decltype(auto) visitStorage(Fn&& fn) const {
+        switch (storage_) {
+        case PriceStorage::Float32:
+            return fn(float());
+        case PriceStorage::Ticks32:
+            return fn(int32_t());
+        default:
+            return fn(double());
+        }
+    }
+    
+    // Get price series for a specific asset (zero-copy view into the store)
+    std::optional<PriceView> getPriceSeries(const std::string& symbol) const;
+
+    // Symbol interning
+    std::optional<SymbolId> getSymbolId(const std::string& symbol) const;
+    const std::string& getSymbol(SymbolId id) const { return data_.symbols[id]; }
+    size_t getNumSymbols() const { return data_.symbols.size(); }
+
+    // Direct column access by id (no lookup)
+    PriceView getPrices(SymbolId id) const {
+        if (!priceBase_) {
+            return decodedPrices(id);
+        }
+        return PriceView(priceBase_ + id * data_.stride, data_.timestamps.size());
+    }
+    double getPrice(SymbolId id, size_t day) const {
+        if (!priceBase_) {
+            return visitStorage([&](auto tag) { return decode(getColumn<decltype(tag)>(id)[day]); });
+        }
+        return priceBase_[id * data_.stride + day];
+    }
+
+    // Σx and Σx² over the bars a symbol has a price on, cached at load time
+    const SeriesMoments& getMoments(SymbolId id) const { return data_.moments[id]; }
     
-    // Get date series
-    const std::vector<std::string>& getDateSeries() const;
+    // Validity bitmap of a symbol, built wherever the moments are
+    const Validity::Word* getValidity(SymbolId id) const {
+        return data_.validity.data() + id * data_.validityWords;
+    }
+    size_t getValidCount(SymbolId id) const { return data_.validCounts[id]; }
+    bool isComplete(SymbolId id) const { return data_.validCounts[id] == data_.timestamps.size(); }
     
-    // Get all available symbols
-    std::vector<std::string> getAvailableSymbols() const;
+    // Policy of alignPair() and everything built on it (default Drop)
+    void setFillPolicy(FillPolicy policy) { fillPolicy_ = policy; }
+    FillPolicy getFillPolicy() const { return fillPolicy_; }
     
-    // Get number of trading days in the dataset
+    // Dense bar ranges two symbols are aligned on under the fill policy:
+    // {[0, n)} when neither has gaps, else the runs of their intersected
+    // bitmaps (Drop) or [first bar both observed, n) (ForwardFill). Kernels
+    // over these ranges never see a missing price. Replaces `ranges`.
+    void alignPair(SymbolId x, SymbolId y, std::vector<Validity::Range>& ranges) const;
+    
+    // Copy a symbol's prices over `ranges` into `out`, back to back
+    // (Validity::length(ranges) values). Bars the symbol has no price on take
+    // its last earlier price, or NaN before its first.
+    void gatherPrices(SymbolId id, const std::vector<Validity::Range>& ranges, double* out) const;
+    
+    // alignPair() and gatherPrices() for both legs; the outputs are resized
+    // to the aligned length and may be reused across calls
+    void alignPrices(SymbolId x, SymbolId y, std::vector<Validity::Range>& ranges,
+                     std::vector<double>& alignedX, std::vector<double>& alignedY) const;
+    
+    // The symbol's prices with every gap after its first price forward-filled,
+    // as backtests mark positions. A view into the store for complete symbols,
+    // else a column filled on its first call and kept.
+    PriceView getFilledPrices(SymbolId id) const;
+    
+    // Regression sums for y on x over the bars alignPair(x, y) keeps. Without
+    // gaps only the cross term Σxy is computed; otherwise both legs are
+    // gathered onto their aligned ranges and summed there.
+    Utilities::RegressionSums getRegressionSums(SymbolId x, SymbolId y) const;
+    
+    // Build per-symbol prefix sums so window moments are O(1)
+    void buildPrefixSums();
+    bool hasPrefixSums() const { return !data_.prefixSum.empty(); }
+    
+    // Σx and Σx² over days [begin, end); uses prefix sums when built
+    SeriesMoments getWindowMoments(SymbolId id, size_t begin, size_t end) const;
+    
+    // Copy of days [begin, end) for the given symbols (all when empty) as a
+    // float64 store with its own moments and bitmaps; ids follow the order
+    // given. The slice keeps this data's bar interval, periods per year and
+    // fill policy.
+    MarketData slice(size_t begin, size_t end, const std::vector<SymbolId>& symbols = {}) const;
+    
+    // Aggregate to bars of `interval` nanoseconds (e.g. 5m, 1h or 1d) as a new
+    // float64 store. Consecutive bars in the same epoch-aligned bucket form
+    // one bar, stamped with the bucket start and priced at each symbol's last
+    // non-missing price in it (NaN if it has none). One pass over the
+    // timestamps finds the bar boundaries, then each column's bitmap locates
+    // every bar's last observed price, so only those prices are read, in any
+    // storage type; bar interval and periods per year are re-derived from the
+    // new timestamps and the fill policy is kept.
+    MarketData resample(int64_t interval) const;
+    
+    // Bar timestamps in epoch nanoseconds (UTC)
+    const std::vector<int64_t>& getTimestamps() const { return data_.timestamps; }
+    
+    // Smallest spacing between bars (0 with fewer than two bars)
+    int64_t getBarInterval() const { return barInterval_; }
+    
+    // Annualization factor for metrics: 252 x the average bars per calendar
+    // day, derived at load time, unless overridden
+    double getPeriodsPerYear() const { return periodsPerYear_; }
+    void setPeriodsPerYear(double periodsPerYear) { periodsPerYear_ = periodsPerYear; }
+
+    // Get all available symbols, in SymbolId order
+    const std::vector<std::string>& getAvailableSymbols() const;
+
+    // Get number of bars in the dataset
     size_t getDataSize() const;
 
 private:
     TimeSeriesData data_;
     bool isDataLoaded_ = false;
-}; 
\ No newline at end of file
+    const double* priceBase_ = nullptr;                 // data_.prices or the mapped cache
+    std::shared_ptr<MappedFile> cacheMapping_;
+    PriceStorage storage_ = PriceStorage::Float64;
+    double tickSize_ = 1.0;
+    int64_t barInterval_ = 0;
+    double periodsPerYear_ = Timestamps::kTradingDaysPerYear;
+    FillPolicy fillPolicy_ = FillPolicy::Drop;
+    
+    // float64 columns decoded on demand from a narrowed store
+    mutable std::vector<AlignedVector<double>> decoded_;
+    mutable std::unique_ptr<std::once_flag[]> decodeOnce_;
+    
+    // Forward-filled columns of symbols with gaps, built on demand
+    mutable std::vector<AlignedVector<double>> filled_;
+    mutable std::unique_ptr<std::once_flag[]> fillOnce_;
+    
+    PriceView decodedPrices(SymbolId id) const;
+    void resetStorage();
+    // Validity bitmaps from the stored columns, then moments over the observed bars
+    void computeMoments();
+    // Observed-bar counts from the bitmaps; resets the filled columns
+    void countValidity();
+    // Bar interval and periods per year from the timestamps
+    void computeCalendar();
+};
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "MappedFile.h"
+#include "MarketData.h"
+
+// Forward-only reader that walks a market data CSV in fixed-size time chunks.
+// Only one chunk of rows is parsed at a time, plus the last bar of the previous
+// chunk, so memory is O(symbols x chunk) however long the history is.
+// Consumed parts of the mapped file are released as the stream advances.
+// Uses the same CSV layout and parsing rules as MarketData::loadFromCSV.
+class MarketDataStream {
+public:
+    using SymbolId = MarketData::SymbolId;
+
+    explicit MarketDataStream(size_t chunkBars = 4096);
+
+    // Map the file, read the header and count the rows (nothing is parsed yet)
+    bool open(const std::string& filePath);
+
+    // Go back to before the first chunk
+    void rewind();
+
+    // Parse the next chunk of rows; false once the file is exhausted or on a
+    // row whose timestamp does not parse
+    bool nextChunk();
+
+    // Carry each symbol's last price over the missing cells of the current
+    // chunk, the carried bar included, as backtests mark a leg through a gap
+    // (MarketData::getFilledPrices). Cells before a symbol's first price stay NaN.
+    void fillForward();
+
+    // Symbol interning, same ids as a MarketData loaded from the same file
+    std::optional<SymbolId> getSymbolId(const std::string& symbol) const;
+    const std::string& getSymbol(SymbolId id) const { return symbols_[id]; }
+    size_t getNumSymbols() const { return symbols_.size(); }
+    const std::vector<std::string>& getAvailableSymbols() const { return symbols_; }
+
+    // Total bars in the file, known after open()
+    size_t getDataSize() const { return numDays_; }
+    size_t getChunkBars() const { return chunkBars_; }
+
+    // Bars of the current chunk: [getChunkBegin(), getChunkEnd())
+    size_t getChunkBegin() const { return chunkBegin_; }
+    size_t getChunkEnd() const { return chunkEnd_; }
+
+    // Price on a global bar index of the current chunk, or the bar just before it
+    double getPrice(SymbolId id, size_t day) const {
+        return prices_[id * stride_ + (day + 1 - chunkBegin_)];
+    }
+    int64_t getTimestamp(size_t day) const { return timestamps_[day - chunkBegin_]; }
+
+private:
+    size_t chunkBars_;
+    size_t stride_;                      // chunkBars_ + 1; slot 0 holds the carried bar
+    MappedFile file_;
+    const char* body_ = nullptr;         // first data row
+    const char* cursor_ = nullptr;       // next unparsed row
+    std::vector<std::string> symbols_;
+    std::unordered_map<std::string, SymbolId> symbolIndex_;
+    size_t numDays_ = 0;
+    size_t chunkBegin_ = 0;
+    size_t chunkEnd_ = 0;
+    AlignedVector<double> prices_;       // symbols x stride, column-major
+    std::vector<int64_t> timestamps_;
+};
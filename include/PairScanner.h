@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "MarketData.h"
+#include "Shard.h"
+
+// A pair that passed the cointegration screen
+struct PairCandidate {
+    MarketData::SymbolId symbolA = 0;
+    MarketData::SymbolId symbolB = 0;
+    double beta = 0.0;
+    double adfStatistic = 0.0;
+    double pValue = 1.0;
+};
+
+// Screens the upper-triangular pair space of a universe for cointegration.
+// The symbol universe is cut into blocks and each (row block, column block)
+// tile is a task on a work-stealing thread pool. A tile first computes all of
+// its cross terms Σxy in one cache-blocked pass over time, then combines them
+// with the per-symbol sums cached in MarketData, so the regression stage costs
+// no further pass over the data. Spreads are then ADF-tested in batches of
+// Utilities::kAdfBatchLanes interleaved series. Only accepted pairs are returned.
+// Narrowed stores (MarketData::setPriceStorage) are read in their stored type.
+//
+// A pair with a missing price in either leg does not use the cached sums: it
+// is aligned under the data's fill policy (MarketData::alignPair), and its
+// regression and ADF test run on the dense aligned bars. A gap therefore
+// costs the pair those bars rather than turning its statistics into NaN.
+//
+// With Options::topK set, a cheap prefilter runs first: the return correlation
+// matrix of the universe is computed as a tiled Zᵀ Z product (Eigen per tile
+// when built with USE_EIGEN), and a pair is tested only if one leg is among
+// the other's K most correlated symbols, so at most N * K pairs reach the
+// regression and ADF stages instead of N(N-1)/2.
+//
+// With Options::prescreenBars set, screening is staged: each spread is first
+// ADF-tested on its first prescreenBars bars only, and only pairs whose
+// statistic there is below prescreenStatistic go on to the full-length test.
+// A worker keeps batching survivors and moves on as soon as a batch is
+// rejected, so pruned pairs cost a prefix of the data instead of all of it.
+// The stage is a heuristic: a pair that fails on the prefix is never tested
+// in full.
+//
+// With Options::shard set, only pairs whose first leg falls in the shard's
+// rows are screened. Shards partition the pair space, and their results
+// concatenated in shard order equal the unsharded scan.
+class PairScanner {
+public:
+    struct Options {
+        size_t numThreads = 0;           // 0 = hardware concurrency
+        size_t blockSize = 32;           // symbols per tile edge
+        size_t timeBlock = 512;          // bars per cache block in the Σxy pass
+        double significanceLevel = 0.05;
+        size_t topK = 0;                 // correlation prefilter partners per symbol (0 = test all pairs)
+        Shard shard;                     // screen only this shard's first-leg rows (Shard::triangleRows)
+        size_t prescreenBars = 0;        // bars in the cheap ADF stage (0 = single full-length test)
+        double prescreenStatistic = -1.0; // prefix ADF statistic a pair must get below to be tested in full
+    };
+
+    PairScanner(std::shared_ptr<const MarketData> marketData, Options options);
+    explicit PairScanner(std::shared_ptr<const MarketData> marketData);
+
+    // Screen all pairs of the full universe
+    std::vector<PairCandidate> scan();
+
+    // Screen all pairs of a subset of symbols
+    std::vector<PairCandidate> scan(const std::vector<MarketData::SymbolId>& universe);
+
+    // Number of pairs evaluated by the last scan
+    size_t getPairsTested() const { return pairsTested_; }
+    
+    // Of those, the number rejected by the prescreen stage
+    size_t getPairsPruned() const { return pairsPruned_; }
+
+    // Pearson correlation of simple daily returns for every pair of the universe,
+    // row-major universe.size() x universe.size(). Non-finite returns count as
+    // zero; a constant series has zero correlation with everything.
+    static std::vector<double> returnCorrelations(const MarketData& marketData,
+                                                  const std::vector<MarketData::SymbolId>& universe,
+                                                  size_t numThreads = 0, size_t blockSize = 64);
+
+    // Σxy for every (row, column) symbol combination of one tile, written
+    // row-major into out (rows.size() * cols.size())
+    static void crossProductTile(const MarketData& marketData,
+                                 const MarketData::SymbolId* rows, size_t numRows,
+                                 const MarketData::SymbolId* cols, size_t numCols,
+                                 size_t timeBlock, double* out);
+
+private:
+    std::shared_ptr<const MarketData> marketData_;
+    Options options_;
+    size_t pairsTested_ = 0;
+    size_t pairsPruned_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Backtester.h"
+#include "CostModel.h"
+#include "MarketData.h"
+#include "PairScanner.h"
+#include "Shard.h"
+
+// Evaluates a grid of entry/exit thresholds and lookback windows against one
+// loaded MarketData and one set of screened pairs. Z-scores are computed once
+// per (pair, window) and shared by every threshold combination; grid points
+// run in parallel, each worker with its own quiet Backtester.
+class ParameterSweep {
+public:
+    struct Grid {
+        std::vector<double> entryThresholds;
+        std::vector<double> exitThresholds;
+        std::vector<size_t> lookbackWindows;
+
+        size_t size() const {
+            return entryThresholds.size() * exitThresholds.size() * lookbackWindows.size();
+        }
+    };
+
+    struct Options {
+        double initialCapital = 1000000.0;
+        bool delayedExecution = true;
+        size_t numThreads = 0;   // 0 = hardware concurrency
+        size_t hedgeRatioWindow = 0;  // 0 = static beta
+        Shard shard;             // evaluate only this shard's contiguous block of grid points
+        CostModel costs;         // charged on every grid point's fills
+        Backtester::KillCriteria kill;  // stop hopeless grid points early
+    };
+
+    struct Result {
+        double entryThreshold = 0.0;
+        double exitThreshold = 0.0;
+        size_t lookbackWindow = 0;
+        Backtester::PerformanceMetrics metrics;
+        bool pruned = false;     // stopped by the kill criteria; metrics cover barsRun bars
+        size_t barsRun = 0;
+    };
+
+    ParameterSweep(std::shared_ptr<MarketData> marketData,
+                   std::vector<PairCandidate> pairs,
+                   Options options);
+
+    // Evaluate every grid point (or the shard's block of them); results are
+    // ordered window-major, then entry, then exit
+    std::vector<Result> run(const Grid& grid) const;
+
+    // Parse a spec such as "entry=1.0:3.0:0.25,window=20,60,120". Each axis is
+    // either start:stop:step or a comma separated list; axes not mentioned keep
+    // the single value already in `grid`.
+    static bool parseGrid(const std::string& spec, Grid& grid);
+
+    // Write one consolidated metrics table
+    static bool exportResults(const std::string& filename, const std::vector<Result>& results);
+
+private:
+    std::shared_ptr<MarketData> marketData_;
+    std::vector<PairCandidate> pairs_;
+    Options options_;
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include "Timestamps.h"
+#include "Utilities.h"
+
+// Summary statistics of one backtest (0% risk-free rate), annualized with the
+// data's periods per year (252 for daily bars)
+struct PerformanceMetrics {
+    double totalReturn = 0.0;
+    double annualizedReturn = 0.0;
+    double sharpeRatio = 0.0;
+    double maxDrawdown = 0.0;
+    int winCount = 0;
+    int lossCount = 0;
+    double avgHoldingPeriod = 0.0;       // in bars
+    double avgWin = 0.0;
+    double avgLoss = 0.0;
+};
+
+// PerformanceMetrics accumulated online: each bar's portfolio value and each
+// closed trade is one O(1) update and no history is kept. Accumulators over
+// consecutive stretches of one equity curve merge into the accumulator of the
+// whole curve, and trade aggregates of disjoint trade sets add, so partial
+// results from threads, chunks or shards combine without revisiting a bar.
+class MetricsAccumulator {
+public:
+    void addValue(double value) {
+        if (numValues_ == 0) {
+            firstValue_ = value;
+            peak_ = value;
+            trough_ = value;
+        } else {
+            dailyReturns_.add((value / lastValue_) - 1.0);
+        }
+        ++numValues_;
+        lastValue_ = value;
+        if (value > peak_) {
+            peak_ = value;
+        } else {
+            double drawdown = (peak_ - value) / peak_;
+            if (drawdown > maxDrawdown_) {
+                maxDrawdown_ = drawdown;
+            }
+        }
+        if (value < trough_) {
+            trough_ = value;
+        }
+    }
+
+    void addTrade(double pnl, int holdingDays) {
+        if (pnl > 0) {
+            ++winCount_;
+            totalWins_ += pnl;
+        } else {
+            ++lossCount_;
+            totalLosses_ += pnl;
+        }
+        totalHoldingDays_ += holdingDays;
+    }
+
+    // Append `later`: its values follow this accumulator's last value and its
+    // trades are added to this one's
+    void merge(const MetricsAccumulator& later);
+
+    size_t numValues() const { return numValues_; }
+    double lastValue() const { return lastValue_; }
+    double currentDrawdown() const { return numValues_ ? (peak_ - lastValue_) / peak_ : 0.0; }
+    double maxDrawdown() const { return maxDrawdown_; }
+    int numTrades() const { return winCount_ + lossCount_; }
+
+    // Annualized Sharpe ratio of the per-bar returns so far (0 without dispersion)
+    double sharpeRatio(double periodsPerYear = Timestamps::kTradingDaysPerYear) const {
+        double stdDailyReturn = dailyReturns_.stdDev();
+        return stdDailyReturn > 0 ? (dailyReturns_.mean() / stdDailyReturn) * std::sqrt(periodsPerYear) : 0.0;
+    }
+
+    // Metrics of everything added so far, returns measured against initialCapital
+    PerformanceMetrics finish(double initialCapital,
+                              double periodsPerYear = Timestamps::kTradingDaysPerYear) const;
+
+private:
+    size_t numValues_ = 0;
+    double firstValue_ = 0.0;
+    double lastValue_ = 0.0;
+    double peak_ = 0.0;
+    double trough_ = 0.0;        // lets a merge see drawdowns from an earlier peak
+    double maxDrawdown_ = 0.0;
+    Utilities::RollingMoments dailyReturns_;
+
+    int winCount_ = 0;
+    int lossCount_ = 0;
+    double totalWins_ = 0.0;
+    double totalLosses_ = 0.0;
+    double totalHoldingDays_ = 0.0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Lightweight scoped timers and counters for the hot paths. The
+// STATARB_PROFILE_* macros compile to nothing unless the build defines
+// STATARB_PROFILING (CMake option ENABLE_PROFILING); when compiled in, each
+// scope costs one relaxed load until recording is switched on with
+// setEnabled(true) (the --profile flag).
+namespace Profiler {
+    enum class Counter {
+        PairsTested,
+        PairsAccepted,
+        PairsPruned,    // rejected by the staged screen's subsample test
+        BasketsTested,
+        BasketsAccepted,
+        BarsProcessed,
+        RunsPruned,     // backtests stopped by their kill criteria
+        Allocations,    // global operator new calls, profiling and test builds only
+        BytesLoaded,
+        Count
+    };
+    
+    const char* counterName(Counter counter);
+    
+    // True when the STATARB_PROFILE_* macros are compiled in
+    bool isCompiledIn();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    
+    // Drop recorded events and zero the counters; call while no scope is open
+    void reset();
+    
+    void addCounter(Counter counter, uint64_t amount);
+    uint64_t getCounter(Counter counter);
+    
+    // Records [construction, destruction) as one event on the calling thread.
+    // `name` must outlive the report (string literals in practice).
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(const char* name);
+        ~ScopedTimer();
+        
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        
+    private:
+        const char* name_;
+        int64_t startNs_;
+    };
+    
+    // Recorded time per scope name, in order of first appearance
+    struct PhaseStats {
+        std::string name;
+        uint64_t calls = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+    };
+    
+    std::vector<PhaseStats> phaseSummary();
+    
+    // Phase table followed by the counters
+    void printReport(std::ostream& out);
+    
+    // Every event as Chrome trace JSON (chrome://tracing, Perfetto)
+    bool writeChromeTrace(const std::string& filePath);
+}
+
+#define STATARB_PROFILE_CONCAT_INNER(a, b) a##b
+#define STATARB_PROFILE_CONCAT(a, b) STATARB_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef STATARB_PROFILING
+#define STATARB_PROFILE_SCOPE(name) \
+    Profiler::ScopedTimer STATARB_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define STATARB_PROFILE_COUNT(counter, amount) \
+    Profiler::addCounter(Profiler::Counter::counter, static_cast<uint64_t>(amount))
+#else
+#define STATARB_PROFILE_SCOPE(name) ((void)0)
+#define STATARB_PROFILE_COUNT(counter, amount) ((void)0)
+#endif
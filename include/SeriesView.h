@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Non-owning, read-only view over a contiguous series (C++17 stand-in for std::span).
+// The viewed storage must outlive the view.
+template <typename T>
+class SeriesView {
+public:
+    SeriesView() = default;
+    SeriesView(const T* data, size_t size) : data_(data), size_(size) {}
+
+    template <typename Alloc>
+    SeriesView(const std::vector<T, Alloc>& vec) : data_(vec.data()), size_(vec.size()) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T& front() const { return data_[0]; }
+    const T& back() const { return data_[size_ - 1]; }
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    // Sub-views
+    SeriesView first(size_t count) const { return {data_, count < size_ ? count : size_}; }
+    SeriesView subview(size_t offset, size_t count) const {
+        if (offset > size_) offset = size_;
+        if (count > size_ - offset) count = size_ - offset;
+        return {data_ + offset, count};
+    }
+
+    // Copy out into an owning vector
+    std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+using PriceView = SeriesView<double>;
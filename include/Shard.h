@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// One node's share of a study (--shard i/N). Work is cut into contiguous,
+// deterministic units that depend only on the problem size and i/N, so
+// independent processes agree on the split without any shared state, and
+// concatenating shard outputs in shard order reproduces the unsharded order.
+struct Shard {
+    size_t index = 0;
+    size_t count = 1;
+
+    bool isWhole() const { return count <= 1; }
+
+    // Items [begin, end) of `total`, in near-equal contiguous blocks
+    std::pair<size_t, size_t> range(size_t total) const;
+
+    // First-leg rows [begin, end) of the upper-triangular pair space of n
+    // symbols, balanced by pair count (row i holds n - 1 - i pairs)
+    std::pair<size_t, size_t> triangleRows(size_t n) const;
+
+    // Parse "i/N" with 0 <= i < N
+    static bool parse(const std::string& spec, Shard& shard);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include "AssetPair.h"
+#include "StrategyPolicies.h"
+#include "Utilities.h"
+
+// One pass over a spread: Welford moments over the trailing window, z-score,
+// then the threshold state machine. spreadAt(i) is called for the incoming bar
+// and again for the bar leaving the window, so spreads can be derived from
+// prices on the fly instead of being stored. Matches Utilities::rollingZScore.
+// Shared by AssetPair (two legs) and SpreadBasket (N legs). The filling part of
+// the window is peeled off, so the steady-state loop has no warm-up branch and
+// only a zero-dispersion window can produce a NaN z-score.
+template <typename SpreadFn, typename Threshold, typename SignalT>
+void zScoreSignalPass(SpreadFn&& spreadAt, size_t n, size_t window, const Threshold& rule,
+                      SignalT* signals, double* zScores) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    
+    // No z-score (hence no signal) until the window holds `window` spreads
+    const size_t warmup = (window == 0) ? n : std::min(n, window - 1);
+    std::fill(zScores, zScores + (zScores ? warmup : 0), nan);
+    std::fill(signals, signals + (signals ? warmup : 0), SignalT(0));
+    if (warmup == n) {
+        return;
+    }
+    
+    Utilities::RollingMoments moments;
+    for (size_t i = 0; i < warmup; ++i) {
+        moments.add(spreadAt(i));
+    }
+    
+    int position = 0;
+    auto emit = [&](size_t i, double spread) {
+        double sd = moments.stdDev();
+        double z = (sd > 0) ? (spread - moments.mean()) / sd : nan;
+        if (zScores) zScores[i] = z;
+        int signal = rule.step(position, z);
+        if (signals) signals[i] = static_cast<SignalT>(signal);
+    };
+    
+    double first = spreadAt(warmup);
+    moments.add(first);
+    emit(warmup, first);
+    for (size_t i = window; i < n; ++i) {
+        double spread = spreadAt(i);
+        moments.replace(spreadAt(i - window), spread);
+        emit(i, spread);
+    }
+}
+
+// Lookback actually used by the batch signal paths: windows that do not fit
+// the history shrink to half its length (at least 2 bars)
+inline size_t effectiveLookback(size_t window, size_t n) {
+    if (window >= n) {
+        window = n / 2;     // Default to half the series length
+        if (window < 2) window = 2;    // Minimum window size
+    }
+    return window > n ? 0 : window;
+}
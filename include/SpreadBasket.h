@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "AssetPair.h"
+#include "Johansen.h"
+#include "SeriesView.h"
+#include "Utilities.h"
+
+// N-leg generalisation of AssetPair: spread_t = sum_i w_i * price_i,t for up to
+// Johansen::kMaxLegs legs. Prices are copied into bar-major rows padded to
+// kMaxLegs with zero weights on the unused lanes, so each bar's spread is one
+// fixed-width dot product. Weights come from the Johansen estimator (first leg
+// normalised to 1) or are set directly; a two-leg basket with weights
+// (1, -beta) is the AssetPair spread.
+class SpreadBasket {
+public:
+    using Signal = AssetPair::Signal;
+    static constexpr size_t kMaxLegs = Johansen::kMaxLegs;
+
+    // Basket over price histories of equal length (longer legs are truncated)
+    SpreadBasket(const std::vector<std::string>& symbols, const std::vector<PriceView>& prices);
+
+    // Streaming-only basket with known weights and no price history
+    SpreadBasket(const std::vector<std::string>& symbols, const std::vector<double>& weights);
+
+    size_t getNumLegs() const { return symbols_.size(); }
+    const std::vector<std::string>& getSymbols() const { return symbols_; }
+    size_t getNumBars() const { return numBars_; }
+    double getPrice(size_t bar, size_t leg) const { return rows_[bar * kMaxLegs + leg]; }
+
+    std::vector<double> getWeights() const;
+    void setWeights(const std::vector<double>& weights, bool isCointegrated = true);
+
+    // Spread on one bar, and the full series on request
+    double getSpread(size_t i) const { return dot(rows_.data() + i * kMaxLegs); }
+    std::vector<double> getSpreads() const;
+    std::vector<double> getZScores(size_t window) const;
+
+    // Johansen trace test on the basket; adopts the first cointegrating vector
+    bool testCointegration(double significanceLevel = 0.05, int lags = 1);
+    const Johansen::Result& getCointegrationResult() const { return cointegration_; }
+    bool isCointegrated() const { return isCointegrated_; }
+
+    // Same threshold rules and window handling as AssetPair::generateSignals
+    std::vector<int> generateSignals(double entryThreshold = 1.5,
+                                     double exitThreshold = 0.0,
+                                     size_t lookbackWindow = 20) const;
+    void computeSignals(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                        Signal* signals, double* zScores = nullptr) const;
+
+    // Online mode, as AssetPair::startStreaming / onBar; onBar takes one price per leg
+    void startStreaming(double entryThreshold, double exitThreshold, size_t lookbackWindow);
+    int onBar(const double* prices);
+    double getCurrentZScore() const { return stream_.zScore; }
+    int getCurrentSignal() const { return stream_.signal; }
+    size_t getBarsSeen() const { return stream_.bars; }
+
+private:
+    std::vector<std::string> symbols_;
+    AlignedVector<double> rows_;                  // numBars_ x kMaxLegs, bar-major
+    size_t numBars_ = 0;
+    alignas(64) double weights_[kMaxLegs] = {};   // zero beyond the last leg
+    Johansen::Result cointegration_;
+    bool isCointegrated_ = false;
+
+    struct StreamingState {
+        Utilities::RollingWindow window;
+        double entryThreshold = 1.5;
+        double exitThreshold = 0.0;
+        double zScore = 0.0;
+        int position = 0;
+        int signal = 0;
+        size_t bars = 0;
+    };
+    StreamingState stream_;
+
+    // Pairwise sum over all kMaxLegs lanes so the whole row reduces in SIMD
+    double dot(const double* row) const {
+        double p[kMaxLegs];
+        for (size_t k = 0; k < kMaxLegs; ++k) {
+            p[k] = row[k] * weights_[k];
+        }
+        static_assert(kMaxLegs == 8, "dot() reduces exactly eight lanes");
+        return ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The ring is allocated once, at construction, with the capacity
+// rounded up to a power of two. Each side's index sits on its own cache line
+// next to a cached copy of the other side's index, so a push or pop only
+// reads the other line when the ring looks full (or empty).
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side: false when the ring is full
+    bool tryPush(const T& item) {
+        const size_t tail = producer_.tail.load(std::memory_order_relaxed);
+        if (tail - producer_.cachedHead == slots_.size()) {
+            producer_.cachedHead = consumer_.head.load(std::memory_order_acquire);
+            if (tail - producer_.cachedHead == slots_.size()) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = item;
+        producer_.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: false when the ring is empty
+    bool tryPop(T& item) {
+        const size_t head = consumer_.head.load(std::memory_order_relaxed);
+        if (head == consumer_.cachedTail) {
+            consumer_.cachedTail = producer_.tail.load(std::memory_order_acquire);
+            if (head == consumer_.cachedTail) {
+                return false;
+            }
+        }
+        item = slots_[head & mask_];
+        consumer_.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+    // Items in the ring; exact only when neither side is running
+    size_t size() const {
+        return producer_.tail.load(std::memory_order_acquire) - consumer_.head.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Producer {
+        std::atomic<size_t> tail{0};     // next slot to write
+        size_t cachedHead = 0;
+    };
+    struct alignas(kCacheLine) Consumer {
+        std::atomic<size_t> head{0};     // next slot to read
+        size_t cachedTail = 0;
+    };
+
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    Producer producer_;
+    Consumer consumer_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+// Compile-time policies for the strategy kernels. The signal pass and the
+// backtest loops take these as template parameters and the run entry points
+// pick the instantiation once from the runtime settings, so the per-bar loop
+// carries no execution-delay, hedge-model or NaN branches of its own. A new
+// strategy variant is a new policy type with the same members; nothing in the
+// inner loop becomes virtual.
+namespace StrategyPolicies {
+
+// ---- Execution delay: bar on which a signal from `day` fills ----------------
+
+// Fill on the signal bar's close
+struct SameBarExecution {
+    static constexpr size_t kDelay = 0;
+    static size_t executionDay(size_t day, size_t /*lastDay*/) { return day; }
+};
+
+// T+1: fill on the next bar, except the last bar fills on itself
+struct NextBarExecution {
+    static constexpr size_t kDelay = 1;
+    static size_t executionDay(size_t day, size_t lastDay) { return std::min(day + 1, lastDay); }
+};
+
+// ---- Hedge-ratio model: hedge ratio in force on bar i ----------------------
+
+struct StaticHedge {
+    double beta;
+    double operator()(size_t) const { return beta; }
+};
+
+// Per-bar estimates, e.g. from AssetPair::estimateRollingHedgeRatio
+struct RollingHedge {
+    const double* betas;
+    double operator()(size_t i) const { return betas[i]; }
+};
+
+// ---- Threshold rule: position state machine on the z-score ------------------
+
+// Enter short above +entry and long below -entry (entry >= 0); leave a long
+// once z >= -exit and a short once z <= exit. The next position is formed from
+// comparison results rather than branches. NaN compares false everywhere, so
+// a NaN z-score keeps the position and reports no signal.
+struct ZScoreBands {
+    double entryThreshold;
+    double exitThreshold;
+
+    int step(int& position, double z) const {
+        const int enter = static_cast<int>(z < -entryThreshold) - static_cast<int>(z > entryThreshold);
+        const int stay = (static_cast<int>(position > 0) & static_cast<int>(!(z >= -exitThreshold))) |
+                         (static_cast<int>(position < 0) & static_cast<int>(!(z <= exitThreshold)));
+        position = (position == 0) ? enter : position * stay;
+        return position * static_cast<int>(z == z);
+    }
+};
+
+} // namespace StrategyPolicies
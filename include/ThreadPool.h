@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool. Each worker owns a task deque; it pops
+// from the front of its own deque and, when empty, steals from the back of the
+// others, so uneven chunks balance themselves out.
+class ThreadPool {
+public:
+    // numThreads == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Queue a task; tasks are distributed round-robin over the worker deques
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished
+    void wait();
+
+    // Split [begin, end) into chunks of `grain` indices and run
+    // fn(chunkBegin, chunkEnd, workerIndex) for each chunk, then wait.
+    template <typename Fn>
+    void parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn);
+
+    // Index of the calling worker thread, or size() when called from outside the pool
+    size_t currentWorker() const;
+
+    static size_t resolveThreadCount(size_t requested);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeCondition_;
+    std::condition_variable doneCondition_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> nextQueue_{0};
+    bool stopping_ = false;
+
+    bool tryPop(size_t worker, std::function<void()>& task);
+    void workerLoop(size_t worker);
+};
+
+template <typename Fn>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn) {
+    if (begin >= end) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    for (size_t lo = begin; lo < end; lo += grain) {
+        size_t hi = (end - lo > grain) ? lo + grain : end;
+        submit([this, lo, hi, &fn]() { fn(lo, hi, currentWorker()); });
+    }
+    wait();
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bar timestamps as int64 nanoseconds since the Unix epoch (UTC), and the
+// bar-frequency arithmetic built on them
+namespace Timestamps {
+
+constexpr int64_t kNanosPerSecond = 1000000000;
+constexpr int64_t kNanosPerMinute = 60 * kNanosPerSecond;
+constexpr int64_t kNanosPerHour = 60 * kNanosPerMinute;
+constexpr int64_t kNanosPerDay = 24 * kNanosPerHour;
+
+// Bars per year of a daily series; intraday series scale it by their bars per day
+constexpr double kTradingDaysPerYear = 252.0;
+// Calendar days per year, for bars spanning several days
+constexpr double kCalendarDaysPerYear = 365.25;
+
+// Parse one timestamp cell: eight digits (a compact YYYYMMDD date), any
+// other integer (epoch nanoseconds) or
+// YYYY-MM-DD[( |T)hh:mm[:ss[.fffffffff]]][Z|(+|-)hh:mm]. Fields may have any
+// number of digits and days past the end of the month roll over, so
+// 2020-01-32 is 2020-02-01.
+bool parse(const char* begin, const char* end, int64_t& nanos);
+inline bool parse(const std::string& text, int64_t& nanos) {
+    return parse(text.data(), text.data() + text.size(), nanos);
+}
+
+// YYYY-MM-DD at midnight, else YYYY-MM-DD hh:mm:ss with any fraction of a second
+std::string format(int64_t nanos);
+
+// Start of the `interval`-long bucket holding `nanos`, buckets aligned to the epoch
+inline int64_t floorTo(int64_t nanos, int64_t interval) {
+    int64_t bucket = nanos / interval;
+    if (nanos % interval < 0) {
+        --bucket;
+    }
+    return bucket * interval;
+}
+
+// Parse a bar length such as 500ms, 30s, 5m, 1h or 1d (units ns, us, ms, s, m, h, d)
+bool parseInterval(const std::string& spec, int64_t& interval);
+
+// Shortest unit that states `interval` exactly, e.g. 300000000000 -> "5m"
+std::string formatInterval(int64_t interval);
+
+// Smallest positive spacing between consecutive timestamps (0 for fewer than two bars)
+int64_t barInterval(const std::vector<int64_t>& timestamps);
+
+// Annualization factor: kTradingDaysPerYear times the average number of bars
+// per UTC calendar day that has any, so daily data gives exactly 252. Bars
+// longer than a day (e.g. 7d) count calendar time instead:
+// kCalendarDaysPerYear days over the bar interval.
+double periodsPerYear(const std::vector<int64_t>& timestamps);
+
+} // namespace Timestamps
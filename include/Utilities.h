@@ -4,20 +4,212 @@
 #include <cmath>
 #include <numeric>
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include "SeriesView.h"
 
 namespace Utilities {
     // Basic statistical functions
-    double mean(const std::vector<double>& data);
-    double standardDeviation(const std::vector<double>& data);
-    std::vector<double> calculateReturns(const std::vector<double>& prices);
+    double mean(SeriesView<double> data);
+    double standardDeviation(SeriesView<double> data);
+    std::vector<double> calculateReturns(SeriesView<double> prices);
     
-    // Rolling window calculations
-    std::vector<double> rollingMean(const std::vector<double>& data, size_t window);
-    std::vector<double> rollingStdDev(const std::vector<double>& data, size_t window);
-    std::vector<double> rollingZScore(const std::vector<double>& data, size_t window);
+    // Incremental mean/variance over a sliding window (Welford update).
+    // add() grows the window, replace() slides it by one observation,
+    // so each step is O(1) with no allocation. NaNs in the window are
+    // counted but kept out of the moments: mean and variance read NaN while
+    // one is inside and recover once it has slid out.
+    class RollingMoments {
+    public:
+        void reset() { count_ = 0; missing_ = 0; mean_ = 0.0; m2_ = 0.0; }
+
+        void add(double value) {
+            if (std::isnan(value)) {
+                ++missing_;
+                return;
+            }
+            ++count_;
+            double delta = value - mean_;
+            mean_ += delta / count_;
+            m2_ += delta * (value - mean_);
+        }
+
+        // Remove the oldest observation and add a new one (window size unchanged)
+        void replace(double oldest, double newest) {
+            if (std::isnan(oldest) || std::isnan(newest)) {
+                remove(oldest);
+                add(newest);
+                return;
+            }
+            double oldMean = mean_;
+            double delta = newest - oldest;
+            mean_ += delta / count_;
+            m2_ += delta * (newest - mean_ + oldest - oldMean);
+            if (m2_ < 0.0) m2_ = 0.0;
+        }
+
+        // Fold in the moments of a disjoint set of observations (pairwise update)
+        void merge(const RollingMoments& other) {
+            missing_ += other.missing_;
+            if (other.count_ == 0) return;
+            if (count_ == 0) { count_ = other.count_; mean_ = other.mean_; m2_ = other.m2_; return; }
+            double n = static_cast<double>(count_ + other.count_);
+            double delta = other.mean_ - mean_;
+            mean_ += delta * (other.count_ / n);
+            m2_ += other.m2_ + delta * delta * (count_ * (other.count_ / n));
+            count_ += other.count_;
+        }
+
+        // Observations in the window, NaNs included
+        size_t count() const { return count_ + missing_; }
+        double mean() const { return missing_ ? std::numeric_limits<double>::quiet_NaN() : mean_; }
+
+        // Sample variance; residual round-off on a flat window is treated as zero
+        double variance() const {
+            if (missing_ || count_ < 2) return std::numeric_limits<double>::quiet_NaN();
+            if (m2_ <= 1e-20 * count_ * mean_ * mean_) return 0.0;
+            return m2_ / (count_ - 1);
+        }
+
+        double stdDev() const { return std::sqrt(variance()); }
+
+    private:
+        size_t count_ = 0;      // finite observations in the moments
+        size_t missing_ = 0;    // NaNs in the window
+        double mean_ = 0.0;
+        double m2_ = 0.0;
+
+        void remove(double value) {
+            if (std::isnan(value)) {
+                --missing_;
+                return;
+            }
+            if (count_ <= 1) { count_ = 0; mean_ = 0.0; m2_ = 0.0; return; }
+            double oldMean = mean_;
+            --count_;
+            mean_ -= (value - mean_) / count_;
+            m2_ -= (value - mean_) * (value - oldMean);
+            if (m2_ < 0.0) m2_ = 0.0;
+        }
+    };
+
+    // RollingMoments over the last `window` values pushed, backed by a ring
+    // buffer so memory stays O(window) however long the stream runs
+    class RollingWindow {
+    public:
+        RollingWindow() = default;
+        explicit RollingWindow(size_t window) { reset(window); }
+        
+        void reset(size_t window) {
+            buffer_.assign(window, 0.0);
+            head_ = 0;
+            moments_.reset();
+        }
+        
+        void push(double value) {
+            if (buffer_.empty()) return;
+            if (moments_.count() < buffer_.size()) {
+                buffer_[moments_.count()] = value;
+                moments_.add(value);
+            } else {
+                double oldest = buffer_[head_];
+                buffer_[head_] = value;
+                head_ = (head_ + 1 == buffer_.size()) ? 0 : head_ + 1;
+                moments_.replace(oldest, value);
+            }
+        }
+        
+        bool full() const { return !buffer_.empty() && moments_.count() == buffer_.size(); }
+        size_t window() const { return buffer_.size(); }
+        const RollingMoments& moments() const { return moments_; }
+        
+        // Z-score of `value` against the window; NaN until the window is full
+        // or while it has zero dispersion (same rule as rollingZScore)
+        double zScore(double value) const {
+            if (!full()) return std::numeric_limits<double>::quiet_NaN();
+            double sd = moments_.stdDev();
+            if (!(sd > 0)) return std::numeric_limits<double>::quiet_NaN();
+            return (value - moments_.mean()) / sd;
+        }
+        
+    private:
+        std::vector<double> buffer_;
+        size_t head_ = 0;
+        RollingMoments moments_;
+    };
+    
+    // Least-squares fit of y on x over a sliding window, kept as running means
+    // and centred co-moments so add()/remove() are O(1) and stay well
+    // conditioned (no large raw sums cancelling). Points with a NaN are
+    // counted but left out of the fit, which has no slope while one is inside.
+    class RollingRegression {
+    public:
+        void reset() { count_ = 0; missing_ = 0; meanX_ = meanY_ = sxx_ = sxy_ = 0.0; }
+        
+        void add(double x, double y) {
+            if (std::isnan(x) || std::isnan(y)) {
+                ++missing_;
+                return;
+            }
+            ++count_;
+            double dx = x - meanX_;
+            meanX_ += dx / count_;
+            meanY_ += (y - meanY_) / count_;
+            sxx_ += dx * (x - meanX_);
+            sxy_ += dx * (y - meanY_);
+        }
+        
+        void remove(double x, double y) {
+            if (std::isnan(x) || std::isnan(y)) {
+                --missing_;
+                return;
+            }
+            if (count_ <= 1) { count_ = 0; meanX_ = meanY_ = sxx_ = sxy_ = 0.0; return; }
+            double oldMeanY = meanY_;
+            double oldMeanX = meanX_;
+            --count_;
+            meanX_ -= (x - meanX_) / count_;
+            meanY_ -= (y - meanY_) / count_;
+            sxx_ -= (x - meanX_) * (x - oldMeanX);
+            sxy_ -= (x - meanX_) * (y - oldMeanY);
+            if (sxx_ < 0.0) sxx_ = 0.0;
+        }
+        
+        // Points in the window, those with a NaN included
+        size_t count() const { return count_ + missing_; }
+        
+        // Slope; NaN until there are two points with dispersion in x, and
+        // while a point with a NaN is in the window
+        double beta() const {
+            if (missing_ || count_ < 2 || !(sxx_ > 0)) return std::numeric_limits<double>::quiet_NaN();
+            return sxy_ / sxx_;
+        }
+        double alpha() const { return meanY_ - beta() * meanX_; }
+        
+    private:
+        size_t count_ = 0;      // finite points in the fit
+        size_t missing_ = 0;    // points with a NaN in the window
+        double meanX_ = 0.0;
+        double meanY_ = 0.0;
+        double sxx_ = 0.0;
+        double sxy_ = 0.0;
+    };
+    
+    // Mean, standard deviation and z-score series produced together
+    struct RollingStats {
+        std::vector<double> mean;
+        std::vector<double> stdDev;
+        std::vector<double> zScore;
+    };
+
+    // Rolling window calculations (single pass, O(n) regardless of window)
+    RollingStats rollingStatistics(SeriesView<double> data, size_t window);
+    std::vector<double> rollingMean(SeriesView<double> data, size_t window);
+    std::vector<double> rollingStdDev(SeriesView<double> data, size_t window);
+    std::vector<double> rollingZScore(SeriesView<double> data, size_t window);
     
     // Linear regression
     struct RegressionResult {
@@ -27,22 +219,161 @@ namespace Utilities {
         std::vector<double> residuals;
     };
     
-    RegressionResult linearRegression(const std::vector<double>& x, const std::vector<double>& y);
+    RegressionResult linearRegression(SeriesView<double> x, SeriesView<double> y);
+    
+    // Sufficient statistics of a least-squares fit of y on x. Per-series terms
+    // can be cached (see MarketData::getMoments) so only sumXY needs a pass.
+    struct RegressionSums {
+        double n = 0.0;
+        double sumX = 0.0;
+        double sumY = 0.0;
+        double sumXX = 0.0;
+        double sumXY = 0.0;
+        double sumYY = 0.0;
+    };
+    
+    RegressionSums regressionSums(SeriesView<double> x, SeriesView<double> y);
+    
+    // Closed-form fit from sufficient statistics (residuals left empty)
+    RegressionResult regressionFromSums(const RegressionSums& sums);
     
-    // Augmented Dickey-Fuller test for stationarity
+    double dotProduct(SeriesView<double> x, SeriesView<double> y);
+    
+    // Augmented Dickey-Fuller test for stationarity. Fits
+    //   dy_t = a + g * y_{t-1} + sum_{i=1..p} c_i * dy_{t-i} + e_t
+    // by accumulating the normal equations in one pass (no allocation) and
+    // reports the t-ratio of g with a MacKinnon (1994) p-value for the
+    // constant-only case. With selectLags the order p in [0, maxLags] with the
+    // lowest AIC is used; all orders share the same sample.
     struct AdfResult {
-        double testStatistic;
-        double pValue;
-        bool isStationary;
+        double testStatistic = 0.0;
+        double pValue = 1.0;
+        bool isStationary = false;
+        int lags = 0;
     };
     
-    AdfResult adfTest(const std::vector<double>& timeSeries, int maxLags = 1);
+    constexpr int kMaxAdfLags = 16;
+    
+    AdfResult adfTest(SeriesView<double> timeSeries, int maxLags = 1,
+                      double significanceLevel = 0.05, bool selectLags = false);
+    
+    // Test kAdfBatchLanes series at once. Series are interleaved so that
+    // interleaved[t * kAdfBatchLanes + lane] is bar t of series `lane`; the
+    // accumulation loop runs across lanes and vectorises. Results are written
+    // for the first numSeries lanes; unused lanes should hold finite values.
+    constexpr size_t kAdfBatchLanes = 8;
+    
+    void adfTestBatch(const double* interleaved, size_t length, size_t numSeries,
+                      AdfResult* results, int maxLags = 1,
+                      double significanceLevel = 0.05, bool selectLags = false);
+    
+    // Approximate p-value of an ADF t-statistic (constant, no trend)
+    double adfPValue(double testStatistic);
+    
+    // Engle-Granger statistics of two series over a window [begin, end) that
+    // rolls forward: the regression sums of a on b, and the cross-moments of
+    // both legs' ADF regressors (lagged levels, lagged differences and the
+    // current differences). The ADF normal equations of the spread a - beta * b
+    // are linear in those moments, so they are formed for any beta without a
+    // pass over the window. setWindow() adds the bars that entered and removes
+    // the bars that left, so sliding by s bars costs O(s) rather than O(window).
+    // Levels are taken relative to the first bar of the series to keep the
+    // raw sums well conditioned.
+    class SlidingCointegration {
+    public:
+        static constexpr int kMaxLags = 4;
+        
+        SlidingCointegration(SeriesView<double> a, SeriesView<double> b, int lags = 1);
+        
+        // Move to bars [begin, end). Windows that move forward and still overlap
+        // are updated in place; anything else is rebuilt.
+        void setWindow(size_t begin, size_t end);
+        size_t begin() const { return begin_; }
+        size_t end() const { return end_; }
+        
+        // Slope of a on b over the window
+        double beta() const;
+        
+        // Same result as adfTest(a - beta * b over the window, lags, significanceLevel)
+        AdfResult adfTest(double beta, double significanceLevel = 0.05) const;
+        
+    private:
+        // u = [1, a_{t-1}, b_{t-1}, da_{t-1}, db_{t-1}, ..., da_{t-p}, db_{t-p}, da_t, db_t]
+        static constexpr int kMaxMoments = 2 * kMaxLags + 5;
+        
+        SeriesView<double> a_;
+        SeriesView<double> b_;
+        int lags_;
+        int numMoments_;
+        size_t begin_ = 0;
+        size_t end_ = 0;
+        RegressionSums regression_;                     // levels relative to bar 0
+        double moments_[kMaxMoments][kMaxMoments] = {}; // upper triangle of sum u u'
+        size_t numObs_ = 0;
+        
+        void updateBars(size_t first, size_t last, double sign);
+        void updateObservations(size_t first, size_t last, double sign);
+    };
     
     // CSV utilities
     bool writeCSV(const std::string& filename, 
                   const std::vector<std::string>& headers, 
                   const std::vector<std::vector<double>>& data);
     
+    // Buffered CSV writer. Fields are formatted with std::to_chars (doubles in
+    // shortest round-trip form) into a large buffer that is written out in
+    // blocks, so a row costs no stream formatting and no allocation.
+    class CsvWriter {
+    public:
+        explicit CsvWriter(size_t bufferSize = 1 << 20);
+        ~CsvWriter() { close(); }
+        CsvWriter(const CsvWriter&) = delete;
+        CsvWriter& operator=(const CsvWriter&) = delete;
+        
+        bool open(const std::string& filename);
+        
+        void field(double value);
+        void field(int64_t value);
+        void field(int value) { field(static_cast<int64_t>(value)); }
+        void field(size_t value) { field(static_cast<int64_t>(value)); }
+        void field(const std::string& value);
+        void header(const std::vector<std::string>& names);
+        void endRow();
+        
+        // Flush and close; false if any write failed
+        bool close();
+        
+    private:
+        char* reserve(size_t bytes);
+        void separate();
+        void flush();
+        
+        std::ofstream file_;
+        std::vector<char> buffer_;
+        size_t used_ = 0;
+        bool rowStart_ = true;
+    };
+    
+    // Binary columnar table (.sacol) for downstream tools such as
+    // scripts/visualize.py. Layout, native little-endian:
+    //   "SACOL001", uint32 version, uint32 numColumns, uint64 numRows,
+    //   numColumns x { char name[48], uint32 type, uint32 reserved, uint64 offset },
+    //   then each column as a contiguous array starting on a 64-byte boundary.
+    enum class ColumnType : uint32_t { Float64 = 0, Int64 = 1, Int32 = 2 };
+    
+    struct ColumnSpec {
+        std::string name;
+        ColumnType type;
+        const void* data;    // first element
+        size_t stride;       // bytes between rows; 0 means densely packed
+    };
+    
+    bool writeColumnar(const std::string& filename, size_t numRows,
+                       const std::vector<ColumnSpec>& columns);
+    
+    // True for paths that should be written with writeColumnar
+    bool isColumnarPath(const std::string& filename);
+    
     // Print utilities for debugging
     void printVector(const std::vector<double>& vec, const std::string& label = "");
 } 
\ No newline at end of file
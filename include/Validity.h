@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Validity bitmaps: bit d of a series' words is set when the series has a
+// value on bar d. Bits at and past the series length are zero, so whole words
+// combine with plain bitwise operations.
+namespace Validity {
+
+using Word = uint64_t;
+constexpr size_t kBitsPerWord = 64;
+
+// Bar range [begin, end)
+using Range = std::pair<size_t, size_t>;
+
+inline size_t numWords(size_t numBits) {
+    return (numBits + kBitsPerWord - 1) / kBitsPerWord;
+}
+
+inline bool test(const Word* bits, size_t i) {
+    return (bits[i / kBitsPerWord] >> (i % kBitsPerWord)) & 1;
+}
+
+// Bitmap of the non-NaN entries of values[0, count); `out` holds numWords(count) words
+template <typename T, typename Decode>
+void build(const T* values, size_t count, Decode&& decode, Word* out) {
+    for (size_t w = 0; w < numWords(count); ++w) {
+        const size_t base = w * kBitsPerWord;
+        const size_t bits = count - base < kBitsPerWord ? count - base : kBitsPerWord;
+        Word word = 0;
+        for (size_t k = 0; k < bits; ++k) {
+            const double value = decode(values[base + k]);
+            word |= static_cast<Word>(value == value) << k;
+        }
+        out[w] = word;
+    }
+}
+
+// Number of set bits
+size_t count(const Word* bits, size_t numWords);
+
+// First bit in [begin, end) equal to `value`, or end if there is none
+size_t find(const Word* bits, size_t begin, size_t end, bool value);
+
+// Last set bit in [begin, end), or end if there is none
+size_t findLast(const Word* bits, size_t begin, size_t end);
+
+// Append the maximal runs of set bits within [begin, end) to `runs`, in order.
+// Scans a word at a time, so the cost is one step per run plus one per word.
+void runs(const Word* bits, size_t begin, size_t end, std::vector<Range>& runs);
+
+// Runs of the bits set in both a and b; the intersection is taken a word at
+// a time as the scan reaches it and never stored
+void runs(const Word* a, const Word* b, size_t begin, size_t end, std::vector<Range>& runs);
+
+// Total number of bars covered by `ranges`
+inline size_t length(const std::vector<Range>& ranges) {
+    size_t total = 0;
+    for (const auto& range : ranges) {
+        total += range.second - range.first;
+    }
+    return total;
+}
+
+} // namespace Validity
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Backtester.h"
+#include "CostModel.h"
+#include "MarketData.h"
+#include "PairScanner.h"
+
+class ThreadPool;
+
+// Rolling formation/trading evaluation over one loaded MarketData. Fold k
+// screens the candidate pairs on bars [k * test, k * test + train) and trades
+// the accepted pairs, with their formation-period hedge ratios, on the next
+// `test` bars. The screen keeps one Utilities::SlidingCointegration per pair
+// and rolls it from fold to fold, so each re-estimation touches only the bars
+// that entered or left the formation window. Folds share no state, so their
+// trading periods run in parallel, each on its own quiet Backtester.
+class WalkForward {
+public:
+    struct Options {
+        size_t trainBars = 504;
+        size_t testBars = 63;
+        double initialCapital = 1000000.0;   // every fold starts from this
+        double entryThreshold = 1.5;
+        double exitThreshold = 0.0;
+        size_t lookbackWindow = 20;          // z-score warm-up taken from the formation period
+        bool delayedExecution = true;
+        double significanceLevel = 0.05;
+        size_t numThreads = 0;               // 0 = hardware concurrency
+        CostModel costs;                     // charged on every fold's fills
+    };
+
+    struct Fold {
+        size_t trainBegin = 0;               // formation bars [trainBegin, testBegin)
+        size_t testBegin = 0;                // trading bars [testBegin, testEnd)
+        size_t testEnd = 0;
+        std::vector<PairCandidate> pairs;    // accepted in the formation window
+        Backtester::PerformanceMetrics metrics;
+        std::vector<double> portfolioValues; // one per trading bar
+        size_t numTrades = 0;
+    };
+
+    // Candidates default to every pair of symbols in the data
+    WalkForward(std::shared_ptr<MarketData> marketData, Options options);
+    WalkForward(std::shared_ptr<MarketData> marketData,
+                std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> candidates,
+                Options options);
+
+    // Number of complete folds that fit in the data
+    size_t numFolds() const;
+
+    // Screen and trade every fold, in time order
+    std::vector<Fold> run() const;
+
+    // Parse "train=504,test=63" into the window lengths of `options`
+    static bool parseSpec(const std::string& spec, Options& options);
+
+    // Return of running the folds back to back, each on the previous fold's ending capital
+    static double compoundedReturn(const std::vector<Fold>& folds);
+
+    // One metrics row per fold
+    static bool exportResults(const std::string& filename, const std::vector<Fold>& folds,
+                              const MarketData& marketData);
+
+private:
+    std::shared_ptr<MarketData> marketData_;
+    std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> candidates_;
+    Options options_;
+
+    // Per (candidate, fold) screen result, candidate-major
+    struct Screen {
+        double beta = 0.0;
+        double adfStatistic = 0.0;
+        double pValue = 1.0;
+        bool accepted = false;
+    };
+
+    std::vector<Screen> screenFolds(ThreadPool& pool, size_t numFolds) const;
+    void tradeFold(Fold& fold) const;
+};
@@ -15,9 +15,30 @@ import argparse
 import os
 import sys
 
+# .sacol column type codes (Utilities::ColumnType)
+SACOL_DTYPES = {0: '<f8', 1: '<i8', 2: '<i4'}
+
+def load_columnar(filename):
+    """Load a binary columnar (.sacol) table written by the simulator"""
+    raw = np.fromfile(filename, dtype=np.uint8)
+    if raw[:8].tobytes() != b'SACOL001':
+        raise ValueError(f"{filename} is not a .sacol file")
+    num_columns = int(raw[12:16].view('<u4')[0])
+    num_rows = int(raw[16:24].view('<u8')[0])
+    columns = {}
+    for c in range(num_columns):
+        entry = raw[24 + c * 64:24 + (c + 1) * 64]
+        name = entry[:48].tobytes().split(b'\0', 1)[0].decode()
+        dtype = SACOL_DTYPES[int(entry[48:52].view('<u4')[0])]
+        offset = int(entry[56:64].view('<u8')[0])
+        columns[name] = np.frombuffer(raw, dtype=dtype, count=num_rows, offset=offset)
+    return pd.DataFrame(columns)
+
 def load_data(filename):
-    """Load backtest results from CSV file"""
+    """Load backtest results (or a trade log) from a CSV or .sacol file"""
     try:
+        if filename.endswith('.sacol'):
+            return load_columnar(filename)
         data = pd.read_csv(filename)
         return data
     except Exception as e:
@@ -119,9 +140,38 @@ def plot_returns_distribution(data, output_file=None):
     
     plt.close()
 
+def plot_trade_pnl(trades, output_file=None):
+    """Plot per-trade P&L in exit order and the cumulative realised P&L"""
+    trades = trades.sort_values('ExitDay', kind='stable')
+    
+    fig, ax = plt.subplots(figsize=(12, 6))
+    colors = np.where(trades['PnL'] >= 0, 'tab:green', 'tab:red')
+    ax.bar(trades['ExitDay'], trades['PnL'], color=colors, alpha=0.6, label='Trade P&L')
+    ax.plot(trades['ExitDay'], trades['PnL'].cumsum(), color='tab:blue', label='Cumulative P&L')
+    ax.set_title('Realised Trade P&L')
+    ax.set_xlabel('Exit Day')
+    ax.set_ylabel('P&L ($)')
+    ax.grid(True)
+    
+    win_rate = (trades['PnL'] > 0).mean() if len(trades) else 0.0
+    holding = (trades['ExitDay'] - trades['EntryDay']).mean() if len(trades) else 0.0
+    ax.annotate(f'Trades: {len(trades)}\nWin Rate: {win_rate:.2%}\nAvg Holding: {holding:.1f} days',
+                xy=(0.02, 0.95), xycoords='axes fraction', va='top',
+                bbox=dict(boxstyle="round,pad=0.5", fc="white", alpha=0.8))
+    ax.legend()
+    
+    if output_file:
+        plt.savefig(output_file, dpi=300, bbox_inches='tight')
+        print(f"Trade P&L chart saved to {output_file}")
+    else:
+        plt.show()
+    
+    plt.close()
+
 def main():
     parser = argparse.ArgumentParser(description='Visualize Statistical Arbitrage backtest results')
-    parser.add_argument('results_file', help='CSV file containing backtest results')
+    parser.add_argument('results_file', help='CSV or .sacol file containing backtest results')
+    parser.add_argument('--trades', '-t', help='Trade log from --trades (CSV or .sacol)')
     parser.add_argument('--output', '-o', help='Output directory for charts', default='.')
     
     args = parser.parse_args()
@@ -139,6 +189,12 @@ def main():
     plot_drawdown(data, os.path.join(args.output, 'drawdown.png'))
     plot_returns_distribution(data, os.path.join(args.output, 'returns_distribution.png'))
     
+    if args.trades:
+        trades = load_data(args.trades)
+        if trades is None:
+            sys.exit(1)
+        plot_trade_pnl(trades, os.path.join(args.output, 'trade_pnl.png'))
+    
     print(f"All charts have been saved to {args.output}")
 
 if __name__ == "__main__":
@@ -1,108 +1,251 @@
 #include "AssetPair.h"
+#include "Profiler.h"
+#include "SignalPass.h"
 #include <algorithm>
 #include <iostream>
+#include <limits>
 
 AssetPair::AssetPair(const std::string& symbolA, const std::string& symbolB,
-                     const std::vector<double>& pricesA, const std::vector<double>& pricesB)
+                     PriceView pricesA, PriceView pricesB)
     : symbolA_(symbolA), symbolB_(symbolB), pricesA_(pricesA), pricesB_(pricesB)
 {
     // Ensure both price series have the same length
     if (pricesA_.size() != pricesB_.size()) {
         // Resize to the smaller of the two sizes
         size_t minSize = std::min(pricesA_.size(), pricesB_.size());
-        pricesA_.resize(minSize);
-        pricesB_.resize(minSize);
+        pricesA_ = pricesA_.first(minSize);
+        pricesB_ = pricesB_.first(minSize);
         
         std::cerr << "Warning: Price series for " << symbolA_ << " and " << symbolB_ 
                   << " have different lengths. Truncating to " << minSize << std::endl;
     }
+}
+
+AssetPair::AssetPair(const std::string& symbolA, const std::string& symbolB, double beta)
+    : symbolA_(symbolA), symbolB_(symbolB), beta_(beta), isCointegrated_(true)
+{
+}
+
+AssetPair::CointegrationResult AssetPair::evaluateCointegration(PriceView pricesA, PriceView pricesB,
+                                                              std::vector<double>& spreadBuffer,
+                                                              double significanceLevel) {
+    size_t n = std::min(pricesA.size(), pricesB.size());
+    pricesA = pricesA.first(n);
+    pricesB = pricesB.first(n);
+    
+    // Regress priceA on priceB; only the slope is needed, so skip residuals
+    auto sums = Utilities::regressionSums(pricesB, pricesA);
+    double beta = Utilities::regressionFromSums(sums).beta;
     
-    // Calculate default spreads (assuming beta=1)
-    calculateSpreads();
+    return evaluateSpread(pricesA, pricesB, beta, spreadBuffer, significanceLevel);
+}
+
+AssetPair::CointegrationResult AssetPair::evaluateSpread(PriceView pricesA, PriceView pricesB, double beta,
+                                                       std::vector<double>& spreadBuffer,
+                                                       double significanceLevel) {
+    CointegrationResult result;
+    result.beta = beta;
+    
+    // Test for stationarity in the spread
+    size_t n = std::min(pricesA.size(), pricesB.size());
+    spreadBuffer.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        spreadBuffer[i] = pricesA[i] - beta * pricesB[i];
+    }
+    auto adfResult = Utilities::adfTest(spreadBuffer, kAdfLags, significanceLevel);
+    
+    result.adfStatistic = adfResult.testStatistic;
+    result.pValue = adfResult.pValue;
+    result.isCointegrated = adfResult.isStationary;
+    return result;
 }
 
 bool AssetPair::testCointegration(double significanceLevel) {
-    // Perform linear regression of priceA on priceB
-    auto regression = Utilities::linearRegression(pricesB_, pricesA_);
+    STATARB_PROFILE_SCOPE("AssetPair::testCointegration");
+    std::vector<double> spreadBuffer;
+    auto result = evaluateCointegration(pricesA_, pricesB_, spreadBuffer, significanceLevel);
+    betas_.clear();
     
     // Update beta to regression coefficient
-    beta_ = regression.beta;
+    beta_ = result.beta;
+    isCointegrated_ = result.isCointegrated;
+    return isCointegrated_;
+}
+
+bool AssetPair::testCointegration(const Utilities::RegressionSums& sums, double significanceLevel) {
+    STATARB_PROFILE_SCOPE("AssetPair::testCointegration");
+    double beta = Utilities::regressionFromSums(sums).beta;
+    std::vector<double> spreadBuffer;
+    auto result = evaluateSpread(pricesA_, pricesB_, beta, spreadBuffer, significanceLevel);
+    betas_.clear();
     
-    // Recalculate spreads with new beta
-    calculateSpreads();
+    beta_ = result.beta;
+    isCointegrated_ = result.isCointegrated;
+    return isCointegrated_;
+}
+
+void AssetPair::setCointegrationBeta(double beta, bool isCointegrated) {
+    beta_ = beta;
+    isCointegrated_ = isCointegrated;
+    betas_.clear();
+}
+
+void AssetPair::estimateRollingHedgeRatio(size_t window) {
+    if (window == 0) {
+        betas_.clear();
+        return;
+    }
     
-    // Test for stationarity in the spread
-    auto adfResult = Utilities::adfTest(spreads_, 1);
+    const size_t n = pricesA_.size();
+    betas_.resize(n);
     
-    isCointegrated_ = adfResult.isStationary;
-    return isCointegrated_;
+    Utilities::RollingRegression regression;
+    double beta = beta_;
+    for (size_t t = 0; t < n; ++t) {
+        regression.add(pricesB_[t], pricesA_[t]);
+        if (t >= window) {
+            regression.remove(pricesB_[t - window], pricesA_[t - window]);
+        }
+        
+        // Keep the previous estimate while the fit is undefined
+        double estimate = regression.beta();
+        if (!std::isnan(estimate)) {
+            beta = estimate;
+        }
+        betas_[t] = beta;
+    }
 }
 
-void AssetPair::calculateSpreads() {
-    spreads_.resize(pricesA_.size());
-    for (size_t i = 0; i < pricesA_.size(); ++i) {
-        spreads_[i] = pricesA_[i] - beta_ * pricesB_[i];
+namespace {
+
+using StrategyPolicies::RollingHedge;
+using StrategyPolicies::StaticHedge;
+using StrategyPolicies::ZScoreBands;
+
+// Fused pass over two price legs under one hedge-ratio model
+template <typename Hedge, typename SignalT>
+void fusedSignalPass(const double* pricesA, const double* pricesB, size_t n, Hedge hedge,
+                     size_t window, const ZScoreBands& rule, SignalT* signals, double* zScores) {
+    auto spreadAt = [&](size_t i) { return pricesA[i] - hedge(i) * pricesB[i]; };
+    zScoreSignalPass(spreadAt, n, window, rule, signals, zScores);
+}
+
+// Pick the hedge model once per pass rather than per bar
+template <typename SignalT>
+void dispatchSignalPass(PriceView pricesA, PriceView pricesB, double beta,
+                        const std::vector<double>& betas, size_t window, const ZScoreBands& rule,
+                        SignalT* signals, double* zScores) {
+    if (betas.empty()) {
+        fusedSignalPass(pricesA.data(), pricesB.data(), pricesA.size(), StaticHedge{beta}, window,
+                        rule, signals, zScores);
+    } else {
+        fusedSignalPass(pricesA.data(), pricesB.data(), pricesA.size(), RollingHedge{betas.data()},
+                        window, rule, signals, zScores);
     }
 }
 
-std::vector<double> AssetPair::getZScores(size_t window) const {
-    if (window >= spreads_.size()) {
-        window = spreads_.size() / 2;  // Default to half the series length
-        if (window < 2) window = 2;    // Minimum window size
+} // namespace
+
+std::vector<double> AssetPair::getSpreads() const {
+    std::vector<double> spreads(pricesA_.size());
+    for (size_t i = 0; i < spreads.size(); ++i) {
+        spreads[i] = getSpread(i);
     }
-    
-    return Utilities::rollingZScore(spreads_, window);
+    return spreads;
+}
+
+size_t AssetPair::effectiveWindow(size_t window) const {
+    return effectiveLookback(window, pricesA_.size());
+}
+
+std::vector<double> AssetPair::getZScores(size_t window) const {
+    std::vector<double> zScores(pricesA_.size());
+    computeSignals(0.0, 0.0, window, nullptr, zScores.data());
+    return zScores;
 }
 
 std::vector<int> AssetPair::generateSignals(double entryThreshold, 
                                           double exitThreshold,
                                           size_t lookbackWindow) const {
-    // Get z-scores
-    std::vector<double> zScores = getZScores(lookbackWindow);
-    
+    STATARB_PROFILE_SCOPE("AssetPair::generateSignals");
+    std::vector<int> signals(pricesA_.size());
+    dispatchSignalPass(pricesA_, pricesB_, beta_, betas_, effectiveWindow(lookbackWindow),
+                       ZScoreBands{entryThreshold, exitThreshold}, signals.data(),
+                       static_cast<double*>(nullptr));
+    return signals;
+}
+
+void AssetPair::computeSignals(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                               Signal* signals, double* zScores) const {
+    STATARB_PROFILE_SCOPE("AssetPair::generateSignals");
+    dispatchSignalPass(pricesA_, pricesB_, beta_, betas_, effectiveWindow(lookbackWindow),
+                       ZScoreBands{entryThreshold, exitThreshold}, signals, zScores);
+}
+
+std::vector<int> AssetPair::signalsFromZScores(const std::vector<double>& zScores,
+                                               double entryThreshold,
+                                               double exitThreshold) {
     // Generate signals
     std::vector<int> signals(zScores.size(), 0);
+    const ZScoreBands rule{entryThreshold, exitThreshold};
     int currentPosition = 0;
     
     for (size_t i = 0; i < zScores.size(); ++i) {
-        if (std::isnan(zScores[i])) {
-            signals[i] = 0;  // No signal for NaN z-scores
-            continue;
+        signals[i] = rule.step(currentPosition, zScores[i]);
+    }
+    
+    return signals;
+}
+
+void AssetPair::signalsFromZScores(const double* zScores, size_t count,
+                                   double entryThreshold, double exitThreshold,
+                                   Signal* signals) {
+    const ZScoreBands rule{entryThreshold, exitThreshold};
+    int currentPosition = 0;
+    for (size_t i = 0; i < count; ++i) {
+        signals[i] = static_cast<Signal>(rule.step(currentPosition, zScores[i]));
+    }
+}
+
+void AssetPair::startStreaming(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                               size_t hedgeWindow) {
+    stream_.window.reset(lookbackWindow);
+    stream_.beta = beta_;
+    stream_.hedge.reset();
+    stream_.hedgeA.assign(hedgeWindow, 0.0);
+    stream_.hedgeB.assign(hedgeWindow, 0.0);
+    stream_.hedgeHead = 0;
+    stream_.entryThreshold = entryThreshold;
+    stream_.exitThreshold = exitThreshold;
+    stream_.position = 0;
+    stream_.signal = 0;
+    stream_.zScore = std::numeric_limits<double>::quiet_NaN();
+    stream_.bars = 0;
+}
+
+int AssetPair::onBar(double priceA, double priceB) {
+    const size_t hedgeWindow = stream_.hedgeA.size();
+    if (hedgeWindow > 0) {
+        // Same add-then-remove order as estimateRollingHedgeRatio
+        stream_.hedge.add(priceB, priceA);
+        if (stream_.bars >= hedgeWindow) {
+            stream_.hedge.remove(stream_.hedgeB[stream_.hedgeHead], stream_.hedgeA[stream_.hedgeHead]);
         }
+        stream_.hedgeA[stream_.hedgeHead] = priceA;
+        stream_.hedgeB[stream_.hedgeHead] = priceB;
+        stream_.hedgeHead = (stream_.hedgeHead + 1 == hedgeWindow) ? 0 : stream_.hedgeHead + 1;
         
-        if (currentPosition == 0) {
-            // No position, check for entry
-            if (zScores[i] > entryThreshold) {
-                // Short the spread (sell A, buy B)
-                signals[i] = -1;
-                currentPosition = -1;
-            } else if (zScores[i] < -entryThreshold) {
-                // Long the spread (buy A, sell B)
-                signals[i] = 1;
-                currentPosition = 1;
-            }
-        } else if (currentPosition == 1) {
-            // Long position, check for exit
-            if (zScores[i] >= -exitThreshold) {
-                // Exit long position
-                signals[i] = 0;
-                currentPosition = 0;
-            } else {
-                // Maintain long position
-                signals[i] = 1;
-            }
-        } else if (currentPosition == -1) {
-            // Short position, check for exit
-            if (zScores[i] <= exitThreshold) {
-                // Exit short position
-                signals[i] = 0;
-                currentPosition = 0;
-            } else {
-                // Maintain short position
-                signals[i] = -1;
-            }
+        double estimate = stream_.hedge.beta();
+        if (!std::isnan(estimate)) {
+            stream_.beta = estimate;
         }
     }
     
-    return signals;
-} 
\ No newline at end of file
+    double spread = priceA - stream_.beta * priceB;
+    stream_.window.push(spread);
+    stream_.zScore = stream_.window.zScore(spread);
+    stream_.signal = stepSignal(stream_.position, stream_.zScore,
+                                stream_.entryThreshold, stream_.exitThreshold);
+    ++stream_.bars;
+    return stream_.signal;
+}
\ No newline at end of file
@@ -1,275 +1,1096 @@
 #include "Backtester.h"
+#include "MarketDataStream.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
 #include <cmath>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <numeric>
+#include <sstream>
+
+namespace {
+
+// Pairs per reduction chunk in the parallel modes. Fixed, so the summation
+// order (and therefore every result bit) does not depend on the thread count.
+constexpr size_t kPairChunk = 16;
+
+// Run fn(chunk) for every chunk, on the pool when there is one
+template <typename Fn>
+void forEachChunk(ThreadPool* pool, size_t numChunks, Fn&& fn) {
+    if (!pool) {
+        for (size_t c = 0; c < numChunks; ++c) {
+            fn(c);
+        }
+        return;
+    }
+    size_t grain = std::max<size_t>(1, numChunks / (4 * pool->size()));
+    pool->parallelFor(0, numChunks, grain, [&](size_t begin, size_t end, size_t) {
+        for (size_t c = begin; c < end; ++c) {
+            fn(c);
+        }
+    });
+}
+
+double bookValue(const Backtester::Position& position, const AssetPair& pair, int day) {
+    if (position.direction == 0) {
+        return 0.0;
+    }
+    return position.quantityA * pair.getPricesA()[day] + position.quantityB * pair.getPricesB()[day];
+}
+
+// Move one pair's book entry to `signal` at `day`: close any open position
+// (appending the trade), then open at `notional`. Returns the cash flow.
+double followSignal(Backtester::Position& position, const AssetPair& pair, size_t pairIndex,
+                    int signal, int day, double notional, std::vector<BacktestTrade>& trades) {
+    if (signal == position.direction) {
+        return 0.0;
+    }
+    
+    double cash = 0.0;
+    double priceA = pair.getPricesA()[day];
+    double priceB = pair.getPricesB()[day];
+    if (position.direction != 0) {
+        trades.push_back(closeTrade(position, day, priceA, priceB));
+        cash += position.quantityA * priceA + position.quantityB * priceB;
+        position.direction = 0;
+    }
+    
+    if (signal != 0) {
+        sizePosition(position, signal, notional, priceA, priceB);
+        position.pairIndex = pairIndex;
+        position.entryPriceA = priceA;
+        position.entryPriceB = priceB;
+        position.entryDay = day;
+        position.direction = signal;
+        cash -= position.quantityA * priceA + position.quantityB * priceB;
+    }
+    return cash;
+}
+
+} // namespace
 
 Backtester::Backtester(std::shared_ptr<MarketData> marketData)
     : marketData_(marketData)
 {
+    if (marketData_) {
+        periodsPerYear_ = marketData_->getPeriodsPerYear();
+        barInterval_ = marketData_->getBarInterval();
+    }
+}
+
+Backtester::Backtester(std::shared_ptr<MarketDataStream> stream)
+    : stream_(std::move(stream))
+{
+}
+
+Backtester::Backtester(std::vector<std::string> symbols)
+    : live_(true), liveSymbols_(std::move(symbols))
+{
+    for (size_t id = 0; id < liveSymbols_.size(); ++id) {
+        liveSymbolIds_.emplace(liveSymbols_[id], static_cast<MarketData::SymbolId>(id));
+    }
+}
+
+Backtester::~Backtester() = default;
+
+double Backtester::priceA(size_t pairIndex, int day) const {
+    if (live_) {
+        return livePrices_[(day & 1) * liveSymbols_.size() + pairSymbols_[pairIndex].first];
+    }
+    return stream_ ? stream_->getPrice(pairSymbols_[pairIndex].first, day)
+                   : pairs_[pairIndex]->getPricesA()[day];
+}
+
+double Backtester::priceB(size_t pairIndex, int day) const {
+    if (live_) {
+        return livePrices_[(day & 1) * liveSymbols_.size() + pairSymbols_[pairIndex].second];
+    }
+    return stream_ ? stream_->getPrice(pairSymbols_[pairIndex].second, day)
+                   : pairs_[pairIndex]->getPricesB()[day];
+}
+
+std::optional<MarketData::SymbolId> Backtester::findSymbol(const std::string& symbol) const {
+    if (live_) {
+        auto it = liveSymbolIds_.find(symbol);
+        if (it == liveSymbolIds_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+    return stream_ ? stream_->getSymbolId(symbol) : marketData_->getSymbolId(symbol);
+}
+
+const std::string& Backtester::symbolName(MarketData::SymbolId id) const {
+    if (live_) {
+        return liveSymbols_[id];
+    }
+    return stream_ ? stream_->getSymbol(id) : marketData_->getSymbol(id);
+}
+
+void Backtester::setExecutionMode(ExecutionMode mode, size_t numThreads) {
+    executionMode_ = mode;
+    size_t threads = ThreadPool::resolveThreadCount(numThreads);
+    if (threads <= 1) {
+        pool_.reset();
+    } else if (!pool_ || pool_->size() != threads) {
+        pool_ = std::make_unique<ThreadPool>(threads);
+    }
 }
 
 void Backtester::addPair(const std::string& symbolA, const std::string& symbolB) {
-    auto pricesA = marketData_->getPriceSeries(symbolA);
-    auto pricesB = marketData_->getPriceSeries(symbolB);
+    STATARB_PROFILE_SCOPE("Backtester::addPair");
+    if (!marketData_) {
+        std::cerr << "Error: Cointegration screening needs the in-memory history; "
+                  << "add streamed or live pairs with a known beta" << std::endl;
+        return;
+    }
+    auto idA = marketData_->getSymbolId(symbolA);
+    auto idB = marketData_->getSymbolId(symbolB);
     
-    if (!pricesA || !pricesB) {
+    if (!idA || !idB) {
         std::cerr << "Error: Could not find price data for " << symbolA
                   << " or " << symbolB << std::endl;
         return;
     }
     
-    auto pair = std::make_unique<AssetPair>(symbolA, symbolB, *pricesA, *pricesB);
+    auto pair = std::make_unique<AssetPair>(symbolA, symbolB,
+                                            marketData_->getFilledPrices(*idA),
+                                            marketData_->getFilledPrices(*idB));
     
-    // Test for cointegration
-    if (pair->testCointegration()) {
+    // Test for cointegration (regression of A on B from the cached sums); a
+    // pair with gaps is tested on its aligned bars and traded on the filled ones
+    bool cointegrated;
+    if (marketData_->isComplete(*idA) && marketData_->isComplete(*idB)) {
+        cointegrated = pair->testCointegration(marketData_->getRegressionSums(*idB, *idA));
+    } else {
+        std::vector<Validity::Range> ranges;
+        std::vector<double> alignedA, alignedB, spreadBuffer;
+        marketData_->alignPrices(*idA, *idB, ranges, alignedA, alignedB);
+        auto result = AssetPair::evaluateCointegration(alignedA, alignedB, spreadBuffer);
+        pair->setCointegrationBeta(result.beta, result.isCointegrated);
+        cointegrated = result.isCointegrated;
+    }
+    if (cointegrated) {
         std::cout << "Pair " << symbolA << " / " << symbolB 
                   << " is cointegrated with beta: " << pair->getCointegrationBeta() << std::endl;
+        if (hedgeRatioWindow_ > 0) {
+            pair->estimateRollingHedgeRatio(hedgeRatioWindow_);
+        }
         pairs_.push_back(std::move(pair));
+        pairSymbols_.emplace_back(*idA, *idB);
     } else {
         std::cout << "Pair " << symbolA << " / " << symbolB 
                   << " is not cointegrated, skipping" << std::endl;
     }
 }
 
+void Backtester::addPair(const PairCandidate& candidate) {
+    STATARB_PROFILE_SCOPE("Backtester::addPair");
+    std::unique_ptr<AssetPair> pair;
+    if (!marketData_) {
+        pair = std::make_unique<AssetPair>(symbolName(candidate.symbolA),
+                                           symbolName(candidate.symbolB), candidate.beta);
+    } else {
+        pair = std::make_unique<AssetPair>(marketData_->getSymbol(candidate.symbolA),
+                                           marketData_->getSymbol(candidate.symbolB),
+                                           marketData_->getFilledPrices(candidate.symbolA),
+                                           marketData_->getFilledPrices(candidate.symbolB));
+        pair->setCointegrationBeta(candidate.beta);
+    }
+    if (hedgeRatioWindow_ > 0) {
+        pair->estimateRollingHedgeRatio(hedgeRatioWindow_);
+    }
+    pairs_.push_back(std::move(pair));
+    pairSymbols_.emplace_back(candidate.symbolA, candidate.symbolB);
+}
+
+void Backtester::addPair(const std::string& symbolA, const std::string& symbolB, double beta) {
+    auto idA = findSymbol(symbolA);
+    auto idB = findSymbol(symbolB);
+    if (!idA || !idB) {
+        std::cerr << "Error: Could not find price data for " << symbolA
+                  << " or " << symbolB << std::endl;
+        return;
+    }
+    
+    PairCandidate candidate;
+    candidate.symbolA = *idA;
+    candidate.symbolB = *idB;
+    candidate.beta = beta;
+    addPair(candidate);
+}
+
+void Backtester::setHedgeRatioWindow(size_t window) {
+    hedgeRatioWindow_ = window;
+    for (auto& pair : pairs_) {
+        pair->estimateRollingHedgeRatio(window);
+    }
+}
+
 void Backtester::runBacktest(double initialCapital,
                            double entryThreshold,
                            double exitThreshold,
                            size_t lookbackWindow,
                            bool delayedExecution) {
-    // Reset state
-    cash_ = initialCapital;
-    initialCapital_ = initialCapital;
-    positions_.clear();
-    portfolioValues_.clear();
-    tradeHistory_.clear();
+    if (live_) {
+        std::cerr << "Error: Live backtesters run through startLive() and onLiveBar()" << std::endl;
+        return;
+    }
+    if (stream_) {
+        resetRun(initialCapital, stream_->getDataSize());
+        runStreaming(entryThreshold, exitThreshold, lookbackWindow, delayedExecution);
+        return;
+    }
     
+    // Generate trading signals for every pair up front, into one reused buffer
+    const size_t numDays = marketData_->getDataSize();
+    workspace_.signals.resize(pairs_.size() * numDays);
+    const size_t numChunks = (pairs_.size() + kPairChunk - 1) / kPairChunk;
+    forEachChunk(pool_.get(), numChunks, [&](size_t c) {
+        for (size_t p = c * kPairChunk; p < std::min(pairs_.size(), (c + 1) * kPairChunk); ++p) {
+            AssetPair::Signal* row = workspace_.signals.data() + p * numDays;
+            std::fill(row, row + numDays, 0);
+            pairs_[p]->computeSignals(entryThreshold, exitThreshold, lookbackWindow,
+                                      row, nullptr);
+        }
+    });
+    
+    runBacktestWithSignals(workspace_.signals.data(), numDays, initialCapital, lookbackWindow,
+                           delayedExecution);
+}
+
+void Backtester::runBacktestWithSignals(const std::vector<std::vector<int>>& signals,
+                                        double initialCapital,
+                                        size_t lookbackWindow,
+                                        bool delayedExecution) {
+    if (!marketData_) {
+        std::cerr << "Error: Precomputed signals need the in-memory history" << std::endl;
+        return;
+    }
+    if (signals.size() != pairs_.size()) {
+        std::cerr << "Error: Expected signals for " << pairs_.size() << " pairs, got "
+                  << signals.size() << std::endl;
+        return;
+    }
+    
+    // Pack into the pair-major buffer; short series are padded with no signal
+    const size_t numDays = marketData_->getDataSize();
+    workspace_.signals.assign(pairs_.size() * numDays, 0);
+    for (size_t p = 0; p < pairs_.size(); ++p) {
+        size_t count = std::min(numDays, signals[p].size());
+        for (size_t day = 0; day < count; ++day) {
+            workspace_.signals[p * numDays + day] = static_cast<AssetPair::Signal>(signals[p][day]);
+        }
+    }
+    
+    runBacktestWithSignals(workspace_.signals.data(), numDays, initialCapital, lookbackWindow,
+                           delayedExecution);
+}
+
+void Backtester::runBacktestWithSignals(const AssetPair::Signal* signals, size_t stride,
+                                        double initialCapital,
+                                        size_t lookbackWindow,
+                                        bool delayedExecution) {
+    if (!marketData_) {
+        std::cerr << "Error: Precomputed signals need the in-memory history" << std::endl;
+        return;
+    }
     size_t numDays = marketData_->getDataSize();
+    resetRun(initialCapital, numDays);
+    
     if (numDays == 0) {
         std::cerr << "Error: No market data available" << std::endl;
         return;
     }
     
-    // Initialize portfolio values with initial capital
-    portfolioValues_.resize(numDays, 0.0);
+    STATARB_PROFILE_SCOPE("Backtester::simulate");
+    STATARB_PROFILE_COUNT(BarsProcessed, pairs_.size() * (numDays - std::min(numDays, lookbackWindow)));
     
-    // For each pair, generate signals and execute trades
-    for (const auto& pair : pairs_) {
-        // Generate trading signals
-        std::vector<int> signals = pair->generateSignals(entryThreshold, exitThreshold, lookbackWindow);
-        
-        int currentPosition = 0;
-        Position position;
-        
-        for (size_t day = lookbackWindow; day < numDays; ++day) {
-            int signal = (day < signals.size()) ? signals[day] : 0;
-            
-            // Handle signal with potential delay
-            int executionDay = day;
-            if (delayedExecution && day + 1 < numDays) {
-                executionDay = day + 1;  // T+1 execution
+    // One dispatch per run; the bar loops are specialised on the fill delay
+    if (delayedExecution) {
+        simulate<StrategyPolicies::NextBarExecution>(signals, stride, lookbackWindow);
+    } else {
+        simulate<StrategyPolicies::SameBarExecution>(signals, stride, lookbackWindow);
+    }
+    
+    // Calculate performance metrics
+    calculateMetrics();
+}
+
+template <typename Execution>
+void Backtester::simulate(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow) {
+    switch (executionMode_) {
+    case ExecutionMode::SharedCapital:
+        runSharedCapital<Execution>(signals, stride, lookbackWindow);
+        break;
+    case ExecutionMode::FixedNotional:
+        runFixedNotional<Execution>(signals, stride, lookbackWindow);
+        break;
+    default:
+        runSerial<Execution>(signals, stride, lookbackWindow);
+        break;
+    }
+}
+
+template <typename Execution>
+void Backtester::runSerial(const AssetPair::Signal* signals, size_t stride, size_t lookbackWindow) {
+    const size_t numDays = marketData_->getDataSize();
+    const size_t lastDay = numDays - 1;
+    const size_t signalDays = std::min(numDays, stride);
+    
+    // Day-major loop: one clock across all pairs; days past the signal matrix are flat
+    size_t day = lookbackWindow;
+    for (; day < signalDays && !pruned_; ++day) {
+        executeSignals(signals + day, stride, static_cast<int>(Execution::executionDay(day, lastDay)));
+    }
+    for (; day < numDays && !pruned_; ++day) {
+        executeSignals(nullptr, stride, static_cast<int>(Execution::executionDay(day, lastDay)));
+    }
+}
+
+void Backtester::resetRun(double initialCapital, size_t numDays) {
+    // Days before the first execution carry the initial capital
+    cash_ = initialCapital;
+    initialCapital_ = initialCapital;
+    metrics_ = PerformanceMetrics();
+    runMetrics_ = MetricsAccumulator();
+    pendingDay_ = -1;
+    pendingValue_ = initialCapital;
+    accumulatedDays_ = 0;
+    runDays_ = numDays;
+    pruned_ = false;
+    firstValuedDay_ = -1;
+    positionsValue_ = 0.0;
+    markDay_ = 0;
+    workspace_.reset(pairs_.size(), recordValues_ ? numDays : 0, initialCapital);
+}
+
+void Backtester::recordValue(int day, double value) {
+    if (recordValues_) {
+        workspace_.portfolioValues[day] = value;
+    }
+    if (day != pendingDay_) {
+        accumulateValuesBefore(static_cast<size_t>(day));
+        pendingDay_ = day;
+    }
+    pendingValue_ = value;
+    
+    // Only the last day's value is ever revised, and it ends the run anyway
+    if (killCriteria_.isSet() && static_cast<size_t>(day) + 1 < runDays_) {
+        accumulateValuesBefore(static_cast<size_t>(day) + 1);
+        checkKillCriteria(day);
+    }
+}
+
+bool Backtester::KillCriteria::parse(const std::string& spec, KillCriteria& criteria) {
+    std::stringstream stream(spec);
+    std::string token;
+    try {
+        while (std::getline(stream, token, ',')) {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Error: Malformed kill criteria: " << spec << std::endl;
+                return false;
             }
-            
-            if (signal != currentPosition) {
-                if (currentPosition != 0) {
-                    // Close existing position
-                    double priceA = pair->getPricesA()[executionDay];
-                    double priceB = pair->getPricesB()[executionDay];
-                    
-                    // Calculate P&L
-                    double entryValueA = position.quantityA * position.entryPriceA;
-                    double entryValueB = position.quantityB * position.entryPriceB;
-                    double exitValueA = position.quantityA * priceA;
-                    double exitValueB = position.quantityB * priceB;
-                    
-                    double pnl = (exitValueA - entryValueA) + (exitValueB - entryValueB);
-                    tradeHistory_.emplace_back(executionDay, pnl);
-                    
-                    // Update cash
-                    cash_ += exitValueA + exitValueB;
-                    
-                    // Record outcome
-                    if (pnl > 0) metrics_.winCount++;
-                    else metrics_.lossCount++;
-                    
-                    // Record holding period
-                    int holdingPeriod = executionDay - position.entryDay;
-                    metrics_.avgHoldingPeriod += holdingPeriod;
-                    
-                    // Clear position
-                    position = Position();
-                    currentPosition = 0;
-                }
-                
-                if (signal != 0) {
-                    // Open new position
-                    double priceA = pair->getPricesA()[executionDay];
-                    double priceB = pair->getPricesB()[executionDay];
-                    
-                    // Size position based on fixed notional value
-                    // Allocate 10% of portfolio to each pair
-                    double positionSize = calculatePortfolioValue(executionDay-1) * 0.1;
-                    
-                    // Determine position direction
-                    double quantityA, quantityB;
-                    if (signal > 0) {
-                        // Long spread: buy A, sell B
-                        quantityA = positionSize / (2 * priceA);
-                        quantityB = -positionSize / (2 * priceB);
-                    } else {
-                        // Short spread: sell A, buy B
-                        quantityA = -positionSize / (2 * priceA);
-                        quantityB = positionSize / (2 * priceB);
-                    }
-                    
-                    // Update position
-                    position.symbolA = pair->getSymbolA();
-                    position.symbolB = pair->getSymbolB();
-                    position.quantityA = quantityA;
-                    position.quantityB = quantityB;
-                    position.entryPriceA = priceA;
-                    position.entryPriceB = priceB;
-                    position.entryDay = executionDay;
-                    position.direction = signal;
-                    
-                    // Update cash
-                    cash_ -= (quantityA * priceA + quantityB * priceB);
-                    
-                    // Add to active positions
-                    positions_.push_back(position);
-                    currentPosition = signal;
-                }
+            std::string key = token.substr(0, eq);
+            std::string value = token.substr(eq + 1);
+            if (key == "drawdown") {
+                criteria.maxDrawdown = std::stod(value);
+            } else if (key == "checkpoint") {
+                criteria.checkpointBars = std::stoul(value);
+            } else if (key == "sharpe") {
+                criteria.minSharpe = std::stod(value);
+            } else if (key == "trades") {
+                criteria.minTradesPerCheckpoint = std::stoi(value);
+            } else {
+                std::cerr << "Error: Unknown kill criterion: " << key << std::endl;
+                return false;
             }
-            
-            // Update portfolio value for the day
-            portfolioValues_[executionDay] = calculatePortfolioValue(executionDay);
         }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Could not parse kill criteria: " << spec << std::endl;
+        return false;
+    }
+    if (criteria.checkpointBars == 0 &&
+        (criteria.minTradesPerCheckpoint > 0 || criteria.minSharpe > -std::numeric_limits<double>::infinity())) {
+        std::cerr << "Error: sharpe and trades kill criteria need checkpoint=<bars>" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Backtester::checkKillCriteria(int day) {
+    if (firstValuedDay_ < 0) {
+        firstValuedDay_ = day;
+    }
+    const KillCriteria& kill = killCriteria_;
+    bool stop = kill.maxDrawdown > 0.0 && runMetrics_.maxDrawdown() > kill.maxDrawdown;
+    
+    const size_t elapsed = static_cast<size_t>(day - firstValuedDay_);
+    if (!stop && kill.checkpointBars > 0 && elapsed > 0 && elapsed % kill.checkpointBars == 0) {
+        const size_t checkpoint = elapsed / kill.checkpointBars;
+        stop = runMetrics_.sharpeRatio(periodsPerYear_) < kill.minSharpe ||
+               static_cast<size_t>(runMetrics_.numTrades()) < checkpoint * kill.minTradesPerCheckpoint;
+    }
+    if (!stop) {
+        return;
+    }
+    pruned_ = true;
+    runDays_ = static_cast<size_t>(day) + 1;
+    if (recordValues_) {
+        workspace_.portfolioValues.resize(runDays_);
+    }
+    STATARB_PROFILE_COUNT(RunsPruned, 1);
+}
+
+void Backtester::accumulateValuesBefore(size_t day) {
+    // Skipped days up to the pending one carry the initial capital
+    if (pendingDay_ >= 0 && accumulatedDays_ <= static_cast<size_t>(pendingDay_) &&
+        static_cast<size_t>(pendingDay_) < day) {
+        for (; accumulatedDays_ < static_cast<size_t>(pendingDay_); ++accumulatedDays_) {
+            runMetrics_.addValue(initialCapital_);
+        }
+        runMetrics_.addValue(pendingValue_);
+        ++accumulatedDays_;
+    }
+    for (; accumulatedDays_ < day; ++accumulatedDays_) {
+        runMetrics_.addValue(initialCapital_);
+    }
+}
+
+void Backtester::executeSignals(const AssetPair::Signal* signals, size_t stride, int executionDay) {
+    // Positions are carried at the previous day's close for sizing
+    markPositionsTo(executionDay - 1);
+    
+    for (size_t p = 0; p < pairs_.size(); ++p) {
+        int signal = signals ? signals[p * stride] : 0;
+        if (signal == workspace_.currentPosition[p]) {
+            continue;
+        }
+        
+        if (workspace_.currentPosition[p] != 0) {
+            closePosition(p, executionDay);
+            workspace_.currentPosition[p] = 0;
+        }
+        
+        if (signal != 0) {
+            openPosition(p, signal, executionDay);
+            workspace_.currentPosition[p] = signal;
+        }
+    }
+    
+    // Update portfolio value for the day
+    markPositionsTo(executionDay);
+    recordValue(executionDay, cash_ + positionsValue_);
+}
+
+void Backtester::runStreaming(double entryThreshold, double exitThreshold,
+                              size_t lookbackWindow, bool delayedExecution) {
+    MarketDataStream& stream = *stream_;
+    const size_t numDays = stream.getDataSize();
+    if (numDays == 0) {
+        std::cerr << "Error: No market data available" << std::endl;
+        return;
+    }
+    if (executionMode_ != ExecutionMode::Serial) {
+        std::cerr << "Warning: streaming runs use serial execution" << std::endl;
+    }
+    
+    STATARB_PROFILE_SCOPE("Backtester::simulate");
+    STATARB_PROFILE_COUNT(BarsProcessed, pairs_.size() * (numDays - std::min(numDays, lookbackWindow)));
+    
+    for (auto& pair : pairs_) {
+        pair->startStreaming(entryThreshold, exitThreshold, lookbackWindow, hedgeRatioWindow_);
+    }
+    
+    if (delayedExecution) {
+        streamBars<StrategyPolicies::NextBarExecution>(lookbackWindow);
+    } else {
+        streamBars<StrategyPolicies::SameBarExecution>(lookbackWindow);
     }
     
-    // Calculate performance metrics
     calculateMetrics();
 }
 
-double Backtester::calculatePortfolioValue(int day) {
-    if (day < 0 || day >= static_cast<int>(marketData_->getDataSize())) {
-        return initialCapital_;
+template <typename Execution>
+void Backtester::streamBars(size_t lookbackWindow) {
+    MarketDataStream& stream = *stream_;
+    const size_t numDays = stream.getDataSize();
+    
+    // Latest signal per pair; with T+1 execution it waits one bar for its fill
+    workspace_.signals.assign(pairs_.size(), 0);
+    
+    // Legs are marked and traded through gaps at their last price, as in-memory runs do
+    stream.rewind();
+    while (!pruned_ && stream.nextChunk()) {
+        stream.fillForward();
+        for (size_t day = stream.getChunkBegin(); day < stream.getChunkEnd() && !pruned_; ++day) {
+            stepOnline<Execution>(day, lookbackWindow);
+        }
     }
     
-    double totalValue = cash_;
+    // The last bar's signals have no next bar and fill on the same bar,
+    // whose prices are still resident
+    if (Execution::kDelay > 0 && lookbackWindow < numDays && !pruned_) {
+        executeSignals(workspace_.signals.data(), 1, static_cast<int>(numDays - 1));
+    }
+}
+
+template <typename Execution>
+void Backtester::stepOnline(size_t day, size_t lookbackWindow) {
+    constexpr bool delayed = Execution::kDelay > 0;
+    AssetPair::Signal* signals = workspace_.signals.data();
     
-    // Add value of all positions
-    for (const auto& position : positions_) {
-        auto pricesA = marketData_->getPriceSeries(position.symbolA);
-        auto pricesB = marketData_->getPriceSeries(position.symbolB);
-        
-        if (pricesA && pricesB && day < static_cast<int>(pricesA->size()) && day < static_cast<int>(pricesB->size())) {
-            double currentPriceA = (*pricesA)[day];
-            double currentPriceB = (*pricesB)[day];
-            
-            totalValue += position.quantityA * currentPriceA + position.quantityB * currentPriceB;
+    // Yesterday's signals fill at today's prices
+    if (delayed && day > lookbackWindow) {
+        executeSignals(signals, 1, static_cast<int>(day));
+    }
+    
+    for (size_t p = 0; p < pairs_.size(); ++p) {
+        signals[p] = static_cast<AssetPair::Signal>(
+            pairs_[p]->onBar(priceA(p, static_cast<int>(day)), priceB(p, static_cast<int>(day))));
+    }
+    
+    if (!delayed && day >= lookbackWindow) {
+        executeSignals(signals, 1, static_cast<int>(day));
+    }
+}
+
+void Backtester::startLive(double initialCapital, double entryThreshold, double exitThreshold,
+                           size_t lookbackWindow, bool delayedExecution) {
+    if (!live_) {
+        std::cerr << "Error: startLive() needs a backtester built on a symbol list" << std::endl;
+        return;
+    }
+    if (executionMode_ != ExecutionMode::Serial) {
+        std::cerr << "Warning: live runs use serial execution" << std::endl;
+    }
+    
+    // The run length is unknown until finishLive(); nothing is kept per bar
+    recordValues_ = false;
+    resetRun(initialCapital, std::numeric_limits<size_t>::max());
+    workspace_.signals.assign(pairs_.size(), 0);
+    livePrices_.assign(2 * liveSymbols_.size(), std::numeric_limits<double>::quiet_NaN());
+    liveBars_ = 0;
+    liveLookback_ = lookbackWindow;
+    liveDelayed_ = delayedExecution;
+    for (auto& pair : pairs_) {
+        pair->startStreaming(entryThreshold, exitThreshold, lookbackWindow, hedgeRatioWindow_);
+    }
+}
+
+const AssetPair::Signal* Backtester::onLiveBar(const double* prices) {
+    if (pruned_) {
+        return workspace_.signals.data();
+    }
+    
+    // This bar's row overwrites the one from two bars back
+    const size_t numSymbols = liveSymbols_.size();
+    const size_t day = liveBars_;
+    double* row = livePrices_.data() + (day & 1) * numSymbols;
+    const double* previous = livePrices_.data() + ((day + 1) & 1) * numSymbols;
+    for (size_t id = 0; id < numSymbols; ++id) {
+        row[id] = prices[id] == prices[id] ? prices[id] : previous[id];
+    }
+    
+    if (liveDelayed_) {
+        stepOnline<StrategyPolicies::NextBarExecution>(day, liveLookback_);
+    } else {
+        stepOnline<StrategyPolicies::SameBarExecution>(day, liveLookback_);
+    }
+    ++liveBars_;
+    return workspace_.signals.data();
+}
+
+void Backtester::finishLive() {
+    if (!live_) {
+        return;
+    }
+    if (!pruned_) {
+        // As on a stream, the last bar's signals fill on that bar
+        if (liveDelayed_ && liveLookback_ < liveBars_) {
+            executeSignals(workspace_.signals.data(), 1, static_cast<int>(liveBars_ - 1));
         }
+        runDays_ = liveBars_;
+    }
+    calculateMetrics();
+}
+
+void Backtester::markPositionsTo(int day) {
+    if (day < 0 || day == markDay_) {
+        return;
     }
     
-    return totalValue;
+    // Apply each live position's price change since the last mark
+    for (const auto& position : workspace_.positions) {
+        const size_t p = position.pairIndex;
+        positionsValue_ += position.quantityA * (priceA(p, day) - priceA(p, markDay_))
+                         + position.quantityB * (priceB(p, day) - priceB(p, markDay_));
+    }
+    markDay_ = day;
 }
 
-void Backtester::executeOrder(int day, const std::string& symbol, double quantity, double price) {
+void Backtester::openPosition(size_t pairIndex, int signal, int day) {
+    double entryA = priceA(pairIndex, day);
+    double entryB = priceB(pairIndex, day);
+    
+    // Size position based on fixed notional value
+    // Allocate 10% of portfolio (valued at the mark day) to each pair
+    double positionSize = (cash_ + positionsValue_) * kPositionFraction;
+    
+    Position position;
+    sizePosition(position, signal, positionSize, entryA, entryB);
+    position.symbolA = pairSymbols_[pairIndex].first;
+    position.symbolB = pairSymbols_[pairIndex].second;
+    position.pairIndex = pairIndex;
+    position.entryPriceA = entryA;
+    position.entryPriceB = entryB;
+    position.entryDay = day;
+    position.direction = signal;
+    
     // Update cash
-    cash_ -= quantity * price;
+    cash_ -= (position.quantityA * entryA + position.quantityB * entryB);
+    
+    // Add to the live book, valued at the current mark day
+    positionsValue_ += position.quantityA * priceA(pairIndex, markDay_)
+                     + position.quantityB * priceB(pairIndex, markDay_);
+    workspace_.pairPositionSlot[pairIndex] = static_cast<int>(workspace_.positions.size());
+    workspace_.positions.push_back(position);
 }
 
-void Backtester::calculateMetrics() {
-    if (portfolioValues_.empty()) {
+void Backtester::closePosition(size_t pairIndex, int day) {
+    int slot = workspace_.pairPositionSlot[pairIndex];
+    if (slot < 0) {
         return;
     }
     
-    // Calculate total return
-    double finalValue = portfolioValues_.back();
-    metrics_.totalReturn = (finalValue / initialCapital_) - 1.0;
+    const Position& position = workspace_.positions[slot];
     
-    // Calculate annualized return (assuming 252 trading days per year)
-    double years = static_cast<double>(portfolioValues_.size()) / 252.0;
-    metrics_.annualizedReturn = std::pow(1.0 + metrics_.totalReturn, 1.0 / years) - 1.0;
-    
-    // Calculate daily returns
-    std::vector<double> dailyReturns(portfolioValues_.size() - 1);
-    for (size_t i = 1; i < portfolioValues_.size(); ++i) {
-        dailyReturns[i-1] = (portfolioValues_[i] / portfolioValues_[i-1]) - 1.0;
+    // Record the round trip, P&L included; live runs only accumulate it
+    const BacktestTrade trade = closeTrade(position, day, priceA(pairIndex, day), priceB(pairIndex, day));
+    runMetrics_.addTrade(trade.pnl, trade.holdingDays());
+    if (!live_) {
+        workspace_.tradeHistory.push_back(trade);
     }
     
-    // Calculate Sharpe ratio (assuming 0% risk-free rate)
-    double meanDailyReturn = Utilities::mean(dailyReturns);
-    double stdDailyReturn = Utilities::standardDeviation(dailyReturns);
+    // Update cash and drop the position's mark-to-market contribution
+    cash_ += position.quantityA * trade.exitPriceA + position.quantityB * trade.exitPriceB;
+    positionsValue_ -= position.quantityA * priceA(pairIndex, markDay_)
+                     + position.quantityB * priceB(pairIndex, markDay_);
     
-    if (stdDailyReturn > 0) {
-        metrics_.sharpeRatio = (meanDailyReturn / stdDailyReturn) * std::sqrt(252.0);
+    // O(1) removal: move the last live position into the vacated slot
+    size_t last = workspace_.positions.size() - 1;
+    if (static_cast<size_t>(slot) != last) {
+        workspace_.positions[slot] = std::move(workspace_.positions[last]);
+        workspace_.pairPositionSlot[workspace_.positions[slot].pairIndex] = slot;
     }
+    workspace_.positions.pop_back();
+    workspace_.pairPositionSlot[pairIndex] = -1;
+}
+
+template <typename Execution>
+void Backtester::runSharedCapital(const AssetPair::Signal* signals, size_t stride,
+                                  size_t lookbackWindow) {
+    BacktestWorkspace& ws = workspace_;
+    const size_t numPairs = pairs_.size();
+    const size_t numDays = marketData_->getDataSize();
+    const size_t numChunks = (numPairs + kPairChunk - 1) / kPairChunk;
+    ws.pairBook.assign(numPairs, Position());
+    ws.chunkCash.assign(numChunks, 0.0);
+    ws.chunkValues.assign(numChunks, 0.0);
+    ws.chunkTrades.resize(numChunks);
     
-    // Calculate max drawdown
-    double maxValue = portfolioValues_[0];
-    double maxDrawdown = 0.0;
+    // Value of the whole book at `day`, reduced in chunk order
+    auto valueBook = [&](int day) {
+        forEachChunk(pool_.get(), numChunks, [&](size_t c) {
+            double value = 0.0;
+            for (size_t p = c * kPairChunk; p < std::min(numPairs, (c + 1) * kPairChunk); ++p) {
+                value += bookValue(ws.pairBook[p], *pairs_[p], day);
+            }
+            ws.chunkValues[c] = value;
+        });
+        double total = 0.0;
+        for (double value : ws.chunkValues) {
+            total += value;
+        }
+        return total;
+    };
     
-    for (const auto& value : portfolioValues_) {
-        if (value > maxValue) {
-            maxValue = value;
-        } else {
-            double drawdown = (maxValue - value) / maxValue;
-            if (drawdown > maxDrawdown) {
-                maxDrawdown = drawdown;
+    int valuedDay = -1;
+    for (size_t day = lookbackWindow; day < numDays && !pruned_; ++day) {
+        const int executionDay = static_cast<int>(Execution::executionDay(day, numDays - 1));
+        
+        // Day barrier: every pair is sized off the same start-of-day equity
+        if (executionDay - 1 != valuedDay) {
+            positionsValue_ = (executionDay > 0) ? valueBook(executionDay - 1) : 0.0;
+        }
+        const double notional = (cash_ + positionsValue_) * kPositionFraction;
+        
+        forEachChunk(pool_.get(), numChunks, [&](size_t c) {
+            ws.chunkTrades[c].clear();
+            double cash = 0.0;
+            double value = 0.0;
+            for (size_t p = c * kPairChunk; p < std::min(numPairs, (c + 1) * kPairChunk); ++p) {
+                int signal = (day < stride) ? signals[p * stride + day] : 0;
+                cash += followSignal(ws.pairBook[p], *pairs_[p], p, signal, executionDay,
+                                     notional, ws.chunkTrades[c]);
+                value += bookValue(ws.pairBook[p], *pairs_[p], executionDay);
             }
+            ws.chunkCash[c] = cash;
+            ws.chunkValues[c] = value;
+        });
+        
+        positionsValue_ = 0.0;
+        for (size_t c = 0; c < numChunks; ++c) {
+            cash_ += ws.chunkCash[c];
+            positionsValue_ += ws.chunkValues[c];
+            recordTrades(ws.chunkTrades[c]);
         }
+        valuedDay = executionDay;
+        recordValue(executionDay, cash_ + positionsValue_);
     }
     
-    metrics_.maxDrawdown = maxDrawdown;
+    markDay_ = std::max(valuedDay, 0);
+    collectOpenPositions();
+}
+
+template <typename Execution>
+void Backtester::runFixedNotional(const AssetPair::Signal* signals, size_t stride,
+                                  size_t lookbackWindow) {
+    BacktestWorkspace& ws = workspace_;
+    const size_t numPairs = pairs_.size();
+    const size_t numDays = marketData_->getDataSize();
+    const size_t numChunks = (numPairs + kPairChunk - 1) / kPairChunk;
+    const double notional = initialCapital_ * kPositionFraction;
+    ws.pairBook.assign(numPairs, Position());
+    ws.chunkCash.assign(numChunks, 0.0);
+    ws.chunkValues.assign(numChunks * numDays, 0.0);
+    // Chunk 0's list doubles as the merged one, so keep it even without pairs
+    ws.chunkTrades.resize(std::max<size_t>(numChunks, 1));
+    ws.chunkTrades[0].clear();
+    
+    // Each pair's whole path is independent; a chunk sums its pairs' equity
+    // streams (cash flows to date plus open value) into one row
+    forEachChunk(pool_.get(), numChunks, [&](size_t c) {
+        double* row = ws.chunkValues.data() + c * numDays;
+        ws.chunkTrades[c].clear();
+        double chunkCash = 0.0;
+        for (size_t p = c * kPairChunk; p < std::min(numPairs, (c + 1) * kPairChunk); ++p) {
+            Position& position = ws.pairBook[p];
+            const AssetPair& pair = *pairs_[p];
+            double cash = 0.0;
+            int pendingDay = -1;
+            double pendingValue = 0.0;
+            for (size_t day = lookbackWindow; day < numDays; ++day) {
+                const int executionDay = static_cast<int>(Execution::executionDay(day, numDays - 1));
+                // Only the last value recorded for an execution day counts
+                if (executionDay != pendingDay) {
+                    if (pendingDay >= 0) row[pendingDay] += pendingValue;
+                    pendingDay = executionDay;
+                }
+                int signal = (day < stride) ? signals[p * stride + day] : 0;
+                cash += followSignal(position, pair, p, signal, executionDay, notional,
+                                     ws.chunkTrades[c]);
+                pendingValue = cash + bookValue(position, pair, executionDay);
+            }
+            if (pendingDay >= 0) row[pendingDay] += pendingValue;
+            chunkCash += cash;
+        }
+        ws.chunkCash[c] = chunkCash;
+    });
     
-    // Calculate average metrics
-    int totalTrades = metrics_.winCount + metrics_.lossCount;
-    if (totalTrades > 0) {
-        metrics_.avgHoldingPeriod /= totalTrades;
+    // Deterministic merge: chunk order for values, (day, pair) order for trades
+    std::vector<BacktestTrade>& trades = ws.chunkTrades[0];
+    for (size_t c = 1; c < numChunks; ++c) {
+        trades.insert(trades.end(), ws.chunkTrades[c].begin(), ws.chunkTrades[c].end());
     }
+    std::stable_sort(trades.begin(), trades.end(),
+                     [](const BacktestTrade& x, const BacktestTrade& y) { return x.exitDay < y.exitDay; });
     
-    // Calculate average win/loss
-    double totalWins = 0.0;
-    double totalLosses = 0.0;
+    // Trades reach the metrics on their exit day, as in the serial loop, so
+    // the kill criteria see the trade count of the bar they check
+    size_t tradesCounted = 0;
+    auto countTradesUpTo = [&](size_t day) {
+        for (; tradesCounted < trades.size() &&
+               static_cast<size_t>(trades[tradesCounted].exitDay) <= day; ++tradesCounted) {
+            runMetrics_.addTrade(trades[tradesCounted].pnl, trades[tradesCounted].holdingDays());
+        }
+    };
+    const size_t firstDay = (lookbackWindow < numDays)
+        ? Execution::executionDay(lookbackWindow, numDays - 1) : numDays;
+    for (size_t day = firstDay; day < numDays && !pruned_; ++day) {
+        double equity = 0.0;
+        for (size_t c = 0; c < numChunks; ++c) {
+            equity += ws.chunkValues[c * numDays + day];
+        }
+        countTradesUpTo(day);
+        recordValue(static_cast<int>(day), initialCapital_ + equity);
+    }
     
-    for (const auto& trade : tradeHistory_) {
-        double pnl = trade.second;
-        if (pnl > 0) {
-            totalWins += pnl;
-        } else {
-            totalLosses += pnl;
+    markDay_ = static_cast<int>(numDays - 1);
+    if (pruned_) {
+        // The pair paths ran past the stop: cut them there. Trades closing
+        // after it are still open at the stop, later entries never happened
+        markDay_ = static_cast<int>(runDays_) - 1;
+        for (auto& position : ws.pairBook) {
+            if (position.direction != 0 && position.entryDay > markDay_) {
+                position = Position();
+            }
+        }
+        auto firstOpen = std::find_if(trades.begin(), trades.end(), [&](const BacktestTrade& trade) {
+            return trade.exitDay > markDay_;
+        });
+        for (auto it = firstOpen; it != trades.end(); ++it) {
+            if (it->entryDay > markDay_) {
+                continue;
+            }
+            Position& position = ws.pairBook[it->pairIndex];
+            position.pairIndex = it->pairIndex;
+            position.quantityA = it->quantityA;
+            position.quantityB = it->quantityB;
+            position.entryPriceA = it->entryPriceA;
+            position.entryPriceB = it->entryPriceB;
+            position.entryDay = it->entryDay;
+            position.direction = it->direction;
+        }
+        trades.erase(firstOpen, trades.end());
+        
+        // Cash at the stop: realised P&L less what the open positions cost
+        for (const auto& trade : trades) {
+            cash_ += trade.pnl;
         }
+        for (const auto& position : ws.pairBook) {
+            if (position.direction != 0) {
+                cash_ -= position.quantityA * position.entryPriceA + position.quantityB * position.entryPriceB;
+            }
+        }
+    } else {
+        for (size_t c = 0; c < numChunks; ++c) {
+            cash_ += ws.chunkCash[c];
+        }
+        countTradesUpTo(numDays);
     }
+    // Already in the metrics: only the history is left to fill
+    ws.tradeHistory.insert(ws.tradeHistory.end(), trades.begin(), trades.end());
     
-    if (metrics_.winCount > 0) {
-        metrics_.avgWin = totalWins / metrics_.winCount;
+    positionsValue_ = 0.0;
+    for (size_t p = 0; p < numPairs; ++p) {
+        positionsValue_ += bookValue(ws.pairBook[p], *pairs_[p], markDay_);
     }
+    collectOpenPositions();
+}
+
+void Backtester::recordTrades(const std::vector<BacktestTrade>& trades) {
+    for (const auto& trade : trades) {
+        workspace_.tradeHistory.push_back(trade);
+        runMetrics_.addTrade(trade.pnl, trade.holdingDays());
+    }
+}
+
+void Backtester::collectOpenPositions() {
+    BacktestWorkspace& ws = workspace_;
+    for (size_t p = 0; p < pairs_.size(); ++p) {
+        Position& position = ws.pairBook[p];
+        if (position.direction == 0) {
+            continue;
+        }
+        position.symbolA = pairSymbols_[p].first;
+        position.symbolB = pairSymbols_[p].second;
+        ws.pairPositionSlot[p] = static_cast<int>(ws.positions.size());
+        ws.currentPosition[p] = position.direction;
+        ws.positions.push_back(position);
+    }
+}
+
+void Backtester::calculateMetrics() {
+    STATARB_PROFILE_SCOPE("Backtester::calculateMetrics");
+    if (runDays_ == 0) {
+        return;
+    }
+    accumulateValuesBefore(runDays_);
+    if (costModel_.isFree() || !recordValues_) {
+        if (!costModel_.isFree()) {
+            std::cerr << "Warning: costs need recorded portfolio values, reporting gross metrics" << std::endl;
+        }
+        costed_.reset();
+        metrics_ = runMetrics_.finish(initialCapital_, periodsPerYear_);
+    } else {
+        costed_ = evaluateCosts(costModel_);
+        metrics_ = costed_->metrics;
+    }
+    if (verbose_) {
+        printMetrics(metrics_, barInterval_);
+    }
+}
+
+Backtester::CostedRun Backtester::evaluateCosts(const CostModel& costs) const {
+    STATARB_PROFILE_SCOPE("Backtester::evaluateCosts");
+    const std::vector<Trade>& trades = workspace_.tradeHistory;
+    const std::vector<double>& gross = workspace_.portfolioValues;
+    CostedRun run;
+    if (!recordValues_ || gross.empty()) {
+        return run;
+    }
+    run.tradeCosts.resize(trades.size());
     
-    if (metrics_.lossCount > 0) {
-        metrics_.avgLoss = totalLosses / metrics_.lossCount;
+    // Leg volumes once per pair rather than per fill
+    std::vector<std::pair<double, double>> volumes(pairSymbols_.size());
+    for (size_t p = 0; p < pairSymbols_.size(); ++p) {
+        volumes[p] = {costs.volumeOf(pairSymbols_[p].first), costs.volumeOf(pairSymbols_[p].second)};
     }
     
-    // Print metrics
+    // Per-day cost flows; entry and exit costs land on their fill bars, and
+    // fills past the recorded values (none in a consistent run) are not charged
+    std::vector<double> dayCosts(gross.size(), 0.0);
+    auto charge = [&](int day, double cost) {
+        if (day >= 0 && static_cast<size_t>(day) < dayCosts.size()) {
+            dayCosts[day] += cost;
+        }
+    };
+    for (size_t k = 0; k < trades.size(); ++k) {
+        const Trade& trade = trades[k];
+        const auto& volume = volumes[trade.pairIndex];
+        double entry = costs.fillCost(trade.quantityA, trade.entryPriceA, volume.first)
+                     + costs.fillCost(trade.quantityB, trade.entryPriceB, volume.second);
+        double exit = costs.fillCost(trade.quantityA, trade.exitPriceA, volume.first)
+                    + costs.fillCost(trade.quantityB, trade.exitPriceB, volume.second);
+        run.tradeCosts[k] = entry + exit;
+        charge(trade.entryDay, entry);
+        charge(trade.exitDay, exit);
+    }
+    for (const auto& position : workspace_.positions) {
+        const auto& volume = volumes[position.pairIndex];
+        charge(position.entryDay, costs.fillCost(position.quantityA, position.entryPriceA, volume.first)
+                                + costs.fillCost(position.quantityB, position.entryPriceB, volume.second));
+    }
+    
+    run.portfolioValues.resize(gross.size());
+    double charged = 0.0;
+    for (size_t day = 0; day < gross.size(); ++day) {
+        charged += dayCosts[day];
+        run.portfolioValues[day] = gross[day] - charged;
+    }
+    run.totalCost = charged;
+    
+    run.trades = trades;
+    for (size_t k = 0; k < trades.size(); ++k) {
+        run.trades[k].pnl -= run.tradeCosts[k];
+    }
+    run.metrics = computeMetrics(run.portfolioValues, run.trades, initialCapital_, periodsPerYear_);
+    return run;
+}
+
+Backtester::PerformanceMetrics Backtester::computeMetrics(const std::vector<double>& portfolioValues,
+                                                          const std::vector<Trade>& trades,
+                                                          double initialCapital,
+                                                          double periodsPerYear) {
+    MetricsAccumulator accumulator;
+    for (double value : portfolioValues) {
+        accumulator.addValue(value);
+    }
+    for (const auto& trade : trades) {
+        accumulator.addTrade(trade.pnl, trade.holdingDays());
+    }
+    return accumulator.finish(initialCapital, periodsPerYear);
+}
+
+void Backtester::printMetrics(const PerformanceMetrics& metrics, int64_t barInterval) {
+    int totalTrades = metrics.winCount + metrics.lossCount;
     std::cout << "------- Performance Metrics -------" << std::endl;
-    std::cout << "Total Return: " << (metrics_.totalReturn * 100.0) << "%" << std::endl;
-    std::cout << "Annualized Return: " << (metrics_.annualizedReturn * 100.0) << "%" << std::endl;
-    std::cout << "Sharpe Ratio: " << metrics_.sharpeRatio << std::endl;
-    std::cout << "Max Drawdown: " << (metrics_.maxDrawdown * 100.0) << "%" << std::endl;
-    std::cout << "Win Rate: " << (static_cast<double>(metrics_.winCount) / totalTrades * 100.0) << "%" << std::endl;
-    std::cout << "Average Holding Period: " << metrics_.avgHoldingPeriod << " days" << std::endl;
-    std::cout << "Average Win: " << metrics_.avgWin << std::endl;
-    std::cout << "Average Loss: " << metrics_.avgLoss << std::endl;
+    std::cout << "Total Return: " << (metrics.totalReturn * 100.0) << "%" << std::endl;
+    std::cout << "Annualized Return: " << (metrics.annualizedReturn * 100.0) << "%" << std::endl;
+    std::cout << "Sharpe Ratio: " << metrics.sharpeRatio << std::endl;
+    std::cout << "Max Drawdown: " << (metrics.maxDrawdown * 100.0) << "%" << std::endl;
+    std::cout << "Win Rate: " << (static_cast<double>(metrics.winCount) / totalTrades * 100.0) << "%" << std::endl;
+    if (barInterval == Timestamps::kNanosPerDay || barInterval == 0) {
+        std::cout << "Average Holding Period: " << metrics.avgHoldingPeriod << " days" << std::endl;
+    } else {
+        std::cout << "Average Holding Period: " << metrics.avgHoldingPeriod << " bars of "
+                  << Timestamps::formatInterval(barInterval) << std::endl;
+    }
+    std::cout << "Average Win: " << metrics.avgWin << std::endl;
+    std::cout << "Average Loss: " << metrics.avgLoss << std::endl;
 }
 
 bool Backtester::exportResults(const std::string& filename) const {
-    std::vector<std::string> headers = {"Day", "PortfolioValue"};
-    std::vector<std::vector<double>> data(portfolioValues_.size(), std::vector<double>(2));
+    if (getPortfolioValues().empty()) {
+        return false;
+    }
+    return writePortfolioValues(filename, getPortfolioValues());
+}
+
+bool Backtester::writePortfolioValues(const std::string& filename, const std::vector<double>& values) {
+    if (Utilities::isColumnarPath(filename)) {
+        std::vector<int64_t> days(values.size());
+        std::iota(days.begin(), days.end(), 0);
+        return Utilities::writeColumnar(filename, values.size(), {
+            {"Day", Utilities::ColumnType::Int64, days.data(), 0},
+            {"PortfolioValue", Utilities::ColumnType::Float64, values.data(), 0},
+        });
+    }
     
-    for (size_t i = 0; i < portfolioValues_.size(); ++i) {
-        data[i][0] = static_cast<double>(i);
-        data[i][1] = portfolioValues_[i];
+    Utilities::CsvWriter writer;
+    if (!writer.open(filename)) {
+        return false;
+    }
+    writer.header({"Day", "PortfolioValue"});
+    for (size_t i = 0; i < values.size(); ++i) {
+        writer.field(i);
+        writer.field(values[i]);
+        writer.endRow();
+    }
+    return writer.close();
+}
+
+bool Backtester::exportTrades(const std::string& filename) const {
+    const std::vector<Trade>& trades = getTradeHistory();
+    
+    if (Utilities::isColumnarPath(filename)) {
+        // Columns are gathered straight out of the trade records; without
+        // any, the (unread) column pointers come from a placeholder record
+        using Utilities::ColumnType;
+        const Trade placeholder;
+        const Trade* first = trades.empty() ? &placeholder : trades.data();
+        const size_t stride = sizeof(Trade);
+        return Utilities::writeColumnar(filename, trades.size(), {
+            {"PairIndex", ColumnType::Int64, &first->pairIndex, stride},
+            {"Direction", ColumnType::Int32, &first->direction, stride},
+            {"EntryDay", ColumnType::Int32, &first->entryDay, stride},
+            {"ExitDay", ColumnType::Int32, &first->exitDay, stride},
+            {"QuantityA", ColumnType::Float64, &first->quantityA, stride},
+            {"QuantityB", ColumnType::Float64, &first->quantityB, stride},
+            {"EntryPriceA", ColumnType::Float64, &first->entryPriceA, stride},
+            {"EntryPriceB", ColumnType::Float64, &first->entryPriceB, stride},
+            {"ExitPriceA", ColumnType::Float64, &first->exitPriceA, stride},
+            {"ExitPriceB", ColumnType::Float64, &first->exitPriceB, stride},
+            {"PnL", ColumnType::Float64, &first->pnl, stride},
+        });
     }
     
-    return Utilities::writeCSV(filename, headers, data);
-} 
\ No newline at end of file
+    Utilities::CsvWriter writer;
+    if (!writer.open(filename)) {
+        return false;
+    }
+    writer.header({"PairA", "PairB", "Direction", "EntryDay", "ExitDay",
+                   "QuantityA", "QuantityB", "EntryPriceA", "EntryPriceB",
+                   "ExitPriceA", "ExitPriceB", "PnL"});
+    for (const Trade& trade : trades) {
+        const std::string& nameA = pairs_[trade.pairIndex]->getSymbolA();
+        const std::string& nameB = pairs_[trade.pairIndex]->getSymbolB();
+        writer.field(nameA);
+        writer.field(nameB);
+        writer.field(trade.direction);
+        writer.field(trade.entryDay);
+        writer.field(trade.exitDay);
+        writer.field(trade.quantityA);
+        writer.field(trade.quantityB);
+        writer.field(trade.entryPriceA);
+        writer.field(trade.entryPriceB);
+        writer.field(trade.exitPriceA);
+        writer.field(trade.exitPriceB);
+        writer.field(trade.pnl);
+        writer.endRow();
+    }
+    return writer.close();
+}
@@ -0,0 +1,125 @@
+#include "BasketScanner.h"
+#include "AlignedAllocator.h"
+#include "Johansen.h"
+#include "PairScanner.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
+BasketScanner::BasketScanner(std::shared_ptr<const MarketData> marketData, Options options)
+    : marketData_(std::move(marketData)), options_(options)
+{
+}
+
+BasketScanner::BasketScanner(std::shared_ptr<const MarketData> marketData)
+    : BasketScanner(std::move(marketData), Options())
+{
+}
+
+std::vector<std::vector<MarketData::SymbolId>> BasketScanner::correlatedBaskets(const MarketData& marketData,
+                                                                                size_t numLegs,
+                                                                                size_t numThreads) {
+    const size_t n = marketData.getNumSymbols();
+    numLegs = std::min(numLegs, Johansen::kMaxLegs);
+    if (numLegs < 2 || n < numLegs) {
+        return {};
+    }
+
+    std::vector<MarketData::SymbolId> universe(n);
+    std::iota(universe.begin(), universe.end(), 0);
+    const std::vector<double> correlations = PairScanner::returnCorrelations(marketData, universe, numThreads);
+
+    std::vector<std::vector<MarketData::SymbolId>> baskets;
+    std::vector<MarketData::SymbolId> others;
+    for (size_t i = 0; i < n; ++i) {
+        const double* row = correlations.data() + i * n;
+        others.clear();
+        for (size_t j = 0; j < n; ++j) {
+            if (j != i) {
+                others.push_back(static_cast<MarketData::SymbolId>(j));
+            }
+        }
+        std::partial_sort(others.begin(), others.begin() + (numLegs - 1), others.end(),
+                          [row](MarketData::SymbolId a, MarketData::SymbolId b) {
+                              return row[a] != row[b] ? row[a] > row[b] : a < b;
+                          });
+        std::vector<MarketData::SymbolId> basket(others.begin(), others.begin() + (numLegs - 1));
+        basket.push_back(static_cast<MarketData::SymbolId>(i));
+        std::sort(basket.begin(), basket.end());
+        baskets.push_back(std::move(basket));
+    }
+    std::sort(baskets.begin(), baskets.end());
+    baskets.erase(std::unique(baskets.begin(), baskets.end()), baskets.end());
+    return baskets;
+}
+
+std::vector<BasketCandidate> BasketScanner::scan() {
+    return scan(correlatedBaskets(*marketData_, options_.numLegs, options_.numThreads));
+}
+
+std::vector<BasketCandidate> BasketScanner::scan(const std::vector<std::vector<MarketData::SymbolId>>& baskets) {
+    STATARB_PROFILE_SCOPE("BasketScanner::scan");
+    basketsTested_ = baskets.size();
+    STATARB_PROFILE_COUNT(BasketsTested, basketsTested_);
+
+    const MarketData& data = *marketData_;
+    const size_t numDays = data.getDataSize();
+    std::vector<std::optional<BasketCandidate>> results(baskets.size());
+
+    ThreadPool pool(options_.numThreads);
+
+    // Per-worker bar-major leg buffer and estimator workspace, reused across the batch
+    struct Scratch {
+        AlignedVector<double> rows;
+        Johansen::Workspace workspace;
+    };
+    std::vector<Scratch> scratch(pool.size() + 1);
+
+    const size_t grain = std::max<size_t>(1, options_.batchSize);
+    pool.parallelFor(0, baskets.size(), grain, [&](size_t begin, size_t end, size_t worker) {
+        Scratch& local = scratch[worker];
+        local.rows.resize(numDays * Johansen::kMaxLegs);
+
+        for (size_t b = begin; b < end; ++b) {
+            const std::vector<MarketData::SymbolId>& legs = baskets[b];
+            if (legs.size() < 2 || legs.size() > Johansen::kMaxLegs) {
+                continue;
+            }
+            data.visitStorage([&](auto tag) {
+                using T = decltype(tag);
+                for (size_t leg = 0; leg < legs.size(); ++leg) {
+                    const T* prices = data.getColumn<T>(legs[leg]);
+                    double* out = local.rows.data() + leg;
+                    for (size_t t = 0; t < numDays; ++t) {
+                        out[t * Johansen::kMaxLegs] = data.decode(prices[t]);
+                    }
+                }
+            });
+
+            Johansen::Result fit = Johansen::estimate(local.rows.data(), numDays, legs.size(),
+                                                      options_.lags, options_.significanceLevel,
+                                                      local.workspace);
+            if (!fit.valid || !fit.isCointegrated) {
+                continue;
+            }
+            BasketCandidate candidate;
+            candidate.symbols = legs;
+            candidate.weights.assign(fit.weights.begin(), fit.weights.begin() + legs.size());
+            candidate.traceStatistic = fit.traceStatistics[0];
+            candidate.criticalValue = fit.criticalValues[0];
+            candidate.rank = fit.rank;
+            results[b] = std::move(candidate);
+        }
+    });
+
+    std::vector<BasketCandidate> accepted;
+    for (auto& result : results) {
+        if (result) {
+            accepted.push_back(std::move(*result));
+        }
+    }
+    STATARB_PROFILE_COUNT(BasketsAccepted, accepted.size());
+    return accepted;
+}
@@ -0,0 +1,50 @@
+#include "CostModel.h"
+#include <iostream>
+#include <sstream>
+
+CostModel CostModel::scaled(double factor) const {
+    CostModel model = *this;
+    model.commissionPerShare *= factor;
+    model.feeBps *= factor;
+    model.halfSpreadBps *= factor;
+    model.impactBps *= factor;
+    return model;
+}
+
+bool CostModel::parse(const std::string& spec, CostModel& model) {
+    std::stringstream stream(spec);
+    std::string token;
+    try {
+        while (std::getline(stream, token, ',')) {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Error: Malformed cost spec: " << spec << std::endl;
+                return false;
+            }
+            std::string key = token.substr(0, eq);
+            double value = std::stod(token.substr(eq + 1));
+            if (value < 0.0) {
+                std::cerr << "Error: Cost parameter " << key << " must not be negative" << std::endl;
+                return false;
+            }
+            if (key == "commission") {
+                model.commissionPerShare = value;
+            } else if (key == "fee") {
+                model.feeBps = value;
+            } else if (key == "spread") {
+                model.halfSpreadBps = value;
+            } else if (key == "impact") {
+                model.impactBps = value;
+            } else if (key == "adv") {
+                model.averageVolume = value;
+            } else {
+                std::cerr << "Error: Unknown cost parameter: " << key << std::endl;
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Could not parse cost spec: " << spec << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,374 @@
+#include "Johansen.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef USE_EIGEN
+#include <Eigen/Dense>
+#endif
+
+namespace Johansen {
+
+namespace {
+
+// MacKinnon, Haug & Michelis (1999) trace critical values, constant in the
+// VECM, by number of stochastic trends (rows) at 90%, 95% and 99%
+constexpr double kTraceCritical[kMaxLegs][3] = {
+    {2.7055, 3.8415, 6.6349},
+    {13.4294, 15.4943, 19.9349},
+    {27.0669, 29.7961, 35.4628},
+    {44.4929, 47.8545, 54.6815},
+    {65.8202, 69.8189, 77.8202},
+    {91.1090, 95.7542, 104.9637},
+    {120.3673, 125.6185, 135.9825},
+    {153.6341, 159.5290, 171.0905},
+};
+
+#ifdef USE_EIGEN
+
+using RowMajorMap = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>,
+                               0, Eigen::OuterStride<>>;
+template <size_t MaxSize>
+using SmallMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MaxSize, MaxSize>;
+
+// b <- a^-1 b for symmetric positive definite a (n x n, row stride lda)
+bool choleskySolve(double* a, size_t n, size_t lda, double* b, size_t m, size_t ldb) {
+    SmallMatrix<kMaxTerms> matrix = RowMajorMap(a, n, n, Eigen::OuterStride<>(lda));
+    Eigen::LLT<SmallMatrix<kMaxTerms>> llt(matrix);
+    if (llt.info() != Eigen::Success) {
+        return false;
+    }
+    RowMajorMap rhs(b, n, m, Eigen::OuterStride<>(ldb));
+    SmallMatrix<kMaxTerms> solution = llt.solve(SmallMatrix<kMaxTerms>(rhs));
+    rhs = solution;
+    return true;
+}
+
+// q v = lambda s v for symmetric q and positive definite s (n x n, row-major).
+// Eigenvalues descending; eigenvector k is column k of vectors.
+bool generalizedEigen(const double* q, const double* s, size_t n, double* values, double* vectors) {
+    SmallMatrix<kMaxLegs> qm = RowMajorMap(const_cast<double*>(q), n, n, Eigen::OuterStride<>(n));
+    SmallMatrix<kMaxLegs> sm = RowMajorMap(const_cast<double*>(s), n, n, Eigen::OuterStride<>(n));
+    Eigen::GeneralizedSelfAdjointEigenSolver<SmallMatrix<kMaxLegs>> solver(qm, sm);
+    if (solver.info() != Eigen::Success) {
+        return false;
+    }
+    for (size_t k = 0; k < n; ++k) {
+        values[k] = solver.eigenvalues()(n - 1 - k);
+        for (size_t i = 0; i < n; ++i) {
+            vectors[i * n + k] = solver.eigenvectors()(i, n - 1 - k);
+        }
+    }
+    return true;
+}
+
+#else
+
+// In-place lower Cholesky factor of a (n x n, row stride lda)
+bool cholesky(double* a, size_t n, size_t lda) {
+    for (size_t j = 0; j < n; ++j) {
+        double diagonal = a[j * lda + j];
+        for (size_t k = 0; k < j; ++k) {
+            diagonal -= a[j * lda + k] * a[j * lda + k];
+        }
+        if (!(diagonal > 0.0)) {
+            return false;
+        }
+        diagonal = std::sqrt(diagonal);
+        a[j * lda + j] = diagonal;
+        for (size_t i = j + 1; i < n; ++i) {
+            double sum = a[i * lda + j];
+            for (size_t k = 0; k < j; ++k) {
+                sum -= a[i * lda + k] * a[j * lda + k];
+            }
+            a[i * lda + j] = sum / diagonal;
+        }
+    }
+    return true;
+}
+
+// b <- l^-1 b and b <- l^-T b for a lower Cholesky factor l
+void forwardSubstitute(const double* l, size_t n, size_t lda, double* b, size_t m, size_t ldb) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < i; ++k) {
+            for (size_t c = 0; c < m; ++c) {
+                b[i * ldb + c] -= l[i * lda + k] * b[k * ldb + c];
+            }
+        }
+        for (size_t c = 0; c < m; ++c) {
+            b[i * ldb + c] /= l[i * lda + i];
+        }
+    }
+}
+
+void backSubstitute(const double* l, size_t n, size_t lda, double* b, size_t m, size_t ldb) {
+    for (size_t i = n; i-- > 0; ) {
+        for (size_t k = i + 1; k < n; ++k) {
+            for (size_t c = 0; c < m; ++c) {
+                b[i * ldb + c] -= l[k * lda + i] * b[k * ldb + c];
+            }
+        }
+        for (size_t c = 0; c < m; ++c) {
+            b[i * ldb + c] /= l[i * lda + i];
+        }
+    }
+}
+
+bool choleskySolve(double* a, size_t n, size_t lda, double* b, size_t m, size_t ldb) {
+    if (!cholesky(a, n, lda)) {
+        return false;
+    }
+    forwardSubstitute(a, n, lda, b, m, ldb);
+    backSubstitute(a, n, lda, b, m, ldb);
+    return true;
+}
+
+// Cyclic Jacobi rotations on a symmetric n x n matrix (destroyed); the
+// eigenvalues end up on its diagonal and the eigenvectors in the columns of v
+void jacobiEigen(double* a, size_t n, double* v) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            v[i * n + j] = i == j ? 1.0 : 0.0;
+        }
+    }
+    for (int sweep = 0; sweep < 64; ++sweep) {
+        double off = 0.0, total = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                total += a[i * n + j] * a[i * n + j];
+                if (i != j) off += a[i * n + j] * a[i * n + j];
+            }
+        }
+        if (off <= 1e-30 * total) {
+            return;
+        }
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                const double apq = a[p * n + q];
+                if (apq == 0.0) {
+                    continue;
+                }
+                // Rotation that zeroes a[p][q] (Numerical Recipes form)
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) /
+                                 (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (size_t k = 0; k < n; ++k) {
+                    const double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    const double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                a[p * n + q] = a[q * n + p] = 0.0;
+                for (size_t k = 0; k < n; ++k) {
+                    const double vkp = v[k * n + p], vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+}
+
+// q v = lambda s v via s = l l^T and the symmetric l^-1 q l^-T
+bool generalizedEigen(const double* q, const double* s, size_t n, double* values, double* vectors) {
+    double l[kMaxLegs * kMaxLegs];
+    double c[kMaxLegs * kMaxLegs];
+    double u[kMaxLegs * kMaxLegs];
+    std::copy(s, s + n * n, l);
+    if (!cholesky(l, n, n)) {
+        return false;
+    }
+    // c = l^-1 q, transposed, then l^-1 again: l^-1 q l^-T since q is symmetric
+    std::copy(q, q + n * n, c);
+    forwardSubstitute(l, n, n, c, n, n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            u[i * n + j] = c[j * n + i];
+        }
+    }
+    forwardSubstitute(l, n, n, u, n, n);
+    std::copy(u, u + n * n, c);
+
+    jacobiEigen(c, n, u);
+    backSubstitute(l, n, n, u, n, n);
+
+    // Sort descending
+    size_t order[kMaxLegs];
+    for (size_t k = 0; k < n; ++k) order[k] = k;
+    std::sort(order, order + n, [&](size_t x, size_t y) { return c[x * n + x] > c[y * n + y]; });
+    for (size_t k = 0; k < n; ++k) {
+        values[k] = c[order[k] * n + order[k]];
+        for (size_t i = 0; i < n; ++i) {
+            vectors[i * n + k] = u[i * n + order[k]];
+        }
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
+double traceCriticalValue(size_t numFree, double significanceLevel) {
+    numFree = std::min(std::max<size_t>(numFree, 1), kMaxLegs);
+    const int level = significanceLevel >= 0.10 ? 0 : (significanceLevel >= 0.05 ? 1 : 2);
+    return kTraceCritical[numFree - 1][level];
+}
+
+Result estimate(const double* rows, size_t length, size_t numLegs, int lags,
+                double significanceLevel, Workspace& workspace) {
+    Result result;
+    result.numLegs = numLegs;
+    lags = std::min(std::max(lags, 0), kMaxLags);
+    if (numLegs < 2 || numLegs > kMaxLegs || length < static_cast<size_t>(lags) + 2) {
+        return result;
+    }
+    const size_t n = numLegs;
+    const size_t p = static_cast<size_t>(lags);
+    const size_t numTerms = n * (2 + p) + 1;
+    const size_t numPartial = numTerms - 2 * n;   // lagged differences and the constant
+
+    // Moments of z_t = [dy_t, y_{t-1}, dy_{t-1}, ..., dy_{t-p}, 1], upper triangle
+    double* m = workspace.moments.data();
+    std::fill(m, m + numTerms * numTerms, 0.0);
+    double z[kMaxTerms];
+    size_t count = 0;
+    for (size_t t = p + 1; t < length; ++t) {
+        const double* now = rows + t * kMaxLegs;
+        const double* prev = now - kMaxLegs;
+        bool finite = true;
+        for (size_t leg = 0; leg < n; ++leg) {
+            z[leg] = now[leg] - prev[leg];
+            z[n + leg] = prev[leg];
+        }
+        for (size_t lag = 1; lag <= p; ++lag) {
+            const double* later = rows + (t - lag) * kMaxLegs;
+            const double* earlier = later - kMaxLegs;
+            for (size_t leg = 0; leg < n; ++leg) {
+                z[(1 + lag) * n + leg] = later[leg] - earlier[leg];
+            }
+        }
+        z[numTerms - 1] = 1.0;
+        for (size_t i = 0; i + 1 < numTerms; ++i) {
+            finite = finite && std::isfinite(z[i]);
+        }
+        if (!finite) {
+            continue;
+        }
+        for (size_t i = 0; i < numTerms; ++i) {
+            double* row = m + i * numTerms;
+            const double zi = z[i];
+            for (size_t j = i; j < numTerms; ++j) {
+                row[j] += zi * z[j];
+            }
+        }
+        ++count;
+    }
+    if (count <= numTerms) {
+        return result;
+    }
+    for (size_t i = 0; i < numTerms; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            m[i * numTerms + j] = m[j * numTerms + i];
+        }
+    }
+
+    // Partial out the lags and constant: S = (M_kk - M_kc M_cc^-1 M_ck) / T
+    // for k = [dy_t, y_{t-1}]
+    const size_t k = 2 * n;
+    double* mcc = workspace.scratch.data();
+    double* x = workspace.projection.data();
+    for (size_t i = 0; i < numPartial; ++i) {
+        for (size_t j = 0; j < numPartial; ++j) {
+            mcc[i * numPartial + j] = m[(k + i) * numTerms + k + j];
+        }
+        for (size_t j = 0; j < k; ++j) {
+            x[i * k + j] = m[(k + i) * numTerms + j];
+        }
+    }
+    if (!choleskySolve(mcc, numPartial, numPartial, x, k, k)) {
+        return result;
+    }
+    double s[2 * kMaxLegs * 2 * kMaxLegs];
+    for (size_t i = 0; i < k; ++i) {
+        for (size_t j = 0; j < k; ++j) {
+            double sum = m[i * numTerms + j];
+            for (size_t c = 0; c < numPartial; ++c) {
+                sum -= m[i * numTerms + k + c] * x[c * k + j];
+            }
+            s[i * k + j] = sum / count;
+        }
+    }
+
+    // q = S10 S00^-1 S01 against S11
+    double s00[kMaxLegs * kMaxLegs], s01[kMaxLegs * kMaxLegs], s11[kMaxLegs * kMaxLegs];
+    double y[kMaxLegs * kMaxLegs], q[kMaxLegs * kMaxLegs];
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            s00[i * n + j] = s[i * k + j];
+            s01[i * n + j] = s[i * k + n + j];
+            s11[i * n + j] = 0.5 * (s[(n + i) * k + n + j] + s[(n + j) * k + n + i]);
+        }
+    }
+    std::copy(s01, s01 + n * n, y);
+    if (!choleskySolve(s00, n, n, y, n, n)) {
+        return result;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double sum = 0.0;
+            for (size_t c = 0; c < n; ++c) {
+                sum += s01[c * n + i] * y[c * n + j];
+            }
+            q[i * n + j] = sum;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            q[i * n + j] = q[j * n + i] = 0.5 * (q[i * n + j] + q[j * n + i]);
+        }
+    }
+
+    double vectors[kMaxLegs * kMaxLegs];
+    if (!generalizedEigen(q, s11, n, result.eigenvalues.data(), vectors)) {
+        return result;
+    }
+
+    // Trace statistics and rank
+    const double sampleSize = static_cast<double>(count);
+    double tail = 0.0;
+    for (size_t r = n; r-- > 0; ) {
+        double lambda = std::min(std::max(result.eigenvalues[r], 0.0), 1.0 - 1e-15);
+        result.eigenvalues[r] = lambda;
+        tail -= sampleSize * std::log(1.0 - lambda);
+        result.traceStatistics[r] = tail;
+        result.criticalValues[r] = traceCriticalValue(n - r, significanceLevel);
+    }
+    result.rank = 0;
+    while (static_cast<size_t>(result.rank) < n &&
+           result.traceStatistics[result.rank] > result.criticalValues[result.rank]) {
+        ++result.rank;
+    }
+    result.isCointegrated = result.rank > 0;
+
+    // First cointegrating vector, scaled so the first leg has weight one
+    double scale = vectors[0];
+    if (std::abs(scale) < 1e-12) {
+        scale = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            if (std::abs(vectors[i * n]) > std::abs(scale)) scale = vectors[i * n];
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        result.weights[i] = vectors[i * n] / scale;
+    }
+    result.valid = true;
+    return result;
+}
+
+} // namespace Johansen
@@ -0,0 +1,97 @@
+#include "LatencyHistogram.h"
+#include <cmath>
+#include <iomanip>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the highest set bit of a non-zero value
+inline unsigned highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucketOf(uint64_t nanos) {
+    if (nanos < kLinear) {
+        return static_cast<size_t>(nanos);
+    }
+    // Octave of the leading bit, then the next kSubBits bits below it
+    const unsigned exponent = highestBit(nanos);
+    const size_t sub = static_cast<size_t>(nanos >> (exponent - kSubBits)) & ((size_t(1) << kSubBits) - 1);
+    return static_cast<size_t>(kLinear) + (exponent - kSubBits - 1) * (size_t(1) << kSubBits) + sub;
+}
+
+int64_t LatencyHistogram::upperEdge(size_t bucket) {
+    if (bucket < kLinear) {
+        return static_cast<int64_t>(bucket);
+    }
+    const size_t offset = bucket - static_cast<size_t>(kLinear);
+    const unsigned exponent = static_cast<unsigned>(offset >> kSubBits) + kSubBits + 1;
+    const uint64_t sub = offset & ((size_t(1) << kSubBits) - 1);
+    const uint64_t lower = (((uint64_t(1) << kSubBits) + sub) << (exponent - kSubBits));
+    return static_cast<int64_t>(lower + (uint64_t(1) << (exponent - kSubBits)) - 1);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+    for (size_t b = 0; b < kBuckets; ++b) {
+        counts_[b] += other.counts_[b];
+    }
+    if (count_ == 0 || other.min_ < min_) {
+        min_ = other.min_;
+    }
+    if (other.max_ > max_) {
+        max_ = other.max_;
+    }
+    count_ += other.count_;
+    total_ += other.total_;
+}
+
+int64_t LatencyHistogram::percentile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    // Rank of the quantile sample, 1-based
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_)));
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += counts_[b];
+        if (seen >= rank) {
+            const int64_t edge = upperEdge(b);
+            return edge < max_ ? edge : max_;
+        }
+    }
+    return max_;
+}
+
+void LatencyHistogram::print(std::ostream& out, const std::string& name) const {
+    auto micros = [](double nanos) { return nanos / 1000.0; };
+    const std::streamsize precision = out.precision();
+    out << name << ": " << count_ << " samples";
+    if (count_ > 0) {
+        out << std::fixed << std::setprecision(2)
+            << ", mean " << micros(mean()) << " us"
+            << ", p50 " << micros(static_cast<double>(percentile(0.5)))
+            << " / p90 " << micros(static_cast<double>(percentile(0.9)))
+            << " / p99 " << micros(static_cast<double>(percentile(0.99)))
+            << " / p99.9 " << micros(static_cast<double>(percentile(0.999)))
+            << " / max " << micros(static_cast<double>(max_)) << " us"
+            << std::defaultfloat << std::setprecision(precision);
+    }
+    out << std::endl;
+}
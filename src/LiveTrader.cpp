@@ -0,0 +1,234 @@
+#include "LiveTrader.h"
+#include "CsvParsing.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+
+// Line buffer floor; rows longer than the buffer are rejected
+constexpr size_t kMinLineBytes = 1 << 16;
+// Generous per-cell allowance when sizing the buffer from the header
+constexpr size_t kBytesPerCell = 32;
+
+} // namespace
+
+CsvFeed::CsvFeed(size_t queueCapacity)
+    : queue_(std::max<size_t>(1, queueCapacity))
+{
+}
+
+CsvFeed::~CsvFeed() {
+    if (ownsFile_ && file_) {
+        std::fclose(file_);
+    }
+}
+
+bool CsvFeed::open(const std::string& path) {
+    if (path == "-") {
+        file_ = stdin;
+        ownsFile_ = false;
+    } else {
+        file_ = std::fopen(path.c_str(), "rb");
+        ownsFile_ = true;
+    }
+    if (!file_) {
+        std::cerr << "Error: Could not open feed " << path << std::endl;
+        return false;
+    }
+
+    // The header row names the symbols; the first column is the timestamp
+    std::string header;
+    for (int c = std::fgetc(file_); c != EOF && c != '\n'; c = std::fgetc(file_)) {
+        header.push_back(static_cast<char>(c));
+    }
+    std::vector<std::string> columns =
+        CsvParsing::splitHeader(header.data(), header.data() + header.size());
+    if (columns.size() < 2) {
+        std::cerr << "Error: Feed header has no symbol columns" << std::endl;
+        return false;
+    }
+    symbols_.assign(columns.begin() + 1, columns.end());
+
+    line_.assign(std::max(kMinLineBytes, std::max(2 * header.size(), kBytesPerCell * columns.size())), '\0');
+    numSlots_ = queue_.capacity() + 2;
+    bars_.assign(numSlots_ * symbols_.size(), std::numeric_limits<double>::quiet_NaN());
+    return true;
+}
+
+void CsvFeed::push(const FeedMessage& message) {
+    FeedMessage stamped = message;
+    stamped.pushedAt = steadyNanos();
+    if (queue_.tryPush(stamped)) {
+        return;
+    }
+    ++stalls_;
+    do {
+        std::this_thread::yield();
+        stamped.pushedAt = steadyNanos();
+    } while (!queue_.tryPush(stamped));
+}
+
+void CsvFeed::run() {
+    const size_t numSymbols = symbols_.size();
+    const int64_t startedAt = steadyNanos();
+    size_t lineNumber = 1;
+    while (file_ && std::fgets(line_.data(), static_cast<int>(line_.size()), file_)) {
+        ++lineNumber;
+        const int64_t receivedAt = steadyNanos();
+        const char* p = line_.data();
+        const size_t length = std::strlen(p);
+        if (length + 1 == line_.size() && p[length - 1] != '\n') {
+            std::cerr << "Error: Feed row " << lineNumber << " is longer than "
+                      << line_.size() - 1 << " bytes" << std::endl;
+            failed_ = true;
+            break;
+        }
+        const char* last = CsvParsing::trimLineEnd(p, CsvParsing::findNewline(p, p + length));
+        if (last == p) {
+            continue;
+        }
+
+        const uint32_t slot = static_cast<uint32_t>(barsRead_ % numSlots_);
+        double* row = bars_.data() + static_cast<size_t>(slot) * numSymbols;
+        std::fill(row, row + numSymbols, std::numeric_limits<double>::quiet_NaN());
+        FeedMessage message;
+        message.slot = slot;
+        message.receivedAt = receivedAt;
+        if (!CsvParsing::parseRow(p, last, numSymbols, message.timestamp, row, 1)) {
+            std::cerr << "Error: Invalid timestamp on feed row " << lineNumber << std::endl;
+            failed_ = true;
+            break;
+        }
+
+        if (paceNanos_ > 0) {
+            const int64_t due = startedAt + static_cast<int64_t>(barsRead_) * paceNanos_;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - steadyNanos()));
+            message.receivedAt = steadyNanos();
+        }
+        push(message);
+        ++barsRead_;
+    }
+
+    FeedMessage end;
+    end.endOfFeed = true;
+    push(end);
+}
+
+LiveTrader::LiveTrader(const std::vector<std::string>& symbols, const Options& options)
+    : options_(options),
+      backtester_(symbols),
+      orders_(std::max<size_t>(1, options.orderQueueCapacity))
+{
+    backtester_.setHedgeRatioWindow(options_.hedgeWindow);
+}
+
+bool LiveTrader::addPair(const std::string& symbolA, const std::string& symbolB, double beta) {
+    const size_t before = backtester_.getNumPairs();
+    backtester_.addPair(symbolA, symbolB, beta);
+    return backtester_.getNumPairs() > before;
+}
+
+void LiveTrader::start() {
+    backtester_.startLive(options_.initialCapital, options_.entryThreshold, options_.exitThreshold,
+                          options_.lookbackWindow, options_.delayedExecution);
+    targets_.assign(backtester_.getNumPairs(), 0);
+    strategyDone_.store(false, std::memory_order_relaxed);
+    tickToSignal_.clear();
+    queueDelay_.clear();
+    tickToOrder_.clear();
+    intents_ = 0;
+    orderStalls_ = 0;
+}
+
+void LiveTrader::processFeed(CsvFeed& feed) {
+    SpscQueue<FeedMessage>& queue = feed.getQueue();
+    FeedMessage message;
+    for (;;) {
+        if (!queue.tryPop(message)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (message.endOfFeed) {
+            break;
+        }
+        queueDelay_.record(steadyNanos() - message.pushedAt);
+
+        const AssetPair::Signal* signals = backtester_.onLiveBar(feed.getBar(message.slot));
+        tickToSignal_.record(steadyNanos() - message.receivedAt);
+        sendIntents(signals, message);
+    }
+}
+
+void LiveTrader::sendIntents(const AssetPair::Signal* signals, const FeedMessage& message) {
+    const double notional = backtester_.getEquity() * kPositionFraction;
+    for (size_t p = 0; p < targets_.size(); ++p) {
+        const int signal = signals[p];
+        if (signal == targets_[p]) {
+            continue;
+        }
+        targets_[p] = signal;
+
+        const auto& symbols = backtester_.getPairSymbols(p);
+        OrderIntent intent;
+        intent.pairIndex = p;
+        intent.bar = backtester_.getLiveBars() - 1;
+        intent.timestamp = message.timestamp;
+        intent.direction = signal;
+        intent.priceA = backtester_.getLivePrice(symbols.first);
+        intent.priceB = backtester_.getLivePrice(symbols.second);
+        if (signal != 0) {
+            BacktestPosition target;
+            sizePosition(target, signal, notional, intent.priceA, intent.priceB);
+            intent.quantityA = target.quantityA;
+            intent.quantityB = target.quantityB;
+        }
+        intent.receivedAt = message.receivedAt;
+        intent.signalledAt = steadyNanos();
+
+        if (!orders_.tryPush(intent)) {
+            ++orderStalls_;
+            while (!orders_.tryPush(intent)) {
+                std::this_thread::yield();
+            }
+        }
+        ++intents_;
+    }
+}
+
+void LiveTrader::finish() {
+    backtester_.finishLive();
+}
+
+void LiveTrader::run(CsvFeed& feed, const std::function<void(const OrderIntent&)>& onIntent) {
+    start();
+    std::thread orderThread([&] {
+        OrderIntent intent;
+        auto deliver = [&] {
+            tickToOrder_.record(steadyNanos() - intent.receivedAt);
+            onIntent(intent);
+        };
+        for (;;) {
+            if (orders_.tryPop(intent)) {
+                deliver();
+            } else if (strategyDone_.load(std::memory_order_acquire)) {
+                // Every intent was pushed before the flag: drain and stop
+                while (orders_.tryPop(intent)) {
+                    deliver();
+                }
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread feedThread([&] { feed.run(); });
+
+    processFeed(feed);
+    strategyDone_.store(true, std::memory_order_release);
+    feedThread.join();
+    orderThread.join();
+    finish();
+}
@@ -1,104 +1,730 @@
 #include "MarketData.h"
+#include "CsvParsing.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 
 MarketData::MarketData(const std::string& dataFilePath) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    
+    if (dataFilePath.size() > 8 && dataFilePath.compare(dataFilePath.size() - 8, 8, ".sacache") == 0) {
+        loadFromCache(dataFilePath);
+        return;
+    }
+    
+    // Prefer an up-to-date cache next to the CSV
+    std::string cachePath = cachePathFor(dataFilePath);
+    if (fs::exists(cachePath, ec)) {
+        auto cacheTime = fs::last_write_time(cachePath, ec);
+        auto csvTime = fs::last_write_time(dataFilePath, ec);
+        if (!ec && cacheTime >= csvTime && loadFromCache(cachePath)) {
+            return;
+        }
+    }
+    
     loadFromCSV(dataFilePath);
 }
 
-bool MarketData::loadFromCSV(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
+namespace {
+
+// Files smaller than this are parsed on the calling thread
+constexpr size_t kParallelParseThreshold = 8 << 20;
+
+using namespace CsvParsing;
+
+} // namespace
+
+bool MarketData::loadFromCSV(const std::string& filePath, size_t numThreads) {
+    STATARB_PROFILE_SCOPE("MarketData::loadFromCSV");
+    MappedFile file;
+    if (!file.open(filePath)) {
         std::cerr << "Error: Could not open file " << filePath << std::endl;
         return false;
     }
+    STATARB_PROFILE_COUNT(BytesLoaded, file.size());
+    
+    const char* begin = file.data();
+    const char* end = begin + file.size();
     
     // Read header line to get symbols
-    std::string headerLine;
-    if (!std::getline(file, headerLine)) {
+    const char* headerEnd = findNewline(begin, end);
+    if (file.size() == 0 || trimLineEnd(begin, headerEnd) == begin) {
         std::cerr << "Error: Empty file or could not read header" << std::endl;
         return false;
     }
     
-    std::stringstream headerStream(headerLine);
-    std::string cell;
-    std::vector<std::string> headers;
-    
-    // Parse header row
-    while (std::getline(headerStream, cell, ',')) {
-        headers.push_back(cell);
-    }
+    std::vector<std::string> headers = splitHeader(begin, headerEnd);
     
     if (headers.size() < 2) {
         std::cerr << "Error: Invalid header format, expected at least date and one symbol" << std::endl;
         return false;
     }
     
-    // Initialize price vectors for each symbol
+    // Intern symbols to dense ids
+    data_ = TimeSeriesData();
+    isDataLoaded_ = false;
+    priceBase_ = nullptr;
+    cacheMapping_.reset();
+    resetStorage();
+    const size_t numSymbols = headers.size() - 1;
     for (size_t i = 1; i < headers.size(); ++i) {
-        data_.prices[headers[i]] = std::vector<double>();
-    }
-    
-    // Read data rows
-    std::string line;
-    while (std::getline(file, line)) {
-        std::stringstream lineStream(line);
-        std::string dateStr;
-        
-        // First column is the date
-        if (!std::getline(lineStream, dateStr, ',')) {
-            continue;
-        }
-        
-        data_.dates.push_back(dateStr);
-        
-        // Read prices for each symbol
-        for (size_t i = 1; i < headers.size(); ++i) {
-            std::string priceStr;
-            if (!std::getline(lineStream, priceStr, ',')) {
-                // Missing data, use NaN or previous value
-                data_.prices[headers[i]].push_back(std::numeric_limits<double>::quiet_NaN());
-            } else {
-                try {
-                    double price = std::stod(priceStr);
-                    data_.prices[headers[i]].push_back(price);
-                } catch (const std::exception& e) {
-                    data_.prices[headers[i]].push_back(std::numeric_limits<double>::quiet_NaN());
+        data_.symbolIndex.emplace(headers[i], static_cast<SymbolId>(data_.symbols.size()));
+        data_.symbols.push_back(headers[i]);
+    }
+    
+    // Split the body into row-aligned chunks
+    const char* body = headerEnd < end ? headerEnd + 1 : end;
+    size_t numChunks = 1;
+    if (static_cast<size_t>(end - body) >= kParallelParseThreshold) {
+        numChunks = ThreadPool::resolveThreadCount(numThreads);
+    }
+    std::vector<const char*> bounds(numChunks + 1, end);
+    bounds[0] = body;
+    for (size_t c = 1; c < numChunks; ++c) {
+        const char* guess = body + (end - body) * c / numChunks;
+        if (guess < bounds[c - 1]) guess = bounds[c - 1];
+        const char* eol = findNewline(guess, end);
+        bounds[c] = eol < end ? eol + 1 : end;
+    }
+    
+    // Pass 1: rows per chunk, so every chunk knows where its rows land
+    std::vector<size_t> rowOffset(numChunks + 1, 0);
+    std::unique_ptr<ThreadPool> pool;
+    if (numChunks > 1) {
+        pool = std::make_unique<ThreadPool>(numChunks);
+    }
+    auto forEachChunk = [&](const std::function<void(size_t)>& fn) {
+        if (!pool) {
+            fn(0);
+            return;
+        }
+        pool->parallelFor(0, numChunks, 1, [&](size_t lo, size_t hi, size_t) {
+            for (size_t c = lo; c < hi; ++c) fn(c);
+        });
+    };
+    forEachChunk([&](size_t c) { rowOffset[c + 1] = countRows(bounds[c], bounds[c + 1]); });
+    for (size_t c = 0; c < numChunks; ++c) {
+        rowOffset[c + 1] += rowOffset[c];
+    }
+    
+    // Size the column store once; each column is padded to a cache-line
+    // multiple (8 doubles)
+    const size_t numDays = rowOffset[numChunks];
+    data_.timestamps.resize(numDays);
+    data_.stride = (numDays + 7) & ~static_cast<size_t>(7);
+    data_.prices.assign(data_.stride * numSymbols, std::numeric_limits<double>::quiet_NaN());
+    
+    // Pass 2: parse every cell directly into its column slot
+    const size_t stride = data_.stride;
+    double* prices = data_.prices.data();
+    priceBase_ = prices;
+    cacheMapping_.reset();
+    // First unparseable timestamp of each chunk, as (row, cell)
+    std::vector<std::pair<size_t, std::string>> badTimestamp(numChunks, {numDays, std::string()});
+    forEachChunk([&](size_t c) {
+        size_t row = rowOffset[c];
+        const char* p = bounds[c];
+        const char* chunkEnd = bounds[c + 1];
+        while (p < chunkEnd) {
+            const char* eol = findNewline(p, chunkEnd);
+            const char* last = trimLineEnd(p, eol);
+            if (last > p) {
+                // Missing trailing cells stay NaN
+                if (!parseRow(p, last, numSymbols, data_.timestamps[row], prices + row, stride) &&
+                    badTimestamp[c].first == numDays) {
+                    badTimestamp[c] = {row, firstCell(p, last)};
                 }
+                ++row;
             }
+            p = eol + 1;
+        }
+    });
+    for (const auto& bad : badTimestamp) {
+        if (bad.first < numDays) {
+            std::cerr << "Error: Could not parse timestamp '" << bad.second << "' in data row "
+                      << (bad.first + 1) << " of " << filePath << std::endl;
+            data_ = TimeSeriesData();
+            priceBase_ = nullptr;
+            return false;
         }
     }
     
+    computeMoments();
+    computeCalendar();
+    
     isDataLoaded_ = true;
     return true;
 }
 
-std::optional<std::vector<double>> MarketData::getPriceSeries(const std::string& symbol) const {
+void MarketData::computeMoments() {
+    const size_t numDays = data_.timestamps.size();
+    const size_t numSymbols = data_.symbols.size();
+    data_.validityWords = Validity::numWords(numDays);
+    data_.validity.assign(data_.validityWords * numSymbols, 0);
+    data_.moments.assign(numSymbols, SeriesMoments());
+    std::vector<Validity::Range> observed;
+    visitStorage([&](auto tag) {
+        for (size_t id = 0; id < numSymbols; ++id) {
+            const auto* column = getColumn<decltype(tag)>(id);
+            Validity::Word* bits = data_.validity.data() + id * data_.validityWords;
+            Validity::build(column, numDays, [&](auto stored) { return decode(stored); }, bits);
+            
+            // Sum the observed runs only, so a gap neither costs nor poisons anything
+            observed.clear();
+            Validity::runs(bits, 0, numDays, observed);
+            SeriesMoments& m = data_.moments[id];
+            for (const auto& run : observed) {
+                for (size_t day = run.first; day < run.second; ++day) {
+                    double price = decode(column[day]);
+                    m.sum += price;
+                    m.sumSq += price * price;
+                }
+            }
+        }
+    });
+    countValidity();
+    data_.prefixSum.clear();
+    data_.prefixSumSq.clear();
+}
+
+void MarketData::countValidity() {
+    const size_t numSymbols = data_.symbols.size();
+    data_.validCounts.resize(numSymbols);
+    for (size_t id = 0; id < numSymbols; ++id) {
+        data_.validCounts[id] = Validity::count(getValidity(static_cast<SymbolId>(id)), data_.validityWords);
+    }
+    filled_.assign(numSymbols, AlignedVector<double>());
+    fillOnce_.reset(new std::once_flag[numSymbols]);
+}
+
+void MarketData::computeCalendar() {
+    barInterval_ = Timestamps::barInterval(data_.timestamps);
+    periodsPerYear_ = Timestamps::periodsPerYear(data_.timestamps);
+}
+
+void MarketData::alignPair(SymbolId x, SymbolId y, std::vector<Validity::Range>& ranges) const {
+    const size_t numDays = data_.timestamps.size();
+    ranges.clear();
+    if (isComplete(x) && isComplete(y)) {
+        if (numDays > 0) {
+            ranges.emplace_back(0, numDays);
+        }
+        return;
+    }
+    
+    const Validity::Word* bitsX = getValidity(x);
+    const Validity::Word* bitsY = getValidity(y);
+    if (fillPolicy_ == FillPolicy::Drop) {
+        Validity::runs(bitsX, bitsY, 0, numDays, ranges);
+        return;
+    }
+    const size_t first = std::max(Validity::find(bitsX, 0, numDays, true),
+                                  Validity::find(bitsY, 0, numDays, true));
+    if (first < numDays) {
+        ranges.emplace_back(first, numDays);
+    }
+}
+
+void MarketData::gatherPrices(SymbolId id, const std::vector<Validity::Range>& ranges, double* out) const {
+    const Validity::Word* bits = getValidity(id);
+    const bool complete = isComplete(id);
+    visitStorage([&](auto tag) {
+        const auto* column = getColumn<decltype(tag)>(id);
+        for (const auto& range : ranges) {
+            size_t day = range.first;
+            while (day < range.second) {
+                // Observed run [day, stop): a straight copy
+                const size_t stop = complete ? range.second : Validity::find(bits, day, range.second, false);
+                for (; day < stop; ++day) {
+                    *out++ = decode(column[day]);
+                }
+                if (day == range.second) {
+                    break;
+                }
+                
+                // Gap [day, next): the last earlier price
+                const size_t next = Validity::find(bits, day, range.second, true);
+                const size_t last = Validity::findLast(bits, 0, day);
+                const double fill = last < day ? decode(column[last]) : std::numeric_limits<double>::quiet_NaN();
+                out = std::fill_n(out, next - day, fill);
+                day = next;
+            }
+        }
+    });
+}
+
+void MarketData::alignPrices(SymbolId x, SymbolId y, std::vector<Validity::Range>& ranges,
+                             std::vector<double>& alignedX, std::vector<double>& alignedY) const {
+    alignPair(x, y, ranges);
+    alignedX.resize(Validity::length(ranges));
+    alignedY.resize(alignedX.size());
+    gatherPrices(x, ranges, alignedX.data());
+    gatherPrices(y, ranges, alignedY.data());
+}
+
+PriceView MarketData::getFilledPrices(SymbolId id) const {
+    if (isComplete(id)) {
+        return getPrices(id);
+    }
+    // Concurrent first calls for one symbol fill it once
+    std::call_once(fillOnce_[id], [&]() {
+        AlignedVector<double>& column = filled_[id];
+        column.resize(data_.timestamps.size());
+        gatherPrices(id, {{0, column.size()}}, column.data());
+    });
+    return PriceView(filled_[id].data(), filled_[id].size());
+}
+
+Utilities::RegressionSums MarketData::getRegressionSums(SymbolId x, SymbolId y) const {
+    if (!isComplete(x) || !isComplete(y)) {
+        std::vector<Validity::Range> ranges;
+        std::vector<double> alignedX, alignedY;
+        alignPrices(x, y, ranges, alignedX, alignedY);
+        return Utilities::regressionSums(alignedX, alignedY);
+    }
+    
+    Utilities::RegressionSums sums;
+    sums.n = static_cast<double>(data_.timestamps.size());
+    sums.sumX = data_.moments[x].sum;
+    sums.sumXX = data_.moments[x].sumSq;
+    sums.sumY = data_.moments[y].sum;
+    sums.sumYY = data_.moments[y].sumSq;
+    if (storage_ == PriceStorage::Float64) {
+        sums.sumXY = Utilities::dotProduct(getPrices(x), getPrices(y));
+        return sums;
+    }
+    sums.sumXY = visitStorage([&](auto tag) {
+        const auto* columnX = getColumn<decltype(tag)>(x);
+        const auto* columnY = getColumn<decltype(tag)>(y);
+        double sum = 0.0;
+        for (size_t day = 0; day < data_.timestamps.size(); ++day) {
+            sum += decode(columnX[day]) * decode(columnY[day]);
+        }
+        return sum;
+    });
+    return sums;
+}
+
+void MarketData::buildPrefixSums() {
+    const size_t numDays = data_.timestamps.size();
+    const size_t width = data_.stride + 1;
+    data_.prefixSum.assign(width * data_.symbols.size(), 0.0);
+    data_.prefixSumSq.assign(width * data_.symbols.size(), 0.0);
+    visitStorage([&](auto tag) {
+        for (size_t id = 0; id < data_.symbols.size(); ++id) {
+            const auto* column = getColumn<decltype(tag)>(id);
+            double* sum = data_.prefixSum.data() + id * width;
+            double* sumSq = data_.prefixSumSq.data() + id * width;
+            for (size_t day = 0; day < numDays; ++day) {
+                double price = decode(column[day]);
+                sum[day + 1] = sum[day] + price;
+                sumSq[day + 1] = sumSq[day] + price * price;
+            }
+        }
+    });
+}
+
+MarketData::SeriesMoments MarketData::getWindowMoments(SymbolId id, size_t begin, size_t end) const {
+    SeriesMoments m;
+    if (end > data_.timestamps.size()) end = data_.timestamps.size();
+    if (begin >= end) {
+        return m;
+    }
+    
+    if (hasPrefixSums()) {
+        const size_t base = id * (data_.stride + 1);
+        m.sum = data_.prefixSum[base + end] - data_.prefixSum[base + begin];
+        m.sumSq = data_.prefixSumSq[base + end] - data_.prefixSumSq[base + begin];
+        return m;
+    }
+    
+    visitStorage([&](auto tag) {
+        const auto* column = getColumn<decltype(tag)>(id);
+        for (size_t day = begin; day < end; ++day) {
+            double price = decode(column[day]);
+            m.sum += price;
+            m.sumSq += price * price;
+        }
+    });
+    return m;
+}
+
+bool MarketData::setPriceStorage(PriceStorage storage, double tickSize) {
+    if (storage == storage_ && (storage != PriceStorage::Ticks32 || tickSize == tickSize_)) {
+        return true;
+    }
+    if (!isDataLoaded_ || storage_ != PriceStorage::Float64) {
+        std::cerr << "Error: Price storage can only be narrowed from loaded float64 data" << std::endl;
+        return false;
+    }
+    
+    // Padding slots are converted too, so kernels may read whole columns
+    const size_t count = data_.symbols.size() * data_.stride;
+    if (storage == PriceStorage::Float32) {
+        data_.pricesF32.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            data_.pricesF32[i] = static_cast<float>(priceBase_[i]);
+        }
+    } else {
+        if (!(tickSize > 0.0)) {
+            std::cerr << "Error: Tick size must be positive" << std::endl;
+            return false;
+        }
+        data_.priceTicks.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            double price = priceBase_[i];
+            if (std::isnan(price)) {
+                data_.priceTicks[i] = kMissingTick;
+                continue;
+            }
+            double ticks = std::round(price / tickSize);
+            if (!(std::abs(ticks) <= std::numeric_limits<int32_t>::max())) {
+                std::cerr << "Error: Price " << price << " does not fit in int32 ticks of "
+                          << tickSize << std::endl;
+                data_.priceTicks = AlignedVector<int32_t>();
+                return false;
+            }
+            data_.priceTicks[i] = static_cast<int32_t>(ticks);
+        }
+        tickSize_ = tickSize;
+    }
+    
+    // Release the float64 columns (or the cache mapping that holds them)
+    storage_ = storage;
+    data_.prices = AlignedVector<double>();
+    cacheMapping_.reset();
+    priceBase_ = nullptr;
+    decoded_.assign(data_.symbols.size(), AlignedVector<double>());
+    decodeOnce_.reset(new std::once_flag[data_.symbols.size()]);
+    
+    computeMoments();
+    return true;
+}
+
+PriceView MarketData::decodedPrices(SymbolId id) const {
+    // Concurrent first calls for one symbol decode it once
+    std::call_once(decodeOnce_[id], [&]() {
+        AlignedVector<double>& column = decoded_[id];
+        column.resize(data_.timestamps.size());
+        visitStorage([&](auto tag) {
+            const auto* stored = getColumn<decltype(tag)>(id);
+            for (size_t day = 0; day < column.size(); ++day) {
+                column[day] = decode(stored[day]);
+            }
+        });
+    });
+    return PriceView(decoded_[id].data(), decoded_[id].size());
+}
+
+void MarketData::resetStorage() {
+    storage_ = PriceStorage::Float64;
+    tickSize_ = 1.0;
+    data_.pricesF32 = AlignedVector<float>();
+    data_.priceTicks = AlignedVector<int32_t>();
+    decoded_.clear();
+    decodeOnce_.reset();
+}
+
+MarketData MarketData::slice(size_t begin, size_t end, const std::vector<SymbolId>& symbols) const {
+    end = std::min(end, data_.timestamps.size());
+    begin = std::min(begin, end);
+    std::vector<SymbolId> ids = symbols;
+    if (ids.empty()) {
+        ids.resize(data_.symbols.size());
+        for (size_t id = 0; id < ids.size(); ++id) {
+            ids[id] = static_cast<SymbolId>(id);
+        }
+    }
+    
+    MarketData window;
+    const size_t numDays = end - begin;
+    window.data_.timestamps.assign(data_.timestamps.begin() + begin, data_.timestamps.begin() + end);
+    window.data_.stride = (numDays + 7) & ~static_cast<size_t>(7);
+    window.data_.prices.assign(window.data_.stride * ids.size(), std::numeric_limits<double>::quiet_NaN());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const std::string& symbol = data_.symbols[ids[i]];
+        window.data_.symbolIndex.emplace(symbol, static_cast<SymbolId>(i));
+        window.data_.symbols.push_back(symbol);
+        PriceView column = getPrices(ids[i]).subview(begin, numDays);
+        std::copy(column.begin(), column.end(), window.data_.prices.data() + i * window.data_.stride);
+    }
+    window.priceBase_ = window.data_.prices.data();
+    window.computeMoments();
+    window.barInterval_ = barInterval_;
+    window.periodsPerYear_ = periodsPerYear_;
+    window.fillPolicy_ = fillPolicy_;
+    window.isDataLoaded_ = true;
+    return window;
+}
+
+MarketData MarketData::resample(int64_t interval) const {
+    STATARB_PROFILE_SCOPE("MarketData::resample");
+    MarketData coarse;
+    if (interval <= 0) {
+        return coarse;
+    }
+    
+    // Bar b covers source bars [ends[b - 1], ends[b])
+    const std::vector<int64_t>& timestamps = data_.timestamps;
+    std::vector<size_t> ends;
+    for (size_t day = 0; day < timestamps.size(); ++day) {
+        const int64_t bucket = Timestamps::floorTo(timestamps[day], interval);
+        if (day == 0 || bucket != coarse.data_.timestamps.back()) {
+            if (day > 0) {
+                ends.push_back(day);
+            }
+            coarse.data_.timestamps.push_back(bucket);
+        }
+    }
+    if (!timestamps.empty()) {
+        ends.push_back(timestamps.size());
+    }
+    
+    const size_t numBars = ends.size();
+    const size_t numSymbols = data_.symbols.size();
+    coarse.data_.symbols = data_.symbols;
+    coarse.data_.symbolIndex = data_.symbolIndex;
+    coarse.data_.stride = (numBars + 7) & ~static_cast<size_t>(7);
+    coarse.data_.prices.assign(coarse.data_.stride * numSymbols, std::numeric_limits<double>::quiet_NaN());
+    visitStorage([&](auto tag) {
+        for (size_t id = 0; id < numSymbols; ++id) {
+            const SymbolId symbol = static_cast<SymbolId>(id);
+            const auto* column = getColumn<decltype(tag)>(symbol);
+            const Validity::Word* bits = getValidity(symbol);
+            double* out = coarse.data_.prices.data() + id * coarse.data_.stride;
+            size_t begin = 0;
+            for (size_t bar = 0; bar < numBars; ++bar) {
+                // The bitmap points straight at the bar's last observed price
+                const size_t last = Validity::findLast(bits, begin, ends[bar]);
+                out[bar] = last < ends[bar] ? decode(column[last]) : std::numeric_limits<double>::quiet_NaN();
+                begin = ends[bar];
+            }
+        }
+    });
+    coarse.priceBase_ = coarse.data_.prices.data();
+    coarse.computeMoments();
+    coarse.computeCalendar();
+    coarse.fillPolicy_ = fillPolicy_;
+    coarse.isDataLoaded_ = true;
+    return coarse;
+}
+
+std::optional<MarketData::SymbolId> MarketData::getSymbolId(const std::string& symbol) const {
+    auto it = data_.symbolIndex.find(symbol);
+    if (it == data_.symbolIndex.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<PriceView> MarketData::getPriceSeries(const std::string& symbol) const {
     if (!isDataLoaded_) {
         return std::nullopt;
     }
     
-    auto it = data_.prices.find(symbol);
-    if (it == data_.prices.end()) {
+    auto id = getSymbolId(symbol);
+    if (!id) {
         return std::nullopt;
     }
     
-    return it->second;
+    return getPrices(*id);
 }
 
-const std::vector<std::string>& MarketData::getDateSeries() const {
-    return data_.dates;
+const std::vector<std::string>& MarketData::getAvailableSymbols() const {
+    return data_.symbols;
+}
+
+size_t MarketData::getDataSize() const {
+    return data_.timestamps.size();
+} 
+
+namespace {
+
+// On-disk layout, all little-endian; sections start on 64-byte boundaries
+constexpr char kCacheMagic[8] = {'S', 'A', 'C', 'A', 'C', 'H', 'E', '1'};
+constexpr uint32_t kCacheVersion = 3;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kCacheAlignment = 64;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numSymbols;
+    uint64_t numDays;
+    uint64_t stride;
+    uint64_t symbolTableOffset;
+    uint64_t timestampsOffset;       // numDays int64 epoch nanoseconds
+    uint64_t momentsOffset;
+    uint64_t validityOffset;         // numSymbols * numWords(numDays) bitmap words
+    uint64_t pricesOffset;
+    uint64_t fileSize;
+};
+
+size_t alignUp(size_t value) {
+    return (value + kCacheAlignment - 1) & ~(kCacheAlignment - 1);
 }
 
-std::vector<std::string> MarketData::getAvailableSymbols() const {
-    std::vector<std::string> symbols;
-    for (const auto& pair : data_.prices) {
-        symbols.push_back(pair.first);
+size_t stringTableSize(const std::vector<std::string>& strings) {
+    size_t size = 0;
+    for (const auto& s : strings) {
+        size += sizeof(uint32_t) + s.size();
     }
-    return symbols;
+    return size;
 }
 
-size_t MarketData::getDataSize() const {
-    return data_.dates.size();
-} 
\ No newline at end of file
+void writeStringTable(std::ofstream& out, const std::vector<std::string>& strings) {
+    for (const auto& s : strings) {
+        uint32_t length = static_cast<uint32_t>(s.size());
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(s.data(), s.size());
+    }
+}
+
+bool readStringTable(const char* p, const char* end, size_t count, std::vector<std::string>& out) {
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t length;
+        if (end - p < static_cast<ptrdiff_t>(sizeof(length))) return false;
+        std::memcpy(&length, p, sizeof(length));
+        p += sizeof(length);
+        if (end - p < static_cast<ptrdiff_t>(length)) return false;
+        out[i].assign(p, length);
+        p += length;
+    }
+    return true;
+}
+
+void padTo(std::ofstream& out, size_t offset) {
+    static const char zeros[kCacheAlignment] = {};
+    size_t current = static_cast<size_t>(out.tellp());
+    if (offset > current) {
+        out.write(zeros, offset - current);
+    }
+}
+
+} // namespace
+
+bool MarketData::saveCache(const std::string& cachePath) const {
+    if (!isDataLoaded_) {
+        return false;
+    }
+    if (storage_ != PriceStorage::Float64) {
+        std::cerr << "Error: The cache stores float64 columns; save it before narrowing" << std::endl;
+        return false;
+    }
+    
+    const size_t numSymbols = data_.symbols.size();
+    const size_t numDays = data_.timestamps.size();
+    
+    CacheHeader header = {};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.byteOrder = kByteOrderMark;
+    header.numSymbols = numSymbols;
+    header.numDays = numDays;
+    header.stride = data_.stride;
+    header.symbolTableOffset = alignUp(sizeof(CacheHeader));
+    header.timestampsOffset = alignUp(header.symbolTableOffset + stringTableSize(data_.symbols));
+    header.momentsOffset = alignUp(header.timestampsOffset + numDays * sizeof(int64_t));
+    header.validityOffset = alignUp(header.momentsOffset + numSymbols * sizeof(SeriesMoments));
+    header.pricesOffset = alignUp(header.validityOffset + data_.validity.size() * sizeof(Validity::Word));
+    header.fileSize = header.pricesOffset + numSymbols * data_.stride * sizeof(double);
+    
+    // Write to a temporary and rename, so readers never map a partial file
+    std::string tmpPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not write cache " << cachePath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(out, header.symbolTableOffset);
+        writeStringTable(out, data_.symbols);
+        padTo(out, header.timestampsOffset);
+        out.write(reinterpret_cast<const char*>(data_.timestamps.data()), numDays * sizeof(int64_t));
+        padTo(out, header.momentsOffset);
+        out.write(reinterpret_cast<const char*>(data_.moments.data()), numSymbols * sizeof(SeriesMoments));
+        padTo(out, header.validityOffset);
+        out.write(reinterpret_cast<const char*>(data_.validity.data()),
+                  data_.validity.size() * sizeof(Validity::Word));
+        padTo(out, header.pricesOffset);
+        out.write(reinterpret_cast<const char*>(priceBase_), numSymbols * data_.stride * sizeof(double));
+        if (!out.good()) {
+            std::cerr << "Error: Could not write cache " << cachePath << std::endl;
+            return false;
+        }
+    }
+    
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        std::cerr << "Error: Could not write cache " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MarketData::loadFromCache(const std::string& cachePath) {
+    STATARB_PROFILE_SCOPE("MarketData::loadFromCache");
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(cachePath) || mapping->size() < sizeof(CacheHeader)) {
+        std::cerr << "Error: Could not open cache " << cachePath << std::endl;
+        return false;
+    }
+    STATARB_PROFILE_COUNT(BytesLoaded, mapping->size());
+    
+    CacheHeader header;
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+        header.version != kCacheVersion || header.byteOrder != kByteOrderMark ||
+        header.fileSize != mapping->size() || header.stride < header.numDays ||
+        header.pricesOffset % kCacheAlignment != 0 ||
+        header.pricesOffset + header.numSymbols * header.stride * sizeof(double) > mapping->size()) {
+        std::cerr << "Error: Invalid or incompatible cache " << cachePath << std::endl;
+        return false;
+    }
+    
+    TimeSeriesData data;
+    const char* base = mapping->data();
+    const char* end = base + mapping->size();
+    const size_t validityWords = Validity::numWords(header.numDays);
+    const size_t validityBytes = header.numSymbols * validityWords * sizeof(Validity::Word);
+    if (!readStringTable(base + header.symbolTableOffset, end, header.numSymbols, data.symbols) ||
+        header.timestampsOffset + header.numDays * sizeof(int64_t) > header.momentsOffset ||
+        header.momentsOffset + header.numSymbols * sizeof(SeriesMoments) > header.validityOffset ||
+        header.validityOffset + validityBytes > header.pricesOffset) {
+        std::cerr << "Error: Corrupt cache " << cachePath << std::endl;
+        return false;
+    }
+    data.timestamps.resize(header.numDays);
+    std::memcpy(data.timestamps.data(), base + header.timestampsOffset, header.numDays * sizeof(int64_t));
+    for (size_t i = 0; i < data.symbols.size(); ++i) {
+        data.symbolIndex.emplace(data.symbols[i], static_cast<SymbolId>(i));
+    }
+    data.stride = header.stride;
+    data.moments.resize(header.numSymbols);
+    std::memcpy(data.moments.data(), base + header.momentsOffset, header.numSymbols * sizeof(SeriesMoments));
+    data.validityWords = validityWords;
+    data.validity.resize(header.numSymbols * validityWords);
+    std::memcpy(data.validity.data(), base + header.validityOffset, validityBytes);
+    
+    data_ = std::move(data);
+    resetStorage();
+    countValidity();
+    cacheMapping_ = std::move(mapping);
+    priceBase_ = reinterpret_cast<const double*>(base + header.pricesOffset);
+    computeCalendar();
+    isDataLoaded_ = true;
+    return true;
+}
\ No newline at end of file
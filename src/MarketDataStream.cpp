@@ -0,0 +1,132 @@
+#include "MarketDataStream.h"
+#include "CsvParsing.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using namespace CsvParsing;
+
+namespace {
+
+// Bytes scanned between page releases while counting rows
+constexpr size_t kCountBlock = 8 << 20;
+
+} // namespace
+
+MarketDataStream::MarketDataStream(size_t chunkBars)
+    : chunkBars_(std::max<size_t>(1, chunkBars)), stride_(chunkBars_ + 1)
+{
+}
+
+bool MarketDataStream::open(const std::string& filePath) {
+    if (!file_.open(filePath)) {
+        std::cerr << "Error: Could not open file " << filePath << std::endl;
+        return false;
+    }
+    STATARB_PROFILE_COUNT(BytesLoaded, file_.size());
+
+    const char* begin = file_.data();
+    const char* end = begin + file_.size();
+    const char* headerEnd = findNewline(begin, end);
+    if (file_.size() == 0 || trimLineEnd(begin, headerEnd) == begin) {
+        std::cerr << "Error: Empty file or could not read header" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> headers = splitHeader(begin, headerEnd);
+    if (headers.size() < 2) {
+        std::cerr << "Error: Invalid header format, expected at least date and one symbol" << std::endl;
+        return false;
+    }
+
+    symbols_.assign(headers.begin() + 1, headers.end());
+    symbolIndex_.clear();
+    for (size_t i = 0; i < symbols_.size(); ++i) {
+        symbolIndex_.emplace(symbols_[i], static_cast<SymbolId>(i));
+    }
+
+    // Count rows a block at a time, releasing each block once counted
+    body_ = headerEnd < end ? headerEnd + 1 : end;
+    numDays_ = 0;
+    for (const char* p = body_; p < end; ) {
+        const char* eol = findNewline(p + std::min<size_t>(kCountBlock, end - p), end);
+        const char* next = eol < end ? eol + 1 : end;
+        numDays_ += countRows(p, next);
+        file_.discard(static_cast<size_t>(p - begin), static_cast<size_t>(next - p));
+        p = next;
+    }
+
+    prices_.assign(symbols_.size() * stride_, std::numeric_limits<double>::quiet_NaN());
+    timestamps_.assign(chunkBars_, 0);
+    rewind();
+    return true;
+}
+
+void MarketDataStream::rewind() {
+    cursor_ = body_;
+    chunkBegin_ = 0;
+    chunkEnd_ = 0;
+}
+
+bool MarketDataStream::nextChunk() {
+    STATARB_PROFILE_SCOPE("MarketDataStream::nextChunk");
+    const char* end = file_.data() + file_.size();
+    if (!cursor_ || cursor_ >= end) {
+        return false;
+    }
+
+    // Carry the last bar of the finished chunk into slot 0; the rest starts
+    // out NaN so missing trailing cells match the whole-file loader
+    const size_t numSymbols = symbols_.size();
+    const size_t carried = chunkEnd_ - chunkBegin_;
+    for (size_t id = 0; id < numSymbols; ++id) {
+        double* column = prices_.data() + id * stride_;
+        column[0] = carried > 0 ? column[carried] : std::numeric_limits<double>::quiet_NaN();
+        std::fill(column + 1, column + stride_, std::numeric_limits<double>::quiet_NaN());
+    }
+
+    const char* chunkStart = cursor_;
+    size_t rows = 0;
+    while (cursor_ < end && rows < chunkBars_) {
+        const char* eol = findNewline(cursor_, end);
+        const char* last = trimLineEnd(cursor_, eol);
+        if (last > cursor_) {
+            if (!parseRow(cursor_, last, numSymbols, timestamps_[rows], prices_.data() + rows + 1, stride_)) {
+                std::cerr << "Error: Could not parse timestamp '" << firstCell(cursor_, last)
+                          << "' in data row " << (chunkEnd_ + rows + 1) << std::endl;
+                cursor_ = end;
+                return false;
+            }
+            ++rows;
+        }
+        cursor_ = eol + 1;
+    }
+    file_.discard(static_cast<size_t>(chunkStart - file_.data()),
+                  static_cast<size_t>(std::min(cursor_, end) - chunkStart));
+
+    chunkBegin_ = chunkEnd_;
+    chunkEnd_ = chunkBegin_ + rows;
+    return rows > 0;
+}
+
+void MarketDataStream::fillForward() {
+    const size_t slots = chunkEnd_ - chunkBegin_ + 1;
+    for (size_t id = 0; id < symbols_.size(); ++id) {
+        double* column = prices_.data() + id * stride_;
+        for (size_t slot = 1; slot < slots; ++slot) {
+            if (std::isnan(column[slot])) {
+                column[slot] = column[slot - 1];
+            }
+        }
+    }
+}
+
+std::optional<MarketDataStream::SymbolId> MarketDataStream::getSymbolId(const std::string& symbol) const {
+    auto it = symbolIndex_.find(symbol);
+    if (it == symbolIndex_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
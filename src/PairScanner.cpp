@@ -0,0 +1,518 @@
+#include "PairScanner.h"
+#include "AlignedAllocator.h"
+#include "AssetPair.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+#ifdef USE_EIGEN
+#include <Eigen/Dense>
+#endif
+
+namespace {
+
+#ifndef USE_EIGEN
+// Bars per cache block of the correlation kernel
+constexpr size_t kCorrelationTimeBlock = 512;
+
+// out[r][c] = z_r . z_c for columns r in [i0, i1) and c in [j0, j1) of the
+// column-major z, written with row stride ldOut
+void dotTile(const double* z, size_t length, size_t i0, size_t i1, size_t j0, size_t j1,
+             double* out, size_t ldOut) {
+    for (size_t r = i0; r < i1; ++r) {
+        std::fill(out + (r - i0) * ldOut, out + (r - i0) * ldOut + (j1 - j0), 0.0);
+    }
+    for (size_t t0 = 0; t0 < length; t0 += kCorrelationTimeBlock) {
+        const size_t t1 = std::min(length, t0 + kCorrelationTimeBlock);
+        for (size_t r = i0; r < i1; ++r) {
+            const double* x = z + r * length;
+            double* acc = out + (r - i0) * ldOut - j0;
+            size_t c = j0;
+            for (; c + 4 <= j1; c += 4) {
+                const double* y0 = z + c * length;
+                const double* y1 = y0 + length;
+                const double* y2 = y1 + length;
+                const double* y3 = y2 + length;
+                double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                for (size_t t = t0; t < t1; ++t) {
+                    s0 += x[t] * y0[t];
+                    s1 += x[t] * y1[t];
+                    s2 += x[t] * y2[t];
+                    s3 += x[t] * y3[t];
+                }
+                acc[c] += s0;
+                acc[c + 1] += s1;
+                acc[c + 2] += s2;
+                acc[c + 3] += s3;
+            }
+            for (; c < j1; ++c) {
+                const double* y = z + c * length;
+                double sum = 0.0;
+                for (size_t t = t0; t < t1; ++t) {
+                    sum += x[t] * y[t];
+                }
+                acc[c] += sum;
+            }
+        }
+    }
+}
+#endif
+
+// Upper-triangular (row block, column block) tiles, diagonal included
+std::vector<std::pair<size_t, size_t>> upperTiles(size_t n, size_t block) {
+    const size_t numBlocks = (n + block - 1) / block;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t bi = 0; bi < numBlocks; ++bi) {
+        for (size_t bj = bi; bj < numBlocks; ++bj) {
+            tiles.emplace_back(bi, bj);
+        }
+    }
+    return tiles;
+}
+
+// For each universe position i, the positions j > i such that one of the two
+// is among the other's k most correlated symbols (sorted, no duplicates)
+std::vector<std::vector<size_t>> correlatedPartners(const std::vector<double>& correlations,
+                                                    size_t n, size_t k) {
+    std::vector<std::vector<size_t>> partners(n);
+    std::vector<size_t> others;
+    for (size_t i = 0; i < n; ++i) {
+        const double* row = correlations.data() + i * n;
+        others.clear();
+        for (size_t j = 0; j < n; ++j) {
+            if (j != i) {
+                others.push_back(j);
+            }
+        }
+        const size_t keep = std::min(k, others.size());
+        std::nth_element(others.begin(), others.begin() + keep, others.end(),
+                         [row](size_t a, size_t b) {
+                             return row[a] != row[b] ? row[a] > row[b] : a < b;
+                         });
+        for (size_t m = 0; m < keep; ++m) {
+            const size_t j = others[m];
+            partners[std::min(i, j)].push_back(std::max(i, j));
+        }
+    }
+    for (auto& list : partners) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    return partners;
+}
+
+} // namespace
+
+PairScanner::PairScanner(std::shared_ptr<const MarketData> marketData, Options options)
+    : marketData_(std::move(marketData)), options_(options)
+{
+}
+
+PairScanner::PairScanner(std::shared_ptr<const MarketData> marketData)
+    : PairScanner(std::move(marketData), Options())
+{
+}
+
+void PairScanner::crossProductTile(const MarketData& marketData,
+                                   const MarketData::SymbolId* rows, size_t numRows,
+                                   const MarketData::SymbolId* cols, size_t numCols,
+                                   size_t timeBlock, double* out) {
+    const size_t numDays = marketData.getDataSize();
+    std::fill(out, out + numRows * numCols, 0.0);
+    if (timeBlock == 0) {
+        timeBlock = numDays;
+    }
+
+    // Columns are read in their stored type and widened to double per element
+    marketData.visitStorage([&](auto tag) {
+        using T = decltype(tag);
+        auto price = [&](T value) { return marketData.decode(value); };
+
+        // Walk time in blocks so the tile's column segments stay cache resident,
+        // and update four output columns per sweep of a row segment
+        for (size_t t0 = 0; t0 < numDays; t0 += timeBlock) {
+            const size_t t1 = std::min(numDays, t0 + timeBlock);
+            for (size_t r = 0; r < numRows; ++r) {
+                const T* x = marketData.getColumn<T>(rows[r]);
+                double* acc = out + r * numCols;
+                size_t c = 0;
+                for (; c + 4 <= numCols; c += 4) {
+                    const T* y0 = marketData.getColumn<T>(cols[c]);
+                    const T* y1 = marketData.getColumn<T>(cols[c + 1]);
+                    const T* y2 = marketData.getColumn<T>(cols[c + 2]);
+                    const T* y3 = marketData.getColumn<T>(cols[c + 3]);
+                    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                    for (size_t t = t0; t < t1; ++t) {
+                        double xt = price(x[t]);
+                        s0 += xt * price(y0[t]);
+                        s1 += xt * price(y1[t]);
+                        s2 += xt * price(y2[t]);
+                        s3 += xt * price(y3[t]);
+                    }
+                    acc[c] += s0;
+                    acc[c + 1] += s1;
+                    acc[c + 2] += s2;
+                    acc[c + 3] += s3;
+                }
+                for (; c < numCols; ++c) {
+                    const T* y = marketData.getColumn<T>(cols[c]);
+                    double sum = 0.0;
+                    for (size_t t = t0; t < t1; ++t) {
+                        sum += price(x[t]) * price(y[t]);
+                    }
+                    acc[c] += sum;
+                }
+            }
+        }
+    });
+}
+
+std::vector<double> PairScanner::returnCorrelations(const MarketData& marketData,
+                                                    const std::vector<MarketData::SymbolId>& universe,
+                                                    size_t numThreads, size_t blockSize) {
+    STATARB_PROFILE_SCOPE("PairScanner::returnCorrelations");
+    const size_t n = universe.size();
+    const size_t numDays = marketData.getDataSize();
+    const size_t length = numDays > 1 ? numDays - 1 : 0;
+    std::vector<double> correlations(n * n, 0.0);
+    if (n == 0 || length == 0) {
+        return correlations;
+    }
+
+    ThreadPool pool(numThreads);
+
+    // Demeaned returns scaled to unit norm, one column per symbol, so that
+    // z_i . z_j is the correlation of symbols i and j
+    AlignedVector<double> z(n * length);
+    pool.parallelFor(0, n, 16, [&](size_t begin, size_t end, size_t) {
+        marketData.visitStorage([&](auto tag) {
+            using T = decltype(tag);
+            for (size_t k = begin; k < end; ++k) {
+                const T* prices = marketData.getColumn<T>(universe[k]);
+                double* column = z.data() + k * length;
+                double sum = 0.0;
+                for (size_t t = 0; t < length; ++t) {
+                    double r = marketData.decode(prices[t + 1]) / marketData.decode(prices[t]) - 1.0;
+                    column[t] = std::isfinite(r) ? r : 0.0;
+                    sum += column[t];
+                }
+                const double mean = sum / length;
+                double sumSq = 0.0;
+                for (size_t t = 0; t < length; ++t) {
+                    column[t] -= mean;
+                    sumSq += column[t] * column[t];
+                }
+                const double scale = sumSq > 0.0 ? 1.0 / std::sqrt(sumSq) : 0.0;
+                for (size_t t = 0; t < length; ++t) {
+                    column[t] *= scale;
+                }
+            }
+        });
+    });
+
+    // Zᵀ Z over upper-triangular tiles, each mirrored into the lower triangle
+    const size_t block = std::max<size_t>(1, blockSize);
+    const auto tiles = upperTiles(n, block);
+    pool.parallelFor(0, tiles.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t t = begin; t < end; ++t) {
+            const size_t i0 = tiles[t].first * block;
+            const size_t i1 = std::min(n, i0 + block);
+            const size_t j0 = tiles[t].second * block;
+            const size_t j1 = std::min(n, j0 + block);
+            double* out = correlations.data() + i0 * n + j0;
+#ifdef USE_EIGEN
+            using RowMajor = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+            Eigen::Map<const Eigen::MatrixXd> returns(z.data(), length, n);
+            Eigen::Map<RowMajor, 0, Eigen::OuterStride<>> tile(out, i1 - i0, j1 - j0, Eigen::OuterStride<>(n));
+            tile.noalias() = returns.middleCols(i0, i1 - i0).transpose() * returns.middleCols(j0, j1 - j0);
+#else
+            dotTile(z.data(), length, i0, i1, j0, j1, out, n);
+#endif
+            for (size_t i = i0; i < i1; ++i) {
+                for (size_t j = std::max(j0, i + 1); j < j1; ++j) {
+                    correlations[j * n + i] = correlations[i * n + j];
+                }
+            }
+        }
+    });
+
+    return correlations;
+}
+
+std::vector<PairCandidate> PairScanner::scan() {
+    std::vector<MarketData::SymbolId> universe(marketData_->getNumSymbols());
+    std::iota(universe.begin(), universe.end(), 0);
+    return scan(universe);
+}
+
+std::vector<PairCandidate> PairScanner::scan(const std::vector<MarketData::SymbolId>& universe) {
+    STATARB_PROFILE_SCOPE("PairScanner::scan");
+    const size_t n = universe.size();
+    pairsTested_ = 0;
+    pairsPruned_ = 0;
+    if (n < 2) {
+        return {};
+    }
+
+    const MarketData& data = *marketData_;
+    const size_t block = std::max<size_t>(1, options_.blockSize);
+
+    // Tasks are either upper-triangular tiles of the whole pair space or, after
+    // the correlation prefilter, one universe row with its surviving partners
+    const bool prefilter = options_.topK > 0 && options_.topK + 1 < n;
+    const auto rows = options_.shard.triangleRows(n);
+    std::vector<std::pair<size_t, size_t>> tiles;
+    std::vector<std::vector<size_t>> partners;
+    if (prefilter) {
+        partners = correlatedPartners(returnCorrelations(data, universe, options_.numThreads),
+                                      n, options_.topK);
+        for (size_t i = 0; i < n; ++i) {
+            if (i < rows.first || i >= rows.second) {
+                partners[i].clear();
+            }
+        }
+    } else {
+        // Only tiles whose row block meets the shard's rows
+        for (const auto& tile : upperTiles(n, block)) {
+            size_t i0 = tile.first * block;
+            if (i0 < rows.second && i0 + block > rows.first) {
+                tiles.push_back(tile);
+            }
+        }
+    }
+    const size_t numTasks = prefilter ? n : tiles.size();
+
+    std::vector<PairCandidate> candidates;
+    std::mutex candidatesMutex;
+
+    ThreadPool pool(options_.numThreads);
+
+    // Per-worker scratch (interleaved spread batch, Σxy tile, partner ids and
+    // the aligned legs of pairs with gaps), sized once and reused
+    struct Scratch {
+        std::vector<double> spreads;
+        std::vector<double> crossTerms;
+        std::vector<MarketData::SymbolId> columns;
+        std::vector<Validity::Range> ranges;
+        std::vector<double> alignedA;
+        std::vector<double> alignedB;
+        std::vector<double> spread;
+    };
+    std::vector<Scratch> scratch(pool.size() + 1);
+
+    const size_t numDays = data.getDataSize();
+    const size_t lanes = Utilities::kAdfBatchLanes;
+    
+    // The prefix must leave the ADF regression some degrees of freedom
+    const size_t prescreenBars = options_.prescreenBars;
+    const bool staged = prescreenBars > 0 && prescreenBars + 2 * AssetPair::kAdfLags + 4 < numDays;
+
+    pool.parallelFor(0, numTasks, 1, [&](size_t begin, size_t end, size_t worker) {
+        Scratch& local = scratch[worker];
+        local.spreads.resize(numDays * lanes);
+        std::vector<PairCandidate> accepted;
+        size_t pruned = 0;
+
+        // Pairs waiting for the ADF stage, tested kAdfBatchLanes at a time.
+        // When staged, pending pairs take the prefix test first and the
+        // survivors queue up for the full-length test.
+        PairCandidate pending[Utilities::kAdfBatchLanes];
+        PairCandidate finalists[Utilities::kAdfBatchLanes];
+        Utilities::AdfResult adf[Utilities::kAdfBatchLanes];
+        // Kept apart from adf: a full finalist batch can flush mid-loop
+        Utilities::AdfResult prefixAdf[Utilities::kAdfBatchLanes];
+        size_t numPending = 0;
+        size_t numFinalists = 0;
+
+        // Spreads of the first `length` bars of a batch, interleaved by lane
+        auto fillSpreads = [&](const PairCandidate* batch, size_t count, size_t length) {
+            // Unused lanes repeat lane 0 so the kernel only sees finite values
+            data.visitStorage([&](auto tag) {
+                using T = decltype(tag);
+                for (size_t l = 0; l < lanes; ++l) {
+                    const PairCandidate& pair = batch[l < count ? l : 0];
+                    const T* a = data.getColumn<T>(pair.symbolA);
+                    const T* b = data.getColumn<T>(pair.symbolB);
+                    double* out = local.spreads.data() + l;
+                    for (size_t t = 0; t < length; ++t) {
+                        out[t * lanes] = data.decode(a[t]) - pair.beta * data.decode(b[t]);
+                    }
+                }
+            });
+        };
+
+        auto flushFinalists = [&]() {
+            if (numFinalists == 0) {
+                return;
+            }
+            fillSpreads(finalists, numFinalists, numDays);
+            Utilities::adfTestBatch(local.spreads.data(), numDays, numFinalists, adf,
+                                    AssetPair::kAdfLags, options_.significanceLevel);
+            for (size_t l = 0; l < numFinalists; ++l) {
+                if (adf[l].isStationary) {
+                    finalists[l].adfStatistic = adf[l].testStatistic;
+                    finalists[l].pValue = adf[l].pValue;
+                    accepted.push_back(finalists[l]);
+                }
+            }
+            numFinalists = 0;
+        };
+
+        auto flush = [&]() {
+            if (numPending == 0) {
+                return;
+            }
+            if (!staged) {
+                std::copy(pending, pending + numPending, finalists);
+                numFinalists = numPending;
+                numPending = 0;
+                flushFinalists();
+                return;
+            }
+            fillSpreads(pending, numPending, prescreenBars);
+            Utilities::adfTestBatch(local.spreads.data(), prescreenBars, numPending, prefixAdf,
+                                    AssetPair::kAdfLags, options_.significanceLevel);
+            for (size_t l = 0; l < numPending; ++l) {
+                if (!(prefixAdf[l].testStatistic < options_.prescreenStatistic)) {
+                    ++pruned;
+                    continue;
+                }
+                finalists[numFinalists] = pending[l];
+                if (++numFinalists == lanes) {
+                    flushFinalists();
+                }
+            }
+            numPending = 0;
+        };
+
+        // A pair with a gap in either leg is regressed and tested on its
+        // aligned bars instead (MarketData::alignPair). Its length is its own,
+        // so it is tested alone rather than in an interleaved batch.
+        auto screenAligned = [&](MarketData::SymbolId a, MarketData::SymbolId b) {
+            data.alignPrices(a, b, local.ranges, local.alignedA, local.alignedB);
+            const PriceView pricesA(local.alignedA);
+            const PriceView pricesB(local.alignedB);
+            
+            PairCandidate pair;
+            pair.symbolA = a;
+            pair.symbolB = b;
+            pair.beta = Utilities::regressionFromSums(Utilities::regressionSums(pricesB, pricesA)).beta;
+            if (prescreenBars > 0 && prescreenBars + 2 * AssetPair::kAdfLags + 4 < pricesA.size()) {
+                auto prefix = AssetPair::evaluateSpread(pricesA.first(prescreenBars), pricesB.first(prescreenBars),
+                                                        pair.beta, local.spread, options_.significanceLevel);
+                if (!(prefix.adfStatistic < options_.prescreenStatistic)) {
+                    ++pruned;
+                    return;
+                }
+            }
+            auto result = AssetPair::evaluateSpread(pricesA, pricesB, pair.beta, local.spread,
+                                                    options_.significanceLevel);
+            if (result.isCointegrated) {
+                pair.adfStatistic = result.adfStatistic;
+                pair.pValue = result.pValue;
+                accepted.push_back(pair);
+            }
+        };
+        
+        // Regression of A on B from cached moments and the Σxy cross term
+        auto addPair = [&](size_t i, size_t j, double sumXY) {
+            MarketData::SymbolId a = universe[i];
+            MarketData::SymbolId b = universe[j];
+            if (!data.isComplete(a) || !data.isComplete(b)) {
+                screenAligned(a, b);
+                return;
+            }
+
+            Utilities::RegressionSums sums;
+            sums.n = static_cast<double>(numDays);
+            sums.sumX = data.getMoments(b).sum;
+            sums.sumXX = data.getMoments(b).sumSq;
+            sums.sumY = data.getMoments(a).sum;
+            sums.sumYY = data.getMoments(a).sumSq;
+            sums.sumXY = sumXY;
+
+            pending[numPending].symbolA = a;
+            pending[numPending].symbolB = b;
+            pending[numPending].beta = Utilities::regressionFromSums(sums).beta;
+            if (++numPending == lanes) {
+                flush();
+            }
+        };
+
+        for (size_t t = begin; t < end; ++t) {
+            if (prefilter) {
+                const std::vector<size_t>& row = partners[t];
+                if (row.empty()) {
+                    continue;
+                }
+                local.columns.clear();
+                for (size_t j : row) {
+                    local.columns.push_back(universe[j]);
+                }
+                local.crossTerms.resize(row.size());
+                crossProductTile(data, universe.data() + t, 1, local.columns.data(), row.size(),
+                                 options_.timeBlock, local.crossTerms.data());
+                for (size_t k = 0; k < row.size(); ++k) {
+                    addPair(t, row[k], local.crossTerms[k]);
+                }
+                continue;
+            }
+
+            const size_t i0 = std::max(rows.first, tiles[t].first * block);
+            const size_t i1 = std::min(rows.second, tiles[t].first * block + block);
+            const size_t j0 = tiles[t].second * block;
+            const size_t j1 = std::min(n, j0 + block);
+            const size_t numCols = j1 - j0;
+
+            local.crossTerms.resize((i1 - i0) * numCols);
+            crossProductTile(data, universe.data() + i0, i1 - i0, universe.data() + j0, numCols,
+                             options_.timeBlock, local.crossTerms.data());
+
+            for (size_t i = i0; i < i1; ++i) {
+                for (size_t j = std::max(j0, i + 1); j < j1; ++j) {
+                    addPair(i, j, local.crossTerms[(i - i0) * numCols + (j - j0)]);
+                }
+            }
+        }
+        flush();
+        flushFinalists();
+
+        if (!accepted.empty() || pruned > 0) {
+            std::lock_guard<std::mutex> lock(candidatesMutex);
+            candidates.insert(candidates.end(), accepted.begin(), accepted.end());
+            pairsPruned_ += pruned;
+        }
+    });
+
+    if (prefilter) {
+        for (const auto& row : partners) {
+            pairsTested_ += row.size();
+        }
+    } else {
+        for (size_t i = rows.first; i < rows.second; ++i) {
+            pairsTested_ += n - 1 - i;
+        }
+    }
+    STATARB_PROFILE_COUNT(PairsTested, pairsTested_);
+    STATARB_PROFILE_COUNT(PairsAccepted, candidates.size());
+    STATARB_PROFILE_COUNT(PairsPruned, pairsPruned_);
+
+    // Tiles finish in arbitrary order; restore the serial enumeration order
+    // so downstream results do not depend on scheduling
+    std::vector<size_t> position(marketData_->getNumSymbols(), 0);
+    for (size_t k = 0; k < n; ++k) {
+        position[universe[k]] = k;
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [&](const PairCandidate& x, const PairCandidate& y) {
+                  if (position[x.symbolA] != position[y.symbolA]) {
+                      return position[x.symbolA] < position[y.symbolA];
+                  }
+                  return position[x.symbolB] < position[y.symbolB];
+              });
+
+    return candidates;
+}
\ No newline at end of file
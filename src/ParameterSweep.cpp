@@ -0,0 +1,196 @@
+#include "ParameterSweep.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+ParameterSweep::ParameterSweep(std::shared_ptr<MarketData> marketData,
+                               std::vector<PairCandidate> pairs,
+                               Options options)
+    : marketData_(std::move(marketData)), pairs_(std::move(pairs)), options_(options)
+{
+}
+
+namespace {
+
+bool parseAxis(const std::string& key, const std::vector<std::string>& values,
+               std::vector<double>& out) {
+    out.clear();
+    for (const auto& value : values) {
+        size_t first = value.find(':');
+        if (first == std::string::npos) {
+            out.push_back(std::stod(value));
+            continue;
+        }
+
+        // start:stop:step range, inclusive of stop
+        size_t second = value.find(':', first + 1);
+        if (second == std::string::npos) {
+            std::cerr << "Error: Range for " << key << " must be start:stop:step" << std::endl;
+            return false;
+        }
+        double start = std::stod(value.substr(0, first));
+        double stop = std::stod(value.substr(first + 1, second - first - 1));
+        double step = std::stod(value.substr(second + 1));
+        if (step <= 0 || stop < start) {
+            std::cerr << "Error: Invalid range for " << key << ": " << value << std::endl;
+            return false;
+        }
+        size_t count = static_cast<size_t>(std::floor((stop - start) / step + 1e-9)) + 1;
+        for (size_t k = 0; k < count; ++k) {
+            out.push_back(start + k * step);
+        }
+    }
+    return !out.empty();
+}
+
+} // namespace
+
+bool ParameterSweep::parseGrid(const std::string& spec, Grid& grid) {
+    // Group comma separated tokens under the most recent key=
+    std::vector<std::pair<std::string, std::vector<std::string>>> axes;
+    std::stringstream stream(spec);
+    std::string token;
+    while (std::getline(stream, token, ',')) {
+        size_t eq = token.find('=');
+        if (eq != std::string::npos) {
+            axes.push_back({token.substr(0, eq), {token.substr(eq + 1)}});
+        } else if (!axes.empty() && !token.empty()) {
+            axes.back().second.push_back(token);
+        } else {
+            std::cerr << "Error: Malformed sweep spec: " << spec << std::endl;
+            return false;
+        }
+    }
+
+    try {
+        for (const auto& axis : axes) {
+            std::vector<double> values;
+            if (!parseAxis(axis.first, axis.second, values)) {
+                return false;
+            }
+            if (axis.first == "entry") {
+                grid.entryThresholds = values;
+            } else if (axis.first == "exit") {
+                grid.exitThresholds = values;
+            } else if (axis.first == "window") {
+                grid.lookbackWindows.clear();
+                for (double v : values) {
+                    if (v < 2) {
+                        std::cerr << "Error: Lookback window must be at least 2" << std::endl;
+                        return false;
+                    }
+                    grid.lookbackWindows.push_back(static_cast<size_t>(std::lround(v)));
+                }
+            } else {
+                std::cerr << "Error: Unknown sweep parameter: " << axis.first << std::endl;
+                return false;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Could not parse sweep spec: " << spec << std::endl;
+        return false;
+    }
+
+    return grid.size() > 0;
+}
+
+std::vector<ParameterSweep::Result> ParameterSweep::run(const Grid& grid) const {
+    const size_t numEntries = grid.entryThresholds.size();
+    const size_t numExits = grid.exitThresholds.size();
+    const size_t pointsPerWindow = numEntries * numExits;
+    const auto points = options_.shard.range(grid.size());
+    std::vector<Result> results(points.second - points.first);
+    if (results.empty()) {
+        return results;
+    }
+
+    ThreadPool pool(options_.numThreads);
+
+    // One quiet Backtester per worker over the same (view-backed) pairs
+    std::vector<std::unique_ptr<Backtester>> backtesters(pool.size() + 1);
+    for (auto& backtester : backtesters) {
+        backtester = std::make_unique<Backtester>(marketData_);
+        backtester->setVerbose(false);
+        backtester->setHedgeRatioWindow(options_.hedgeRatioWindow);
+        backtester->setCostModel(options_.costs);
+        // Only summary metrics are returned; costs are charged on the daily values
+        backtester->setRecordValues(!options_.costs.isFree());
+        backtester->setKillCriteria(options_.kill);
+        for (const auto& candidate : pairs_) {
+            backtester->addPair(candidate);
+        }
+    }
+    const Backtester& reference = *backtesters[0];
+
+    // Flat per-pair z-score rows and per-worker signal matrices, reused across the grid
+    const size_t numDays = marketData_->getDataSize();
+    std::vector<double> zScores(pairs_.size() * numDays);
+    std::vector<std::vector<AssetPair::Signal>> signals(backtesters.size());
+    for (auto& buffer : signals) {
+        buffer.assign(pairs_.size() * numDays, 0);
+    }
+
+    for (size_t w = 0; w < grid.lookbackWindows.size(); ++w) {
+        const size_t window = grid.lookbackWindows[w];
+        
+        // This window's points that fall in the shard
+        const size_t first = std::max(points.first, w * pointsPerWindow);
+        const size_t last = std::min(points.second, (w + 1) * pointsPerWindow);
+        if (first >= last) {
+            continue;
+        }
+
+        // Z-scores for this window, shared by every threshold combination
+        pool.parallelFor(0, pairs_.size(), 1, [&](size_t begin, size_t end, size_t) {
+            for (size_t p = begin; p < end; ++p) {
+                reference.getPair(p).computeSignals(0.0, 0.0, window, nullptr,
+                                                    zScores.data() + p * numDays);
+            }
+        });
+
+        pool.parallelFor(first - w * pointsPerWindow, last - w * pointsPerWindow, 1,
+                         [&](size_t begin, size_t end, size_t worker) {
+            Backtester& backtester = *backtesters[worker];
+            AssetPair::Signal* local = signals[worker].data();
+            for (size_t k = begin; k < end; ++k) {
+                Result& result = results[w * pointsPerWindow + k - points.first];
+                result.entryThreshold = grid.entryThresholds[k / numExits];
+                result.exitThreshold = grid.exitThresholds[k % numExits];
+                result.lookbackWindow = window;
+
+                for (size_t p = 0; p < pairs_.size(); ++p) {
+                    AssetPair::signalsFromZScores(zScores.data() + p * numDays, numDays,
+                                                  result.entryThreshold, result.exitThreshold,
+                                                  local + p * numDays);
+                }
+                backtester.runBacktestWithSignals(local, numDays, options_.initialCapital, window,
+                                                  options_.delayedExecution);
+                result.metrics = backtester.getPerformanceMetrics();
+                result.pruned = backtester.wasPruned();
+                result.barsRun = backtester.getBarsRun();
+            }
+        });
+    }
+
+    return results;
+}
+
+bool ParameterSweep::exportResults(const std::string& filename, const std::vector<Result>& results) {
+    std::vector<std::string> headers = {"Entry", "Exit", "Window", "TotalReturn", "AnnualizedReturn",
+                                        "SharpeRatio", "MaxDrawdown", "Wins", "Losses",
+                                        "AvgHoldingPeriod", "AvgWin", "AvgLoss", "Pruned", "BarsRun"};
+    std::vector<std::vector<double>> data;
+    data.reserve(results.size());
+    for (const auto& r : results) {
+        const auto& m = r.metrics;
+        data.push_back({r.entryThreshold, r.exitThreshold, static_cast<double>(r.lookbackWindow),
+                        m.totalReturn, m.annualizedReturn, m.sharpeRatio, m.maxDrawdown,
+                        static_cast<double>(m.winCount), static_cast<double>(m.lossCount),
+                        m.avgHoldingPeriod, m.avgWin, m.avgLoss,
+                        r.pruned ? 1.0 : 0.0, static_cast<double>(r.barsRun)});
+    }
+    return Utilities::writeCSV(filename, headers, data);
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "PerformanceMetrics.h"
+#include <algorithm>
+#include <cmath>
+
+void MetricsAccumulator::merge(const MetricsAccumulator& later) {
+    winCount_ += later.winCount_;
+    lossCount_ += later.lossCount_;
+    totalWins_ += later.totalWins_;
+    totalLosses_ += later.totalLosses_;
+    totalHoldingDays_ += later.totalHoldingDays_;
+    if (later.numValues_ == 0) {
+        return;
+    }
+    if (numValues_ == 0) {
+        numValues_ = later.numValues_;
+        firstValue_ = later.firstValue_;
+        lastValue_ = later.lastValue_;
+        peak_ = later.peak_;
+        trough_ = later.trough_;
+        maxDrawdown_ = later.maxDrawdown_;
+        dailyReturns_ = later.dailyReturns_;
+        return;
+    }
+    
+    // The return across the seam, then the later stretch's own returns
+    dailyReturns_.add((later.firstValue_ / lastValue_) - 1.0);
+    dailyReturns_.merge(later.dailyReturns_);
+    
+    // Later bars are measured from the higher of the two peaks: below this
+    // stretch's peak the deepest point is the later trough, above it the
+    // later stretch's own drawdown already counts
+    double seamDrawdown = (peak_ - later.trough_) / peak_;
+    maxDrawdown_ = std::max({maxDrawdown_, later.maxDrawdown_, seamDrawdown});
+    peak_ = std::max(peak_, later.peak_);
+    trough_ = std::min(trough_, later.trough_);
+    lastValue_ = later.lastValue_;
+    numValues_ += later.numValues_;
+}
+
+PerformanceMetrics MetricsAccumulator::finish(double initialCapital, double periodsPerYear) const {
+    PerformanceMetrics metrics;
+    if (numValues_ == 0) {
+        return metrics;
+    }
+    
+    // Calculate total return
+    metrics.totalReturn = (lastValue_ / initialCapital) - 1.0;
+    
+    // Calculate annualized return
+    double years = static_cast<double>(numValues_) / periodsPerYear;
+    metrics.annualizedReturn = std::pow(1.0 + metrics.totalReturn, 1.0 / years) - 1.0;
+    
+    // Calculate Sharpe ratio (assuming 0% risk-free rate)
+    metrics.sharpeRatio = sharpeRatio(periodsPerYear);
+    
+    metrics.maxDrawdown = maxDrawdown_;
+    
+    // Win/loss counts, holding period and average win/loss
+    metrics.winCount = winCount_;
+    metrics.lossCount = lossCount_;
+    int totalTrades = winCount_ + lossCount_;
+    if (totalTrades > 0) {
+        metrics.avgHoldingPeriod = totalHoldingDays_ / totalTrades;
+    }
+    if (winCount_ > 0) {
+        metrics.avgWin = totalWins_ / winCount_;
+    }
+    if (lossCount_ > 0) {
+        metrics.avgLoss = totalLosses_ / lossCount_;
+    }
+    return metrics;
+}
@@ -0,0 +1,279 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace Profiler {
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+// Events of one thread; only the owning thread appends
+struct ThreadLog {
+    uint32_t threadId = 0;
+    std::vector<Event> events;
+};
+
+std::atomic<bool> enabled{false};
+std::atomic<uint64_t> counters[static_cast<size_t>(Counter::Count)];
+
+std::mutex logsMutex;
+std::vector<std::shared_ptr<ThreadLog>> logs;   // keeps logs of finished threads
+std::atomic<int64_t> originNs{0};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadLog& threadLog() {
+    thread_local std::shared_ptr<ThreadLog> log = [] {
+        auto created = std::make_shared<ThreadLog>();
+        std::lock_guard<std::mutex> lock(logsMutex);
+        created->threadId = static_cast<uint32_t>(logs.size());
+        logs.push_back(created);
+        return created;
+    }();
+    return *log;
+}
+
+} // namespace
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::PairsTested: return "pairs_tested";
+        case Counter::PairsAccepted: return "pairs_accepted";
+        case Counter::PairsPruned: return "pairs_pruned";
+        case Counter::BasketsTested: return "baskets_tested";
+        case Counter::BasketsAccepted: return "baskets_accepted";
+        case Counter::BarsProcessed: return "bars_processed";
+        case Counter::RunsPruned: return "runs_pruned";
+        case Counter::Allocations: return "allocations";
+        case Counter::BytesLoaded: return "bytes_loaded";
+        default: return "unknown";
+    }
+}
+
+bool isCompiledIn() {
+#ifdef STATARB_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setEnabled(bool on) {
+    if (on && originNs.load() == 0) {
+        originNs.store(nowNs());
+    }
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+bool isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void reset() {
+    std::lock_guard<std::mutex> lock(logsMutex);
+    for (auto& log : logs) {
+        log->events.clear();
+    }
+    for (auto& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    originNs.store(nowNs());
+}
+
+void addCounter(Counter counter, uint64_t amount) {
+    if (isEnabled()) {
+        counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+}
+
+uint64_t getCounter(Counter counter) {
+    return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+ScopedTimer::ScopedTimer(const char* name)
+    : name_(name), startNs_(isEnabled() ? nowNs() : 0)
+{
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (startNs_ != 0 && isEnabled()) {
+        threadLog().events.push_back({name_, startNs_, nowNs() - startNs_});
+    }
+}
+
+std::vector<PhaseStats> phaseSummary() {
+    std::vector<PhaseStats> phases;
+    std::lock_guard<std::mutex> lock(logsMutex);
+    
+    // Order phases by their earliest start across threads
+    std::vector<std::pair<int64_t, size_t>> firstSeen;
+    for (const auto& log : logs) {
+        for (const auto& event : log->events) {
+            auto it = std::find_if(phases.begin(), phases.end(),
+                                   [&](const PhaseStats& p) { return p.name == event.name; });
+            if (it == phases.end()) {
+                phases.push_back({event.name, 0, 0.0, 0.0});
+                firstSeen.emplace_back(event.startNs, phases.size() - 1);
+                it = phases.end() - 1;
+            } else {
+                auto& seen = firstSeen[it - phases.begin()];
+                seen.first = std::min(seen.first, event.startNs);
+            }
+            double ms = event.durationNs / 1e6;
+            it->calls++;
+            it->totalMs += ms;
+            it->maxMs = std::max(it->maxMs, ms);
+        }
+    }
+    
+    std::vector<size_t> order(phases.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return firstSeen[a].first < firstSeen[b].first; });
+    std::vector<PhaseStats> sorted;
+    sorted.reserve(phases.size());
+    for (size_t i : order) sorted.push_back(phases[i]);
+    return sorted;
+}
+
+void printReport(std::ostream& out) {
+    out << "------- Profile -------" << std::endl;
+    out << std::left << std::setw(36) << "Phase" << std::right << std::setw(10) << "Calls"
+        << std::setw(14) << "Total ms" << std::setw(14) << "Max ms" << std::endl;
+    for (const auto& phase : phaseSummary()) {
+        out << std::left << std::setw(36) << phase.name << std::right << std::setw(10) << phase.calls
+            << std::setw(14) << std::fixed << std::setprecision(3) << phase.totalMs
+            << std::setw(14) << phase.maxMs << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+    for (size_t c = 0; c < static_cast<size_t>(Counter::Count); ++c) {
+        out << std::left << std::setw(36) << counterName(static_cast<Counter>(c)) << std::right
+            << std::setw(10) << getCounter(static_cast<Counter>(c)) << std::endl;
+    }
+    out << std::left;
+}
+
+bool writeChromeTrace(const std::string& filePath) {
+    std::ofstream file(filePath);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    const int64_t origin = originNs.load();
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(logsMutex);
+        for (const auto& log : logs) {
+            for (const auto& event : log->events) {
+                file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name
+                     << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << log->threadId
+                     << ",\"ts\":" << (event.startNs - origin) / 1000.0
+                     << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+                first = false;
+            }
+        }
+    }
+    
+    // Final counter values as one counter sample at the end of the trace
+    file << (first ? "\n" : ",\n") << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":"
+         << (nowNs() - origin) / 1000.0 << ",\"args\":{";
+    for (size_t c = 0; c < static_cast<size_t>(Counter::Count); ++c) {
+        file << (c ? "," : "") << "\"" << counterName(static_cast<Counter>(c)) << "\":"
+             << getCounter(static_cast<Counter>(c));
+    }
+    file << "}}\n]}\n";
+    return static_cast<bool>(file);
+}
+
+} // namespace Profiler
+
+#if defined(STATARB_PROFILING) || defined(STATARB_COUNT_ALLOCATIONS)
+// Count heap allocations while recording. The global allocation functions
+// are only replaced in profiling builds and in the test binary, which checks
+// hot paths against this counter; every form is replaced so each pointer is
+// released by the function family that allocated it.
+namespace {
+
+void* allocate(std::size_t size) {
+    Profiler::addCounter(Profiler::Counter::Allocations, 1);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    Profiler::addCounter(Profiler::Counter::Allocations, 1);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a whole number of alignments
+    const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+#if defined(_MSC_VER)
+    void* p = _aligned_malloc(rounded, align);
+#else
+    void* p = std::aligned_alloc(align, rounded);
+#endif
+    if (p) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void releaseAligned(void* p) noexcept {
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { releaseAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { releaseAligned(p); }
+#endif
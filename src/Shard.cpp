@@ -0,0 +1,45 @@
+#include "Shard.h"
+#include <iostream>
+
+std::pair<size_t, size_t> Shard::range(size_t total) const {
+    if (isWhole()) {
+        return {0, total};
+    }
+    return {total * index / count, total * (index + 1) / count};
+}
+
+std::pair<size_t, size_t> Shard::triangleRows(size_t n) const {
+    if (isWhole() || n < 2) {
+        return {0, n};
+    }
+    
+    // Row boundaries where the running pair count first reaches k / count of the total
+    const size_t total = n * (n - 1) / 2;
+    auto boundary = [&](size_t k) {
+        const size_t target = total * k / count;
+        size_t row = 0;
+        size_t before = 0;
+        while (row < n && before < target) {
+            before += n - 1 - row;
+            ++row;
+        }
+        return row;
+    };
+    return {boundary(index), index + 1 == count ? n : boundary(index + 1)};
+}
+
+bool Shard::parse(const std::string& spec, Shard& shard) {
+    size_t slash = spec.find('/');
+    try {
+        if (slash != std::string::npos) {
+            shard.index = std::stoul(spec.substr(0, slash));
+            shard.count = std::stoul(spec.substr(slash + 1));
+            if (shard.count > 0 && shard.index < shard.count) {
+                return true;
+            }
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Error: Shard must be i/N with 0 <= i < N, got " << spec << std::endl;
+    return false;
+}
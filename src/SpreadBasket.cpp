@@ -0,0 +1,130 @@
+#include "SpreadBasket.h"
+#include "Profiler.h"
+#include "SignalPass.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+SpreadBasket::SpreadBasket(const std::vector<std::string>& symbols, const std::vector<PriceView>& prices)
+    : symbols_(symbols)
+{
+    if (symbols_.size() > kMaxLegs || prices.size() != symbols_.size()) {
+        std::cerr << "Warning: A basket takes one price series per leg and at most "
+                  << kMaxLegs << " legs; keeping " << std::min({symbols_.size(), prices.size(), kMaxLegs})
+                  << std::endl;
+        symbols_.resize(std::min({symbols_.size(), prices.size(), kMaxLegs}));
+    }
+
+    numBars_ = std::numeric_limits<size_t>::max();
+    for (size_t leg = 0; leg < symbols_.size(); ++leg) {
+        numBars_ = std::min(numBars_, prices[leg].size());
+    }
+    if (symbols_.empty()) {
+        numBars_ = 0;
+    }
+
+    rows_.assign(numBars_ * kMaxLegs, 0.0);
+    for (size_t leg = 0; leg < symbols_.size(); ++leg) {
+        if (prices[leg].size() != numBars_) {
+            std::cerr << "Warning: Price series for " << symbols_[leg]
+                      << " is longer than the basket. Truncating to " << numBars_ << std::endl;
+        }
+        for (size_t t = 0; t < numBars_; ++t) {
+            rows_[t * kMaxLegs + leg] = prices[leg][t];
+        }
+    }
+
+    // Equal weights until a test or setWeights() says otherwise
+    for (size_t leg = 0; leg < symbols_.size(); ++leg) {
+        weights_[leg] = 1.0;
+    }
+}
+
+SpreadBasket::SpreadBasket(const std::vector<std::string>& symbols, const std::vector<double>& weights)
+    : symbols_(symbols)
+{
+    symbols_.resize(std::min(symbols_.size(), kMaxLegs));
+    setWeights(weights);
+}
+
+std::vector<double> SpreadBasket::getWeights() const {
+    return std::vector<double>(weights_, weights_ + symbols_.size());
+}
+
+void SpreadBasket::setWeights(const std::vector<double>& weights, bool isCointegrated) {
+    std::fill(weights_, weights_ + kMaxLegs, 0.0);
+    std::copy_n(weights.begin(), std::min(weights.size(), symbols_.size()), weights_);
+    isCointegrated_ = isCointegrated;
+}
+
+std::vector<double> SpreadBasket::getSpreads() const {
+    std::vector<double> spreads(numBars_);
+    for (size_t i = 0; i < numBars_; ++i) {
+        spreads[i] = getSpread(i);
+    }
+    return spreads;
+}
+
+std::vector<double> SpreadBasket::getZScores(size_t window) const {
+    std::vector<double> zScores(numBars_);
+    computeSignals(0.0, 0.0, window, nullptr, zScores.data());
+    return zScores;
+}
+
+bool SpreadBasket::testCointegration(double significanceLevel, int lags) {
+    STATARB_PROFILE_SCOPE("SpreadBasket::testCointegration");
+    Johansen::Workspace workspace;
+    cointegration_ = Johansen::estimate(rows_.data(), numBars_, symbols_.size(), lags,
+                                        significanceLevel, workspace);
+    if (cointegration_.valid) {
+        setWeights(std::vector<double>(cointegration_.weights.begin(),
+                                       cointegration_.weights.begin() + symbols_.size()),
+                   cointegration_.isCointegrated);
+    } else {
+        isCointegrated_ = false;
+    }
+    return isCointegrated_;
+}
+
+std::vector<int> SpreadBasket::generateSignals(double entryThreshold,
+                                               double exitThreshold,
+                                               size_t lookbackWindow) const {
+    STATARB_PROFILE_SCOPE("SpreadBasket::generateSignals");
+    std::vector<int> signals(numBars_);
+    auto spreadAt = [this](size_t i) { return getSpread(i); };
+    zScoreSignalPass(spreadAt, numBars_, effectiveLookback(lookbackWindow, numBars_),
+                     StrategyPolicies::ZScoreBands{entryThreshold, exitThreshold}, signals.data(),
+                     static_cast<double*>(nullptr));
+    return signals;
+}
+
+void SpreadBasket::computeSignals(double entryThreshold, double exitThreshold, size_t lookbackWindow,
+                                  Signal* signals, double* zScores) const {
+    STATARB_PROFILE_SCOPE("SpreadBasket::generateSignals");
+    auto spreadAt = [this](size_t i) { return getSpread(i); };
+    zScoreSignalPass(spreadAt, numBars_, effectiveLookback(lookbackWindow, numBars_),
+                     StrategyPolicies::ZScoreBands{entryThreshold, exitThreshold}, signals, zScores);
+}
+
+void SpreadBasket::startStreaming(double entryThreshold, double exitThreshold, size_t lookbackWindow) {
+    stream_.window.reset(lookbackWindow);
+    stream_.entryThreshold = entryThreshold;
+    stream_.exitThreshold = exitThreshold;
+    stream_.position = 0;
+    stream_.signal = 0;
+    stream_.zScore = std::numeric_limits<double>::quiet_NaN();
+    stream_.bars = 0;
+}
+
+int SpreadBasket::onBar(const double* prices) {
+    alignas(64) double row[kMaxLegs] = {};
+    std::copy_n(prices, symbols_.size(), row);
+
+    double spread = dot(row);
+    stream_.window.push(spread);
+    stream_.zScore = stream_.window.zScore(spread);
+    stream_.signal = AssetPair::stepSignal(stream_.position, stream_.zScore,
+                                           stream_.entryThreshold, stream_.exitThreshold);
+    ++stream_.bars;
+    return stream_.signal;
+}
@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+namespace {
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local size_t tlsWorker = 0;
+}
+
+size_t ThreadPool::resolveThreadCount(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    size_t hw = std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    size_t count = resolveThreadCount(numThreads);
+    for (size_t i = 0; i < count; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wakeCondition_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    doneCondition_.wait(lock, [this]() { return pending_.load() == 0; });
+}
+
+size_t ThreadPool::currentWorker() const {
+    return tlsPool == this ? tlsWorker : workers_.size();
+}
+
+bool ThreadPool::tryPop(size_t worker, std::function<void()>& task) {
+    // Own queue first (FIFO), then steal from the back of the others
+    {
+        WorkerQueue& own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkerQueue& victim = *queues_[(worker + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+    tlsPool = this;
+    tlsWorker = worker;
+
+    std::function<void()> task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            wakeCondition_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+            if (queued_.load() == 0 && stopping_) {
+                return;
+            }
+        }
+
+        if (!tryPop(worker, task)) {
+            continue;
+        }
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+
+        task();
+        task = nullptr;
+
+        if (pending_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            doneCondition_.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "Timestamps.h"
+#include <charconv>
+#include <cstdio>
+#include <limits>
+
+namespace {
+
+// Days between 1970-01-01 and the civil date (proleptic Gregorian), after
+// Howard Hinnant's days_from_civil; linear in the day, so overflowing days roll over
+int64_t daysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yearOfEra = year - era * 400;
+    const int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromDays(int64_t days, int64_t& year, int64_t& month, int64_t& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Unsigned decimal field of at most `maxDigits` digits
+bool readField(const char*& p, const char* end, int64_t& value, int maxDigits = 18) {
+    const char* start = p;
+    value = 0;
+    while (p < end && isDigit(*p) && p - start < maxDigits) {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return p > start;
+}
+
+bool expect(const char*& p, const char* end, char c) {
+    if (p < end && *p == c) {
+        ++p;
+        return true;
+    }
+    return false;
+}
+
+// Latest day whose midnight still fits in int64 nanoseconds
+constexpr int64_t kMaxDays = std::numeric_limits<int64_t>::max() / Timestamps::kNanosPerDay - 1;
+
+} // namespace
+
+namespace Timestamps {
+
+bool parse(const char* begin, const char* end, int64_t& nanos) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+    if (begin == end) {
+        return false;
+    }
+
+    // Eight bare digits are a compact YYYYMMDD date (as epoch nanoseconds
+    // they would all fall in the first 0.1 s of 1970); any other bare
+    // integer is already epoch nanoseconds
+    const char* p = begin + (*begin == '-');
+    while (p < end && isDigit(*p)) ++p;
+    const bool compactDate = p == end && *begin != '-' && end - begin == 8;
+    if (p == end && !compactDate) {
+        auto result = std::from_chars(begin, end, nanos);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    p = begin;
+    int64_t year, month, day;
+    if (compactDate) {
+        readField(p, end, year, 4);
+        readField(p, end, month, 2);
+        readField(p, end, day, 2);
+        if (month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+        nanos = daysFromCivil(year, month, day) * kNanosPerDay;
+        return true;
+    }
+    if (!readField(p, end, year, 6) || !expect(p, end, '-') || !readField(p, end, month) ||
+        !expect(p, end, '-') || !readField(p, end, day) || month < 1 || month > 12 || day < 1) {
+        return false;
+    }
+    const int64_t days = daysFromCivil(year, month, day);
+    if (days > kMaxDays || days < -kMaxDays) {
+        return false;
+    }
+    int64_t value = days * kNanosPerDay;
+
+    if (p < end && (*p == ' ' || *p == 'T')) {
+        ++p;
+        int64_t hour, minute, second = 0;
+        if (!readField(p, end, hour, 2) || !expect(p, end, ':') || !readField(p, end, minute, 2)) {
+            return false;
+        }
+        if (expect(p, end, ':')) {
+            if (!readField(p, end, second, 2)) {
+                return false;
+            }
+            if (expect(p, end, '.')) {
+                // Digits past nanoseconds are dropped
+                const char* fractionStart = p;
+                int64_t fraction;
+                if (!readField(p, end, fraction, 9)) {
+                    return false;
+                }
+                for (auto digits = p - fractionStart; digits < 9; ++digits) {
+                    fraction *= 10;
+                }
+                while (p < end && isDigit(*p)) ++p;
+                value += fraction;
+            }
+        }
+        value += hour * kNanosPerHour + minute * kNanosPerMinute + second * kNanosPerSecond;
+    }
+
+    if (p < end && (*p == '+' || *p == '-')) {
+        const int64_t sign = (*p == '+') ? 1 : -1;
+        ++p;
+        int64_t hours, minutes;
+        if (!readField(p, end, hours, 2) || !expect(p, end, ':') || !readField(p, end, minutes, 2)) {
+            return false;
+        }
+        value -= sign * (hours * kNanosPerHour + minutes * kNanosPerMinute);
+    } else {
+        expect(p, end, 'Z');
+    }
+    if (p != end) {
+        return false;
+    }
+    nanos = value;
+    return true;
+}
+
+std::string format(int64_t nanos) {
+    const int64_t midnight = floorTo(nanos, kNanosPerDay);
+    int64_t year, month, day;
+    civilFromDays(midnight / kNanosPerDay, year, month, day);
+
+    char buffer[64];
+    int length = std::snprintf(buffer, sizeof(buffer), "%04lld-%02lld-%02lld",
+                               static_cast<long long>(year), static_cast<long long>(month),
+                               static_cast<long long>(day));
+    const int64_t timeOfDay = nanos - midnight;
+    if (timeOfDay != 0) {
+        const int64_t seconds = timeOfDay / kNanosPerSecond;
+        length += std::snprintf(buffer + length, sizeof(buffer) - length, " %02lld:%02lld:%02lld",
+                                static_cast<long long>(seconds / 3600),
+                                static_cast<long long>(seconds / 60 % 60),
+                                static_cast<long long>(seconds % 60));
+        int64_t fraction = timeOfDay % kNanosPerSecond;
+        if (fraction != 0) {
+            int digits = 9;
+            while (fraction % 10 == 0) {
+                fraction /= 10;
+                --digits;
+            }
+            length += std::snprintf(buffer + length, sizeof(buffer) - length, ".%0*lld", digits,
+                                    static_cast<long long>(fraction));
+        }
+    }
+    return std::string(buffer, length);
+}
+
+namespace {
+
+struct IntervalUnit {
+    const char* name;
+    int64_t nanos;
+};
+
+// Longest first, so formatInterval picks the coarsest exact unit
+constexpr IntervalUnit kIntervalUnits[] = {
+    {"d", kNanosPerDay}, {"h", kNanosPerHour}, {"m", kNanosPerMinute}, {"s", kNanosPerSecond},
+    {"ms", 1000000}, {"us", 1000}, {"ns", 1},
+};
+
+} // namespace
+
+bool parseInterval(const std::string& spec, int64_t& interval) {
+    const char* begin = spec.data();
+    const char* end = begin + spec.size();
+    int64_t count = 0;
+    auto result = std::from_chars(begin, end, count);
+    if (result.ec != std::errc() || count <= 0) {
+        return false;
+    }
+    const std::string unit(result.ptr, end);
+    for (const auto& candidate : kIntervalUnits) {
+        if (unit == candidate.name) {
+            if (count > std::numeric_limits<int64_t>::max() / candidate.nanos) {
+                return false;
+            }
+            interval = count * candidate.nanos;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string formatInterval(int64_t interval) {
+    if (interval <= 0) {
+        return "0s";
+    }
+    for (const auto& unit : kIntervalUnits) {
+        if (interval % unit.nanos == 0) {
+            return std::to_string(interval / unit.nanos) + unit.name;
+        }
+    }
+    return std::to_string(interval) + "ns";
+}
+
+int64_t barInterval(const std::vector<int64_t>& timestamps) {
+    int64_t interval = 0;
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+        const int64_t step = timestamps[i] - timestamps[i - 1];
+        if (step > 0 && (interval == 0 || step < interval)) {
+            interval = step;
+        }
+    }
+    return interval;
+}
+
+double periodsPerYear(const std::vector<int64_t>& timestamps) {
+    if (timestamps.empty()) {
+        return kTradingDaysPerYear;
+    }
+    const int64_t interval = barInterval(timestamps);
+    if (interval > kNanosPerDay) {
+        return kCalendarDaysPerYear * static_cast<double>(kNanosPerDay) / static_cast<double>(interval);
+    }
+    size_t calendarDays = 1;
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+        calendarDays += floorTo(timestamps[i], kNanosPerDay) != floorTo(timestamps[i - 1], kNanosPerDay);
+    }
+    return kTradingDaysPerYear * static_cast<double>(timestamps.size()) / static_cast<double>(calendarDays);
+}
+
+} // namespace Timestamps
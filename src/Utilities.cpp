@@ -1,11 +1,14 @@
 #include "Utilities.h"
+#include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <random>
 
 namespace Utilities {
 
-double mean(const std::vector<double>& data) {
+double mean(SeriesView<double> data) {
     if (data.empty()) {
         return std::numeric_limits<double>::quiet_NaN();
     }
@@ -14,7 +17,7 @@ double mean(const std::vector<double>& data) {
     return sum / data.size();
 }
 
-double standardDeviation(const std::vector<double>& data) {
+double standardDeviation(SeriesView<double> data) {
     if (data.size() < 2) {
         return std::numeric_limits<double>::quiet_NaN();
     }
@@ -30,7 +33,7 @@ double standardDeviation(const std::vector<double>& data) {
     return std::sqrt(sum_squared_diff / (data.size() - 1));
 }
 
-std::vector<double> calculateReturns(const std::vector<double>& prices) {
+std::vector<double> calculateReturns(SeriesView<double> prices) {
     if (prices.size() < 2) {
         return {};
     }
@@ -43,82 +46,140 @@ std::vector<double> calculateReturns(const std::vector<double>& prices) {
     return returns;
 }
 
-std::vector<double> rollingMean(const std::vector<double>& data, size_t window) {
-    if (data.size() < window) {
-        return std::vector<double>(data.size(), std::numeric_limits<double>::quiet_NaN());
+namespace {
+
+// Shared single-pass kernel; any output pointer may be null if not wanted
+void rollingPass(SeriesView<double> data, size_t window,
+                 double* means, double* stdDevs, double* zScores) {
+    RollingMoments moments;
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (i < window) {
+            moments.add(data[i]);
+        } else {
+            moments.replace(data[i - window], data[i]);
+        }
+        
+        if (i + 1 < window) {
+            continue;
+        }
+        
+        double mu = moments.mean();
+        if (means) means[i] = mu;
+        if (stdDevs || zScores) {
+            double sd = moments.stdDev();
+            if (stdDevs) stdDevs[i] = sd;
+            if (zScores && sd > 0) zScores[i] = (data[i] - mu) / sd;
+        }
+    }
+}
+
+} // namespace
+
+RollingStats rollingStatistics(SeriesView<double> data, size_t window) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    RollingStats stats;
+    stats.mean.assign(data.size(), nan);
+    stats.stdDev.assign(data.size(), nan);
+    stats.zScore.assign(data.size(), nan);
+    
+    if (window > 0 && data.size() >= window) {
+        rollingPass(data, window, stats.mean.data(), stats.stdDev.data(), stats.zScore.data());
     }
     
+    return stats;
+}
+
+std::vector<double> rollingMean(SeriesView<double> data, size_t window) {
     std::vector<double> result(data.size(), std::numeric_limits<double>::quiet_NaN());
-    
-    for (size_t i = window - 1; i < data.size(); ++i) {
-        double sum = 0.0;
-        for (size_t j = i - window + 1; j <= i; ++j) {
-            sum += data[j];
-        }
-        result[i] = sum / window;
+    if (window > 0 && data.size() >= window) {
+        rollingPass(data, window, result.data(), nullptr, nullptr);
     }
-    
     return result;
 }
 
-std::vector<double> rollingStdDev(const std::vector<double>& data, size_t window) {
-    if (data.size() < window) {
-        return std::vector<double>(data.size(), std::numeric_limits<double>::quiet_NaN());
+std::vector<double> rollingStdDev(SeriesView<double> data, size_t window) {
+    std::vector<double> result(data.size(), std::numeric_limits<double>::quiet_NaN());
+    if (window > 0 && data.size() >= window) {
+        rollingPass(data, window, nullptr, result.data(), nullptr);
     }
-    
+    return result;
+}
+
+std::vector<double> rollingZScore(SeriesView<double> data, size_t window) {
     std::vector<double> result(data.size(), std::numeric_limits<double>::quiet_NaN());
-    
-    for (size_t i = window - 1; i < data.size(); ++i) {
-        std::vector<double> window_data(data.begin() + (i - window + 1), data.begin() + i + 1);
-        result[i] = standardDeviation(window_data);
+    if (window > 0 && data.size() >= window) {
+        rollingPass(data, window, nullptr, nullptr, result.data());
     }
-    
     return result;
 }
 
-std::vector<double> rollingZScore(const std::vector<double>& data, size_t window) {
-    if (data.size() < window) {
-        return std::vector<double>(data.size(), std::numeric_limits<double>::quiet_NaN());
+RegressionSums regressionSums(SeriesView<double> x, SeriesView<double> y) {
+    RegressionSums sums;
+    sums.n = static_cast<double>(x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+        sums.sumX += x[i];
+        sums.sumY += y[i];
+        sums.sumXY += x[i] * y[i];
+        sums.sumXX += x[i] * x[i];
+        sums.sumYY += y[i] * y[i];
     }
+    return sums;
+}
+
+RegressionResult regressionFromSums(const RegressionSums& sums) {
+    double n = sums.n;
+    double denominator = n * sums.sumXX - sums.sumX * sums.sumX;
     
-    std::vector<double> means = rollingMean(data, window);
-    std::vector<double> stdDevs = rollingStdDev(data, window);
+    // A regressor whose dispersion is below the cancellation error of the
+    // raw sums is constant; its "slope" would be rounding noise
+    if (n == 0 || !(denominator > 1e-12 * n * sums.sumXX)) {
+        return {0, 0, 0, {}};
+    }
     
-    std::vector<double> zScores(data.size(), std::numeric_limits<double>::quiet_NaN());
+    double covariance = n * sums.sumXY - sums.sumX * sums.sumY;
+    double beta = covariance / denominator;
+    double alpha = (sums.sumY - beta * sums.sumX) / n;
     
-    for (size_t i = window - 1; i < data.size(); ++i) {
-        if (stdDevs[i] > 0) {
-            zScores[i] = (data[i] - means[i]) / stdDevs[i];
-        }
+    double varianceY = n * sums.sumYY - sums.sumY * sums.sumY;
+    double rsquared = 0.0;
+    if (varianceY > 0) {
+        rsquared = (covariance * covariance) / (denominator * varianceY);
     }
     
-    return zScores;
+    return {alpha, beta, rsquared, {}};
+}
+
+double dotProduct(SeriesView<double> x, SeriesView<double> y) {
+    // Four independent accumulators break the add dependency chain
+    const size_t n = std::min(x.size(), y.size());
+    double acc0 = 0.0, acc1 = 0.0, acc2 = 0.0, acc3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += x[i] * y[i];
+        acc1 += x[i + 1] * y[i + 1];
+        acc2 += x[i + 2] * y[i + 2];
+        acc3 += x[i + 3] * y[i + 3];
+    }
+    for (; i < n; ++i) {
+        acc0 += x[i] * y[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
 }
 
-RegressionResult linearRegression(const std::vector<double>& x, const std::vector<double>& y) {
+RegressionResult linearRegression(SeriesView<double> x, SeriesView<double> y) {
     if (x.size() != y.size() || x.empty()) {
         return {0, 0, 0, {}};
     }
     
-    double sum_x = 0.0, sum_y = 0.0, sum_xy = 0.0, sum_xx = 0.0, sum_yy = 0.0;
-    
-    for (size_t i = 0; i < x.size(); ++i) {
-        sum_x += x[i];
-        sum_y += y[i];
-        sum_xy += x[i] * y[i];
-        sum_xx += x[i] * x[i];
-        sum_yy += y[i] * y[i];
-    }
-    
-    double n = static_cast<double>(x.size());
-    double denominator = n * sum_xx - sum_x * sum_x;
-    
-    if (denominator == 0) {
+    RegressionSums sums = regressionSums(x, y);
+    double n = sums.n;
+    if (n * sums.sumXX - sums.sumX * sums.sumX == 0) {
         return {0, 0, 0, {}};
     }
     
-    double beta = (n * sum_xy - sum_x * sum_y) / denominator;
-    double alpha = (sum_y - beta * sum_x) / n;
+    RegressionResult fit = regressionFromSums(sums);
+    double alpha = fit.alpha;
+    double beta = fit.beta;
     
     // Calculate residuals and R-squared
     std::vector<double> residuals(x.size());
@@ -128,7 +189,7 @@ RegressionResult linearRegression(const std::vector<double>& x, const std::vecto
     for (size_t i = 0; i < x.size(); ++i) {
         double predicted = alpha + beta * x[i];
         residuals[i] = y[i] - predicted;
-        ss_total += (y[i] - sum_y / n) * (y[i] - sum_y / n);
+        ss_total += (y[i] - sums.sumY / n) * (y[i] - sums.sumY / n);
         ss_residual += residuals[i] * residuals[i];
     }
     
@@ -140,54 +201,348 @@ RegressionResult linearRegression(const std::vector<double>& x, const std::vecto
     return {alpha, beta, rsquared, residuals};
 }
 
-AdfResult adfTest(const std::vector<double>& timeSeries, int maxLags) {
-    // This is a simplified ADF test implementation
-    // In a real-world scenario, consider using an established econometrics library
+namespace {
+
+constexpr int kMaxAdfTerms = kMaxAdfLags + 2;
+constexpr int kPackedAdfTerms = kMaxAdfTerms * (kMaxAdfTerms + 1) / 2;
+
+// Normal equations of one ADF regression; regressors are ordered
+// [1, y_{t-1}, dy_{t-1}, ..., dy_{t-p}] so every lower order is a leading block
+struct AdfSums {
+    double xtx[kMaxAdfTerms][kMaxAdfTerms];
+    double xty[kMaxAdfTerms];
+    double yty;
+};
+
+// Accumulate X'X, X'y and y'y for Lanes interleaved series. The level
+// regressor is shifted by each lane's first value, which leaves g and its
+// t-ratio unchanged (the intercept absorbs it) but keeps X'X well conditioned.
+template <size_t Lanes>
+void accumulateAdf(const double* data, size_t length, int lags, AdfSums* sums) {
+    const int terms = lags + 2;
+    double xtx[kPackedAdfTerms][Lanes] = {};
+    double xty[kMaxAdfTerms][Lanes] = {};
+    double yty[Lanes] = {};
+    double shift[Lanes];
+    for (size_t l = 0; l < Lanes; ++l) {
+        shift[l] = data[l];
+    }
     
-    // Ensure we have enough data
-    if (timeSeries.size() < 20) {
-        return {0.0, 1.0, false};
+    double x[kMaxAdfTerms][Lanes];
+    double dy[Lanes];
+    for (size_t l = 0; l < Lanes; ++l) {
+        x[0][l] = 1.0;
     }
     
-    // Create differenced series (y_t - y_{t-1})
-    std::vector<double> diff(timeSeries.size() - 1);
-    for (size_t i = 1; i < timeSeries.size(); ++i) {
-        diff[i-1] = timeSeries[i] - timeSeries[i-1];
+    for (size_t t = static_cast<size_t>(lags) + 1; t < length; ++t) {
+        const double* cur = data + t * Lanes;
+        const double* prev = cur - Lanes;
+        for (size_t l = 0; l < Lanes; ++l) {
+            dy[l] = cur[l] - prev[l];
+            x[1][l] = prev[l] - shift[l];
+        }
+        for (int i = 1; i <= lags; ++i) {
+            const double* a = data + (t - i) * Lanes;
+            const double* b = a - Lanes;
+            for (size_t l = 0; l < Lanes; ++l) {
+                x[1 + i][l] = a[l] - b[l];
+            }
+        }
+        
+        int k = 0;
+        for (int r = 0; r < terms; ++r) {
+            for (int c = r; c < terms; ++c, ++k) {
+                for (size_t l = 0; l < Lanes; ++l) {
+                    xtx[k][l] += x[r][l] * x[c][l];
+                }
+            }
+            for (size_t l = 0; l < Lanes; ++l) {
+                xty[r][l] += x[r][l] * dy[l];
+            }
+        }
+        for (size_t l = 0; l < Lanes; ++l) {
+            yty[l] += dy[l] * dy[l];
+        }
     }
     
-    // Create lagged series (y_{t-1})
-    std::vector<double> lagged(timeSeries.size() - 1);
-    for (size_t i = 0; i < timeSeries.size() - 1; ++i) {
-        lagged[i] = timeSeries[i];
+    for (size_t l = 0; l < Lanes; ++l) {
+        int k = 0;
+        for (int r = 0; r < terms; ++r) {
+            for (int c = r; c < terms; ++c, ++k) {
+                sums[l].xtx[r][c] = xtx[k][l];
+                sums[l].xtx[c][r] = xtx[k][l];
+            }
+            sums[l].xty[r] = xty[r][l];
+        }
+        sums[l].yty = yty[l];
+    }
+}
+
+// Solve the accumulated regression. One Cholesky factor X'X = LL' serves
+// every lag order: with z = L^-1 X'y and w = L^-1 e_1 (both prefix-valid),
+// order k has g = sum w_i z_i, SSR = y'y - sum z_i^2 and
+// [(X'X)^-1]_11 = sum w_i^2 over i < k.
+AdfResult solveAdf(AdfSums& sums, size_t numObs, int maxLags,
+                   double significanceLevel, bool selectLags) {
+    AdfResult result;
+    result.lags = maxLags;
+    const int terms = maxLags + 2;
+    double (&L)[kMaxAdfTerms][kMaxAdfTerms] = sums.xtx;
+    
+    // In-place Cholesky; stop at the first non-positive pivot
+    int factored = 0;
+    for (int j = 0; j < terms; ++j) {
+        double d = L[j][j];
+        for (int k = 0; k < j; ++k) {
+            d -= L[j][k] * L[j][k];
+        }
+        if (!(d > 1e-12 * sums.xtx[j][j])) {
+            break;
+        }
+        L[j][j] = std::sqrt(d);
+        for (int i = j + 1; i < terms; ++i) {
+            double v = L[i][j];
+            for (int k = 0; k < j; ++k) {
+                v -= L[i][k] * L[j][k];
+            }
+            L[i][j] = v / L[j][j];
+        }
+        factored = j + 1;
+    }
+    if (factored < 2) {
+        return result;
     }
     
-    // Run regression: diff ~ alpha + beta*lagged
-    auto regression = linearRegression(lagged, diff);
+    double z[kMaxAdfTerms];
+    double w[kMaxAdfTerms];
+    for (int i = 0; i < factored; ++i) {
+        double zi = sums.xty[i];
+        double wi = (i == 1) ? 1.0 : 0.0;
+        for (int k = 0; k < i; ++k) {
+            zi -= L[i][k] * z[k];
+            wi -= L[i][k] * w[k];
+        }
+        z[i] = zi / L[i][i];
+        w[i] = wi / L[i][i];
+    }
     
-    // Calculate t-statistic
-    double beta = regression.beta;
-    double se = 0.0;
+    const double n = static_cast<double>(numObs);
+    double gamma = w[0] * z[0];
+    double inverse = w[0] * w[0];
+    double explained = z[0] * z[0];
+    double bestAic = std::numeric_limits<double>::infinity();
+    bool found = false;
+    for (int k = 1; k < factored; ++k) {
+        gamma += w[k] * z[k];
+        inverse += w[k] * w[k];
+        explained += z[k] * z[k];
+        const int order = k - 1;
+        if (!selectLags && order != maxLags) {
+            continue;
+        }
+        
+        const double ssr = sums.yty - explained;
+        const double dof = n - (k + 1);
+        if (!(ssr > 0) || dof < 1) {
+            continue;
+        }
+        const double aic = n * std::log(ssr / n) + 2.0 * (k + 1);
+        if (selectLags && aic >= bestAic) {
+            continue;
+        }
+        bestAic = aic;
+        result.testStatistic = gamma / std::sqrt(ssr / dof * inverse);
+        result.lags = order;
+        found = true;
+    }
+    if (!found) {
+        result.testStatistic = 0.0;
+        result.lags = maxLags;
+        return result;
+    }
     
-    for (const auto& residual : regression.residuals) {
-        se += residual * residual;
+    result.pValue = adfPValue(result.testStatistic);
+    result.isStationary = result.pValue < significanceLevel;
+    return result;
+}
+
+bool adfUsable(size_t length, int maxLags) {
+    // Keep the original 20-bar floor and leave room for the regressors
+    return maxLags >= 0 && maxLags <= kMaxAdfLags && length >= 20 &&
+           length > static_cast<size_t>(2 * maxLags + 4);
+}
+
+} // namespace
+
+double adfPValue(double testStatistic) {
+    // MacKinnon (1994) response surface, one variable, constant only
+    const double tauMax = 2.74;
+    const double tauMin = -18.83;
+    const double tauStar = -1.61;
+    if (testStatistic > tauMax) {
+        return 1.0;
+    }
+    if (testStatistic < tauMin) {
+        return 0.0;
     }
     
-    se = std::sqrt(se / (regression.residuals.size() - 2));
-    se = se / std::sqrt(std::accumulate(lagged.begin(), lagged.end(), 0.0, 
-                                      [](double sum, double val) { return sum + val * val; }));
+    const double t = testStatistic;
+    double z;
+    if (t <= tauStar) {
+        z = 2.1659 + t * (1.4412 + t * 0.038269);
+    } else {
+        z = 1.7339 + t * (0.93202 + t * (-0.12745 + t * -0.010368));
+    }
+    return 0.5 * std::erfc(-z / std::sqrt(2.0));
+}
+
+AdfResult adfTest(SeriesView<double> timeSeries, int maxLags, double significanceLevel, bool selectLags) {
+    if (!adfUsable(timeSeries.size(), maxLags)) {
+        return {0.0, 1.0, false, std::max(maxLags, 0)};
+    }
     
-    double tStat = beta / se;
+    AdfSums sums;
+    accumulateAdf<1>(timeSeries.data(), timeSeries.size(), maxLags, &sums);
+    return solveAdf(sums, timeSeries.size() - 1 - maxLags, maxLags, significanceLevel, selectLags);
+}
+
+void adfTestBatch(const double* interleaved, size_t length, size_t numSeries,
+                  AdfResult* results, int maxLags, double significanceLevel, bool selectLags) {
+    numSeries = std::min(numSeries, kAdfBatchLanes);
+    if (!adfUsable(length, maxLags)) {
+        for (size_t l = 0; l < numSeries; ++l) {
+            results[l] = {0.0, 1.0, false, std::max(maxLags, 0)};
+        }
+        return;
+    }
     
-    // Critical values (approximate) for 5% significance
-    const double criticalValue = -2.86;
+    AdfSums sums[kAdfBatchLanes];
+    accumulateAdf<kAdfBatchLanes>(interleaved, length, maxLags, sums);
+    for (size_t l = 0; l < numSeries; ++l) {
+        results[l] = solveAdf(sums[l], length - 1 - maxLags, maxLags, significanceLevel, selectLags);
+    }
+}
+
+SlidingCointegration::SlidingCointegration(SeriesView<double> a, SeriesView<double> b, int lags)
+    : a_(a), b_(b), lags_(std::clamp(lags, 0, kMaxLags)), numMoments_(2 * lags_ + 5)
+{
+    size_t n = std::min(a_.size(), b_.size());
+    a_ = a_.first(n);
+    b_ = b_.first(n);
+}
+
+void SlidingCointegration::setWindow(size_t begin, size_t end) {
+    end = std::min(end, a_.size());
+    begin = std::min(begin, end);
+    
+    // A window's first ADF observation needs lags + 1 earlier bars
+    const size_t skip = static_cast<size_t>(lags_) + 1;
+    auto firstObservation = [skip](size_t b, size_t e) { return std::min(b + skip, e); };
+    
+    bool overlaps = begin_ < end_ && begin >= begin_ && end >= end_ && begin < end_;
+    if (!overlaps) {
+        regression_ = RegressionSums();
+        std::fill(&moments_[0][0], &moments_[0][0] + kMaxMoments * kMaxMoments, 0.0);
+        numObs_ = 0;
+        updateBars(begin, end, 1.0);
+        updateObservations(firstObservation(begin, end), end, 1.0);
+    } else {
+        // Observations move from [oldFirst, end_) to [newFirst, end)
+        size_t oldFirst = firstObservation(begin_, end_);
+        size_t newFirst = firstObservation(begin, end);
+        updateBars(begin_, begin, -1.0);
+        updateBars(end_, end, 1.0);
+        updateObservations(oldFirst, std::min(newFirst, end_), -1.0);
+        updateObservations(std::max(newFirst, end_), end, 1.0);
+    }
+    begin_ = begin;
+    end_ = end;
+}
+
+void SlidingCointegration::updateBars(size_t first, size_t last, double sign) {
+    for (size_t t = first; t < last; ++t) {
+        double x = b_[t] - b_[0];
+        double y = a_[t] - a_[0];
+        regression_.n += sign;
+        regression_.sumX += sign * x;
+        regression_.sumY += sign * y;
+        regression_.sumXX += sign * x * x;
+        regression_.sumXY += sign * x * y;
+        regression_.sumYY += sign * y * y;
+    }
+}
+
+void SlidingCointegration::updateObservations(size_t first, size_t last, double sign) {
+    const int m = numMoments_;
+    double u[kMaxMoments];
+    u[0] = 1.0;
+    for (size_t t = first; t < last; ++t) {
+        u[1] = a_[t - 1] - a_[0];
+        u[2] = b_[t - 1] - b_[0];
+        for (int i = 1; i <= lags_; ++i) {
+            u[1 + 2 * i] = a_[t - i] - a_[t - i - 1];
+            u[2 + 2 * i] = b_[t - i] - b_[t - i - 1];
+        }
+        u[m - 2] = a_[t] - a_[t - 1];
+        u[m - 1] = b_[t] - b_[t - 1];
+        
+        for (int r = 0; r < m; ++r) {
+            double scaled = sign * u[r];
+            for (int c = r; c < m; ++c) {
+                moments_[r][c] += scaled * u[c];
+            }
+        }
+        numObs_ = (sign > 0) ? numObs_ + 1 : numObs_ - 1;
+    }
+}
+
+double SlidingCointegration::beta() const {
+    return regressionFromSums(regression_).beta;
+}
+
+AdfResult SlidingCointegration::adfTest(double beta, double significanceLevel) const {
+    if (!adfUsable(end_ - begin_, lags_)) {
+        return {0.0, 1.0, false, lags_};
+    }
     
-    // Create result
-    AdfResult result;
-    result.testStatistic = tStat;
-    result.pValue = 0.05;  // Simplified; real implementation would compute actual p-value
-    result.isStationary = (tStat < criticalValue);
+    // Spread regressors [1, s_{t-1}, ds_{t-1}, ..., ds_{t-p}] and then ds_t, each
+    // as (moment of the a leg) - beta * (moment of the b leg); the constant has no b part
+    const int terms = lags_ + 2;
+    int legA[kMaxAdfTerms + 1];
+    int legB[kMaxAdfTerms + 1];
+    legA[0] = 0;
+    legB[0] = -1;
+    for (int i = 0; i <= lags_; ++i) {
+        legA[1 + i] = 1 + 2 * i;
+        legB[1 + i] = 2 + 2 * i;
+    }
+    legA[terms] = numMoments_ - 2;
+    legB[terms] = numMoments_ - 1;
+    
+    auto moment = [this](int r, int c) { return r <= c ? moments_[r][c] : moments_[c][r]; };
+    auto cross = [&](int r, int c) {
+        double v = moment(legA[r], legA[c]);
+        if (legB[c] >= 0) {
+            v -= beta * moment(legA[r], legB[c]);
+        }
+        if (legB[r] >= 0) {
+            v -= beta * moment(legB[r], legA[c]);
+            if (legB[c] >= 0) {
+                v += beta * beta * moment(legB[r], legB[c]);
+            }
+        }
+        return v;
+    };
     
-    return result;
+    AdfSums sums;
+    for (int r = 0; r < terms; ++r) {
+        for (int c = 0; c < terms; ++c) {
+            sums.xtx[r][c] = cross(r, c);
+        }
+        sums.xty[r] = cross(r, terms);
+    }
+    sums.yty = cross(terms, terms);
+    return solveAdf(sums, numObs_, lags_, significanceLevel, false);
 }
 
 bool writeCSV(const std::string& filename, 
@@ -197,32 +552,191 @@ bool writeCSV(const std::string& filename,
         return false;
     }
     
-    std::ofstream file(filename);
-    if (!file.is_open()) {
+    CsvWriter writer;
+    if (!writer.open(filename)) {
         return false;
     }
     
-    // Write header
-    for (size_t i = 0; i < headers.size(); ++i) {
-        file << headers[i];
-        if (i < headers.size() - 1) {
-            file << ",";
+    writer.header(headers);
+    for (const auto& row : data) {
+        for (double value : row) {
+            writer.field(value);
         }
+        writer.endRow();
+    }
+    
+    return writer.close();
+}
+
+namespace {
+
+// Longest field to_chars can produce (shortest round-trip double or int64)
+constexpr size_t kMaxFieldChars = 32;
+
+constexpr char kColumnarMagic[8] = {'S', 'A', 'C', 'O', 'L', '0', '0', '1'};
+constexpr uint32_t kColumnarVersion = 1;
+constexpr size_t kColumnarAlign = 64;
+constexpr size_t kColumnNameBytes = 48;
+
+size_t columnWidth(ColumnType type) {
+    return type == ColumnType::Int32 ? 4 : 8;
+}
+
+size_t alignUp(size_t offset) {
+    return (offset + kColumnarAlign - 1) / kColumnarAlign * kColumnarAlign;
+}
+
+template <typename T>
+void putRaw(std::vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+} // namespace
+
+CsvWriter::CsvWriter(size_t bufferSize)
+    : buffer_(std::max(bufferSize, 2 * kMaxFieldChars))
+{
+}
+
+bool CsvWriter::open(const std::string& filename) {
+    close();
+    file_.clear();
+    file_.open(filename, std::ios::binary);
+    used_ = 0;
+    rowStart_ = true;
+    return file_.is_open();
+}
+
+char* CsvWriter::reserve(size_t bytes) {
+    if (used_ + bytes > buffer_.size()) {
+        flush();
+    }
+    return buffer_.data() + used_;
+}
+
+void CsvWriter::separate() {
+    if (!rowStart_) {
+        *reserve(1) = ',';
+        ++used_;
+    }
+    rowStart_ = false;
+}
+
+void CsvWriter::field(double value) {
+    separate();
+    char* out = reserve(kMaxFieldChars);
+    used_ = std::to_chars(out, buffer_.data() + buffer_.size(), value).ptr - buffer_.data();
+}
+
+void CsvWriter::field(int64_t value) {
+    separate();
+    char* out = reserve(kMaxFieldChars);
+    used_ = std::to_chars(out, buffer_.data() + buffer_.size(), value).ptr - buffer_.data();
+}
+
+void CsvWriter::field(const std::string& value) {
+    separate();
+    if (value.size() > buffer_.size()) {
+        flush();
+        file_.write(value.data(), static_cast<std::streamsize>(value.size()));
+        return;
+    }
+    std::copy(value.begin(), value.end(), reserve(value.size()));
+    used_ += value.size();
+}
+
+void CsvWriter::header(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        field(name);
+    }
+    endRow();
+}
+
+void CsvWriter::endRow() {
+    *reserve(1) = '\n';
+    ++used_;
+    rowStart_ = true;
+}
+
+void CsvWriter::flush() {
+    if (used_ > 0 && file_.is_open()) {
+        file_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+    }
+    used_ = 0;
+}
+
+bool CsvWriter::close() {
+    if (!file_.is_open()) {
+        return false;
+    }
+    flush();
+    file_.close();
+    return !file_.fail();
+}
+
+bool writeColumnar(const std::string& filename, size_t numRows,
+                   const std::vector<ColumnSpec>& columns) {
+    if (columns.empty()) {
+        return false;
+    }
+    
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
     }
-    file << "\n";
     
-    // Write data
-    for (size_t row = 0; row < data.size(); ++row) {
-        for (size_t col = 0; col < data[row].size(); ++col) {
-            file << data[row][col];
-            if (col < data[row].size() - 1) {
-                file << ",";
+    // Header and column directory
+    std::vector<char> head(kColumnarMagic, kColumnarMagic + sizeof(kColumnarMagic));
+    putRaw(head, kColumnarVersion);
+    putRaw(head, static_cast<uint32_t>(columns.size()));
+    putRaw(head, static_cast<uint64_t>(numRows));
+    
+    size_t offset = alignUp(head.size() + columns.size() * (kColumnNameBytes + 16));
+    std::vector<size_t> offsets;
+    for (const auto& column : columns) {
+        char name[kColumnNameBytes] = {};
+        column.name.copy(name, kColumnNameBytes - 1);
+        head.insert(head.end(), name, name + kColumnNameBytes);
+        putRaw(head, static_cast<uint32_t>(column.type));
+        putRaw(head, uint32_t(0));
+        putRaw(head, static_cast<uint64_t>(offset));
+        offsets.push_back(offset);
+        offset = alignUp(offset + numRows * columnWidth(column.type));
+    }
+    head.resize(offsets[0], 0);
+    file.write(head.data(), static_cast<std::streamsize>(head.size()));
+    
+    // Gather strided rows into a block buffer so each column is one run of writes
+    std::vector<char> block(1 << 20);
+    size_t written = head.size();
+    for (size_t c = 0; c < columns.size(); ++c) {
+        const ColumnSpec& column = columns[c];
+        const size_t width = columnWidth(column.type);
+        const size_t stride = column.stride ? column.stride : width;
+        const char* src = static_cast<const char*>(column.data);
+        const size_t rowsPerBlock = block.size() / width;
+        
+        std::fill(block.begin(), block.begin() + (offsets[c] - written), 0);
+        file.write(block.data(), static_cast<std::streamsize>(offsets[c] - written));
+        
+        for (size_t r0 = 0; r0 < numRows; r0 += rowsPerBlock) {
+            const size_t r1 = std::min(numRows, r0 + rowsPerBlock);
+            for (size_t r = r0; r < r1; ++r) {
+                std::memcpy(block.data() + (r - r0) * width, src + r * stride, width);
             }
+            file.write(block.data(), static_cast<std::streamsize>((r1 - r0) * width));
         }
-        file << "\n";
+        written = offsets[c] + numRows * width;
     }
     
-    return true;
+    return !file.fail();
+}
+
+bool isColumnarPath(const std::string& filename) {
+    const std::string extension = ".sacol";
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
 }
 
 void printVector(const std::vector<double>& vec, const std::string& label) {
@@ -0,0 +1,114 @@
+#include "Validity.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+using Validity::kBitsPerWord;
+using Validity::Word;
+
+// Index of the lowest / highest set bit of a non-zero word
+inline size_t lowestBit(Word word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+}
+
+inline size_t highestBit(Word word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return index;
+#else
+    return kBitsPerWord - 1 - static_cast<size_t>(__builtin_clzll(word));
+#endif
+}
+
+inline size_t popCount(Word word) {
+#if defined(_MSC_VER)
+    return static_cast<size_t>(__popcnt64(word));
+#else
+    return static_cast<size_t>(__builtin_popcountll(word));
+#endif
+}
+
+// First bit in [begin, end) equal to `value` in the bitmap whose w-th word is wordAt(w)
+template <typename WordAt>
+size_t findIn(WordAt&& wordAt, size_t begin, size_t end, bool value) {
+    size_t i = begin;
+    while (i < end) {
+        const size_t w = i / kBitsPerWord;
+        Word word = value ? wordAt(w) : ~wordAt(w);
+        word &= ~Word(0) << (i % kBitsPerWord);
+        if (word != 0) {
+            return std::min(end, w * kBitsPerWord + lowestBit(word));
+        }
+        i = (w + 1) * kBitsPerWord;
+    }
+    return end;
+}
+
+template <typename WordAt>
+void runsIn(WordAt&& wordAt, size_t begin, size_t end, std::vector<Validity::Range>& runs) {
+    size_t i = begin;
+    while (i < end) {
+        const size_t start = findIn(wordAt, i, end, true);
+        if (start == end) {
+            break;
+        }
+        i = findIn(wordAt, start, end, false);
+        runs.emplace_back(start, i);
+    }
+}
+
+} // namespace
+
+namespace Validity {
+
+size_t count(const Word* bits, size_t numWords) {
+    size_t total = 0;
+    for (size_t w = 0; w < numWords; ++w) {
+        total += popCount(bits[w]);
+    }
+    return total;
+}
+
+size_t find(const Word* bits, size_t begin, size_t end, bool value) {
+    return findIn([bits](size_t w) { return bits[w]; }, begin, end, value);
+}
+
+size_t findLast(const Word* bits, size_t begin, size_t end) {
+    size_t i = end;
+    while (i > begin) {
+        const size_t w = (i - 1) / kBitsPerWord;
+        Word word = bits[w];
+        // Keep bits below i
+        const size_t top = i - w * kBitsPerWord;
+        if (top < kBitsPerWord) {
+            word &= (Word(1) << top) - 1;
+        }
+        if (word != 0) {
+            const size_t last = w * kBitsPerWord + highestBit(word);
+            return last >= begin ? last : end;
+        }
+        i = w * kBitsPerWord;
+    }
+    return end;
+}
+
+void runs(const Word* bits, size_t begin, size_t end, std::vector<Range>& runs) {
+    runsIn([bits](size_t w) { return bits[w]; }, begin, end, runs);
+}
+
+void runs(const Word* a, const Word* b, size_t begin, size_t end, std::vector<Range>& runs) {
+    runsIn([a, b](size_t w) { return a[w] & b[w]; }, begin, end, runs);
+}
+
+} // namespace Validity
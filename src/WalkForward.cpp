@@ -0,0 +1,253 @@
+#include "WalkForward.h"
+#include "AssetPair.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Candidate pairs per screening task
+constexpr size_t kScreenGrain = 16;
+
+} // namespace
+
+WalkForward::WalkForward(std::shared_ptr<MarketData> marketData, Options options)
+    : marketData_(std::move(marketData)), options_(options)
+{
+    const size_t n = marketData_->getNumSymbols();
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) {
+            candidates_.emplace_back(static_cast<MarketData::SymbolId>(i),
+                                     static_cast<MarketData::SymbolId>(j));
+        }
+    }
+}
+
+WalkForward::WalkForward(std::shared_ptr<MarketData> marketData,
+                         std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> candidates,
+                         Options options)
+    : marketData_(std::move(marketData)), candidates_(std::move(candidates)), options_(options)
+{
+}
+
+size_t WalkForward::numFolds() const {
+    const size_t numDays = marketData_->getDataSize();
+    if (options_.testBars == 0 || numDays < options_.trainBars + options_.testBars) {
+        return 0;
+    }
+    return (numDays - options_.trainBars) / options_.testBars;
+}
+
+bool WalkForward::parseSpec(const std::string& spec, Options& options) {
+    std::stringstream stream(spec);
+    std::string token;
+    try {
+        while (std::getline(stream, token, ',')) {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos) {
+                std::cerr << "Error: Malformed walk-forward spec: " << spec << std::endl;
+                return false;
+            }
+            std::string key = token.substr(0, eq);
+            size_t value = std::stoul(token.substr(eq + 1));
+            if (key == "train") {
+                options.trainBars = value;
+            } else if (key == "test") {
+                options.testBars = value;
+            } else {
+                std::cerr << "Error: Unknown walk-forward parameter: " << key << std::endl;
+                return false;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Could not parse walk-forward spec: " << spec << std::endl;
+        return false;
+    }
+
+    if (options.testBars == 0 || options.trainBars < options.lookbackWindow) {
+        std::cerr << "Error: Walk-forward needs test > 0 and train >= the lookback window" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<WalkForward::Screen> WalkForward::screenFolds(ThreadPool& pool, size_t numFolds) const {
+    STATARB_PROFILE_SCOPE("WalkForward::screen");
+    std::vector<Screen> screens(candidates_.size() * numFolds);
+    pool.parallelFor(0, candidates_.size(), kScreenGrain, [&](size_t begin, size_t end, size_t) {
+        std::vector<Validity::Range> ranges;
+        std::vector<Validity::Range> windowRanges;
+        std::vector<double> alignedA, alignedB, spread;
+        for (size_t c = begin; c < end; ++c) {
+            const MarketData::SymbolId a = candidates_[c].first;
+            const MarketData::SymbolId b = candidates_[c].second;
+            if (!marketData_->isComplete(a) || !marketData_->isComplete(b)) {
+                // A pair with gaps is screened on the bars of each formation
+                // window it is aligned on under the fill policy
+                marketData_->alignPair(a, b, ranges);
+                for (size_t k = 0; k < numFolds; ++k) {
+                    const size_t trainBegin = k * options_.testBars;
+                    const size_t trainEnd = trainBegin + options_.trainBars;
+                    windowRanges.clear();
+                    for (const auto& range : ranges) {
+                        const size_t first = std::max(range.first, trainBegin);
+                        const size_t last = std::min(range.second, trainEnd);
+                        if (first < last) windowRanges.emplace_back(first, last);
+                    }
+                    Screen& screen = screens[c * numFolds + k];
+                    const size_t length = Validity::length(windowRanges);
+                    if (length <= 2 * AssetPair::kAdfLags + 4) {
+                        continue;
+                    }
+                    alignedA.resize(length);
+                    alignedB.resize(length);
+                    marketData_->gatherPrices(a, windowRanges, alignedA.data());
+                    marketData_->gatherPrices(b, windowRanges, alignedB.data());
+                    const PriceView pricesA(alignedA);
+                    const PriceView pricesB(alignedB);
+                    screen.beta = Utilities::regressionFromSums(Utilities::regressionSums(pricesB, pricesA)).beta;
+                    auto result = AssetPair::evaluateSpread(pricesA, pricesB, screen.beta, spread,
+                                                            options_.significanceLevel);
+                    screen.adfStatistic = result.adfStatistic;
+                    screen.pValue = result.pValue;
+                    screen.accepted = result.isCointegrated;
+                }
+                continue;
+            }
+            
+            Utilities::SlidingCointegration window(marketData_->getPrices(a), marketData_->getPrices(b),
+                                                   AssetPair::kAdfLags);
+            // Each fold moves the formation window on by testBars
+            for (size_t k = 0; k < numFolds; ++k) {
+                size_t trainBegin = k * options_.testBars;
+                window.setWindow(trainBegin, trainBegin + options_.trainBars);
+
+                Screen& screen = screens[c * numFolds + k];
+                screen.beta = window.beta();
+                auto adf = window.adfTest(screen.beta, options_.significanceLevel);
+                screen.adfStatistic = adf.testStatistic;
+                screen.pValue = adf.pValue;
+                screen.accepted = adf.isStationary;
+            }
+        }
+    });
+    STATARB_PROFILE_COUNT(PairsTested, candidates_.size() * numFolds);
+    return screens;
+}
+
+void WalkForward::tradeFold(Fold& fold) const {
+    if (fold.pairs.empty()) {
+        fold.portfolioValues.assign(fold.testEnd - fold.testBegin, options_.initialCapital);
+        return;
+    }
+
+    // Only the traded legs, from the z-score warm-up to the end of the trading period
+    std::vector<MarketData::SymbolId> legs;
+    for (const auto& pair : fold.pairs) {
+        legs.push_back(pair.symbolA);
+        legs.push_back(pair.symbolB);
+    }
+    std::sort(legs.begin(), legs.end());
+    legs.erase(std::unique(legs.begin(), legs.end()), legs.end());
+
+    const size_t warmup = options_.lookbackWindow;
+    auto window = std::make_shared<MarketData>(
+        marketData_->slice(fold.testBegin - warmup, fold.testEnd, legs));
+
+    Backtester backtester(window);
+    backtester.setVerbose(false);
+    backtester.setCostModel(options_.costs);
+    for (const auto& pair : fold.pairs) {
+        backtester.addPair(marketData_->getSymbol(pair.symbolA), marketData_->getSymbol(pair.symbolB),
+                           pair.beta);
+    }
+    // The first bar past the warm-up is the first trading bar
+    backtester.runBacktest(options_.initialCapital, options_.entryThreshold, options_.exitThreshold,
+                           warmup, options_.delayedExecution);
+
+    fold.metrics = backtester.getPerformanceMetrics();
+    fold.numTrades = backtester.getTradeHistory().size();
+    const auto& values = backtester.getPortfolioValues();
+    fold.portfolioValues.assign(values.begin() + warmup, values.end());
+}
+
+std::vector<WalkForward::Fold> WalkForward::run() const {
+    STATARB_PROFILE_SCOPE("WalkForward::run");
+    const size_t count = numFolds();
+    if (count == 0 || options_.trainBars < options_.lookbackWindow) {
+        std::cerr << "Error: Not enough data for one walk-forward fold of " << options_.trainBars
+                  << " + " << options_.testBars << " bars" << std::endl;
+        return {};
+    }
+
+    ThreadPool pool(options_.numThreads);
+    const std::vector<Screen> screens = screenFolds(pool, count);
+
+    std::vector<Fold> folds(count);
+    for (size_t k = 0; k < count; ++k) {
+        Fold& fold = folds[k];
+        fold.trainBegin = k * options_.testBars;
+        fold.testBegin = fold.trainBegin + options_.trainBars;
+        fold.testEnd = fold.testBegin + options_.testBars;
+        for (size_t c = 0; c < candidates_.size(); ++c) {
+            const Screen& screen = screens[c * count + k];
+            if (!screen.accepted) {
+                continue;
+            }
+            PairCandidate candidate;
+            candidate.symbolA = candidates_[c].first;
+            candidate.symbolB = candidates_[c].second;
+            candidate.beta = screen.beta;
+            candidate.adfStatistic = screen.adfStatistic;
+            candidate.pValue = screen.pValue;
+            fold.pairs.push_back(candidate);
+        }
+    }
+
+    // Trading periods are independent given the screen
+    STATARB_PROFILE_SCOPE("WalkForward::trade");
+    pool.parallelFor(0, count, 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t k = begin; k < end; ++k) {
+            tradeFold(folds[k]);
+        }
+    });
+    return folds;
+}
+
+double WalkForward::compoundedReturn(const std::vector<Fold>& folds) {
+    double growth = 1.0;
+    for (const auto& fold : folds) {
+        growth *= 1.0 + fold.metrics.totalReturn;
+    }
+    return growth - 1.0;
+}
+
+bool WalkForward::exportResults(const std::string& filename, const std::vector<Fold>& folds,
+                                const MarketData& marketData) {
+    const auto& timestamps = marketData.getTimestamps();
+    Utilities::CsvWriter writer;
+    if (!writer.open(filename)) {
+        return false;
+    }
+    writer.header({"Fold", "TrainStart", "TestStart", "TestEnd", "Pairs", "Trades", "TotalReturn",
+                   "SharpeRatio", "MaxDrawdown", "Wins", "Losses"});
+    for (size_t k = 0; k < folds.size(); ++k) {
+        const Fold& fold = folds[k];
+        writer.field(k);
+        writer.field(Timestamps::format(timestamps[fold.trainBegin]));
+        writer.field(Timestamps::format(timestamps[fold.testBegin]));
+        writer.field(Timestamps::format(timestamps[fold.testEnd - 1]));
+        writer.field(fold.pairs.size());
+        writer.field(fold.numTrades);
+        writer.field(fold.metrics.totalReturn);
+        writer.field(fold.metrics.sharpeRatio);
+        writer.field(fold.metrics.maxDrawdown);
+        writer.field(fold.metrics.winCount);
+        writer.field(fold.metrics.lossCount);
+        writer.endRow();
+    }
+    return writer.close();
+}
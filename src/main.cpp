@@ -1,10 +1,21 @@
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "MarketData.h"
+#include "MarketDataStream.h"
 #include "AssetPair.h"
 #include "Backtester.h"
+#include "BasketScanner.h"
+#include "CostModel.h"
+#include "LiveTrader.h"
+#include "PairScanner.h"
+#include "ParameterSweep.h"
+#include "Profiler.h"
+#include "Timestamps.h"
+#include "WalkForward.h"
 
 void printUsage() {
     std::cout << "Usage: StatArbSimulator <data_file> [options]" << std::endl;
@@ -14,10 +25,349 @@ void printUsage() {
     std::cout << "  --exit <value>           Exit threshold (default: 0.0)" << std::endl;
     std::cout << "  --window <value>         Lookback window (default: 20)" << std::endl;
     std::cout << "  --immediate              Use immediate execution (default: T+1)" << std::endl;
-    std::cout << "  --output <file>          Output file for results (default: results.csv)" << std::endl;
+    std::cout << "  --output <file>          Output file for results (default: results.csv; .sacol for binary columnar)" << std::endl;
+    std::cout << "  --trades <file>          Also write the trade log (CSV, or binary columnar for .sacol)" << std::endl;
+    std::cout << "  --threads <n>            Worker threads for screening and parallel backtests (default: all cores)" << std::endl;
+    std::cout << "  --execution <mode>       serial, shared (shared capital, day barrier) or fixed (fixed notional) (default: serial)" << std::endl;
+    std::cout << "  --hedge-window <n>       Rolling OLS hedge ratio over n bars (default: 0 = static beta)" << std::endl;
+    std::cout << "  --price-storage <type>   float64, float32 or ticks[:size] (int32 ticks, default size 0.0001) (default: float64)" << std::endl;
+    std::cout << "  --no-cache               Always parse the CSV; do not read or write <data_file>.sacache" << std::endl;
+    std::cout << "  --bar <interval>         Resample the data to bars of <interval> before screening and trading," << std::endl;
+    std::cout << "                           e.g. 5m, 1h or 1d (units ns, us, ms, s, m, h, d)" << std::endl;
+    std::cout << "  --screen-bar <interval>  Screen pairs and baskets on bars resampled to <interval>, trade on the loaded bars" << std::endl;
+    std::cout << "  --periods-per-year <n>   Annualization of returns and Sharpe (default: 252 x bars per calendar day)" << std::endl;
+    std::cout << "  --fill <policy>          Missing prices in pair screens: drop (bars both legs observed) or ffill" << std::endl;
+    std::cout << "                           (carry each leg's last price) (default: drop)" << std::endl;
+    std::cout << "  --top-k <k>              Only test pairs among each symbol's k most return-correlated partners (default: all pairs)" << std::endl;
+    std::cout << "  --baskets <legs>         Also screen baskets of <legs> correlated symbols with the Johansen test" << std::endl;
+    std::cout << "  --pairs <file>           Trade the pairs and betas in file (SymbolA,SymbolB,Beta) instead of screening" << std::endl;
+    std::cout << "  --save-pairs <file>      Write the screened pairs for a later --pairs run" << std::endl;
+    std::cout << "  --stream <bars>          Read the data in chunks of <bars> rows, keeping only rolling state (needs --pairs)" << std::endl;
+    std::cout << "  --live                   Paper-trade the --pairs list on bars fed one at a time from <data_file>" << std::endl;
+    std::cout << "                           (a file, or - for stdin); prints tick-to-signal latency histograms" << std::endl;
+    std::cout << "  --pace <interval>        With --live, release one bar per <interval>, e.g. 1ms (default: as read)" << std::endl;
+    std::cout << "  --intents <file>         With --live, write every order intent to file (CSV)" << std::endl;
+    std::cout << "  --walk-forward <spec>    Roll formation/trading windows, e.g. train=504,test=63; pairs are" << std::endl;
+    std::cout << "                           re-screened on each formation window (writes one row per fold)" << std::endl;
+    std::cout << "  --sweep <spec>           Parameter sweep, e.g. entry=1.0:3.0:0.25,window=20,60,120" << std::endl;
+    std::cout << "                           (axes: entry, exit, window; writes one metrics table)" << std::endl;
+    std::cout << "  --costs <spec>           Per-fill costs, e.g. commission=0.005,fee=0.5,spread=1,impact=10,adv=1e6" << std::endl;
+    std::cout << "                           (per share; fee, half spread and impact in bps; adv in shares per bar)" << std::endl;
+    std::cout << "  --cost-scale <list>      Also re-price the run's fills at these multiples of --costs, e.g. 0,0.5,2" << std::endl;
+    std::cout << "  --kill <spec>            Stop backtests early, e.g. drawdown=0.2,checkpoint=252,sharpe=0,trades=2" << std::endl;
+    std::cout << "                           (trades and sharpe are tested every checkpoint bars)" << std::endl;
+    std::cout << "  --prescreen <bars>[:t]   ADF-test each spread on its first <bars> bars and fully test only pairs" << std::endl;
+    std::cout << "                           whose statistic there is below t (default -1.0)" << std::endl;
+    std::cout << "  --shard <i/N>            Run work unit i of N: a slice of the pair screen and --pairs list, or of" << std::endl;
+    std::cout << "                           the --sweep grid; combine shard outputs with StatArbMerge (backtests need --execution fixed)" << std::endl;
+    std::cout << "  --profile                Print a per-phase timing and counter report (ENABLE_PROFILING builds)" << std::endl;
+    std::cout << "  --profile-trace <file>   Also write a Chrome trace JSON of every timed scope" << std::endl;
     std::cout << "  --help                   Show this help message" << std::endl;
 }
 
+int runSweep(std::shared_ptr<MarketData> marketData,
+             const std::vector<PairCandidate>& candidates,
+             const std::string& spec,
+             const ParameterSweep::Options& options,
+             double entryThreshold, double exitThreshold, size_t lookbackWindow,
+             const std::string& outputFile) {
+    // Axes not named in the spec keep their command-line value
+    ParameterSweep::Grid grid;
+    grid.entryThresholds = {entryThreshold};
+    grid.exitThresholds = {exitThreshold};
+    grid.lookbackWindows = {lookbackWindow};
+    if (!ParameterSweep::parseGrid(spec, grid)) {
+        return 1;
+    }
+    
+    std::cout << "\nRunning parameter sweep over " << grid.size() << " combinations ("
+              << grid.entryThresholds.size() << " entry x " << grid.exitThresholds.size()
+              << " exit x " << grid.lookbackWindows.size() << " window)" << std::endl;
+    
+    ParameterSweep sweep(marketData, candidates, options);
+    auto results = sweep.run(grid);
+    
+    const ParameterSweep::Result* best = nullptr;
+    size_t numPruned = 0;
+    for (const auto& result : results) {
+        if (result.pruned) {
+            ++numPruned;
+            continue;
+        }
+        if (!best || result.metrics.sharpeRatio > best->metrics.sharpeRatio) {
+            best = &result;
+        }
+    }
+    if (best) {
+        std::cout << "Best Sharpe " << best->metrics.sharpeRatio << " at entry=" << best->entryThreshold
+                  << " exit=" << best->exitThreshold << " window=" << best->lookbackWindow << std::endl;
+    }
+    if (numPruned > 0) {
+        std::cout << "Pruned " << numPruned << " of " << results.size() << " grid points early" << std::endl;
+    }
+    
+    std::cout << "\nExporting sweep results to " << outputFile << std::endl;
+    if (!ParameterSweep::exportResults(outputFile, results)) {
+        std::cerr << "Error: Failed to export sweep results" << std::endl;
+        return 1;
+    }
+    std::cout << "Results successfully exported" << std::endl;
+    return 0;
+}
+
+int runWalkForward(std::shared_ptr<MarketData> marketData, WalkForward::Options options,
+                   const std::string& outputFile) {
+    WalkForward walkForward(marketData, options);
+    std::cout << "\nWalk-forward over " << walkForward.numFolds() << " folds (train "
+              << options.trainBars << ", test " << options.testBars << " bars)" << std::endl;
+    auto folds = walkForward.run();
+    if (folds.empty()) {
+        return 1;
+    }
+    
+    const auto& timestamps = marketData->getTimestamps();
+    for (size_t k = 0; k < folds.size(); ++k) {
+        const auto& fold = folds[k];
+        std::cout << "Fold " << k << " " << Timestamps::format(timestamps[fold.testBegin]) << " to "
+                  << Timestamps::format(timestamps[fold.testEnd - 1])
+                  << ": " << fold.pairs.size() << " pairs, " << fold.numTrades << " trades, return "
+                  << (fold.metrics.totalReturn * 100.0) << "%" << std::endl;
+    }
+    std::cout << "Compounded Return: " << (WalkForward::compoundedReturn(folds) * 100.0) << "%" << std::endl;
+    
+    std::cout << "\nExporting walk-forward results to " << outputFile << std::endl;
+    if (!WalkForward::exportResults(outputFile, folds, *marketData)) {
+        std::cerr << "Error: Failed to export walk-forward results" << std::endl;
+        return 1;
+    }
+    std::cout << "Results successfully exported" << std::endl;
+    return 0;
+}
+
+// A pair and hedge ratio from a --pairs file
+struct PairSpec {
+    std::string symbolA;
+    std::string symbolB;
+    double beta = 0.0;
+};
+
+bool loadPairs(const std::string& path, std::vector<PairSpec>& pairs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open pairs file " << path << std::endl;
+        return false;
+    }
+    
+    // Header, then SymbolA,SymbolB,Beta[,...] per line
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::stringstream row(line);
+        PairSpec spec;
+        std::string beta;
+        if (!std::getline(row, spec.symbolA, ',') || !std::getline(row, spec.symbolB, ',') ||
+            !std::getline(row, beta, ',')) {
+            std::cerr << "Error: Malformed line in pairs file: " << line << std::endl;
+            return false;
+        }
+        try {
+            spec.beta = std::stod(beta);
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid beta in pairs file: " << line << std::endl;
+            return false;
+        }
+        pairs.push_back(spec);
+    }
+    return true;
+}
+
+bool savePairs(const std::string& path, const MarketData& marketData,
+               const std::vector<PairCandidate>& candidates) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.precision(17);
+    file << "SymbolA,SymbolB,Beta,ADF,PValue\n";
+    for (const auto& c : candidates) {
+        file << marketData.getSymbol(c.symbolA) << "," << marketData.getSymbol(c.symbolB) << ","
+             << c.beta << "," << c.adfStatistic << "," << c.pValue << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+void printParameters(double initialCapital, double entryThreshold, double exitThreshold,
+                     size_t lookbackWindow, size_t hedgeWindow, bool delayedExecution) {
+    std::cout << "\nRunning backtest with parameters:" << std::endl;
+    std::cout << "Initial Capital: $" << initialCapital << std::endl;
+    std::cout << "Entry Threshold: " << entryThreshold << " sigma" << std::endl;
+    std::cout << "Exit Threshold: " << exitThreshold << " sigma" << std::endl;
+    std::cout << "Lookback Window: " << lookbackWindow << " bars" << std::endl;
+    if (hedgeWindow > 0) {
+        std::cout << "Hedge Ratio: rolling OLS over " << hedgeWindow << " bars" << std::endl;
+    }
+    std::cout << "Execution: " << (delayedExecution ? "T+1" : "Same day") << "\n" << std::endl;
+}
+
+// --trades: write the trade log if one was requested
+bool exportTrades(const Backtester& backtester, const std::string& tradesFile) {
+    if (tradesFile.empty()) {
+        return true;
+    }
+    std::cout << "Exporting " << backtester.getTradeHistory().size() << " trades to " << tradesFile << std::endl;
+    if (!backtester.exportTrades(tradesFile)) {
+        std::cerr << "Error: Failed to export trades" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --cost-scale: the run's fills re-priced at multiples of the cost model
+void printCostSensitivity(const Backtester& backtester, const CostModel& costs,
+                          const std::vector<double>& scales) {
+    if (scales.empty()) {
+        return;
+    }
+    std::cout << "\nCost sensitivity (multiple of --costs: total cost, return, Sharpe)" << std::endl;
+    for (double scale : scales) {
+        auto run = backtester.evaluateCosts(costs.scaled(scale));
+        std::cout << "  x" << scale << ": " << run.totalCost << ", " << (run.metrics.totalReturn * 100.0)
+                  << "%, " << run.metrics.sharpeRatio << std::endl;
+    }
+}
+
+// --stream: one forward pass over the file, chunkBars rows resident at a time
+int runStreaming(const std::string& dataFilePath, size_t chunkBars,
+                 const std::vector<PairSpec>& pairs,
+                 double initialCapital, double entryThreshold, double exitThreshold,
+                 size_t lookbackWindow, size_t hedgeWindow, bool delayedExecution,
+                 const CostModel& costs, double periodsPerYear,
+                 const std::string& outputFile, const std::string& tradesFile) {
+    auto stream = std::make_shared<MarketDataStream>(chunkBars);
+    std::cout << "Streaming market data from " << dataFilePath << std::endl;
+    if (!stream->open(dataFilePath) || stream->getDataSize() == 0) {
+        std::cerr << "Error: Failed to load market data" << std::endl;
+        return 1;
+    }
+    std::cout << "Found " << stream->getDataSize() << " bars of data for "
+              << stream->getNumSymbols() << " symbols, reading " << stream->getChunkBars()
+              << " bars per chunk" << std::endl;
+    
+    Backtester backtester(stream);
+    backtester.setHedgeRatioWindow(hedgeWindow);
+    backtester.setCostModel(costs);
+    if (periodsPerYear > 0.0) {
+        backtester.setPeriodsPerYear(periodsPerYear);
+    }
+    for (const auto& pair : pairs) {
+        backtester.addPair(pair.symbolA, pair.symbolB, pair.beta);
+    }
+    if (backtester.getNumPairs() == 0) {
+        std::cerr << "Error: No tradable pairs in the pairs file" << std::endl;
+        return 1;
+    }
+    std::cout << "Trading " << backtester.getNumPairs() << " pairs" << std::endl;
+    
+    printParameters(initialCapital, entryThreshold, exitThreshold, lookbackWindow, hedgeWindow,
+                    delayedExecution);
+    backtester.runBacktest(initialCapital, entryThreshold, exitThreshold, lookbackWindow, delayedExecution);
+    if (!costs.isFree()) {
+        std::cout << "Transaction Costs: " << backtester.getTotalCosts() << std::endl;
+    }
+    
+    std::cout << "\nExporting results to " << outputFile << std::endl;
+    if (!backtester.exportResults(outputFile)) {
+        std::cerr << "Error: Failed to export results" << std::endl;
+        return 1;
+    }
+    std::cout << "Results successfully exported" << std::endl;
+    return exportTrades(backtester, tradesFile) ? 0 : 1;
+}
+
+// --live: the feed thread reads bars from feedPath and the paper book trades them as they arrive
+int runLive(const std::string& feedPath, int64_t pace, const std::vector<PairSpec>& pairs,
+            const LiveTrader::Options& options, const Backtester::KillCriteria& killCriteria,
+            double periodsPerYear, const std::string& intentsFile) {
+    CsvFeed feed;
+    std::cout << "Live feed from " << (feedPath == "-" ? "stdin" : feedPath) << std::endl;
+    if (!feed.open(feedPath)) {
+        return 1;
+    }
+    feed.setPace(pace);
+    std::cout << "Feed carries " << feed.getSymbols().size() << " symbols" << std::endl;
+    
+    LiveTrader trader(feed.getSymbols(), options);
+    trader.getBacktester().setKillCriteria(killCriteria);
+    if (periodsPerYear > 0.0) {
+        trader.getBacktester().setPeriodsPerYear(periodsPerYear);
+    }
+    for (const auto& pair : pairs) {
+        trader.addPair(pair.symbolA, pair.symbolB, pair.beta);
+    }
+    if (trader.getNumPairs() == 0) {
+        std::cerr << "Error: No tradable pairs in the pairs file" << std::endl;
+        return 1;
+    }
+    std::cout << "Trading " << trader.getNumPairs() << " pairs" << std::endl;
+    
+    std::ofstream intents;
+    if (!intentsFile.empty()) {
+        intents.open(intentsFile);
+        if (!intents) {
+            std::cerr << "Error: Could not open " << intentsFile << std::endl;
+            return 1;
+        }
+        intents << "Timestamp,Pair,SymbolA,SymbolB,Direction,QuantityA,QuantityB,PriceA,PriceB\n";
+    }
+    
+    printParameters(options.initialCapital, options.entryThreshold, options.exitThreshold,
+                    options.lookbackWindow, options.hedgeWindow, options.delayedExecution);
+    // Intents are written on the order thread, off the strategy's path
+    const Backtester& book = trader.getBacktester();
+    trader.run(feed, [&](const OrderIntent& intent) {
+        if (!intents.is_open()) {
+            return;
+        }
+        const AssetPair& pair = book.getPair(intent.pairIndex);
+        intents << Timestamps::format(intent.timestamp) << "," << intent.pairIndex << ","
+                << pair.getSymbolA() << "," << pair.getSymbolB() << "," << intent.direction << ","
+                << intent.quantityA << "," << intent.quantityB << ","
+                << intent.priceA << "," << intent.priceB << "\n";
+    });
+    
+    std::cout << "\nProcessed " << feed.getBarsRead() << " bars, " << trader.getIntents()
+              << " order intents" << std::endl;
+    trader.getTickToSignal().print(std::cout, "Tick to signal");
+    trader.getQueueDelay().print(std::cout, "Feed queue delay");
+    trader.getTickToOrder().print(std::cout, "Tick to order");
+    if (feed.getStalls() > 0 || trader.getOrderStalls() > 0) {
+        std::cout << "Queue full: " << feed.getStalls() << " bars, " << trader.getOrderStalls()
+                  << " intents waited" << std::endl;
+    }
+    if (intents.is_open()) {
+        std::cout << "Wrote order intents to " << intentsFile << std::endl;
+    }
+    return feed.failed() ? 1 : 0;
+}
+
+// Print the --profile report and optionally write the trace
+void finishProfile(bool profile, const std::string& tracePath) {
+    if (!profile) {
+        return;
+    }
+    std::cout << std::endl;
+    Profiler::printReport(std::cout);
+    if (!tracePath.empty()) {
+        if (Profiler::writeChromeTrace(tracePath)) {
+            std::cout << "Wrote Chrome trace to " << tracePath << std::endl;
+        } else {
+            std::cerr << "Error: Failed to write trace " << tracePath << std::endl;
+        }
+    }
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Error: Missing data file path" << std::endl;
@@ -33,6 +383,36 @@ int main(int argc, char* argv[]) {
     size_t lookbackWindow = 20;
     bool delayedExecution = true;
     std::string outputFile = "results.csv";
+    std::string tradesFile;
+    size_t numThreads = 0;
+    std::string sweepSpec;
+    std::string walkForwardSpec;
+    bool useCache = true;
+    size_t hedgeWindow = 0;
+    Backtester::ExecutionMode executionMode = Backtester::ExecutionMode::Serial;
+    bool profile = false;
+    std::string tracePath;
+    std::string pairsFile;
+    std::string savePairsFile;
+    size_t streamBars = 0;
+    bool live = false;
+    int64_t livePace = 0;
+    std::string intentsFile;
+    size_t topK = 0;
+    size_t basketLegs = 0;
+    MarketData::PriceStorage priceStorage = MarketData::PriceStorage::Float64;
+    double tickSize = 1e-4;
+    Shard shard;
+    CostModel costs;
+    std::vector<double> costScales;
+    Backtester::KillCriteria killCriteria;
+    size_t prescreenBars = 0;
+    double prescreenStatistic = -1.0;
+    int64_t barInterval = 0;
+    int64_t screenInterval = 0;
+    double periodsPerYear = 0.0;
+    std::string fillSpec;
+    MarketData::FillPolicy fillPolicy = MarketData::FillPolicy::Drop;
     
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
@@ -52,6 +432,128 @@ int main(int argc, char* argv[]) {
             delayedExecution = false;
         } else if (arg == "--output" && i + 1 < argc) {
             outputFile = argv[++i];
+        } else if (arg == "--trades" && i + 1 < argc) {
+            tradesFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::stoul(argv[++i]);
+        } else if (arg == "--execution" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "serial") {
+                executionMode = Backtester::ExecutionMode::Serial;
+            } else if (mode == "shared") {
+                executionMode = Backtester::ExecutionMode::SharedCapital;
+            } else if (mode == "fixed") {
+                executionMode = Backtester::ExecutionMode::FixedNotional;
+            } else {
+                std::cerr << "Unknown execution mode: " << mode << std::endl;
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--hedge-window" && i + 1 < argc) {
+            hedgeWindow = std::stoul(argv[++i]);
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--profile-trace" && i + 1 < argc) {
+            profile = true;
+            tracePath = argv[++i];
+        } else if (arg == "--price-storage" && i + 1 < argc) {
+            std::string storage = argv[++i];
+            if (storage == "float64") {
+                priceStorage = MarketData::PriceStorage::Float64;
+            } else if (storage == "float32") {
+                priceStorage = MarketData::PriceStorage::Float32;
+            } else if (storage.compare(0, 5, "ticks") == 0 &&
+                       (storage.size() == 5 || storage[5] == ':')) {
+                priceStorage = MarketData::PriceStorage::Ticks32;
+                if (storage.size() > 6) {
+                    tickSize = std::stod(storage.substr(6));
+                }
+            } else {
+                std::cerr << "Unknown price storage: " << storage << std::endl;
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--no-cache") {
+            useCache = false;
+        } else if ((arg == "--bar" || arg == "--screen-bar") && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (!Timestamps::parseInterval(spec, arg == "--bar" ? barInterval : screenInterval)) {
+                std::cerr << "Error: Invalid bar interval: " << spec << std::endl;
+                return 1;
+            }
+        } else if (arg == "--periods-per-year" && i + 1 < argc) {
+            periodsPerYear = std::stod(argv[++i]);
+            if (!(periodsPerYear > 0.0)) {
+                std::cerr << "Error: --periods-per-year must be positive" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--fill" && i + 1 < argc) {
+            fillSpec = argv[++i];
+            if (fillSpec == "drop") {
+                fillPolicy = MarketData::FillPolicy::Drop;
+            } else if (fillSpec == "ffill") {
+                fillPolicy = MarketData::FillPolicy::ForwardFill;
+            } else {
+                std::cerr << "Unknown fill policy: " << fillSpec << std::endl;
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--top-k" && i + 1 < argc) {
+            topK = std::stoul(argv[++i]);
+        } else if (arg == "--baskets" && i + 1 < argc) {
+            basketLegs = std::stoul(argv[++i]);
+            if (basketLegs < 2 || basketLegs > Johansen::kMaxLegs) {
+                std::cerr << "Error: --baskets needs between 2 and " << Johansen::kMaxLegs << " legs" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pairs" && i + 1 < argc) {
+            pairsFile = argv[++i];
+        } else if (arg == "--save-pairs" && i + 1 < argc) {
+            savePairsFile = argv[++i];
+        } else if (arg == "--stream" && i + 1 < argc) {
+            streamBars = std::stoul(argv[++i]);
+            if (streamBars == 0) {
+                std::cerr << "Error: --stream needs a chunk size of at least 1 bar" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--live") {
+            live = true;
+        } else if (arg == "--pace" && i + 1 < argc) {
+            if (!Timestamps::parseInterval(argv[++i], livePace)) {
+                std::cerr << "Error: Invalid --pace interval: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--intents" && i + 1 < argc) {
+            intentsFile = argv[++i];
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            sweepSpec = argv[++i];
+        } else if (arg == "--walk-forward" && i + 1 < argc) {
+            walkForwardSpec = argv[++i];
+        } else if (arg == "--costs" && i + 1 < argc) {
+            if (!CostModel::parse(argv[++i], costs)) {
+                return 1;
+            }
+        } else if (arg == "--cost-scale" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string factor;
+            while (std::getline(list, factor, ',')) {
+                costScales.push_back(std::stod(factor));
+            }
+        } else if (arg == "--kill" && i + 1 < argc) {
+            if (!Backtester::KillCriteria::parse(argv[++i], killCriteria)) {
+                return 1;
+            }
+        } else if (arg == "--prescreen" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t colon = spec.find(':');
+            prescreenBars = std::stoul(spec.substr(0, colon));
+            if (colon != std::string::npos) {
+                prescreenStatistic = std::stod(spec.substr(colon + 1));
+            }
+        } else if (arg == "--shard" && i + 1 < argc) {
+            if (!Shard::parse(argv[++i], shard)) {
+                return 1;
+            }
         } else {
             std::cerr << "Unknown option: " << arg << std::endl;
             printUsage();
@@ -59,46 +561,286 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (profile && !Profiler::isCompiledIn()) {
+        std::cerr << "Warning: built without ENABLE_PROFILING, ignoring --profile" << std::endl;
+        profile = false;
+    }
+    Profiler::setEnabled(profile);
+    
+    // Only fixed-notional pairs are independent, so only their portfolio values add up across shards
+    if (!shard.isWhole()) {
+        if (streamBars > 0 || live || !walkForwardSpec.empty()) {
+            std::cerr << "Error: --shard does not support --stream, --live or --walk-forward" << std::endl;
+            return 1;
+        }
+        if (sweepSpec.empty() && executionMode != Backtester::ExecutionMode::FixedNotional) {
+            std::cerr << "Error: A sharded backtest needs --execution fixed" << std::endl;
+            return 1;
+        }
+    }
+    
+    std::vector<PairSpec> pairSpecs;
+    if (!pairsFile.empty() && !loadPairs(pairsFile, pairSpecs)) {
+        return 1;
+    }
+    // A sweep shards its grid instead and trades every pair
+    if (sweepSpec.empty() && !shard.isWhole()) {
+        auto range = shard.range(pairSpecs.size());
+        pairSpecs = std::vector<PairSpec>(pairSpecs.begin() + range.first, pairSpecs.begin() + range.second);
+    }
+    
+    if (live) {
+        // Bars arrive one at a time, so like --stream there is no history to screen or resample
+        if (pairsFile.empty()) {
+            std::cerr << "Error: --live needs --pairs <file> (e.g. from a --save-pairs run)" << std::endl;
+            return 1;
+        }
+        if (streamBars > 0 || !sweepSpec.empty() || !walkForwardSpec.empty() ||
+            executionMode != Backtester::ExecutionMode::Serial) {
+            std::cerr << "Error: --live supports serial single runs only" << std::endl;
+            return 1;
+        }
+        if (barInterval > 0 || screenInterval > 0 || !fillSpec.empty() || !costs.isFree()) {
+            std::cerr << "Error: --live trades the bars as they arrive; --bar, --screen-bar, --fill and --costs need the full history" << std::endl;
+            return 1;
+        }
+        LiveTrader::Options options;
+        options.initialCapital = initialCapital;
+        options.entryThreshold = entryThreshold;
+        options.exitThreshold = exitThreshold;
+        options.lookbackWindow = lookbackWindow;
+        options.hedgeWindow = hedgeWindow;
+        options.delayedExecution = delayedExecution;
+        int status = runLive(dataFilePath, livePace, pairSpecs, options, killCriteria, periodsPerYear,
+                             intentsFile);
+        finishProfile(profile, tracePath);
+        return status;
+    }
+    
+    if (streamBars > 0) {
+        // Without the full history in memory there is nothing to screen on
+        if (pairsFile.empty()) {
+            std::cerr << "Error: --stream needs --pairs <file> (e.g. from a --save-pairs run)" << std::endl;
+            return 1;
+        }
+        if (!sweepSpec.empty() || executionMode != Backtester::ExecutionMode::Serial) {
+            std::cerr << "Error: --stream supports serial single runs only" << std::endl;
+            return 1;
+        }
+        if (barInterval > 0 || screenInterval > 0 || !fillSpec.empty()) {
+            std::cerr << "Error: --stream reads the bars as they are; --bar, --screen-bar and --fill need the full history" << std::endl;
+            return 1;
+        }
+        int status = runStreaming(dataFilePath, streamBars, pairSpecs, initialCapital,
+                                  entryThreshold, exitThreshold, lookbackWindow, hedgeWindow,
+                                  delayedExecution, costs, periodsPerYear, outputFile, tradesFile);
+        finishProfile(profile, tracePath);
+        return status;
+    }
+    
     // Load market data
     std::cout << "Loading market data from " << dataFilePath << std::endl;
-    auto marketData = std::make_shared<MarketData>(dataFilePath);
+    std::shared_ptr<MarketData> marketData;
+    if (useCache) {
+        marketData = std::make_shared<MarketData>(dataFilePath);
+    } else {
+        marketData = std::make_shared<MarketData>();
+        marketData->loadFromCSV(dataFilePath);
+    }
     
     if (marketData->getDataSize() == 0) {
         std::cerr << "Error: Failed to load market data" << std::endl;
         return 1;
     }
     
-    std::cout << "Loaded " << marketData->getDataSize() << " days of data for "
+    // Convert the CSV once; later runs map the binary cache instead
+    if (useCache && !marketData->isCacheBacked()) {
+        std::string cachePath = MarketData::cachePathFor(dataFilePath);
+        if (marketData->saveCache(cachePath)) {
+            std::cout << "Wrote binary cache " << cachePath << std::endl;
+        }
+    } else if (marketData->isCacheBacked()) {
+        std::cout << "Using binary cache for " << dataFilePath << std::endl;
+    }
+    
+    // The cache keeps the loaded bars; coarser bars are aggregated from it on every run
+    if (barInterval > 0) {
+        marketData = std::make_shared<MarketData>(marketData->resample(barInterval));
+        std::cout << "Resampled to " << marketData->getDataSize() << " bars of "
+                  << Timestamps::formatInterval(barInterval) << std::endl;
+    }
+    std::shared_ptr<MarketData> screenData = marketData;
+    if (screenInterval > 0) {
+        if (!walkForwardSpec.empty()) {
+            std::cerr << "Error: --walk-forward screens on its own formation windows; use --bar instead of --screen-bar" << std::endl;
+            return 1;
+        }
+        screenData = std::make_shared<MarketData>(marketData->resample(screenInterval));
+        std::cout << "Screening on " << screenData->getDataSize() << " bars of "
+                  << Timestamps::formatInterval(screenInterval) << std::endl;
+    }
+    
+    // Narrow after the cache is written; the cache always holds float64
+    if (!marketData->setPriceStorage(priceStorage, tickSize) ||
+        (screenData != marketData && !screenData->setPriceStorage(priceStorage, tickSize))) {
+        return 1;
+    }
+    if (periodsPerYear > 0.0) {
+        marketData->setPeriodsPerYear(periodsPerYear);
+    }
+    marketData->setFillPolicy(fillPolicy);
+    screenData->setFillPolicy(fillPolicy);
+    
+    std::cout << "Loaded " << marketData->getDataSize() << " bars of "
+              << Timestamps::formatInterval(marketData->getBarInterval()) << " data for "
               << marketData->getAvailableSymbols().size() << " symbols" << std::endl;
+    size_t symbolsWithGaps = 0;
+    for (MarketData::SymbolId id = 0; id < marketData->getNumSymbols(); ++id) {
+        symbolsWithGaps += !marketData->isComplete(id);
+    }
+    if (symbolsWithGaps > 0) {
+        std::cout << symbolsWithGaps << " symbols have missing prices; pair screens use --fill "
+                  << (fillPolicy == MarketData::FillPolicy::Drop ? "drop" : "ffill") << std::endl;
+    }
+    
+    // Walk-forward screens each formation window itself
+    if (!walkForwardSpec.empty()) {
+        WalkForward::Options walkOptions;
+        walkOptions.initialCapital = initialCapital;
+        walkOptions.entryThreshold = entryThreshold;
+        walkOptions.exitThreshold = exitThreshold;
+        walkOptions.lookbackWindow = lookbackWindow;
+        walkOptions.delayedExecution = delayedExecution;
+        walkOptions.numThreads = numThreads;
+        walkOptions.costs = costs;
+        if (!WalkForward::parseSpec(walkForwardSpec, walkOptions)) {
+            return 1;
+        }
+        int status = runWalkForward(marketData, walkOptions, outputFile);
+        finishProfile(profile, tracePath);
+        return status;
+    }
     
     // Create backtester
     Backtester backtester(marketData);
+    backtester.setHedgeRatioWindow(hedgeWindow);
+    backtester.setExecutionMode(executionMode, numThreads);
+    backtester.setCostModel(costs);
+    backtester.setKillCriteria(killCriteria);
     
     // If we have symbols, auto-add all valid pairs
-    auto symbols = marketData->getAvailableSymbols();
-    if (symbols.size() >= 2) {
-        std::cout << "Analyzing all possible pairs for cointegration..." << std::endl;
-        
-        // Test all symbol pairs for cointegration
-        for (size_t i = 0; i < symbols.size(); ++i) {
-            for (size_t j = i + 1; j < symbols.size(); ++j) {
-                backtester.addPair(symbols[i], symbols[j]);
+    const auto& symbols = marketData->getAvailableSymbols();
+    std::vector<PairCandidate> candidates;
+    if (!pairsFile.empty()) {
+        // Trade the given pairs as they are
+        for (const auto& spec : pairSpecs) {
+            auto idA = marketData->getSymbolId(spec.symbolA);
+            auto idB = marketData->getSymbolId(spec.symbolB);
+            if (!idA || !idB) {
+                std::cerr << "Error: Could not find price data for " << spec.symbolA
+                          << " or " << spec.symbolB << std::endl;
+                continue;
             }
+            PairCandidate candidate;
+            candidate.symbolA = *idA;
+            candidate.symbolB = *idB;
+            candidate.beta = spec.beta;
+            candidates.push_back(candidate);
+            backtester.addPair(candidate);
+        }
+        std::cout << "Loaded " << candidates.size() << " pairs from " << pairsFile << std::endl;
+    } else if (symbols.size() >= 2) {
+        if (topK > 0) {
+            std::cout << "Analyzing pairs among each symbol's " << topK
+                      << " most correlated partners for cointegration..." << std::endl;
+        } else {
+            std::cout << "Analyzing all possible pairs for cointegration..." << std::endl;
+        }
+        
+        // Screen symbol pairs for cointegration in parallel
+        PairScanner::Options scanOptions;
+        scanOptions.numThreads = numThreads;
+        scanOptions.topK = topK;
+        if (sweepSpec.empty()) {
+            scanOptions.shard = shard;
+        }
+        scanOptions.prescreenBars = prescreenBars;
+        scanOptions.prescreenStatistic = prescreenStatistic;
+        PairScanner scanner(screenData, scanOptions);
+        STATARB_PROFILE_SCOPE("main::pairLoop");
+        candidates = scanner.scan();
+        
+        for (const auto& candidate : candidates) {
+            std::cout << "Pair " << marketData->getSymbol(candidate.symbolA) << " / "
+                      << marketData->getSymbol(candidate.symbolB)
+                      << " is cointegrated with beta: " << candidate.beta << std::endl;
+            backtester.addPair(candidate);
+        }
+        
+        std::cout << "Tested " << scanner.getPairsTested() << " pairs, "
+                  << candidates.size() << " cointegrated" << std::endl;
+        if (prescreenBars > 0) {
+            std::cout << "Prescreen rejected " << scanner.getPairsPruned() << " pairs" << std::endl;
         }
     } else {
         std::cerr << "Error: Need at least 2 symbols for pairs trading" << std::endl;
         return 1;
     }
     
+    if (basketLegs > 0) {
+        std::cout << "\nScreening " << basketLegs << "-leg baskets for cointegration..." << std::endl;
+        BasketScanner::Options basketOptions;
+        basketOptions.numThreads = numThreads;
+        basketOptions.numLegs = basketLegs;
+        BasketScanner basketScanner(screenData, basketOptions);
+        auto baskets = basketScanner.scan();
+        for (const auto& basket : baskets) {
+            std::cout << "Basket";
+            for (size_t leg = 0; leg < basket.symbols.size(); ++leg) {
+                std::cout << " " << marketData->getSymbol(basket.symbols[leg]) << " (" << basket.weights[leg] << ")";
+            }
+            std::cout << " has rank " << basket.rank << ", trace " << basket.traceStatistic
+                      << " > " << basket.criticalValue << std::endl;
+        }
+        std::cout << "Tested " << basketScanner.getBasketsTested() << " baskets, "
+                  << baskets.size() << " cointegrated" << std::endl;
+    }
+    
+    if (!savePairsFile.empty()) {
+        if (savePairs(savePairsFile, *marketData, candidates)) {
+            std::cout << "Wrote " << candidates.size() << " pairs to " << savePairsFile << std::endl;
+        } else {
+            std::cerr << "Error: Failed to write pairs file " << savePairsFile << std::endl;
+        }
+    }
+    
+    if (!sweepSpec.empty()) {
+        ParameterSweep::Options sweepOptions;
+        sweepOptions.initialCapital = initialCapital;
+        sweepOptions.delayedExecution = delayedExecution;
+        sweepOptions.numThreads = numThreads;
+        sweepOptions.hedgeRatioWindow = hedgeWindow;
+        sweepOptions.shard = shard;
+        sweepOptions.costs = costs;
+        sweepOptions.kill = killCriteria;
+        int status = runSweep(marketData, candidates, sweepSpec, sweepOptions,
+                              entryThreshold, exitThreshold, lookbackWindow, outputFile);
+        finishProfile(profile, tracePath);
+        return status;
+    }
+    
     // Run backtest
-    std::cout << "\nRunning backtest with parameters:" << std::endl;
-    std::cout << "Initial Capital: $" << initialCapital << std::endl;
-    std::cout << "Entry Threshold: " << entryThreshold << " sigma" << std::endl;
-    std::cout << "Exit Threshold: " << exitThreshold << " sigma" << std::endl;
-    std::cout << "Lookback Window: " << lookbackWindow << " days" << std::endl;
-    std::cout << "Execution: " << (delayedExecution ? "T+1" : "Same day") << "\n" << std::endl;
+    printParameters(initialCapital, entryThreshold, exitThreshold, lookbackWindow, hedgeWindow,
+                    delayedExecution);
     
     backtester.runBacktest(initialCapital, entryThreshold, exitThreshold, lookbackWindow, delayedExecution);
+    if (!costs.isFree()) {
+        std::cout << "Transaction Costs: " << backtester.getTotalCosts() << std::endl;
+    }
+    if (backtester.wasPruned()) {
+        std::cout << "Stopped by the kill criteria after " << backtester.getBarsRun() << " bars" << std::endl;
+    }
+    printCostSensitivity(backtester, costs, costScales);
     
     // Export results
     std::cout << "\nExporting results to " << outputFile << std::endl;
@@ -107,6 +849,8 @@ int main(int argc, char* argv[]) {
     } else {
         std::cerr << "Error: Failed to export results" << std::endl;
     }
+    exportTrades(backtester, tradesFile);
     
+    finishProfile(profile, tracePath);
     return 0;
 } 
\ No newline at end of file
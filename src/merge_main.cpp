@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Backtester.h"
+#include "Timestamps.h"
+#include "Utilities.h"
+
+// Combines the outputs of --shard i/N runs into what the unsharded run writes.
+// Inputs are given in shard order and must be CSV.
+
+void printUsage() {
+    std::cout << "Usage: StatArbMerge [--periods-per-year <n>] <kind> <output> <shard_file>..." << std::endl;
+    std::cout << "Kinds:" << std::endl;
+    std::cout << "  results   Daily portfolio values of --execution fixed runs; each shard's gain" << std::endl;
+    std::cout << "            over its day-0 capital is added to that capital (.sacol output allowed)" << std::endl;
+    std::cout << "  trades    Trade logs (--trades); rows concatenated and ordered by exit day" << std::endl;
+    std::cout << "  sweep     Sweep metrics tables; rows concatenated in shard order" << std::endl;
+    std::cout << "--periods-per-year annualizes merged results as the runs did (default: 252, daily bars)" << std::endl;
+}
+
+// Header and data lines of one CSV file
+bool readLines(const std::string& filename, std::string& header, std::vector<std::string>& rows) {
+    if (Utilities::isColumnarPath(filename)) {
+        std::cerr << "Error: Merge inputs must be CSV, got " << filename << std::endl;
+        return false;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << std::endl;
+        return false;
+    }
+    if (!std::getline(file, header)) {
+        std::cerr << "Error: Empty file " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            rows.push_back(line);
+        }
+    }
+    return true;
+}
+
+// Field `column` of a CSV row, parsed as a number
+bool numericField(const std::string& row, size_t column, double& value) {
+    std::stringstream stream(row);
+    std::string token;
+    for (size_t c = 0; c <= column; ++c) {
+        if (!std::getline(stream, token, ',')) {
+            return false;
+        }
+    }
+    try {
+        value = std::stod(token);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+int mergeResults(const std::string& output, const std::vector<std::string>& inputs, double periodsPerYear) {
+    std::vector<double> merged;
+    double capital = 0.0;
+    for (size_t s = 0; s < inputs.size(); ++s) {
+        std::string header;
+        std::vector<std::string> rows;
+        if (!readLines(inputs[s], header, rows)) {
+            return 1;
+        }
+        std::vector<double> values(rows.size());
+        for (size_t day = 0; day < rows.size(); ++day) {
+            if (!numericField(rows[day], 1, values[day])) {
+                std::cerr << "Error: Malformed row " << (day + 2) << " in " << inputs[s] << std::endl;
+                return 1;
+            }
+        }
+        if (values.empty()) {
+            std::cerr << "Error: No portfolio values in " << inputs[s] << std::endl;
+            return 1;
+        }
+        if (s == 0) {
+            capital = values[0];
+            merged.assign(values.size(), capital);
+        } else if (values.size() != merged.size() || values[0] != capital) {
+            std::cerr << "Error: " << inputs[s] << " covers a different run than " << inputs[0] << std::endl;
+            return 1;
+        }
+        for (size_t day = 0; day < values.size(); ++day) {
+            merged[day] += values[day] - capital;
+        }
+    }
+
+    Backtester::PerformanceMetrics metrics = Backtester::computeMetrics(merged, {}, capital, periodsPerYear);
+    std::cout << "Merged " << inputs.size() << " shards over " << merged.size() << " bars" << std::endl;
+    std::cout << "Total Return: " << (metrics.totalReturn * 100.0) << "%" << std::endl;
+    std::cout << "Annualized Return: " << (metrics.annualizedReturn * 100.0) << "%" << std::endl;
+    std::cout << "Sharpe Ratio: " << metrics.sharpeRatio << std::endl;
+    std::cout << "Max Drawdown: " << (metrics.maxDrawdown * 100.0) << "%" << std::endl;
+
+    if (!Backtester::writePortfolioValues(output, merged)) {
+        std::cerr << "Error: Failed to write " << output << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int mergeTrades(const std::string& output, const std::vector<std::string>& inputs) {
+    // Exit day and P&L columns of the exportTrades layout
+    constexpr size_t kExitDayColumn = 4;
+    constexpr size_t kPnlColumn = 11;
+
+    struct Row {
+        double exitDay;
+        double pnl;
+        std::string line;
+    };
+    std::vector<Row> trades;
+    std::string header;
+    for (const auto& input : inputs) {
+        std::vector<std::string> rows;
+        if (!readLines(input, header, rows)) {
+            return 1;
+        }
+        for (auto& line : rows) {
+            Row row;
+            if (!numericField(line, kExitDayColumn, row.exitDay) || !numericField(line, kPnlColumn, row.pnl)) {
+                std::cerr << "Error: Malformed trade row in " << input << ": " << line << std::endl;
+                return 1;
+            }
+            row.line = std::move(line);
+            trades.push_back(std::move(row));
+        }
+    }
+    // Shard order breaks exit-day ties, matching the fixed-notional merge of pair chunks
+    std::stable_sort(trades.begin(), trades.end(),
+                     [](const Row& a, const Row& b) { return a.exitDay < b.exitDay; });
+
+    if (Utilities::isColumnarPath(output)) {
+        std::cerr << "Error: Merged trade logs are written as CSV only" << std::endl;
+        return 1;
+    }
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << output << " for writing" << std::endl;
+        return 1;
+    }
+    file << header << '\n';
+    int wins = 0;
+    for (const auto& trade : trades) {
+        file << trade.line << '\n';
+        wins += trade.pnl > 0;
+    }
+    if (!file) {
+        std::cerr << "Error: Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Merged " << trades.size() << " trades from " << inputs.size() << " shards ("
+              << wins << " wins, " << (trades.size() - wins) << " losses)" << std::endl;
+    return 0;
+}
+
+int mergeSweep(const std::string& output, const std::vector<std::string>& inputs) {
+    std::string header;
+    std::vector<std::string> rows;
+    for (const auto& input : inputs) {
+        std::string shardHeader;
+        if (!readLines(input, shardHeader, rows)) {
+            return 1;
+        }
+        if (!header.empty() && shardHeader != header) {
+            std::cerr << "Error: " << input << " has a different header than " << inputs[0] << std::endl;
+            return 1;
+        }
+        header = shardHeader;
+    }
+
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << output << " for writing" << std::endl;
+        return 1;
+    }
+    file << header << '\n';
+    for (const auto& row : rows) {
+        file << row << '\n';
+    }
+    if (!file) {
+        std::cerr << "Error: Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Merged " << rows.size() << " sweep rows from " << inputs.size() << " shards" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "--help") {
+        printUsage();
+        return 0;
+    }
+    int first = 1;
+    double periodsPerYear = Timestamps::kTradingDaysPerYear;
+    if (argc >= 3 && std::string(argv[1]) == "--periods-per-year") {
+        periodsPerYear = std::atof(argv[2]);
+        if (!(periodsPerYear > 0.0)) {
+            std::cerr << "Error: --periods-per-year must be positive" << std::endl;
+            return 1;
+        }
+        first = 3;
+    }
+    if (argc - first < 3) {
+        std::cerr << "Error: Need a kind, an output file and at least one shard file" << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    std::string kind = argv[first];
+    std::string output = argv[first + 1];
+    std::vector<std::string> inputs(argv + first + 2, argv + argc);
+
+    if (kind == "results") {
+        return mergeResults(output, inputs, periodsPerYear);
+    } else if (kind == "trades") {
+        return mergeTrades(output, inputs);
+    } else if (kind == "sweep") {
+        return mergeSweep(output, inputs);
+    }
+    std::cerr << "Unknown merge kind: " << kind << std::endl;
+    printUsage();
+    return 1;
+}
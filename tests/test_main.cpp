@@ -2,13 +2,39 @@
 #include "catch.hpp"
 
 #include "../include/MarketData.h"
+#include "../include/MarketDataStream.h"
 #include "../include/AssetPair.h"
 #include "../include/Utilities.h"
 #include "../include/Backtester.h"
+#include "../include/PairScanner.h"
+#include "../include/ParameterSweep.h"
+#include "../include/Shard.h"
+#include "../include/Profiler.h"
+#include "../include/SpreadBasket.h"
+#include "../include/BasketScanner.h"
+#include "../include/CostModel.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/LiveTrader.h"
+#include "../include/SpscQueue.h"
+#include "../include/Timestamps.h"
+#include "../include/Validity.h"
+#include "../include/WalkForward.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
 #include <memory>
+#include <numeric>
+#include <thread>
 #include <vector>
 #include <cmath>
+#include <random>
+
+// Heap allocations counted by src/Profiler.cpp (STATARB_COUNT_ALLOCATIONS or a
+// profiling build) while recording is on, so tests can check a hot path never allocates
+static size_t allocationCount() {
+    return Profiler::getCounter(Profiler::Counter::Allocations);
+}
 
 // Note: Before running these tests, you need to download catch.hpp to the tests directory
 // wget https://github.com/catchorg/Catch2/releases/download/v2.13.6/catch.hpp
@@ -34,6 +60,66 @@ TEST_CASE("Utilities functions", "[utilities]") {
         REQUIRE(rolling_std[2] == Approx(1.0));
         REQUIRE(rolling_std[5] == Approx(1.0));
     }
+
+    SECTION("Streaming rolling statistics match the direct window computation") {
+        std::vector<double> data;
+        for (int i = 0; i < 200; ++i) {
+            data.push_back(100.0 + i * 0.05 + std::sin(i * 0.7) * 3.0);
+        }
+        size_t window = 25;
+
+        auto stats = Utilities::rollingStatistics(data, window);
+        REQUIRE(std::isnan(stats.zScore[window - 2]));
+
+        for (size_t i = window - 1; i < data.size(); ++i) {
+            std::vector<double> slice(data.begin() + (i + 1 - window), data.begin() + i + 1);
+            double mu = Utilities::mean(slice);
+            double sd = Utilities::standardDeviation(slice);
+            REQUIRE(stats.mean[i] == Approx(mu));
+            REQUIRE(stats.stdDev[i] == Approx(sd));
+            REQUIRE(stats.zScore[i] == Approx((data[i] - mu) / sd));
+        }
+
+        auto zscores = Utilities::rollingZScore(data, window);
+        REQUIRE(zscores[150] == Approx(stats.zScore[150]));
+    }
+
+    SECTION("A gap only affects the windows that hold it") {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        std::vector<double> data = {1.0, 2.0, nan, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+        auto stats = Utilities::rollingStatistics(data, 3);
+        for (size_t i = 2; i < 5; ++i) {
+            REQUIRE(std::isnan(stats.mean[i]));
+            REQUIRE(std::isnan(stats.zScore[i]));
+        }
+        for (size_t i = 5; i < data.size(); ++i) {
+            REQUIRE(stats.mean[i] == Approx(data[i] - 1.0));
+            REQUIRE(stats.stdDev[i] == Approx(1.0));
+            REQUIRE(stats.zScore[i] == Approx(1.0));
+        }
+
+        Utilities::RollingWindow window(3);
+        for (double value : data) window.push(value);
+        REQUIRE(window.full());
+        REQUIRE(window.moments().mean() == Approx(8.0));
+    }
+
+    SECTION("The rolling hedge fit has no slope while a gap is in its window") {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        Utilities::RollingRegression regression;
+        std::vector<double> x = {1.0, 2.0, nan, 4.0, 5.0, 6.0, 7.0};
+        for (size_t t = 0; t < x.size(); ++t) {
+            regression.add(x[t], 3.0 * x[t] + 1.0 + (t % 2) * 0.1);
+            if (t >= 3) regression.remove(x[t - 3], 3.0 * x[t - 3] + 1.0 + ((t - 3) % 2) * 0.1);
+            REQUIRE(regression.count() == std::min<size_t>(t + 1, 3));
+            if (t >= 2 && t < 5) {
+                REQUIRE(std::isnan(regression.beta()));
+            }
+        }
+        std::vector<double> tailX = {5.0, 6.0, 7.0};
+        std::vector<double> tailY = {3.0 * 5.0 + 1.0, 3.0 * 6.0 + 1.1, 3.0 * 7.0 + 1.0};
+        REQUIRE(regression.beta() == Approx(Utilities::linearRegression(tailX, tailY).beta));
+    }
     
     SECTION("Linear regression") {
         std::vector<double> x = {1.0, 2.0, 3.0, 4.0, 5.0};
@@ -45,6 +131,20 @@ TEST_CASE("Utilities functions", "[utilities]") {
         REQUIRE(regression.beta == Approx(2.0));
         REQUIRE(regression.rsquared == Approx(1.0));
     }
+
+    SECTION("Regression from sufficient statistics") {
+        std::vector<double> x = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+        std::vector<double> y = {2.1, 3.9, 6.2, 7.8, 10.1, 12.0};
+
+        auto direct = Utilities::linearRegression(x, y);
+        auto fromSums = Utilities::regressionFromSums(Utilities::regressionSums(x, y));
+
+        REQUIRE(fromSums.alpha == Approx(direct.alpha));
+        REQUIRE(fromSums.beta == Approx(direct.beta));
+        REQUIRE(fromSums.rsquared == Approx(direct.rsquared));
+        REQUIRE(fromSums.residuals.empty());
+        REQUIRE(Utilities::dotProduct(x, y) == Approx(Utilities::regressionSums(x, y).sumXY));
+    }
 }
 
 TEST_CASE("Market Data loading", "[market_data]") {
@@ -67,11 +167,443 @@ TEST_CASE("Market Data loading", "[market_data]") {
     REQUIRE(prices_a->size() == 3);
     REQUIRE((*prices_a)[0] == Approx(100.0));
     REQUIRE((*prices_a)[2] == Approx(102.0));
-    
+
+    // Symbols are interned in header order and columns are views into one store
+    auto id_c = market_data.getSymbolId("C");
+    REQUIRE(id_c.has_value());
+    REQUIRE(market_data.getSymbol(*id_c) == "C");
+    REQUIRE(market_data.getPrices(*id_c)[1] == Approx(305.0));
+    REQUIRE(market_data.getPriceSeries("C")->data() == market_data.getPrices(*id_c).data());
+    REQUIRE_FALSE(market_data.getSymbolId("D").has_value());
+
+    // Cached sufficient statistics
+    REQUIRE(market_data.getMoments(*id_c).sum == Approx(915.0));
+    auto window = market_data.getWindowMoments(*id_c, 1, 3);
+    market_data.buildPrefixSums();
+    auto prefixWindow = market_data.getWindowMoments(*id_c, 1, 3);
+    REQUIRE(window.sum == Approx(615.0));
+    REQUIRE(prefixWindow.sum == Approx(615.0));
+    REQUIRE(prefixWindow.sumSq == Approx(window.sumSq));
+
     // Clean up
     std::remove("test_data.csv");
 }
 
+TEST_CASE("Market Data parsing edge cases", "[market_data]") {
+    std::ofstream test_file("edge_data.csv", std::ios::binary);
+    test_file << "Date,A,B,C\r\n";
+    test_file << "2020-01-01,100,200,300\r\n";
+    test_file << "\r\n";
+    test_file << "2020-01-02, 101,bad,\r\n";
+    test_file << "2020-01-03,+102,1e2\n";
+    test_file << "2020-01-04,103.25,204,310";
+    test_file.close();
+
+    MarketData market_data("edge_data.csv");
+    std::remove("edge_data.csv");
+
+    REQUIRE(market_data.getDataSize() == 4);
+    REQUIRE(market_data.getSymbol(2) == "C");
+    REQUIRE(Timestamps::format(market_data.getTimestamps()[1]) == "2020-01-02");
+    REQUIRE(market_data.getPrice(0, 1) == Approx(101.0));
+    REQUIRE(std::isnan(market_data.getPrice(1, 1)));
+    REQUIRE(std::isnan(market_data.getPrice(2, 1)));
+    REQUIRE(market_data.getPrice(0, 2) == Approx(102.0));
+    REQUIRE(market_data.getPrice(1, 2) == Approx(100.0));
+    REQUIRE(std::isnan(market_data.getPrice(2, 2)));
+    REQUIRE(market_data.getPrice(0, 3) == Approx(103.25));
+    REQUIRE(market_data.getPrice(2, 3) == Approx(310.0));
+}
+
+TEST_CASE("Market Data binary cache", "[market_data]") {
+    std::ofstream test_file("cache_data.csv");
+    test_file << "Date,A,B\n";
+    for (int i = 0; i < 13; ++i) {
+        test_file << "2020-01-" << (i + 1) << "," << (100.0 + i) << "," << (i == 5 ? "" : "50.5") << "\n";
+    }
+    test_file.close();
+
+    MarketData parsed;
+    REQUIRE(parsed.loadFromCSV("cache_data.csv"));
+    REQUIRE(parsed.saveCache(MarketData::cachePathFor("cache_data.csv")));
+
+    // The constructor prefers the (newer) cache over the CSV
+    MarketData cached("cache_data.csv");
+    REQUIRE(cached.isCacheBacked());
+    REQUIRE_FALSE(parsed.isCacheBacked());
+    REQUIRE(cached.getDataSize() == 13);
+    REQUIRE(cached.getAvailableSymbols() == parsed.getAvailableSymbols());
+    REQUIRE(cached.getTimestamps() == parsed.getTimestamps());
+    REQUIRE(cached.getPeriodsPerYear() == parsed.getPeriodsPerYear());
+    REQUIRE(cached.getSymbolId("B") == parsed.getSymbolId("B"));
+    REQUIRE(cached.getPrice(0, 12) == Approx(112.0));
+    REQUIRE(std::isnan(cached.getPrice(1, 5)));
+    REQUIRE(cached.getMoments(0).sum == parsed.getMoments(0).sum);
+    REQUIRE(reinterpret_cast<uintptr_t>(cached.getPrices(1).data()) % 64 == 0);
+
+    std::remove("cache_data.csv");
+    std::remove(MarketData::cachePathFor("cache_data.csv").c_str());
+}
+
+TEST_CASE("Market Data narrowed price storage", "[market_data]") {
+    std::ofstream test_file("storage_data.csv");
+    test_file << "Date,A,B,C\n";
+    for (int i = 0; i < 200; ++i) {
+        double a = 100.0 + i * 0.05 + sin(i * 0.3) * 4.0;
+        double b = a * 1.5 + sin(i * 0.9) * 0.7;
+        test_file << "2020-01-" << (i + 1) << "," << std::fixed << std::setprecision(4) << a << ","
+                  << b << "," << (i == 7 ? "" : "75.1234") << "\n";
+    }
+    test_file.close();
+
+    auto referenceData = std::make_shared<MarketData>();
+    REQUIRE(referenceData->loadFromCSV("storage_data.csv"));
+    const MarketData& reference = *referenceData;
+    auto referenceScan = PairScanner(referenceData).scan();
+    REQUIRE_FALSE(referenceScan.empty());
+
+    for (auto storage : {MarketData::PriceStorage::Float32, MarketData::PriceStorage::Ticks32}) {
+        auto narrowed = std::make_shared<MarketData>();
+        REQUIRE(narrowed->loadFromCSV("storage_data.csv"));
+        REQUIRE(narrowed->setPriceStorage(storage));
+        REQUIRE(narrowed->getPriceStorage() == storage);
+        REQUIRE_FALSE(narrowed->setPriceStorage(MarketData::PriceStorage::Float64));
+        REQUIRE_FALSE(narrowed->saveCache("storage_data.sacache"));
+
+        // Prices decode to the quoted four decimals; missing cells stay NaN
+        for (size_t day = 0; day < 200; ++day) {
+            REQUIRE(narrowed->getPrice(0, day) == Approx(reference.getPrice(0, day)).epsilon(1e-7));
+            REQUIRE(narrowed->getPrices(1)[day] == Approx(reference.getPrice(1, day)).epsilon(1e-7));
+        }
+        REQUIRE(std::isnan(narrowed->getPrice(2, 7)));
+        REQUIRE(std::isnan(narrowed->getPrices(2)[7]));
+        REQUIRE(narrowed->getPrices(1).data() == narrowed->getPrices(1).data());
+        REQUIRE(narrowed->getMoments(0).sum == Approx(reference.getMoments(0).sum));
+
+        // The screen reads the narrowed columns and accumulates in double
+        auto scan = PairScanner(narrowed).scan();
+        REQUIRE(scan.size() == referenceScan.size());
+        for (size_t k = 0; k < scan.size(); ++k) {
+            REQUIRE(scan[k].symbolA == referenceScan[k].symbolA);
+            REQUIRE(scan[k].symbolB == referenceScan[k].symbolB);
+            REQUIRE(scan[k].beta == Approx(referenceScan[k].beta).epsilon(1e-6));
+        }
+    }
+
+    // Ticks are exact for prices quoted on the tick grid
+    MarketData ticks;
+    REQUIRE(ticks.loadFromCSV("storage_data.csv"));
+    REQUIRE(ticks.setPriceStorage(MarketData::PriceStorage::Ticks32, 1e-4));
+    REQUIRE(ticks.getColumn<int32_t>(2)[0] == 751234);
+    REQUIRE(ticks.getColumn<int32_t>(2)[7] == MarketData::kMissingTick);
+
+    // Prices beyond int32 ticks are rejected and the store is left as float64
+    MarketData overflow;
+    REQUIRE(overflow.loadFromCSV("storage_data.csv"));
+    REQUIRE_FALSE(overflow.setPriceStorage(MarketData::PriceStorage::Ticks32, 1e-8));
+    REQUIRE(overflow.getPriceStorage() == MarketData::PriceStorage::Float64);
+    REQUIRE(overflow.getPrice(0, 3) == reference.getPrice(0, 3));
+
+    std::remove("storage_data.csv");
+}
+
+TEST_CASE("Bar timestamps and resampling", "[market_data]") {
+    using namespace Timestamps;
+
+    SECTION("Timestamps parse to epoch nanoseconds and format back") {
+        int64_t t = 0;
+        REQUIRE(parse("2020-01-02", t));
+        REQUIRE(t == 1577923200LL * kNanosPerSecond);
+        REQUIRE(format(t) == "2020-01-02");
+        REQUIRE(parse("2020-01-02 09:30:00.25", t));
+        REQUIRE(format(t) == "2020-01-02 09:30:00.25");
+        int64_t utc = 0;
+        REQUIRE(parse("2020-01-02T10:30:00.250+01:00", utc));
+        REQUIRE(utc == t);
+        REQUIRE(parse("2020-01-02T09:30Z", t));
+        REQUIRE(format(t) == "2020-01-02 09:30:00");
+        REQUIRE(parse("1577923200000000000", t));
+        REQUIRE(format(t) == "2020-01-02");
+        REQUIRE(parse("1969-12-31 23:59:59", t));
+        REQUIRE(t == -kNanosPerSecond);
+        REQUIRE(parse("2020-01-32", t));
+        REQUIRE(format(t) == "2020-02-01");
+        REQUIRE_FALSE(parse("2020-13-01", t));
+        REQUIRE_FALSE(parse("d5", t));
+        REQUIRE_FALSE(parse("2020-01-02 9", t));
+        // Eight bare digits are a compact date, other integers epoch nanoseconds
+        REQUIRE(parse("20200102", t));
+        REQUIRE(format(t) == "2020-01-02");
+        REQUIRE_FALSE(parse("20201301", t));
+        REQUIRE(parse("1577923200000000000", t));
+        REQUIRE(format(t) == "2020-01-02");
+        REQUIRE(parse("1234567", t));
+        REQUIRE(t == 1234567);
+
+        // So a daily file with compact dates loads at the daily frequency
+        std::ofstream compact_file("compact_dates.csv");
+        compact_file << "Date,A\n";
+        for (int i = 0; i < 30; ++i) {
+            int64_t day = 0;
+            REQUIRE(parse("2020-01-01", day));
+            compact_file << format(day + i * kNanosPerDay).erase(7, 1).erase(4, 1) << "," << (100.0 + i) << "\n";
+        }
+        compact_file.close();
+        MarketData compact;
+        REQUIRE(compact.loadFromCSV("compact_dates.csv"));
+        std::remove("compact_dates.csv");
+        REQUIRE(compact.getDataSize() == 30);
+        REQUIRE(format(compact.getTimestamps()[29]) == "2020-01-30");
+        REQUIRE(compact.getBarInterval() == kNanosPerDay);
+        REQUIRE(compact.getPeriodsPerYear() == 252.0);
+
+        int64_t interval = 0;
+        REQUIRE(parseInterval("5m", interval));
+        REQUIRE(interval == 5 * kNanosPerMinute);
+        REQUIRE(formatInterval(interval) == "5m");
+        REQUIRE(parseInterval("250ms", interval));
+        REQUIRE(formatInterval(interval) == "250ms");
+        REQUIRE(formatInterval(90 * kNanosPerMinute) == "90m");
+        REQUIRE_FALSE(parseInterval("0h", interval));
+        REQUIRE_FALSE(parseInterval("5", interval));
+        REQUIRE(floorTo(-1, kNanosPerDay) == -kNanosPerDay);
+        REQUIRE(periodsPerYear({0, 7 * kNanosPerDay, 14 * kNanosPerDay}) == Approx(365.25 / 7));
+    }
+
+    // Two sessions of one-minute bars, 09:30 to 10:29; B misses its last print
+    std::ofstream test_file("intraday_data.csv");
+    test_file << std::fixed << std::setprecision(4) << "Timestamp,A,B\n";
+    for (int day = 0; day < 2; ++day) {
+        for (int minute = 0; minute < 60; ++minute) {
+            double a = 100.0 + day * 10.0 + minute * 0.1 + sin(minute * 0.7);
+            double b = 0.5 * a + cos(minute * 1.3) * 0.2;
+            test_file << "2020-01-0" << (2 + day) << " " << (9 + (30 + minute) / 60) << ":"
+                      << std::setw(2) << std::setfill('0') << (30 + minute) % 60 << ":00," << a << ","
+                      << (day == 1 && minute == 59 ? std::string() : std::to_string(b)) << "\n";
+        }
+    }
+    test_file.close();
+    auto fine = std::make_shared<MarketData>();
+    REQUIRE(fine->loadFromCSV("intraday_data.csv"));
+    std::remove("intraday_data.csv");
+
+    REQUIRE(fine->getDataSize() == 120);
+    REQUIRE(format(fine->getTimestamps()[1]) == "2020-01-02 09:31:00");
+    REQUIRE(fine->getBarInterval() == kNanosPerMinute);
+    REQUIRE(fine->getPeriodsPerYear() == 252.0 * 60);
+
+    SECTION("Resampling keeps each bucket's last price") {
+        MarketData fiveMinute = fine->resample(5 * kNanosPerMinute);
+        REQUIRE(fiveMinute.getDataSize() == 24);
+        REQUIRE(fiveMinute.getTimestamps()[0] == fine->getTimestamps()[0]);
+        REQUIRE(fiveMinute.getBarInterval() == 5 * kNanosPerMinute);
+        REQUIRE(fiveMinute.getPeriodsPerYear() == 252.0 * 12);
+        REQUIRE(fiveMinute.getAvailableSymbols() == fine->getAvailableSymbols());
+        for (size_t bar = 0; bar < 24; ++bar) {
+            REQUIRE(fiveMinute.getTimestamps()[bar] == fine->getTimestamps()[5 * bar]);
+            REQUIRE(fiveMinute.getPrice(0, bar) == fine->getPrice(0, 5 * bar + 4));
+        }
+        REQUIRE(fiveMinute.getPrice(1, 23) == fine->getPrice(1, 118));
+        REQUIRE(fiveMinute.getMoments(0).sum == Approx(fiveMinute.getWindowMoments(0, 0, 24).sum));
+
+        MarketData daily = fine->resample(kNanosPerDay);
+        REQUIRE(daily.getDataSize() == 2);
+        REQUIRE(format(daily.getTimestamps()[1]) == "2020-01-03");
+        REQUIRE(daily.getPrice(0, 1) == fine->getPrice(0, 119));
+        REQUIRE(daily.getPeriodsPerYear() == 252.0);
+
+        // Narrowed stores resample from their stored values
+        MarketData narrowed = fine->slice(0, fine->getDataSize());
+        REQUIRE(narrowed.setPriceStorage(MarketData::PriceStorage::Float32));
+        REQUIRE(narrowed.getPeriodsPerYear() == fine->getPeriodsPerYear());
+        MarketData narrowedDaily = narrowed.resample(kNanosPerDay);
+        REQUIRE(narrowedDaily.getPrice(0, 0) == static_cast<float>(fine->getPrice(0, 59)));
+    }
+
+    SECTION("Metrics are annualized with the bar frequency") {
+        Backtester backtester(fine);
+        backtester.setVerbose(false);
+        backtester.addPair(PairCandidate{0, 1, 2.0, 0.0, 0.0});
+        backtester.runBacktest(100000.0, 1.0, 0.0, 10, true);
+        REQUIRE(backtester.getPeriodsPerYear() == 252.0 * 60);
+        REQUIRE_FALSE(backtester.getTradeHistory().empty());
+        auto metrics = backtester.getPerformanceMetrics();
+        auto daily = Backtester::computeMetrics(backtester.getPortfolioValues(), backtester.getTradeHistory(),
+                                                100000.0);
+        REQUIRE(metrics.sharpeRatio == Approx(daily.sharpeRatio * std::sqrt(60.0)));
+        REQUIRE(metrics.avgHoldingPeriod == daily.avgHoldingPeriod);
+    }
+
+    SECTION("Unparseable timestamps fail the load") {
+        std::ofstream bad_file("bad_timestamp_data.csv");
+        bad_file << "Date,A\n2020-01-02,1\nyesterday,2\n";
+        bad_file.close();
+        MarketData bad;
+        REQUIRE_FALSE(bad.loadFromCSV("bad_timestamp_data.csv"));
+        REQUIRE(bad.getDataSize() == 0);
+        std::remove("bad_timestamp_data.csv");
+    }
+}
+
+TEST_CASE("Missing-data alignment", "[market_data]") {
+    using Validity::Range;
+
+    SECTION("Bitmap scans cross word boundaries") {
+        std::vector<Validity::Word> a(Validity::numWords(200), 0);
+        std::vector<Validity::Word> b(a.size(), 0);
+        for (size_t i = 0; i < 200; ++i) {
+            bool inA = (i >= 3 && i < 70) || (i >= 128 && i < 130) || i >= 190;
+            a[i / 64] |= static_cast<Validity::Word>(inA) << (i % 64);
+            b[i / 64] |= static_cast<Validity::Word>(i % 2 == 0 || i >= 60) << (i % 64);
+        }
+        REQUIRE(Validity::count(a.data(), a.size()) == 67 + 2 + 10);
+        REQUIRE(Validity::test(a.data(), 69));
+        REQUIRE_FALSE(Validity::test(a.data(), 70));
+        REQUIRE(Validity::find(a.data(), 70, 200, true) == 128);
+        REQUIRE(Validity::find(a.data(), 3, 50, false) == 50);
+        REQUIRE(Validity::findLast(a.data(), 0, 128) == 69);
+        REQUIRE(Validity::findLast(a.data(), 70, 128) == 128);
+        REQUIRE(Validity::findLast(a.data(), 0, 200) == 199);
+
+        std::vector<Range> runs;
+        Validity::runs(a.data(), 0, 200, runs);
+        REQUIRE(runs == std::vector<Range>{{3, 70}, {128, 130}, {190, 200}});
+        runs.clear();
+        Validity::runs(a.data(), b.data(), 50, 140, runs);
+        const std::vector<Range> joint = {{50, 51}, {52, 53}, {54, 55}, {56, 57}, {58, 59}, {60, 70}, {128, 130}};
+        REQUIRE(runs == joint);
+        REQUIRE(Validity::length(runs) == 17);
+    }
+
+    // B tracks A; A misses bar 10 and bars 64-70, B its first five bars and bar 100
+    std::ofstream test_file("gappy_data.csv");
+    test_file << std::fixed << std::setprecision(6) << "Date,A,B,C\n";
+    for (int i = 0; i < 150; ++i) {
+        double a = 100.0 + i * 0.1 + sin(i * 0.3) * 5.0;
+        double b = a * 2.0 + sin(i * 0.3) * 2.0;
+        bool missingA = i == 10 || (i >= 64 && i <= 70);
+        bool missingB = i < 5 || i == 100;
+        test_file << "2020-01-" << (i + 1) << "," << (missingA ? std::string() : std::to_string(a)) << ","
+                  << (missingB ? std::string() : std::to_string(b)) << "," << (80.0 + i * 0.5) << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>();
+    REQUIRE(market_data->loadFromCSV("gappy_data.csv"));
+    const MarketData::SymbolId A = 0, B = 1, C = 2;
+
+    REQUIRE(market_data->getValidCount(A) == 142);
+    REQUIRE(market_data->getValidCount(B) == 144);
+    REQUIRE_FALSE(market_data->isComplete(A));
+    REQUIRE(market_data->isComplete(C));
+    REQUIRE_FALSE(Validity::test(market_data->getValidity(A), 64));
+    REQUIRE(Validity::test(market_data->getValidity(A), 71));
+
+    SECTION("Moments cover the observed bars only") {
+        double sum = 0.0;
+        for (size_t day = 0; day < 150; ++day) {
+            double price = market_data->getPrice(A, day);
+            sum += std::isnan(price) ? 0.0 : price;
+        }
+        REQUIRE(market_data->getMoments(A).sum == Approx(sum));
+        REQUIRE(std::isfinite(market_data->getMoments(A).sumSq));
+    }
+
+    SECTION("Drop aligns on the bars both legs observed") {
+        std::vector<Range> ranges;
+        market_data->alignPair(A, B, ranges);
+        REQUIRE(ranges == std::vector<Range>{{5, 10}, {11, 64}, {71, 100}, {101, 150}});
+        market_data->alignPair(A, C, ranges);
+        REQUIRE(ranges == std::vector<Range>{{0, 10}, {11, 64}, {71, 150}});
+        market_data->alignPair(C, C, ranges);
+        REQUIRE(ranges == std::vector<Range>{{0, 150}});
+
+        std::vector<double> alignedA, alignedB;
+        market_data->alignPrices(A, B, ranges, alignedA, alignedB);
+        REQUIRE(alignedA.size() == 136);
+        REQUIRE(alignedA[5] == market_data->getPrice(A, 11));
+        REQUIRE(alignedB[58] == market_data->getPrice(B, 71));
+        auto sums = market_data->getRegressionSums(B, A);
+        auto expected = Utilities::regressionSums(alignedB, alignedA);
+        REQUIRE(sums.n == 136.0);
+        REQUIRE(sums.sumXY == expected.sumXY);
+        REQUIRE(sums.sumYY == expected.sumYY);
+    }
+
+    SECTION("ForwardFill carries each leg's last price from the first shared bar") {
+        market_data->setFillPolicy(MarketData::FillPolicy::ForwardFill);
+        std::vector<Range> ranges;
+        std::vector<double> alignedA, alignedB;
+        market_data->alignPrices(A, B, ranges, alignedA, alignedB);
+        REQUIRE(ranges == std::vector<Range>{{5, 150}});
+        REQUIRE(alignedA[10 - 5] == market_data->getPrice(A, 9));
+        REQUIRE(alignedA[70 - 5] == market_data->getPrice(A, 63));
+        REQUIRE(alignedB[100 - 5] == market_data->getPrice(B, 99));
+        REQUIRE(market_data->getRegressionSums(A, B).n == 145.0);
+
+        // Slices and resampled copies keep the policy
+        REQUIRE(market_data->slice(0, 100).getFillPolicy() == MarketData::FillPolicy::ForwardFill);
+        REQUIRE(market_data->resample(2 * Timestamps::kNanosPerDay).getFillPolicy() ==
+                MarketData::FillPolicy::ForwardFill);
+    }
+
+    SECTION("Filled prices for trading") {
+        PriceView filled = market_data->getFilledPrices(B);
+        REQUIRE(filled.size() == 150);
+        REQUIRE(std::isnan(filled[4]));
+        REQUIRE(filled[5] == market_data->getPrice(B, 5));
+        REQUIRE(filled[100] == market_data->getPrice(B, 99));
+        REQUIRE(market_data->getFilledPrices(B).data() == filled.data());
+        REQUIRE(market_data->getFilledPrices(C).data() == market_data->getPrices(C).data());
+    }
+
+    SECTION("Pairs with gaps are screened on their aligned bars") {
+        for (auto policy : {MarketData::FillPolicy::Drop, MarketData::FillPolicy::ForwardFill}) {
+            market_data->setFillPolicy(policy);
+            std::vector<Range> ranges;
+            std::vector<double> alignedA, alignedB, spreads;
+            market_data->alignPrices(A, B, ranges, alignedA, alignedB);
+            auto expected = AssetPair::evaluateCointegration(alignedA, alignedB, spreads);
+            REQUIRE(expected.isCointegrated);
+
+            PairScanner::Options options;
+            options.numThreads = 2;
+            options.blockSize = 2;
+            PairScanner scanner(market_data, options);
+            auto candidates = scanner.scan();
+            REQUIRE(scanner.getPairsTested() == 3);
+            REQUIRE_FALSE(candidates.empty());
+            REQUIRE(candidates[0].symbolA == A);
+            REQUIRE(candidates[0].symbolB == B);
+            REQUIRE(candidates[0].beta == Approx(expected.beta));
+            REQUIRE(candidates[0].adfStatistic == Approx(expected.adfStatistic));
+
+            Backtester backtester(market_data);
+            backtester.addPair("A", "B");
+            REQUIRE(backtester.getNumPairs() == 1);
+        }
+    }
+
+    SECTION("Bitmaps survive the cache and narrowing") {
+        REQUIRE(market_data->saveCache("gappy_data.sacache"));
+        MarketData cached;
+        REQUIRE(cached.loadFromCache("gappy_data.sacache"));
+        std::remove("gappy_data.sacache");
+        for (MarketData::SymbolId id = 0; id < 3; ++id) {
+            REQUIRE(cached.getValidCount(id) == market_data->getValidCount(id));
+            REQUIRE(std::equal(cached.getValidity(id), cached.getValidity(id) + Validity::numWords(150),
+                               market_data->getValidity(id)));
+        }
+        REQUIRE(cached.getMoments(B).sum == market_data->getMoments(B).sum);
+
+        MarketData ticks = market_data->slice(0, 150);
+        REQUIRE(ticks.setPriceStorage(MarketData::PriceStorage::Ticks32, 1e-6));
+        REQUIRE(ticks.getValidCount(A) == 142);
+        REQUIRE(ticks.getMoments(A).sum == Approx(market_data->getMoments(A).sum));
+    }
+
+    std::remove("gappy_data.csv");
+}
+
 TEST_CASE("Asset Pair functionality", "[asset_pair]") {
     std::vector<double> prices_a = {100.0, 101.0, 102.0, 101.5, 101.0, 100.5, 101.0, 102.0, 103.0, 102.5};
     std::vector<double> prices_b = {200.0, 202.0, 204.0, 203.0, 202.0, 201.0, 202.0, 204.0, 206.0, 205.0};
@@ -136,4 +668,1913 @@ TEST_CASE("Backtester execution", "[backtester]") {
     
     // Clean up
     std::remove("backtest_data.csv");
-} 
\ No newline at end of file
+} 
+
+TEST_CASE("Pair scanner", "[pair_scanner]") {
+    SECTION("Parallel scan matches the serial cointegration test") {
+        std::ofstream test_file("scanner_data.csv");
+        test_file << "Date,A1,B1,A2,B2,C\n";
+        for (int i = 0; i < 120; ++i) {
+            double a1 = 100.0 + i * 0.1 + sin(i * 0.3) * 5.0;
+            double b1 = a1 * 2.0 + sin(i * 0.3) * 2.0;
+            double a2 = 50.0 + i * 0.2 + sin(i * 0.3) * 3.0;
+            double b2 = a2 * 0.5 + sin(i * 0.7) * 1.0;
+            double c = 80.0 + i * 0.5;
+            test_file << "2020-01-" << (i + 1) << "," << a1 << "," << b1 << "," << a2 << "," << b2 << "," << c << "\n";
+        }
+        test_file.close();
+
+        auto market_data = std::make_shared<MarketData>("scanner_data.csv");
+        std::remove("scanner_data.csv");
+
+        PairScanner::Options options;
+        options.numThreads = 4;
+        options.blockSize = 2;
+        options.timeBlock = 50;
+        PairScanner scanner(market_data, options);
+        auto candidates = scanner.scan();
+        REQUIRE(scanner.getPairsTested() == 10);
+
+        std::vector<PairCandidate> expected;
+        const auto& symbols = market_data->getAvailableSymbols();
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            for (size_t j = i + 1; j < symbols.size(); ++j) {
+                AssetPair pair(symbols[i], symbols[j],
+                               *market_data->getPriceSeries(symbols[i]),
+                               *market_data->getPriceSeries(symbols[j]));
+                if (pair.testCointegration()) {
+                    expected.push_back({static_cast<MarketData::SymbolId>(i),
+                                        static_cast<MarketData::SymbolId>(j),
+                                        pair.getCointegrationBeta(), 0.0, 0.0});
+                }
+            }
+        }
+
+        REQUIRE(candidates.size() == expected.size());
+        REQUIRE_FALSE(candidates.empty());
+        for (size_t k = 0; k < expected.size(); ++k) {
+            REQUIRE(candidates[k].symbolA == expected[k].symbolA);
+            REQUIRE(candidates[k].symbolB == expected[k].symbolB);
+            REQUIRE(candidates[k].beta == Approx(expected[k].beta));
+        }
+    }
+
+    SECTION("Correlation prefilter") {
+        // Eight symbols in four co-moving pairs driven by separate random walks
+        std::mt19937 rng(7);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        std::ofstream test_file("prefilter_data.csv");
+        test_file << "Date,A0,A1,A2,A3,B0,B1,B2,B3\n";
+        double walk[4] = {100.0, 80.0, 60.0, 120.0};
+        test_file << std::setprecision(10);
+        for (int i = 0; i < 300; ++i) {
+            std::vector<double> row(8);
+            for (int k = 0; k < 4; ++k) {
+                walk[k] += noise(rng);
+                row[k] = walk[k];
+                row[4 + k] = 0.5 * walk[k] + 0.2 * noise(rng);
+            }
+            test_file << "2020-01-" << (i + 1);
+            for (double value : row) {
+                test_file << "," << value;
+            }
+            test_file << "\n";
+        }
+        test_file.close();
+
+        auto market_data = std::make_shared<MarketData>("prefilter_data.csv");
+        std::remove("prefilter_data.csv");
+        std::vector<MarketData::SymbolId> universe(8);
+        std::iota(universe.begin(), universe.end(), 0);
+
+        // Matches a direct Pearson correlation of the returns
+        auto correlations = PairScanner::returnCorrelations(*market_data, universe, 2, 3);
+        REQUIRE(correlations.size() == 64);
+        auto returnsA = Utilities::calculateReturns(market_data->getPrices(0));
+        for (MarketData::SymbolId b = 0; b < 8; ++b) {
+            auto returnsB = Utilities::calculateReturns(market_data->getPrices(b));
+            double meanA = Utilities::mean(returnsA), meanB = Utilities::mean(returnsB);
+            double sab = 0.0, saa = 0.0, sbb = 0.0;
+            for (size_t t = 0; t < returnsA.size(); ++t) {
+                sab += (returnsA[t] - meanA) * (returnsB[t] - meanB);
+                saa += (returnsA[t] - meanA) * (returnsA[t] - meanA);
+                sbb += (returnsB[t] - meanB) * (returnsB[t] - meanB);
+            }
+            REQUIRE(correlations[b] == Approx(sab / std::sqrt(saa * sbb)).margin(1e-12));
+            REQUIRE(correlations[b * 8] == correlations[b]);
+        }
+
+        PairScanner::Options options;
+        options.numThreads = 2;
+        options.blockSize = 3;
+        PairScanner full(market_data, options);
+        auto all = full.scan();
+        REQUIRE(full.getPairsTested() == 28);
+
+        // Top-1 only tests the four co-moving pairs and finds the same ones
+        options.topK = 1;
+        PairScanner filtered(market_data, options);
+        auto kept = filtered.scan();
+        REQUIRE(filtered.getPairsTested() == 4);
+        REQUIRE_FALSE(kept.empty());
+        for (const auto& candidate : kept) {
+            REQUIRE(candidate.symbolB == candidate.symbolA + 4);
+            auto match = std::find_if(all.begin(), all.end(), [&](const PairCandidate& c) {
+                return c.symbolA == candidate.symbolA && c.symbolB == candidate.symbolB;
+            });
+            REQUIRE(match != all.end());
+            REQUIRE(match->beta == candidate.beta);
+            REQUIRE(match->adfStatistic == candidate.adfStatistic);
+        }
+
+        // Once K covers every partner the prefilter is skipped
+        options.topK = 7;
+        PairScanner wide(market_data, options);
+        REQUIRE(wide.scan().size() == all.size());
+        REQUIRE(wide.getPairsTested() == 28);
+    }
+}
+
+TEST_CASE("Spread basket", "[basket]") {
+    // A0 = 0.5 * W1 + 0.3 * W2 + noise, with W1, W2, W3 independent random walks
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::ofstream test_file("basket_data.csv");
+    test_file << "Date,A0,W1,W2,W3\n" << std::setprecision(12);
+    double w1 = 50.0, w2 = 80.0, w3 = 30.0;
+    for (int i = 0; i < 1000; ++i) {
+        w1 += noise(rng);
+        w2 += noise(rng);
+        w3 += noise(rng);
+        double a0 = 0.5 * w1 + 0.3 * w2 + 0.5 * noise(rng);
+        test_file << "2020-01-" << (i + 1) << "," << a0 << "," << w1 << "," << w2 << "," << w3 << "\n";
+    }
+    test_file.close();
+
+    auto market_data = std::make_shared<MarketData>("basket_data.csv");
+    std::remove("basket_data.csv");
+    const auto& symbols = market_data->getAvailableSymbols();
+    auto basketOf = [&](const std::vector<MarketData::SymbolId>& ids) {
+        std::vector<std::string> names;
+        std::vector<PriceView> prices;
+        for (auto id : ids) {
+            names.push_back(symbols[id]);
+            prices.push_back(market_data->getPrices(id));
+        }
+        return SpreadBasket(names, prices);
+    };
+
+    SECTION("Johansen estimate recovers the cointegrating vector") {
+        SpreadBasket basket = basketOf({0, 1, 2});
+        REQUIRE(basket.testCointegration());
+        const auto& result = basket.getCointegrationResult();
+        REQUIRE(result.rank == 1);
+        REQUIRE(result.traceStatistics[0] > result.criticalValues[0]);
+        REQUIRE(result.criticalValues[0] == Approx(Johansen::traceCriticalValue(3, 0.05)));
+        REQUIRE(result.eigenvalues[0] >= result.eigenvalues[1]);
+        auto weights = basket.getWeights();
+        REQUIRE(weights[0] == 1.0);
+        REQUIRE(weights[1] == Approx(-0.5).margin(0.02));
+        REQUIRE(weights[2] == Approx(-0.3).margin(0.02));
+        REQUIRE(basket.getSpread(10) == Approx(market_data->getPrice(0, 10) + weights[1] * market_data->getPrice(1, 10) +
+                                              weights[2] * market_data->getPrice(2, 10)));
+
+        // Independent walks are not cointegrated
+        SpreadBasket walks = basketOf({1, 2, 3});
+        REQUIRE_FALSE(walks.testCointegration());
+        REQUIRE(walks.getCointegrationResult().rank == 0);
+    }
+
+    SECTION("Two-leg basket reproduces the pair signals") {
+        AssetPair pair(symbols[0], symbols[1], market_data->getPrices(0), market_data->getPrices(1));
+        pair.setCointegrationBeta(0.7);
+        SpreadBasket basket = basketOf({0, 1});
+        basket.setWeights({1.0, -0.7});
+
+        auto pairZ = pair.getZScores(30);
+        auto basketZ = basket.getZScores(30);
+        REQUIRE(basketZ.size() == pairZ.size());
+        for (size_t i = 29; i < pairZ.size(); ++i) {
+            REQUIRE(basketZ[i] == Approx(pairZ[i]).margin(1e-9));
+        }
+        REQUIRE(basket.generateSignals(1.5, 0.0, 30) == pair.generateSignals(1.5, 0.0, 30));
+    }
+
+    SECTION("Streaming replay matches the batch signals") {
+        SpreadBasket basket = basketOf({0, 1, 2});
+        basket.testCointegration();
+        auto batch = basket.generateSignals(1.0, 0.0, 40);
+        SpreadBasket live(basket.getSymbols(), basket.getWeights());
+        live.startStreaming(1.0, 0.0, 40);
+        for (size_t t = 0; t < basket.getNumBars(); ++t) {
+            double prices[3] = {basket.getPrice(t, 0), basket.getPrice(t, 1), basket.getPrice(t, 2)};
+            REQUIRE(live.onBar(prices) == batch[t]);
+        }
+        REQUIRE(live.getBarsSeen() == basket.getNumBars());
+    }
+
+    SECTION("Basket scanner") {
+        BasketScanner::Options options;
+        options.numThreads = 2;
+        options.batchSize = 1;
+        BasketScanner scanner(market_data, options);
+        std::vector<std::vector<MarketData::SymbolId>> baskets = {{1, 2, 3}, {0, 1, 2}, {0, 1, 2, 3}};
+        auto accepted = scanner.scan(baskets);
+        REQUIRE(scanner.getBasketsTested() == 3);
+        REQUIRE(accepted.size() == 2);
+        REQUIRE(accepted[0].symbols == baskets[1]);
+        REQUIRE(accepted[1].symbols == baskets[2]);
+
+        // Same estimate as the basket's own test
+        SpreadBasket basket = basketOf({0, 1, 2});
+        basket.testCointegration();
+        for (size_t leg = 0; leg < 3; ++leg) {
+            REQUIRE(accepted[0].weights[leg] == Approx(basket.getWeights()[leg]));
+        }
+        REQUIRE(accepted[0].traceStatistic == Approx(basket.getCointegrationResult().traceStatistics[0]));
+
+        // Generated candidates: one sorted basket per symbol, duplicates removed
+        auto generated = BasketScanner::correlatedBaskets(*market_data, 3, 1);
+        REQUIRE_FALSE(generated.empty());
+        REQUIRE(generated.size() <= 4);
+        for (const auto& legs : generated) {
+            REQUIRE(legs.size() == 3);
+            REQUIRE(std::is_sorted(legs.begin(), legs.end()));
+        }
+        BasketScanner generatedScan(market_data, options);
+        generatedScan.scan();
+        REQUIRE(generatedScan.getBasketsTested() == generated.size());
+    }
+}
+
+TEST_CASE("Backtester mark-to-market accounting", "[backtester]") {
+    std::ofstream test_file("accounting_data.csv");
+    test_file << "Date,A1,B1,A2,B2\n";
+    for (int i = 0; i < 150; ++i) {
+        double a1 = 100.0 + i * 0.1 + sin(i * 0.3) * 5.0;
+        double b1 = 50.0 + i * 0.05 + cos(i * 0.2) * 2.0;
+        double a2 = 50.0 + i * 0.2 + sin(i * 0.45) * 3.0;
+        double b2 = 80.0 - i * 0.1 + sin(i * 0.25) * 1.5;
+        test_file << "2020-01-" << (i + 1) << "," << a1 << "," << b1 << "," << a2 << "," << b2 << "\n";
+    }
+    test_file.close();
+
+    auto market_data = std::make_shared<MarketData>("accounting_data.csv");
+    std::remove("accounting_data.csv");
+
+    // Force both pairs in regardless of the cointegration screen
+    Backtester backtester(market_data);
+    backtester.addPair(PairCandidate{0, 1, 1.5, 0.0, 0.0});
+    backtester.addPair(PairCandidate{2, 3, 0.8, 0.0, 0.0});
+    backtester.runBacktest(100000.0, 1.0, 0.0, 10, true);
+
+    const auto& values = backtester.getPortfolioValues();
+    REQUIRE(values.size() == 150);
+    REQUIRE(values[0] == Approx(100000.0));
+    REQUIRE_FALSE(backtester.getTradeHistory().empty());
+
+    // Final value = capital + realised P&L + unrealised P&L of the live book
+    double expected = 100000.0;
+    for (const auto& trade : backtester.getTradeHistory()) {
+        expected += trade.pnl;
+    }
+    for (const auto& position : backtester.getOpenPositions()) {
+        auto pricesA = market_data->getPrices(position.symbolA);
+        auto pricesB = market_data->getPrices(position.symbolB);
+        expected += position.quantityA * (pricesA.back() - position.entryPriceA)
+                  + position.quantityB * (pricesB.back() - position.entryPriceB);
+    }
+    REQUIRE(values.back() == Approx(expected));
+    REQUIRE(backtester.getOpenPositions().size() <= 2);
+
+    // A repeat run reuses the workspace buffers and reproduces the result
+    std::vector<double> firstRun = values;
+    const double* storage = values.data();
+    const auto* trades = backtester.getTradeHistory().data();
+    backtester.runBacktest(100000.0, 1.0, 0.0, 10, true);
+    REQUIRE(backtester.getPortfolioValues().data() == storage);
+    REQUIRE(backtester.getTradeHistory().data() == trades);
+    REQUIRE(backtester.getPortfolioValues() == firstRun);
+    for (const auto& position : backtester.getOpenPositions()) {
+        REQUIRE(market_data->getSymbol(position.symbolA) ==
+                backtester.getPair(position.pairIndex).getSymbolA());
+    }
+}
+
+TEST_CASE("Backtester result export", "[backtester]") {
+    std::ofstream test_file("export_data.csv");
+    test_file << "Date,A,B\n";
+    for (int i = 0; i < 150; ++i) {
+        double a = 100.0 + i * 0.1 + sin(i * 0.3) * 5.0;
+        double b = 50.0 + i * 0.05 + cos(i * 0.2) * 2.0;
+        test_file << "2020-01-" << (i + 1) << "," << a << "," << b << "\n";
+    }
+    test_file.close();
+
+    auto market_data = std::make_shared<MarketData>("export_data.csv");
+    std::remove("export_data.csv");
+
+    Backtester backtester(market_data);
+    backtester.addPair(PairCandidate{0, 1, 1.5, 0.0, 0.0});
+    backtester.runBacktest(100000.0, 1.0, 0.0, 10, true);
+    const auto& values = backtester.getPortfolioValues();
+    const auto& trades = backtester.getTradeHistory();
+    REQUIRE_FALSE(trades.empty());
+
+    // Trade records carry their own prices; P&L is consistent with them
+    for (const auto& trade : trades) {
+        REQUIRE(trade.exitDay >= trade.entryDay);
+        REQUIRE(trade.exitPriceA == market_data->getPrice(0, trade.exitDay));
+        REQUIRE(trade.pnl == Approx(trade.quantityA * (trade.exitPriceA - trade.entryPriceA) +
+                                    trade.quantityB * (trade.exitPriceB - trade.entryPriceB)));
+    }
+
+    SECTION("CSV values round-trip exactly") {
+        REQUIRE(backtester.exportResults("export_values.csv"));
+        std::ifstream in("export_values.csv");
+        std::string line;
+        std::getline(in, line);
+        REQUIRE(line == "Day,PortfolioValue");
+        size_t rows = 0;
+        while (std::getline(in, line)) {
+            size_t comma = line.find(',');
+            REQUIRE(std::stoul(line.substr(0, comma)) == rows);
+            REQUIRE(std::stod(line.substr(comma + 1)) == values[rows]);
+            ++rows;
+        }
+        REQUIRE(rows == values.size());
+        in.close();
+        std::remove("export_values.csv");
+
+        REQUIRE(backtester.exportTrades("export_trades.csv"));
+        std::ifstream tradesIn("export_trades.csv");
+        std::getline(tradesIn, line);
+        REQUIRE(line.rfind("PairA,PairB,Direction,EntryDay,ExitDay", 0) == 0);
+        std::getline(tradesIn, line);
+        REQUIRE(line.rfind("A,B,", 0) == 0);
+        REQUIRE(std::stod(line.substr(line.rfind(',') + 1)) == trades[0].pnl);
+        tradesIn.close();
+        std::remove("export_trades.csv");
+    }
+
+    SECTION("Columnar trade log") {
+        REQUIRE(backtester.exportTrades("export_trades.sacol"));
+        std::ifstream in("export_trades.sacol", std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::remove("export_trades.sacol");
+
+        REQUIRE(bytes.size() >= 24);
+        REQUIRE(std::string(bytes.data(), 8) == "SACOL001");
+        uint32_t numColumns;
+        uint64_t numRows;
+        std::memcpy(&numColumns, bytes.data() + 12, sizeof(numColumns));
+        std::memcpy(&numRows, bytes.data() + 16, sizeof(numRows));
+        REQUIRE(numColumns == 11);
+        REQUIRE(numRows == trades.size());
+
+        // Find columns by name in the directory and check them against the records
+        auto column = [&](const std::string& name, uint32_t& type) -> const char* {
+            for (uint32_t c = 0; c < numColumns; ++c) {
+                const char* entry = bytes.data() + 24 + c * 64;
+                if (name == entry) {
+                    uint64_t offset;
+                    std::memcpy(&type, entry + 48, sizeof(type));
+                    std::memcpy(&offset, entry + 56, sizeof(offset));
+                    REQUIRE(offset % 64 == 0);
+                    return bytes.data() + offset;
+                }
+            }
+            return nullptr;
+        };
+        uint32_t type = 0;
+        const char* pnl = column("PnL", type);
+        REQUIRE(pnl != nullptr);
+        REQUIRE(type == static_cast<uint32_t>(Utilities::ColumnType::Float64));
+        const char* exitDay = column("ExitDay", type);
+        REQUIRE(exitDay != nullptr);
+        REQUIRE(type == static_cast<uint32_t>(Utilities::ColumnType::Int32));
+        for (size_t r = 0; r < trades.size(); ++r) {
+            double value;
+            int32_t day;
+            std::memcpy(&value, pnl + r * sizeof(double), sizeof(value));
+            std::memcpy(&day, exitDay + r * sizeof(int32_t), sizeof(day));
+            REQUIRE(value == trades[r].pnl);
+            REQUIRE(day == trades[r].exitDay);
+        }
+
+        // A run without trades writes the directory and no rows
+        Backtester idle(market_data);
+        idle.setVerbose(false);
+        idle.addPair(PairCandidate{0, 1, 1.5, 0.0, 0.0});
+        idle.runBacktest(100000.0, 1e9, 0.0, 10, true);
+        REQUIRE(idle.getTradeHistory().empty());
+        REQUIRE(idle.exportTrades("export_empty.sacol"));
+        std::ifstream emptyIn("export_empty.sacol", std::ios::binary);
+        std::vector<char> emptyBytes((std::istreambuf_iterator<char>(emptyIn)), std::istreambuf_iterator<char>());
+        emptyIn.close();
+        std::remove("export_empty.sacol");
+        REQUIRE(std::string(emptyBytes.data(), 8) == "SACOL001");
+        std::memcpy(&numColumns, emptyBytes.data() + 12, sizeof(numColumns));
+        std::memcpy(&numRows, emptyBytes.data() + 16, sizeof(numRows));
+        REQUIRE(numColumns == 11);
+        REQUIRE(numRows == 0);
+    }
+}
+
+TEST_CASE("Parameter sweep", "[sweep]") {
+    SECTION("Grid spec parsing") {
+        ParameterSweep::Grid grid;
+        grid.entryThresholds = {1.5};
+        grid.exitThresholds = {0.0};
+        grid.lookbackWindows = {20};
+
+        REQUIRE(ParameterSweep::parseGrid("entry=1.0:2.0:0.25,window=20,60,120", grid));
+        REQUIRE(grid.entryThresholds.size() == 5);
+        REQUIRE(grid.entryThresholds.back() == Approx(2.0));
+        REQUIRE(grid.exitThresholds.size() == 1);
+        REQUIRE(grid.lookbackWindows == std::vector<size_t>{20, 60, 120});
+        REQUIRE(grid.size() == 15);
+
+        REQUIRE_FALSE(ParameterSweep::parseGrid("stop=1", grid));
+        REQUIRE_FALSE(ParameterSweep::parseGrid("entry=2.0:1.0:0.5", grid));
+    }
+
+    SECTION("Sweep points match individual backtests") {
+        std::ofstream test_file("sweep_data.csv");
+        test_file << "Date,A1,B1,A2,B2\n";
+        for (int i = 0; i < 150; ++i) {
+            double a1 = 100.0 + i * 0.1 + sin(i * 0.3) * 5.0;
+            double b1 = 50.0 + i * 0.05 + cos(i * 0.2) * 2.0;
+            double a2 = 50.0 + i * 0.2 + sin(i * 0.45) * 3.0;
+            double b2 = 80.0 - i * 0.1 + sin(i * 0.25) * 1.5;
+            test_file << "2020-01-" << (i + 1) << "," << a1 << "," << b1 << "," << a2 << "," << b2 << "\n";
+        }
+        test_file.close();
+
+        auto market_data = std::make_shared<MarketData>("sweep_data.csv");
+        std::remove("sweep_data.csv");
+        std::vector<PairCandidate> pairs = {{0, 1, 1.5, 0.0, 0.0}, {2, 3, 0.8, 0.0, 0.0}};
+
+        ParameterSweep::Options options;
+        options.initialCapital = 100000.0;
+        options.numThreads = 3;
+        ParameterSweep sweep(market_data, pairs, options);
+
+        ParameterSweep::Grid grid;
+        grid.entryThresholds = {1.0, 1.5};
+        grid.exitThresholds = {0.0, 0.5};
+        grid.lookbackWindows = {10, 15};
+        auto results = sweep.run(grid);
+        REQUIRE(results.size() == 8);
+
+        for (const auto& result : results) {
+            Backtester backtester(market_data);
+            backtester.setVerbose(false);
+            for (const auto& pair : pairs) {
+                backtester.addPair(pair);
+            }
+            backtester.runBacktest(100000.0, result.entryThreshold, result.exitThreshold,
+                                   result.lookbackWindow, true);
+            auto metrics = backtester.getPerformanceMetrics();
+            REQUIRE(result.metrics.totalReturn == metrics.totalReturn);
+            REQUIRE(result.metrics.winCount == metrics.winCount);
+        }
+    }
+}
+
+TEST_CASE("Walk-forward", "[walk_forward]") {
+    // A cointegrated pair (A tracks 1.3 B plus AR(1) noise) and an unrelated walk
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    const size_t n = 600;
+    std::vector<double> a(n), b(n), c(n);
+    double b_level = 50.0, c_level = 80.0, ar = 0.0;
+    for (size_t t = 0; t < n; ++t) {
+        b_level += noise(rng);
+        c_level += noise(rng);
+        ar = 0.5 * ar + noise(rng);
+        b[t] = b_level;
+        c[t] = c_level;
+        a[t] = 1.3 * b_level + 10.0 + ar;
+    }
+
+    SECTION("Sliding statistics match a recompute on every window") {
+        Utilities::SlidingCointegration sliding(a, b, 1);
+        std::vector<std::pair<size_t, size_t>> windows;
+        for (size_t begin = 0; begin + 200 <= n; begin += 37) {
+            windows.emplace_back(begin, begin + 200);
+        }
+        windows.emplace_back(100, 350);   // moves back: rebuilt
+        windows.emplace_back(340, 380);   // barely overlaps
+        windows.emplace_back(500, 600);   // disjoint
+
+        for (const auto& window : windows) {
+            sliding.setWindow(window.first, window.second);
+            const size_t length = window.second - window.first;
+            PriceView wa = PriceView(a.data(), n).subview(window.first, length);
+            PriceView wb = PriceView(b.data(), n).subview(window.first, length);
+
+            double beta = Utilities::regressionFromSums(Utilities::regressionSums(wb, wa)).beta;
+            REQUIRE(sliding.beta() == Approx(beta).epsilon(1e-9));
+
+            std::vector<double> spread(length);
+            for (size_t t = 0; t < length; ++t) {
+                spread[t] = wa[t] - beta * wb[t];
+            }
+            auto direct = Utilities::adfTest(spread, 1);
+            auto incremental = sliding.adfTest(beta);
+            REQUIRE(incremental.testStatistic == Approx(direct.testStatistic).epsilon(1e-7));
+            REQUIRE(incremental.isStationary == direct.isStationary);
+        }
+    }
+
+    std::ofstream test_file("walk_forward_data.csv");
+    test_file << std::setprecision(17) << "Date,A,B,C\n";
+    for (size_t t = 0; t < n; ++t) {
+        test_file << "2020-01-" << (t + 1) << "," << a[t] << "," << b[t] << "," << c[t] << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>();
+    REQUIRE(market_data->loadFromCSV("walk_forward_data.csv"));
+    std::remove("walk_forward_data.csv");
+
+    SECTION("Spec parsing and fold layout") {
+        WalkForward::Options options;
+        REQUIRE(WalkForward::parseSpec("train=250,test=50", options));
+        REQUIRE(options.trainBars == 250);
+        REQUIRE(options.testBars == 50);
+        REQUIRE_FALSE(WalkForward::parseSpec("train=250,step=50", options));
+        REQUIRE_FALSE(WalkForward::parseSpec("train=10,test=50", options));
+
+        options.trainBars = 250;
+        WalkForward walk_forward(market_data, options);
+        REQUIRE(walk_forward.numFolds() == 7);
+    }
+
+    SECTION("Folds trade their formation-period screen") {
+        WalkForward::Options options;
+        options.trainBars = 250;
+        options.testBars = 50;
+        options.initialCapital = 100000.0;
+        options.lookbackWindow = 15;
+        options.numThreads = 1;
+        auto folds = WalkForward(market_data, options).run();
+        REQUIRE(folds.size() == 7);
+
+        options.numThreads = 3;
+        auto parallel = WalkForward(market_data, options).run();
+        REQUIRE(parallel.size() == folds.size());
+
+        for (size_t k = 0; k < folds.size(); ++k) {
+            const auto& fold = folds[k];
+            REQUIRE(fold.testBegin == k * 50 + 250);
+            REQUIRE(fold.portfolioValues.size() == 50);
+            REQUIRE(parallel[k].metrics.totalReturn == fold.metrics.totalReturn);
+            REQUIRE(parallel[k].pairs.size() == fold.pairs.size());
+
+            // The screen is the full-history test run on the formation window alone
+            auto formation = std::make_shared<MarketData>(
+                market_data->slice(fold.trainBegin, fold.testBegin));
+            REQUIRE(formation->getDataSize() == 250);
+            PairScanner scanner(formation);
+            auto expected = scanner.scan();
+            REQUIRE(fold.pairs.size() == expected.size());
+            for (size_t p = 0; p < expected.size(); ++p) {
+                REQUIRE(fold.pairs[p].symbolA == expected[p].symbolA);
+                REQUIRE(fold.pairs[p].symbolB == expected[p].symbolB);
+                REQUIRE(fold.pairs[p].beta == Approx(expected[p].beta).epsilon(1e-9));
+            }
+
+            // Trading matches a backtest over the warm-up plus the trading bars
+            auto trading = std::make_shared<MarketData>(
+                market_data->slice(fold.testBegin - 15, fold.testEnd));
+            Backtester backtester(trading);
+            backtester.setVerbose(false);
+            for (const auto& pair : fold.pairs) {
+                backtester.addPair(pair);
+            }
+            backtester.runBacktest(100000.0, 1.5, 0.0, 15, true);
+            REQUIRE(fold.metrics.totalReturn == Approx(backtester.getPerformanceMetrics().totalReturn));
+            REQUIRE(fold.portfolioValues.back() == Approx(backtester.getPortfolioValues().back()));
+        }
+
+        // The cointegrated pair is picked up in most formation windows
+        size_t with_pair = 0;
+        for (const auto& fold : folds) {
+            with_pair += std::any_of(fold.pairs.begin(), fold.pairs.end(), [](const PairCandidate& p) {
+                return p.symbolA == 0 && p.symbolB == 1;
+            });
+        }
+        REQUIRE(with_pair >= 5);
+        REQUIRE(WalkForward::compoundedReturn(folds) ==
+                Approx(std::accumulate(folds.begin(), folds.end(), 1.0, [](double g, const WalkForward::Fold& f) {
+                    return g * (1.0 + f.metrics.totalReturn);
+                }) - 1.0));
+    }
+
+    SECTION("Pairs with gaps are screened on each window's aligned bars") {
+        // A misses bars 60-61 and 320, B bar 430: each falls in some formation windows only
+        std::ofstream gappy_file("walk_forward_gappy.csv");
+        gappy_file << std::setprecision(17) << "Date,A,B,C\n";
+        for (size_t t = 0; t < n; ++t) {
+            const bool missingA = t == 60 || t == 61 || t == 320;
+            const bool missingB = t == 430;
+            gappy_file << "2020-01-" << (t + 1) << ",";
+            if (!missingA) gappy_file << a[t];
+            gappy_file << ",";
+            if (!missingB) gappy_file << b[t];
+            gappy_file << "," << c[t] << "\n";
+        }
+        gappy_file.close();
+        auto gappy = std::make_shared<MarketData>();
+        REQUIRE(gappy->loadFromCSV("walk_forward_gappy.csv"));
+        std::remove("walk_forward_gappy.csv");
+        REQUIRE_FALSE(gappy->isComplete(0));
+
+        WalkForward::Options options;
+        options.trainBars = 250;
+        options.testBars = 50;
+        options.lookbackWindow = 15;
+        options.numThreads = 2;
+        for (auto policy : {MarketData::FillPolicy::Drop, MarketData::FillPolicy::ForwardFill}) {
+            gappy->setFillPolicy(policy);
+            auto folds = WalkForward(gappy, options).run();
+            REQUIRE(folds.size() == 7);
+
+            size_t with_pair = 0;
+            for (const auto& fold : folds) {
+                auto formation = std::make_shared<MarketData>(gappy->slice(fold.trainBegin, fold.testBegin));
+                auto expected = PairScanner(formation).scan();
+                REQUIRE(fold.pairs.size() == expected.size());
+                for (size_t p = 0; p < expected.size(); ++p) {
+                    REQUIRE(fold.pairs[p].symbolA == expected[p].symbolA);
+                    REQUIRE(fold.pairs[p].symbolB == expected[p].symbolB);
+                    REQUIRE(fold.pairs[p].beta == Approx(expected[p].beta).epsilon(1e-9));
+                    REQUIRE(fold.pairs[p].adfStatistic == Approx(expected[p].adfStatistic).epsilon(1e-7));
+                }
+                for (double value : fold.portfolioValues) {
+                    REQUIRE(std::isfinite(value));
+                }
+                with_pair += std::any_of(fold.pairs.begin(), fold.pairs.end(), [](const PairCandidate& p) {
+                    return p.symbolA == 0 && p.symbolB == 1;
+                });
+            }
+            // A gap does not cost the pair the windows after it
+            REQUIRE(with_pair >= 5);
+        }
+    }
+}
+
+TEST_CASE("Sharded runs", "[shard]") {
+    SECTION("Shards partition the work") {
+        Shard shard;
+        REQUIRE(Shard::parse("2/5", shard));
+        REQUIRE(shard.index == 2);
+        REQUIRE(shard.count == 5);
+        REQUIRE_FALSE(Shard::parse("5/5", shard));
+        REQUIRE_FALSE(Shard::parse("1", shard));
+        REQUIRE_FALSE(Shard::parse("0/0", shard));
+
+        for (size_t count : {1u, 3u, 7u}) {
+            for (size_t total : {0u, 5u, 23u}) {
+                size_t next = 0;
+                size_t nextRow = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    Shard part{i, count};
+                    auto range = part.range(total);
+                    REQUIRE(range.first == next);
+                    REQUIRE(range.second - range.first <= total / count + 1);
+                    next = range.second;
+                    auto rows = part.triangleRows(total);
+                    REQUIRE(rows.first == nextRow);
+                    nextRow = rows.second;
+                }
+                REQUIRE(next == total);
+                REQUIRE(nextRow == total);
+            }
+        }
+    }
+
+    std::ofstream test_file("shard_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 12; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 160; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 12; ++s) {
+            // Pairs of symbols share a cycle, so some pairs cointegrate
+            double base = 60.0 + s + sin(i * (0.1 + 0.02 * (s / 2))) * (2.0 + s % 3);
+            test_file << "," << (base + sin(i * (0.7 + 0.05 * s)) * 0.3 + i * 0.01 * (s % 4));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>("shard_data.csv");
+    std::remove("shard_data.csv");
+
+    SECTION("Sharded scans concatenate to the whole scan") {
+        for (size_t topK : {0u, 4u}) {
+            PairScanner::Options options;
+            options.numThreads = 2;
+            options.blockSize = 2;
+            options.topK = topK;
+            PairScanner whole(market_data, options);
+            auto expected = whole.scan();
+            REQUIRE_FALSE(expected.empty());
+
+            std::vector<PairCandidate> merged;
+            size_t tested = 0;
+            for (size_t i = 0; i < 3; ++i) {
+                options.shard = Shard{i, 3};
+                PairScanner part(market_data, options);
+                auto candidates = part.scan();
+                merged.insert(merged.end(), candidates.begin(), candidates.end());
+                tested += part.getPairsTested();
+            }
+            REQUIRE(tested == whole.getPairsTested());
+            REQUIRE(merged.size() == expected.size());
+            for (size_t k = 0; k < merged.size(); ++k) {
+                REQUIRE(merged[k].symbolA == expected[k].symbolA);
+                REQUIRE(merged[k].symbolB == expected[k].symbolB);
+                REQUIRE(merged[k].beta == expected[k].beta);
+            }
+        }
+    }
+
+    std::vector<PairCandidate> pairs;
+    for (MarketData::SymbolId s = 0; s + 1 < 12; ++s) {
+        pairs.push_back(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+    }
+
+    SECTION("Sharded sweeps concatenate to the whole sweep") {
+        ParameterSweep::Grid grid;
+        grid.entryThresholds = {1.0, 1.5, 2.0};
+        grid.exitThresholds = {0.0, 0.5};
+        grid.lookbackWindows = {10, 20};
+
+        ParameterSweep::Options options;
+        options.initialCapital = 100000.0;
+        options.numThreads = 2;
+        auto expected = ParameterSweep(market_data, pairs, options).run(grid);
+
+        std::vector<ParameterSweep::Result> merged;
+        for (size_t i = 0; i < 5; ++i) {
+            options.shard = Shard{i, 5};
+            auto results = ParameterSweep(market_data, pairs, options).run(grid);
+            merged.insert(merged.end(), results.begin(), results.end());
+        }
+        REQUIRE(merged.size() == expected.size());
+        for (size_t k = 0; k < merged.size(); ++k) {
+            REQUIRE(merged[k].entryThreshold == expected[k].entryThreshold);
+            REQUIRE(merged[k].lookbackWindow == expected[k].lookbackWindow);
+            REQUIRE(merged[k].metrics.totalReturn == expected[k].metrics.totalReturn);
+        }
+    }
+
+    SECTION("Fixed-notional shard values add up to the whole run") {
+        auto run = [&](size_t begin, size_t end) {
+            auto backtester = std::make_unique<Backtester>(market_data);
+            backtester->setVerbose(false);
+            backtester->setExecutionMode(Backtester::ExecutionMode::FixedNotional, 1);
+            for (size_t p = begin; p < end; ++p) {
+                backtester->addPair(pairs[p]);
+            }
+            backtester->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            return backtester;
+        };
+        auto whole = run(0, pairs.size());
+        REQUIRE_FALSE(whole->getTradeHistory().empty());
+
+        std::vector<double> merged(whole->getPortfolioValues().size(), 100000.0);
+        std::vector<Backtester::Trade> trades;
+        for (size_t i = 0; i < 3; ++i) {
+            auto range = Shard{i, 3}.range(pairs.size());
+            auto part = run(range.first, range.second);
+            const auto& values = part->getPortfolioValues();
+            for (size_t day = 0; day < values.size(); ++day) {
+                merged[day] += values[day] - 100000.0;
+            }
+            trades.insert(trades.end(), part->getTradeHistory().begin(), part->getTradeHistory().end());
+        }
+        std::stable_sort(trades.begin(), trades.end(),
+                         [](const Backtester::Trade& a, const Backtester::Trade& b) { return a.exitDay < b.exitDay; });
+
+        for (size_t day = 0; day < merged.size(); ++day) {
+            REQUIRE(merged[day] == Approx(whole->getPortfolioValues()[day]));
+        }
+        REQUIRE(trades.size() == whole->getTradeHistory().size());
+        for (size_t k = 0; k < trades.size(); ++k) {
+            REQUIRE(trades[k].exitDay == whole->getTradeHistory()[k].exitDay);
+            REQUIRE(trades[k].pnl == Approx(whole->getTradeHistory()[k].pnl));
+        }
+
+        auto metrics = Backtester::computeMetrics(merged, trades, 100000.0);
+        auto expected = whole->getPerformanceMetrics();
+        REQUIRE(metrics.totalReturn == Approx(expected.totalReturn));
+        REQUIRE(metrics.sharpeRatio == Approx(expected.sharpeRatio));
+        REQUIRE(metrics.winCount == expected.winCount);
+        REQUIRE(metrics.avgHoldingPeriod == Approx(expected.avgHoldingPeriod));
+    }
+}
+
+TEST_CASE("Asset Pair streaming mode", "[asset_pair]") {
+    std::vector<double> prices_a, prices_b;
+    for (int i = 0; i < 300; ++i) {
+        prices_a.push_back(100.0 + i * 0.05 + sin(i * 0.35) * 4.0);
+        prices_b.push_back(60.0 + i * 0.02 + cos(i * 0.15) * 2.0);
+    }
+
+    AssetPair batch("A", "B", prices_a, prices_b);
+    batch.setCointegrationBeta(1.2);
+    auto zscores = batch.getZScores(30);
+    auto signals = batch.generateSignals(1.0, 0.25, 30);
+
+    AssetPair online("A", "B", 1.2);
+    online.startStreaming(1.0, 0.25, 30);
+    for (size_t i = 0; i < prices_a.size(); ++i) {
+        int signal = online.onBar(prices_a[i], prices_b[i]);
+        REQUIRE(signal == signals[i]);
+        if (std::isnan(zscores[i])) {
+            REQUIRE(std::isnan(online.getCurrentZScore()));
+        } else {
+            REQUIRE(online.getCurrentZScore() == zscores[i]);
+        }
+    }
+    REQUIRE(online.getBarsSeen() == 300);
+}
+
+TEST_CASE("Rolling hedge ratio", "[asset_pair]") {
+    std::vector<double> prices_a, prices_b;
+    for (int i = 0; i < 200; ++i) {
+        double b = 50.0 + i * 0.1 + sin(i * 0.2) * 3.0;
+        double beta = (i < 100) ? 1.5 : 2.5;   // regime change half way
+        prices_b.push_back(b);
+        prices_a.push_back(beta * b + sin(i * 0.9) * 0.5);
+    }
+
+    AssetPair pair("A", "B", prices_a, prices_b);
+    pair.estimateRollingHedgeRatio(40);
+    const auto& betas = pair.getHedgeRatios();
+    REQUIRE(betas.size() == 200);
+
+    // Each estimate matches a direct OLS fit over its trailing window
+    for (size_t t : {39u, 80u, 150u, 199u}) {
+        std::vector<double> x(prices_b.begin() + (t - 39), prices_b.begin() + t + 1);
+        std::vector<double> y(prices_a.begin() + (t - 39), prices_a.begin() + t + 1);
+        REQUIRE(betas[t] == Approx(Utilities::linearRegression(x, y).beta).epsilon(1e-9));
+        REQUIRE(pair.getSpreads()[t] == Approx(prices_a[t] - betas[t] * prices_b[t]));
+    }
+    REQUIRE(betas[199] == Approx(2.5).epsilon(0.02));
+
+    // Streaming re-estimation replays the batch signals exactly
+    auto signals = pair.generateSignals(1.0, 0.0, 20);
+    AssetPair online("A", "B", 1.0);
+    online.startStreaming(1.0, 0.0, 20, 40);
+    for (size_t i = 0; i < prices_a.size(); ++i) {
+        REQUIRE(online.onBar(prices_a[i], prices_b[i]) == signals[i]);
+    }
+
+    // window 0 reverts to the static beta
+    pair.estimateRollingHedgeRatio(0);
+    REQUIRE(pair.getHedgeRatios().empty());
+}
+
+TEST_CASE("ADF test", "[utilities]") {
+    // AR(1) with coefficient 0.6 (stationary) and a random walk
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<double> stationary(400), walk(400);
+    stationary[0] = 5.0;
+    walk[0] = 5.0;
+    for (size_t t = 1; t < 400; ++t) {
+        stationary[t] = 5.0 + 0.6 * (stationary[t - 1] - 5.0) + noise(rng);
+        walk[t] = walk[t - 1] + noise(rng);
+    }
+
+    SECTION("Zero lags match the plain Dickey-Fuller regression") {
+        std::vector<double> lagged(stationary.begin(), stationary.end() - 1);
+        std::vector<double> diff(399);
+        for (size_t t = 1; t < 400; ++t) {
+            diff[t - 1] = stationary[t] - stationary[t - 1];
+        }
+        auto fit = Utilities::linearRegression(lagged, diff);
+        double ssr = 0.0;
+        for (double r : fit.residuals) {
+            ssr += r * r;
+        }
+        double meanLag = Utilities::mean(lagged);
+        double sxx = 0.0;
+        for (double v : lagged) {
+            sxx += (v - meanLag) * (v - meanLag);
+        }
+        double expected = fit.beta / std::sqrt(ssr / (399 - 2) / sxx);
+
+        auto result = Utilities::adfTest(stationary, 0);
+        REQUIRE(result.testStatistic == Approx(expected).epsilon(1e-9));
+        REQUIRE(result.lags == 0);
+    }
+
+    SECTION("Stationary and non-stationary series") {
+        auto good = Utilities::adfTest(stationary, 2);
+        auto bad = Utilities::adfTest(walk, 2);
+        REQUIRE(good.isStationary);
+        REQUIRE(good.pValue < 0.01);
+        REQUIRE_FALSE(bad.isStationary);
+        REQUIRE(bad.pValue > 0.05);
+        REQUIRE_FALSE(Utilities::adfTest(stationary, 2, 1e-12).isStationary);
+
+        auto selected = Utilities::adfTest(stationary, 8, 0.05, true);
+        REQUIRE(selected.lags >= 0);
+        REQUIRE(selected.lags <= 8);
+        REQUIRE(selected.isStationary);
+    }
+
+    SECTION("MacKinnon p-values") {
+        REQUIRE(Utilities::adfPValue(-2.86) == Approx(0.05).margin(0.002));
+        REQUIRE(Utilities::adfPValue(-3.43) == Approx(0.01).margin(0.001));
+        REQUIRE(Utilities::adfPValue(-1.0) > Utilities::adfPValue(-2.0));
+        REQUIRE(Utilities::adfPValue(5.0) == 1.0);
+        REQUIRE(Utilities::adfPValue(-25.0) == 0.0);
+    }
+
+    SECTION("Batch kernel matches the single-series test") {
+        const size_t lanes = Utilities::kAdfBatchLanes;
+        std::vector<double> interleaved(400 * lanes);
+        for (size_t l = 0; l < lanes; ++l) {
+            for (size_t t = 0; t < 400; ++t) {
+                interleaved[t * lanes + l] = (l % 2 == 0) ? stationary[t] * (1.0 + l) : walk[t] - l;
+            }
+        }
+        std::vector<Utilities::AdfResult> results(lanes);
+        Utilities::adfTestBatch(interleaved.data(), 400, lanes - 1, results.data(), 1);
+        for (size_t l = 0; l + 1 < lanes; ++l) {
+            std::vector<double> series(400);
+            for (size_t t = 0; t < 400; ++t) {
+                series[t] = interleaved[t * lanes + l];
+            }
+            auto single = Utilities::adfTest(series, 1);
+            REQUIRE(results[l].testStatistic == Approx(single.testStatistic).epsilon(1e-12));
+            REQUIRE(results[l].isStationary == single.isStationary);
+        }
+    }
+}
+
+TEST_CASE("Fused signal pass", "[asset_pair]") {
+    std::vector<double> prices_a, prices_b;
+    for (int i = 0; i < 300; ++i) {
+        double b = 40.0 + i * 0.05 + sin(i * 0.13) * 2.0;
+        prices_b.push_back(b);
+        prices_a.push_back(1.3 * b + sin(i * 0.41) * 1.5 + cos(i * 0.07));
+    }
+    AssetPair pair("A", "B", prices_a, prices_b);
+    pair.setCointegrationBeta(1.3);
+
+    for (size_t hedgeWindow : {0u, 50u}) {
+        pair.estimateRollingHedgeRatio(hedgeWindow);
+        for (size_t window : {2u, 20u, 299u, 1000u}) {
+            // Reference: materialised spread, rolling z-score, then thresholds
+            size_t used = window >= 300 ? 150 : window;
+            auto expectedZ = Utilities::rollingZScore(pair.getSpreads(), used);
+            auto expectedSignals = AssetPair::signalsFromZScores(expectedZ, 1.25, 0.25);
+
+            std::vector<AssetPair::Signal> signals(300);
+            std::vector<double> zScores(300);
+            pair.computeSignals(1.25, 0.25, window, signals.data(), zScores.data());
+            for (size_t i = 0; i < 300; ++i) {
+                if (std::isnan(expectedZ[i])) {
+                    REQUIRE(std::isnan(zScores[i]));
+                } else {
+                    REQUIRE(zScores[i] == expectedZ[i]);
+                }
+                REQUIRE(signals[i] == expectedSignals[i]);
+            }
+        }
+    }
+}
+
+TEST_CASE("Strategy policies", "[asset_pair]") {
+    SECTION("Branch-free threshold rule matches the branching state machine") {
+        std::mt19937 rng(5);
+        std::normal_distribution<double> noise(0.0, 1.5);
+        StrategyPolicies::ZScoreBands rule{1.25, 0.25};
+        int position = 0;
+        int reference = 0;
+        for (int i = 0; i < 5000; ++i) {
+            double z = (i % 17 == 0) ? std::numeric_limits<double>::quiet_NaN() : noise(rng);
+            if (i % 23 == 0) z = (i % 2) ? 0.25 : -1.25;   // exactly on a band
+            int expected = 0;
+            if (!std::isnan(z)) {
+                if (reference == 0) {
+                    if (z > 1.25) reference = -1;
+                    else if (z < -1.25) reference = 1;
+                } else if (reference == 1) {
+                    if (z >= -0.25) reference = 0;
+                } else if (z <= 0.25) {
+                    reference = 0;
+                }
+                expected = reference;
+            }
+            REQUIRE(rule.step(position, z) == expected);
+            REQUIRE(position == reference);
+        }
+    }
+
+    SECTION("Execution delay") {
+        using StrategyPolicies::NextBarExecution;
+        using StrategyPolicies::SameBarExecution;
+        REQUIRE(SameBarExecution::executionDay(5, 9) == 5);
+        REQUIRE(NextBarExecution::executionDay(5, 9) == 6);
+        REQUIRE(NextBarExecution::executionDay(9, 9) == 9);
+    }
+
+    SECTION("Hedge models give the same spreads as the pair") {
+        std::vector<double> betas = {1.0, 1.1, 1.2};
+        StrategyPolicies::StaticHedge fixed{1.3};
+        StrategyPolicies::RollingHedge rolling{betas.data()};
+        REQUIRE(fixed(2) == 1.3);
+        REQUIRE(rolling(1) == 1.1);
+    }
+}
+
+TEST_CASE("Parallel backtest modes", "[backtester]") {
+    std::ofstream test_file("parallel_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 40; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 200; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 40; ++s) {
+            test_file << "," << (60.0 + s + sin(i * (0.1 + 0.01 * s)) * (2.0 + s % 5) + i * 0.02 * (s % 3));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>("parallel_data.csv");
+    std::remove("parallel_data.csv");
+
+    // 38 pairs span several reduction chunks
+    auto build = [&]() {
+        auto backtester = std::make_unique<Backtester>(market_data);
+        backtester->setVerbose(false);
+        for (MarketData::SymbolId s = 0; s + 1 < 39; ++s) {
+            backtester->addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+        }
+        return backtester;
+    };
+
+    for (auto mode : {Backtester::ExecutionMode::SharedCapital, Backtester::ExecutionMode::FixedNotional}) {
+        auto reference = build();
+        reference->setExecutionMode(mode, 1);
+        reference->runBacktest(100000.0, 1.0, 0.0, 15, true);
+
+        for (size_t threads : {2u, 4u}) {
+            auto parallel = build();
+            parallel->setExecutionMode(mode, threads);
+            parallel->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(parallel->getPortfolioValues() == reference->getPortfolioValues());
+            REQUIRE(parallel->getTradeHistory() == reference->getTradeHistory());
+            REQUIRE(parallel->getPerformanceMetrics().sharpeRatio ==
+                    reference->getPerformanceMetrics().sharpeRatio);
+        }
+
+        // Final value = capital + realised P&L + unrealised P&L of the live book
+        const auto& values = reference->getPortfolioValues();
+        REQUIRE(values[0] == 100000.0);
+        REQUIRE_FALSE(reference->getTradeHistory().empty());
+        double expected = 100000.0;
+        for (const auto& trade : reference->getTradeHistory()) {
+            expected += trade.pnl;
+        }
+        for (const auto& position : reference->getOpenPositions()) {
+            expected += position.quantityA * (market_data->getPrices(position.symbolA).back() - position.entryPriceA)
+                      + position.quantityB * (market_data->getPrices(position.symbolB).back() - position.entryPriceB);
+        }
+        REQUIRE(values.back() == Approx(expected));
+        auto metrics = reference->getPerformanceMetrics();
+        REQUIRE(static_cast<size_t>(metrics.winCount + metrics.lossCount) ==
+                reference->getTradeHistory().size());
+    }
+}
+
+TEST_CASE("Online metrics", "[backtester]") {
+    SECTION("Merged accumulators match one pass") {
+        std::mt19937 rng(7);
+        std::normal_distribution<double> noise(0.0003, 0.01);
+        std::vector<double> values{100000.0};
+        for (int i = 1; i < 500; ++i) {
+            values.push_back(values.back() * (1.0 + noise(rng)));
+        }
+
+        MetricsAccumulator whole;
+        for (double value : values) {
+            whole.addValue(value);
+        }
+        whole.addTrade(120.0, 4);
+        whole.addTrade(-80.0, 9);
+        whole.addTrade(35.0, 2);
+
+        for (size_t split : {1u, 137u, 250u, 499u}) {
+            MetricsAccumulator head;
+            MetricsAccumulator tail;
+            for (size_t i = 0; i < values.size(); ++i) {
+                (i < split ? head : tail).addValue(values[i]);
+            }
+            head.addTrade(120.0, 4);
+            tail.addTrade(-80.0, 9);
+            tail.addTrade(35.0, 2);
+            head.merge(tail);
+
+            auto expected = whole.finish(100000.0);
+            auto merged = head.finish(100000.0);
+            REQUIRE(head.numValues() == values.size());
+            REQUIRE(merged.totalReturn == expected.totalReturn);
+            REQUIRE(merged.maxDrawdown == expected.maxDrawdown);
+            REQUIRE(merged.sharpeRatio == Approx(expected.sharpeRatio));
+            REQUIRE(merged.winCount == 2);
+            REQUIRE(merged.lossCount == 1);
+            REQUIRE(merged.avgHoldingPeriod == Approx(5.0));
+            REQUIRE(merged.avgWin == Approx(77.5));
+        }
+
+        MetricsAccumulator empty;
+        empty.merge(whole);
+        REQUIRE(empty.finish(100000.0).sharpeRatio == whole.finish(100000.0).sharpeRatio);
+    }
+
+    SECTION("Runs accumulate the metrics of their values and trades") {
+        std::ofstream test_file("online_data.csv");
+        test_file << "Date";
+        for (int s = 0; s < 10; ++s) test_file << ",S" << s;
+        test_file << "\n";
+        for (int i = 0; i < 180; ++i) {
+            test_file << "2020-01-" << (i + 1);
+            for (int s = 0; s < 10; ++s) {
+                test_file << "," << (60.0 + s + sin(i * (0.1 + 0.01 * s)) * (2.0 + s % 5) + i * 0.02 * (s % 3));
+            }
+            test_file << "\n";
+        }
+        test_file.close();
+        auto market_data = std::make_shared<MarketData>("online_data.csv");
+        std::remove("online_data.csv");
+
+        for (auto mode : {Backtester::ExecutionMode::Serial, Backtester::ExecutionMode::SharedCapital,
+                          Backtester::ExecutionMode::FixedNotional}) {
+            for (bool delayed : {true, false}) {
+                Backtester backtester(market_data);
+                backtester.setVerbose(false);
+                backtester.setExecutionMode(mode, 1);
+                for (MarketData::SymbolId s = 0; s + 1 < 10; ++s) {
+                    backtester.addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+                }
+                backtester.runBacktest(100000.0, 1.0, 0.0, 15, delayed);
+                REQUIRE_FALSE(backtester.getTradeHistory().empty());
+                auto online = backtester.getPerformanceMetrics();
+                auto batch = Backtester::computeMetrics(backtester.getPortfolioValues(),
+                                                        backtester.getTradeHistory(), 100000.0);
+                REQUIRE(online.totalReturn == batch.totalReturn);
+                REQUIRE(online.sharpeRatio == batch.sharpeRatio);
+                REQUIRE(online.maxDrawdown == batch.maxDrawdown);
+                REQUIRE(online.winCount == batch.winCount);
+                REQUIRE(online.avgWin == batch.avgWin);
+                REQUIRE(online.avgHoldingPeriod == batch.avgHoldingPeriod);
+                REQUIRE(backtester.getRunMetrics().numValues() == market_data->getDataSize());
+
+                // Without the value history only the summary is kept
+                backtester.setRecordValues(false);
+                backtester.runBacktest(100000.0, 1.0, 0.0, 15, delayed);
+                REQUIRE(backtester.getPortfolioValues().empty());
+                REQUIRE(backtester.getPerformanceMetrics().sharpeRatio == online.sharpeRatio);
+                REQUIRE(backtester.getPerformanceMetrics().maxDrawdown == online.maxDrawdown);
+            }
+        }
+    }
+}
+
+TEST_CASE("Early termination", "[backtester]") {
+    std::ofstream test_file("kill_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 10; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 240; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 10; ++s) {
+            double base = 60.0 + s + sin(i * (0.1 + 0.02 * (s / 2))) * (2.0 + s % 3);
+            test_file << "," << (base + sin(i * (0.7 + 0.05 * s)) * 0.3 + i * 0.03 * (s % 4));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>("kill_data.csv");
+    std::remove("kill_data.csv");
+    const size_t numDays = market_data->getDataSize();
+
+    auto build = [&](Backtester::ExecutionMode mode) {
+        auto backtester = std::make_unique<Backtester>(market_data);
+        backtester->setVerbose(false);
+        backtester->setExecutionMode(mode, 1);
+        for (MarketData::SymbolId s = 0; s + 1 < 10; ++s) {
+            backtester->addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+        }
+        return backtester;
+    };
+
+    SECTION("Kill criteria stop runs at the failing bar") {
+        for (auto mode : {Backtester::ExecutionMode::Serial, Backtester::ExecutionMode::SharedCapital,
+                          Backtester::ExecutionMode::FixedNotional}) {
+            auto full = build(mode);
+            full->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            const double drawdown = full->getPerformanceMetrics().maxDrawdown;
+            REQUIRE(drawdown > 0.0);
+
+            // A limit the run never breaches changes nothing
+            Backtester::KillCriteria loose;
+            loose.maxDrawdown = drawdown * 1.01;
+            auto kept = build(mode);
+            kept->setKillCriteria(loose);
+            kept->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE_FALSE(kept->wasPruned());
+            REQUIRE(kept->getPortfolioValues() == full->getPortfolioValues());
+            REQUIRE(kept->getPerformanceMetrics().sharpeRatio == full->getPerformanceMetrics().sharpeRatio);
+
+            // A tighter one stops on the first bar past it, with the same path up to there
+            Backtester::KillCriteria tight;
+            tight.maxDrawdown = drawdown * 0.5;
+            auto killed = build(mode);
+            killed->setKillCriteria(tight);
+            killed->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(killed->wasPruned());
+            const auto& values = killed->getPortfolioValues();
+            REQUIRE(values.size() == killed->getBarsRun());
+            REQUIRE(values.size() < numDays);
+            REQUIRE(std::equal(values.begin(), values.end(), full->getPortfolioValues().begin()));
+            REQUIRE(killed->getPerformanceMetrics().maxDrawdown > tight.maxDrawdown);
+            REQUIRE(Backtester::computeMetrics(std::vector<double>(values.begin(), values.end() - 1),
+                                               {}, 100000.0).maxDrawdown <= tight.maxDrawdown);
+            for (const auto& trade : killed->getTradeHistory()) {
+                REQUIRE(static_cast<size_t>(trade.exitDay) < values.size());
+            }
+            auto batch = Backtester::computeMetrics(values, killed->getTradeHistory(), 100000.0);
+            REQUIRE(killed->getPerformanceMetrics().winCount == batch.winCount);
+            REQUIRE(killed->getPerformanceMetrics().totalReturn == batch.totalReturn);
+        }
+    }
+
+    SECTION("Fixed-notional runs are cut at the stop") {
+        auto full = build(Backtester::ExecutionMode::FixedNotional);
+        full->runBacktest(100000.0, 1.0, 0.0, 15, true);
+        Backtester::KillCriteria tight;
+        tight.maxDrawdown = full->getPerformanceMetrics().maxDrawdown * 0.5;
+        CostModel costs;
+        costs.feeBps = 1.0;
+        costs.halfSpreadBps = 1.0;
+
+        for (bool costed : {false, true}) {
+            auto killed = build(Backtester::ExecutionMode::FixedNotional);
+            killed->setKillCriteria(tight);
+            if (costed) killed->setCostModel(costs);
+            killed->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(killed->wasPruned());
+            const int stopDay = static_cast<int>(killed->getBarsRun()) - 1;
+
+            // Trades closed by the stop survive, those spanning it are open there
+            std::vector<BacktestTrade> closed;
+            std::vector<std::pair<size_t, int>> open;
+            for (const auto& trade : full->getTradeHistory()) {
+                if (trade.exitDay <= stopDay) {
+                    closed.push_back(trade);
+                } else if (trade.entryDay <= stopDay) {
+                    open.emplace_back(trade.pairIndex, trade.entryDay);
+                }
+            }
+            for (const auto& position : full->getOpenPositions()) {
+                if (position.entryDay <= stopDay) open.emplace_back(position.pairIndex, position.entryDay);
+            }
+            std::vector<std::pair<size_t, int>> kept;
+            for (const auto& position : killed->getOpenPositions()) {
+                REQUIRE(position.entryDay <= stopDay);
+                kept.emplace_back(position.pairIndex, position.entryDay);
+            }
+            std::sort(open.begin(), open.end());
+            REQUIRE(kept == open);
+
+            auto run = killed->evaluateCosts(costs);
+            REQUIRE(run.portfolioValues.size() == killed->getBarsRun());
+            if (costed) {
+                REQUIRE(killed->getTradeHistory() == run.trades);
+            } else {
+                REQUIRE(killed->getTradeHistory() == closed);
+                REQUIRE(killed->getEquity() == Approx(killed->getPortfolioValues().back()));
+            }
+            double charged = 0.0;
+            for (double cost : run.tradeCosts) charged += cost;
+            for (const auto& position : killed->getOpenPositions()) {
+                charged += costs.fillCost(position.quantityA, position.entryPriceA, 0.0)
+                         + costs.fillCost(position.quantityB, position.entryPriceB, 0.0);
+            }
+            REQUIRE(run.totalCost == Approx(charged));
+        }
+    }
+
+    SECTION("Checkpoint tests") {
+        REQUIRE_FALSE(Backtester::KillCriteria().isSet());
+        Backtester::KillCriteria criteria;
+        REQUIRE(Backtester::KillCriteria::parse("checkpoint=40,trades=1000", criteria));
+        REQUIRE(criteria.isSet());
+        Backtester::KillCriteria rejected;
+        REQUIRE_FALSE(Backtester::KillCriteria::parse("sharpe=1", rejected));
+        REQUIRE_FALSE(Backtester::KillCriteria::parse("loss=1", rejected));
+
+        // T+1: the first valued bar is lookback + 1, the first checkpoint 40 bars later
+        for (auto mode : {Backtester::ExecutionMode::Serial, Backtester::ExecutionMode::FixedNotional}) {
+            auto run = build(mode);
+            run->setKillCriteria(criteria);
+            run->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(run->wasPruned());
+            REQUIRE(run->getBarsRun() == 15 + 1 + 40 + 1);
+
+            // Trades closed by each checkpoint count towards it in every mode
+            Backtester::KillCriteria active;
+            REQUIRE(Backtester::KillCriteria::parse("checkpoint=40,trades=1", active));
+            run->setKillCriteria(active);
+            run->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE_FALSE(run->wasPruned());
+            REQUIRE(run->getBarsRun() == numDays);
+        }
+
+        auto backtester = build(Backtester::ExecutionMode::Serial);
+        criteria = Backtester::KillCriteria();
+        criteria.checkpointBars = 40;
+        criteria.minSharpe = 1e9;
+        backtester->setKillCriteria(criteria);
+        backtester->runBacktest(100000.0, 1.0, 0.0, 15, true);
+        REQUIRE(backtester->getBarsRun() == 15 + 1 + 40 + 1);
+    }
+
+    SECTION("Pruned sweep points are flagged, the rest unchanged") {
+        std::vector<PairCandidate> pairs;
+        for (MarketData::SymbolId s = 0; s + 1 < 10; ++s) {
+            pairs.push_back(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+        }
+        ParameterSweep::Grid grid;
+        grid.entryThresholds = {0.5, 1.0, 1.5, 2.0};
+        grid.exitThresholds = {0.0, 0.5};
+        grid.lookbackWindows = {10, 20};
+
+        ParameterSweep::Options options;
+        options.initialCapital = 100000.0;
+        options.numThreads = 2;
+        auto expected = ParameterSweep(market_data, pairs, options).run(grid);
+
+        std::vector<double> drawdowns;
+        for (const auto& result : expected) {
+            drawdowns.push_back(result.metrics.maxDrawdown);
+        }
+        std::sort(drawdowns.begin(), drawdowns.end());
+        options.kill.maxDrawdown = drawdowns[drawdowns.size() / 2];
+        auto results = ParameterSweep(market_data, pairs, options).run(grid);
+
+        size_t pruned = 0;
+        for (size_t k = 0; k < results.size(); ++k) {
+            REQUIRE(results[k].pruned == (expected[k].metrics.maxDrawdown > options.kill.maxDrawdown));
+            if (results[k].pruned) {
+                ++pruned;
+                REQUIRE(results[k].barsRun < numDays);
+            } else {
+                REQUIRE(results[k].barsRun == numDays);
+                REQUIRE(results[k].metrics.sharpeRatio == expected[k].metrics.sharpeRatio);
+            }
+        }
+        REQUIRE(pruned > 0);
+    }
+
+    SECTION("Staged screening") {
+        PairScanner::Options options;
+        options.numThreads = 2;
+        options.blockSize = 3;
+        auto expected = PairScanner(market_data, options).scan();
+        REQUIRE_FALSE(expected.empty());
+
+        // A prefix threshold every pair passes leaves the result unchanged
+        options.prescreenBars = 80;
+        options.prescreenStatistic = std::numeric_limits<double>::infinity();
+        PairScanner open(market_data, options);
+        auto all = open.scan();
+        REQUIRE(open.getPairsPruned() == 0);
+        REQUIRE(all.size() == expected.size());
+        for (size_t k = 0; k < all.size(); ++k) {
+            REQUIRE(all[k].symbolB == expected[k].symbolB);
+            REQUIRE(all[k].adfStatistic == expected[k].adfStatistic);
+        }
+
+        // A strict one prunes, and what is left is a subset with full-length statistics
+        options.prescreenStatistic = -3.0;
+        PairScanner staged(market_data, options);
+        auto survivors = staged.scan();
+        REQUIRE(staged.getPairsPruned() > 0);
+        REQUIRE(staged.getPairsTested() == 45);
+        for (const auto& pair : survivors) {
+            auto match = std::find_if(expected.begin(), expected.end(), [&](const PairCandidate& c) {
+                return c.symbolA == pair.symbolA && c.symbolB == pair.symbolB;
+            });
+            REQUIRE(match != expected.end());
+            REQUIRE(match->adfStatistic == pair.adfStatistic);
+        }
+
+        // On a universe large enough to fill both batches, the survivors are
+        // exactly the cointegrated pairs whose prefix clears the threshold
+        std::ofstream wide_file("staged_data.csv");
+        wide_file << "Date";
+        for (int s = 0; s < 101; ++s) wide_file << ",S" << s;
+        wide_file << "\n";
+        // A common factor plus, on most symbols, an idiosyncratic random walk
+        std::mt19937 rng(11);
+        std::normal_distribution<double> step(0.0, 0.15);
+        std::vector<double> drift(101, 0.0);
+        for (int i = 0; i < 320; ++i) {
+            wide_file << "2020-01-" << (i + 1);
+            const double factor = 50.0 + sin(i * 0.05) * 5.0 + i * 0.02;
+            for (int s = 0; s < 101; ++s) {
+                drift[s] += step(rng) * (s % 4);
+                wide_file << "," << (factor * (1.0 + 0.002 * s) + drift[s] + sin(i * (0.3 + 0.013 * s) + s) * 0.5);
+            }
+            wide_file << "\n";
+        }
+        wide_file.close();
+        auto wide = std::make_shared<MarketData>("staged_data.csv");
+        std::remove("staged_data.csv");
+
+        PairScanner::Options wideOptions;
+        wideOptions.numThreads = 2;
+        auto cointegrated = PairScanner(wide, wideOptions).scan();
+        wideOptions.prescreenBars = 200;
+        wideOptions.prescreenStatistic = -1.0;
+        PairScanner wideStaged(wide, wideOptions);
+        auto kept = wideStaged.scan();
+
+        std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> reference;
+        std::vector<double> spread;
+        for (const auto& pair : cointegrated) {
+            auto prefix = AssetPair::evaluateSpread(wide->getPrices(pair.symbolA).first(200),
+                                                    wide->getPrices(pair.symbolB).first(200),
+                                                    pair.beta, spread, wideOptions.significanceLevel);
+            if (prefix.adfStatistic < wideOptions.prescreenStatistic) {
+                reference.emplace_back(pair.symbolA, pair.symbolB);
+            }
+        }
+        std::vector<std::pair<MarketData::SymbolId, MarketData::SymbolId>> survivorSet;
+        for (const auto& pair : kept) {
+            survivorSet.emplace_back(pair.symbolA, pair.symbolB);
+        }
+        std::sort(reference.begin(), reference.end());
+        std::sort(survivorSet.begin(), survivorSet.end());
+        INFO(cointegrated.size() << " cointegrated, " << wideStaged.getPairsPruned() << " pruned");
+        REQUIRE(wideStaged.getPairsPruned() > 0);
+        REQUIRE(survivorSet.size() > 2 * Utilities::kAdfBatchLanes);
+        REQUIRE(survivorSet == reference);
+    }
+}
+
+TEST_CASE("Transaction costs", "[backtester]") {
+    SECTION("Fill cost and spec parsing") {
+        CostModel costs;
+        REQUIRE(costs.isFree());
+        REQUIRE(CostModel::parse("commission=0.01,fee=1,spread=2,impact=10,adv=1000", costs));
+        // 100 shares at 50: 1.00 commission + 5000 * (1 + 2 + 10 * 0.1) bps
+        REQUIRE(costs.fillCost(-100.0, 50.0, costs.volumeOf(0)) == Approx(1.0 + 2.0));
+        REQUIRE(costs.fillCost(100.0, 50.0, 0.0) == Approx(1.0 + 1.5));
+        costs.symbolVolumes = {0.0, 100.0};
+        REQUIRE(costs.volumeOf(0) == 1000.0);
+        REQUIRE(costs.volumeOf(1) == 100.0);
+        REQUIRE(costs.scaled(2.0).fillCost(100.0, 50.0, 0.0) == Approx(5.0));
+        REQUIRE(costs.scaled(0.0).isFree());
+
+        REQUIRE_FALSE(CostModel::parse("slippage=1", costs));
+        REQUIRE_FALSE(CostModel::parse("fee=-1", costs));
+    }
+
+    std::ofstream test_file("cost_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 8; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 200; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 8; ++s) {
+            test_file << "," << (60.0 + s + sin(i * (0.1 + 0.01 * s)) * (2.0 + s % 5) + i * 0.02 * (s % 3));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>("cost_data.csv");
+    std::remove("cost_data.csv");
+
+    auto build = [&](Backtester::ExecutionMode mode) {
+        auto backtester = std::make_unique<Backtester>(market_data);
+        backtester->setVerbose(false);
+        backtester->setExecutionMode(mode, 1);
+        for (MarketData::SymbolId s = 0; s + 1 < 8; ++s) {
+            backtester->addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+        }
+        return backtester;
+    };
+    CostModel costs;
+    costs.commissionPerShare = 0.005;
+    costs.halfSpreadBps = 2.0;
+    costs.impactBps = 20.0;
+    costs.averageVolume = 5000.0;
+
+    SECTION("Re-pricing matches a costed run") {
+        for (auto mode : {Backtester::ExecutionMode::Serial, Backtester::ExecutionMode::FixedNotional}) {
+            auto free = build(mode);
+            free->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(free->getTotalCosts() == 0.0);
+            REQUIRE_FALSE(free->getTradeHistory().empty());
+
+            auto run = free->evaluateCosts(costs);
+            auto costed = build(mode);
+            costed->setCostModel(costs);
+            costed->runBacktest(100000.0, 1.0, 0.0, 15, true);
+            REQUIRE(costed->getPortfolioValues() == run.portfolioValues);
+            REQUIRE(costed->getTradeHistory() == run.trades);
+            REQUIRE(costed->getTotalCosts() == run.totalCost);
+            REQUIRE(costed->getPerformanceMetrics().sharpeRatio == run.metrics.sharpeRatio);
+
+            // Re-pricing starts from the gross fills, whatever the run was charged
+            REQUIRE(costed->evaluateCosts(CostModel()).portfolioValues == free->getPortfolioValues());
+
+            // Every fill pays, so net P&L and equity only fall
+            REQUIRE(run.totalCost > 0.0);
+            double charged = 0.0;
+            for (size_t k = 0; k < run.trades.size(); ++k) {
+                REQUIRE(run.tradeCosts[k] > 0.0);
+                REQUIRE(run.trades[k].pnl == Approx(free->getTradeHistory()[k].pnl - run.tradeCosts[k]));
+                charged += run.tradeCosts[k];
+            }
+            for (const auto& position : free->getOpenPositions()) {
+                charged += costs.fillCost(position.quantityA, position.entryPriceA, costs.averageVolume)
+                         + costs.fillCost(position.quantityB, position.entryPriceB, costs.averageVolume);
+            }
+            REQUIRE(run.totalCost == Approx(charged));
+            REQUIRE(run.portfolioValues.back() == Approx(free->getPortfolioValues().back() - charged));
+            for (size_t day = 0; day < run.portfolioValues.size(); ++day) {
+                REQUIRE(run.portfolioValues[day] <= free->getPortfolioValues()[day]);
+            }
+        }
+    }
+
+    SECTION("Costs scale with the model") {
+        auto backtester = build(Backtester::ExecutionMode::FixedNotional);
+        backtester->runBacktest(100000.0, 1.0, 0.0, 15, true);
+        CostModel linear = costs;
+        linear.impactBps = 0.0;
+        double base = backtester->evaluateCosts(linear).totalCost;
+        REQUIRE(backtester->evaluateCosts(linear.scaled(3.0)).totalCost == Approx(3.0 * base));
+        REQUIRE(backtester->evaluateCosts(linear.scaled(0.0)).totalCost == 0.0);
+        REQUIRE(backtester->evaluateCosts(costs).metrics.totalReturn <
+                backtester->getPerformanceMetrics().totalReturn);
+    }
+
+    SECTION("Nothing to re-price without recorded values") {
+        auto backtester = build(Backtester::ExecutionMode::Serial);
+        backtester->setRecordValues(false);
+        backtester->runBacktest(100000.0, 1.0, 0.0, 15, true);
+        REQUIRE_FALSE(backtester->getTradeHistory().empty());
+        auto run = backtester->evaluateCosts(costs);
+        REQUIRE(run.portfolioValues.empty());
+        REQUIRE(run.trades.empty());
+        REQUIRE(run.totalCost == 0.0);
+    }
+}
+
+TEST_CASE("Streaming backtest", "[backtester]") {
+    std::ofstream test_file("stream_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 6; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 150; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 6; ++s) {
+            test_file << "," << (50.0 + s + sin(i * (0.15 + 0.02 * s)) * (1.5 + s) + i * 0.03 * (s % 2));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+    auto market_data = std::make_shared<MarketData>();
+    REQUIRE(market_data->loadFromCSV("stream_data.csv"));
+
+    SECTION("Chunks cover every bar and carry the previous one") {
+        MarketDataStream stream(64);
+        REQUIRE(stream.open("stream_data.csv"));
+        REQUIRE(stream.getDataSize() == 150);
+        REQUIRE(stream.getNumSymbols() == 6);
+        size_t bars = 0;
+        while (stream.nextChunk()) {
+            REQUIRE(stream.getChunkBegin() == bars);
+            for (size_t day = stream.getChunkBegin(); day < stream.getChunkEnd(); ++day) {
+                REQUIRE(stream.getPrice(3, day) == market_data->getPrice(3, day));
+                REQUIRE(stream.getTimestamp(day) == market_data->getTimestamps()[day]);
+            }
+            if (bars > 0) {
+                REQUIRE(stream.getPrice(3, bars - 1) == market_data->getPrice(3, bars - 1));
+            }
+            bars = stream.getChunkEnd();
+        }
+        REQUIRE(bars == 150);
+    }
+
+    SECTION("Matches the in-memory run") {
+        for (size_t hedgeWindow : {0u, 40u}) {
+            for (bool delayed : {true, false}) {
+                Backtester reference(market_data);
+                reference.setVerbose(false);
+                reference.setHedgeRatioWindow(hedgeWindow);
+                for (MarketData::SymbolId s = 0; s + 1 < 6; ++s) {
+                    reference.addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+                }
+                reference.runBacktest(100000.0, 1.0, 0.0, 15, delayed);
+                REQUIRE_FALSE(reference.getTradeHistory().empty());
+
+                for (size_t chunk : {1u, 7u, 1000u}) {
+                    auto stream = std::make_shared<MarketDataStream>(chunk);
+                    REQUIRE(stream->open("stream_data.csv"));
+                    Backtester streamed(stream);
+                    streamed.setVerbose(false);
+                    streamed.setHedgeRatioWindow(hedgeWindow);
+                    for (int s = 0; s + 1 < 6; ++s) {
+                        streamed.addPair("S" + std::to_string(s), "S" + std::to_string(s + 1), 0.9);
+                    }
+                    streamed.runBacktest(100000.0, 1.0, 0.0, 15, delayed);
+                    REQUIRE(streamed.getPortfolioValues() == reference.getPortfolioValues());
+                    REQUIRE(streamed.getTradeHistory() == reference.getTradeHistory());
+                    REQUIRE(streamed.getOpenPositions().size() == reference.getOpenPositions().size());
+                }
+            }
+        }
+    }
+    std::remove("stream_data.csv");
+
+    SECTION("Gaps are carried over as in the in-memory run") {
+        // S1 misses a bar inside a chunk, S2 the first bar of one, S3 its first prices
+        std::ofstream gappy_file("stream_gappy.csv");
+        gappy_file << "Date";
+        for (int s = 0; s < 4; ++s) gappy_file << ",S" << s;
+        gappy_file << "\n";
+        for (int i = 0; i < 150; ++i) {
+            gappy_file << "2020-01-" << (i + 1);
+            for (int s = 0; s < 4; ++s) {
+                const bool missing = (s == 1 && (i == 40 || i == 90)) || (s == 2 && i == 64) || (s == 3 && i < 3);
+                gappy_file << ",";
+                if (!missing) gappy_file << (50.0 + s + sin(i * (0.15 + 0.02 * s)) * (1.5 + s));
+            }
+            gappy_file << "\n";
+        }
+        gappy_file.close();
+        auto gappy = std::make_shared<MarketData>();
+        REQUIRE(gappy->loadFromCSV("stream_gappy.csv"));
+
+        Backtester reference(gappy);
+        reference.setVerbose(false);
+        reference.setHedgeRatioWindow(40);
+        for (MarketData::SymbolId s = 0; s + 1 < 4; ++s) {
+            reference.addPair(PairCandidate{s, static_cast<MarketData::SymbolId>(s + 1), 0.9, 0.0, 0.0});
+        }
+        reference.runBacktest(100000.0, 1.0, 0.0, 15, true);
+
+        auto stream = std::make_shared<MarketDataStream>(32);
+        REQUIRE(stream->open("stream_gappy.csv"));
+        Backtester streamed(stream);
+        streamed.setVerbose(false);
+        streamed.setHedgeRatioWindow(40);
+        for (int s = 0; s + 1 < 4; ++s) {
+            streamed.addPair("S" + std::to_string(s), "S" + std::to_string(s + 1), 0.9);
+        }
+        streamed.runBacktest(100000.0, 1.0, 0.0, 15, true);
+        std::remove("stream_gappy.csv");
+
+        REQUIRE(streamed.getPortfolioValues() == reference.getPortfolioValues());
+        REQUIRE(streamed.getTradeHistory() == reference.getTradeHistory());
+        // The pair with gaps in both legs keeps trading after the last of them
+        REQUIRE(std::any_of(streamed.getTradeHistory().begin(), streamed.getTradeHistory().end(),
+                            [](const BacktestTrade& trade) { return trade.pairIndex == 1 && trade.entryDay > 90; }));
+    }
+}
+
+TEST_CASE("Live trading", "[live]") {
+    SECTION("SPSC queue is bounded and keeps order across threads") {
+        SpscQueue<int> queue(5);
+        REQUIRE(queue.capacity() == 8);
+        int value = -1;
+        REQUIRE_FALSE(queue.tryPop(value));
+        for (int i = 0; i < 8; ++i) {
+            REQUIRE(queue.tryPush(i));
+        }
+        REQUIRE_FALSE(queue.tryPush(8));
+        REQUIRE(queue.tryPop(value));
+        REQUIRE(value == 0);
+        REQUIRE(queue.tryPush(8));
+        REQUIRE(queue.size() == 8);
+        for (int i = 1; i <= 8; ++i) {
+            REQUIRE(queue.tryPop(value));
+            REQUIRE(value == i);
+        }
+        REQUIRE_FALSE(queue.tryPop(value));
+
+        constexpr int kItems = 200000;
+        std::thread producer([&] {
+            for (int i = 0; i < kItems; ++i) {
+                while (!queue.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        bool ordered = true;
+        for (int expected = 0; expected < kItems; ) {
+            if (queue.tryPop(value)) {
+                ordered = ordered && value == expected;
+                ++expected;
+            }
+        }
+        producer.join();
+        REQUIRE(ordered);
+    }
+
+    SECTION("Latency histogram percentiles are within one bucket") {
+        LatencyHistogram histogram;
+        REQUIRE(histogram.percentile(0.5) == 0);
+        for (int64_t nanos = 1; nanos <= 10000; ++nanos) {
+            histogram.record(nanos);
+        }
+        REQUIRE(histogram.count() == 10000);
+        REQUIRE(histogram.min() == 1);
+        REQUIRE(histogram.max() == 10000);
+        REQUIRE(histogram.mean() == Approx(5000.5));
+        for (double q : {0.01, 0.5, 0.9, 0.99}) {
+            const double exact = q * 10000;
+            REQUIRE(histogram.percentile(q) >= exact);
+            REQUIRE(histogram.percentile(q) <= exact * 1.125);
+        }
+        REQUIRE(histogram.percentile(1.0) == 10000);
+
+        // Exact below 16 ns; negative stamps count as 0
+        LatencyHistogram small;
+        small.record(7);
+        small.record(-3);
+        REQUIRE(small.percentile(0.5) == 0);
+        REQUIRE(small.percentile(1.0) == 7);
+        small.merge(histogram);
+        REQUIRE(small.count() == 10002);
+        REQUIRE(small.min() == 0);
+        REQUIRE(small.max() == 10000);
+    }
+
+    std::ofstream test_file("live_data.csv");
+    test_file << "Date";
+    for (int s = 0; s < 6; ++s) test_file << ",S" << s;
+    test_file << "\n";
+    for (int i = 0; i < 150; ++i) {
+        test_file << "2020-01-" << (i + 1);
+        for (int s = 0; s < 6; ++s) {
+            test_file << "," << (50.0 + s + sin(i * (0.15 + 0.02 * s)) * (1.5 + s) + i * 0.03 * (s % 2));
+        }
+        test_file << "\n";
+    }
+    test_file.close();
+
+    LiveTrader::Options options;
+    options.initialCapital = 100000.0;
+    options.entryThreshold = 1.0;
+    options.lookbackWindow = 15;
+
+    SECTION("Replaying a history matches the streaming run") {
+        for (size_t hedgeWindow : {0u, 40u}) {
+            for (bool delayed : {true, false}) {
+                auto stream = std::make_shared<MarketDataStream>(32);
+                REQUIRE(stream->open("live_data.csv"));
+                Backtester streamed(stream);
+                streamed.setVerbose(false);
+                streamed.setHedgeRatioWindow(hedgeWindow);
+
+                // A tiny feed queue makes the feed wait on the strategy and reuse bar slots
+                CsvFeed feed(2);
+                REQUIRE(feed.open("live_data.csv"));
+                options.hedgeWindow = hedgeWindow;
+                options.delayedExecution = delayed;
+                LiveTrader trader(feed.getSymbols(), options);
+                trader.getBacktester().setVerbose(false);
+                for (int s = 0; s + 1 < 6; ++s) {
+                    streamed.addPair("S" + std::to_string(s), "S" + std::to_string(s + 1), 0.9);
+                    REQUIRE(trader.addPair("S" + std::to_string(s), "S" + std::to_string(s + 1), 0.9));
+                }
+                REQUIRE_FALSE(trader.addPair("S0", "missing", 1.0));
+                streamed.runBacktest(100000.0, 1.0, 0.0, 15, delayed);
+
+                std::vector<OrderIntent> intents;
+                trader.run(feed, [&](const OrderIntent& intent) { intents.push_back(intent); });
+                REQUIRE(feed.getBarsRead() == 150);
+                REQUIRE_FALSE(feed.failed());
+
+                const Backtester& book = trader.getBacktester();
+                const auto live = book.getPerformanceMetrics();
+                const auto reference = streamed.getPerformanceMetrics();
+                REQUIRE(live.totalReturn == reference.totalReturn);
+                REQUIRE(live.sharpeRatio == reference.sharpeRatio);
+                REQUIRE(live.maxDrawdown == reference.maxDrawdown);
+                REQUIRE(live.winCount == reference.winCount);
+                REQUIRE(live.lossCount == reference.lossCount);
+                REQUIRE(live.avgHoldingPeriod == reference.avgHoldingPeriod);
+                REQUIRE(book.getOpenPositions().size() == streamed.getOpenPositions().size());
+                REQUIRE(book.getTradeHistory().empty());
+
+                // One intent per target change, in bar order; the last one per pair is the final book
+                REQUIRE(intents.size() == trader.getIntents());
+                REQUIRE(trader.getTickToSignal().count() == 150);
+                REQUIRE(trader.getTickToOrder().count() == intents.size());
+                std::vector<int> last(book.getNumPairs(), 0);
+                for (size_t i = 0; i < intents.size(); ++i) {
+                    REQUIRE(intents[i].direction != last[intents[i].pairIndex]);
+                    last[intents[i].pairIndex] = intents[i].direction;
+                    REQUIRE((i == 0 || intents[i].bar >= intents[i - 1].bar));
+                    REQUIRE((intents[i].direction == 0) == (intents[i].quantityA == 0.0));
+                    REQUIRE(intents[i].timestamp == Timestamps::kNanosPerDay * (18262 + static_cast<int64_t>(intents[i].bar)));
+                }
+                for (size_t p = 0; p < book.getNumPairs(); ++p) {
+                    REQUIRE(last[p] == book.getCurrentPosition(p));
+                }
+            }
+        }
+    }
+
+    SECTION("The strategy loop does not allocate") {
+        CsvFeed feed(8);
+        REQUIRE(feed.open("live_data.csv"));
+        options.orderQueueCapacity = 4096;
+        LiveTrader trader(feed.getSymbols(), options);
+        trader.getBacktester().setVerbose(false);
+        trader.getBacktester().setHedgeRatioWindow(40);
+        for (int s = 0; s + 1 < 6; ++s) {
+            trader.addPair("S" + std::to_string(s), "S" + std::to_string(s + 1), 0.9);
+        }
+
+        // The counter sees allocations at all
+        Profiler::setEnabled(true);
+        const size_t probe = allocationCount();
+        ::operator delete(::operator new(sizeof(int)));
+        REQUIRE(allocationCount() > probe);
+
+        trader.start();
+        std::thread feedThread([&] { feed.run(); });
+        const size_t before = allocationCount();
+        trader.processFeed(feed);
+        const size_t after = allocationCount();
+        feedThread.join();
+        Profiler::setEnabled(false);
+        trader.finish();
+
+        REQUIRE(after == before);
+        REQUIRE(trader.getIntents() > 0);
+        REQUIRE(trader.getIntents() == trader.getOrders().size());
+        REQUIRE(trader.getBacktester().getRunMetrics().numTrades() > 0);
+    }
+    std::remove("live_data.csv");
+}
+
+TEST_CASE("Profiler", "[profiler]") {
+    Profiler::setEnabled(true);
+    Profiler::reset();
+    {
+        Profiler::ScopedTimer outer("test::outer");
+        for (int i = 0; i < 3; ++i) {
+            Profiler::ScopedTimer inner("test::inner");
+        }
+    }
+    Profiler::addCounter(Profiler::Counter::PairsTested, 10);
+    Profiler::addCounter(Profiler::Counter::PairsTested, 5);
+
+    auto phases = Profiler::phaseSummary();
+    REQUIRE(phases.size() == 2);
+    REQUIRE(phases[0].name == "test::outer");
+    REQUIRE(phases[0].calls == 1);
+    REQUIRE(phases[1].name == "test::inner");
+    REQUIRE(phases[1].calls == 3);
+    REQUIRE(phases[0].totalMs >= phases[1].totalMs);
+    REQUIRE(Profiler::getCounter(Profiler::Counter::PairsTested) == 15);
+
+    REQUIRE(Profiler::writeChromeTrace("profile_trace.json"));
+    std::ifstream trace("profile_trace.json");
+    std::string contents((std::istreambuf_iterator<char>(trace)), std::istreambuf_iterator<char>());
+    trace.close();
+    std::remove("profile_trace.json");
+    REQUIRE(contents.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(contents.find("\"name\":\"test::inner\",\"ph\":\"X\"") != std::string::npos);
+    REQUIRE(contents.find("\"pairs_tested\":15") != std::string::npos);
+
+    // Nothing is recorded while disabled
+    Profiler::setEnabled(false);
+    Profiler::reset();
+    {
+        Profiler::ScopedTimer ignored("test::disabled");
+    }
+    Profiler::addCounter(Profiler::Counter::PairsTested, 1);
+    REQUIRE(Profiler::phaseSummary().empty());
+    REQUIRE(Profiler::getCounter(Profiler::Counter::PairsTested) == 0);
+}